@@ -14,6 +14,7 @@
 #include "Component.h"
 #include <imgui.h>
 #include "ResourceManager.h"
+#include "ProceduralMesh.h"
 #include "Utils.h"
 #include "MeshComponent.h"
 #include "SpriteComponent.h"
@@ -53,13 +54,13 @@ void DemoApplication::LoadPongScene()
 	auto pMaterialManager = MaterialManager::GetInstance();
 	pMaterialManager->AddMaterial("default", new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx", "default"));
 	pMaterialManager->GetMaterial("default")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/uv_grid_2.png"));
 
 	auto pDefaultMaterial = PxGetPhysics().createMaterial(.5f, .5f, 1.f);
 	auto pRigidBody = new RigidBodyComponent(false);
 	pRigidBody->SetKinematic(true);
 	auto pPlayer = new GameObject("Player", DirectX::XMFLOAT3{ 0.f, -2.f, 0.f });
-	pPlayer->AddComponent(new MeshComponent(CreateCube(0.5, 0.1f, 0.5f)));
+	pPlayer->AddComponent(new MeshComponent(ProceduralMesh::CreateBox(0.5f, 0.1f, 0.5f)));
 	pPlayer->AddComponent(pRigidBody);
 	pRigidBody->AddCollider(physx::PxBoxGeometry{ 0.25f, 0.05f, 0.25f }, *pDefaultMaterial, true);
 
@@ -80,7 +81,7 @@ void DemoApplication::LoadPongScene()
 			auto pBrick = new GameObject("Grid", DirectX::XMFLOAT3{static_cast<float>(i), static_cast<float>(j) * 0.5f, 0.f});
 			pRigidBody = new RigidBodyComponent(true);
 
-			pBrick->AddComponent(new MeshComponent(CreateCube(0.5, 0.1f, 0.5f)));
+			pBrick->AddComponent(new MeshComponent(ProceduralMesh::CreateBox(0.5f, 0.1f, 0.5f)));
 			pBrick->AddComponent(pRigidBody);
 			pRigidBody->AddCollider(physx::PxBoxGeometry{ 0.25f, 0.05f, 0.25f }, *pDefaultMaterial, true);
 
@@ -96,7 +97,7 @@ void DemoApplication::LoadPongScene()
 	pRigidBody = new RigidBodyComponent(false);
 	pRigidBody->SetKinematic(true);
 	auto pBall = new GameObject("Ball", DirectX::XMFLOAT3{0,-1,0});
-	pBall->AddComponent(new MeshComponent(CreateSphere(0.1f, 10)));
+	pBall->AddComponent(new MeshComponent(ProceduralMesh::CreateSphere(0.1f, 10, 10)));
 	pBall->AddComponent(pRigidBody);
 	pRigidBody->AddCollider(physx::PxSphereGeometry(0.1f), *pDefaultMaterial, false);
 
@@ -114,7 +115,7 @@ void DemoApplication::LoadBaseScene()
 
 	pMaterialManager->AddMaterial("default", new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx", "default"));
 	pMaterialManager->GetMaterial("default")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/uv_grid_2.png"));
 
 	RECT rect;
 	GetWindowRect(MyEngine::GetSingleton()->GetWindowHandle(), &rect);
@@ -180,13 +181,13 @@ void DemoApplication::LoadBaseScene()
 	terrainObject->AddComponent(new TerrainComponent(64, 64));
 
 	pMaterialManager->GetMaterial("lambert8SG")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/T_BarrelAndBanjo_BC_01.jpg", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/T_BarrelAndBanjo_BC_01.jpg"));
 	pMaterialManager->GetMaterial("lambert5SG")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/T_Distillery_BC_01.jpg", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/T_Distillery_BC_01.jpg"));
 	pMaterialManager->GetMaterial("lambert9SG")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/T_Shotgun_BC_01.jpg", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/T_Shotgun_BC_01.jpg"));
 	pMaterialManager->GetMaterial("lambert10SG")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/T_ChairAndFirepit_BC_01.jpg", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/T_ChairAndFirepit_BC_01.jpg"));
 	pMaterialManager->GetMaterial("DAE2_RickAstley_Assignment1_000_aiStandardSurface1SG1")->SetDiffuseMap(
-		new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png", MyEngine::GetSingleton()->GetDeviceContext()));
+		ResourceManager::GetInstance()->LoadTextureAsync("Resources/uv_grid_2.png"));
 }
@@ -1,6 +1,10 @@
 // Input/Output structs
 
 float4x4 gWorldViewProj : WorldViewProjection;
+
+// Quantized positions are relative to the mesh bounds
+float3 gPositionOffset = float3(0.f, 0.f, 0.f);
+float3 gPositionScale = float3(1.f, 1.f, 1.f);
 float4x4 gWorldMatrix : WORLD;
 float4x4 gViewInverseMatrix : VIEWINVERSE;
 
@@ -36,7 +40,16 @@ struct VS_INPUT
 {
 	float3 Position : POSITION;
 	float3 Normal : NORMAL;
-	float3 Tangent : TANGENT;
+	float4 Tangent : TANGENT; // w is the handedness of the bitangent
+	float2 TexCoord : TEXCOORD;
+};
+
+// Matches QuantizedVertex in VertexFormat.h
+struct VS_INPUT_QUANTIZED
+{
+	float4 Position : POSITION;
+	float2 Normal : NORMAL;
+	float2 Tangent : TANGENT;
 	float2 TexCoord : TEXCOORD;
 };
 
@@ -45,7 +58,7 @@ struct VS_OUTPUT
 	float4 Position : SV_POSITION;
 	float4 WorldPosition : COLOR;
 	float3 Normal : NORMAL;
-	float3 Tangent : TANGENT;
+	float4 Tangent : TANGENT;
 	float2 TexCoord : TEXCOORD;
 };
 
@@ -104,7 +117,7 @@ VS_OUTPUT VS(VS_INPUT input)
 	output.Position = mul(float4(input.Position, 1.f), gWorldViewProj);
 	output.WorldPosition = mul(float4(input.Position, 1.f), gWorldMatrix);
 	output.Normal = mul(normalize(input.Normal), (float3x3)gWorldMatrix);
-	output.Tangent = mul(normalize(input.Tangent), (float3x3)gWorldMatrix);
+	output.Tangent = float4(mul(normalize(input.Tangent.xyz), (float3x3)gWorldMatrix), input.Tangent.w);
 	output.TexCoord = input.TexCoord;
 	return output;
 }
@@ -159,17 +172,36 @@ float4 CalcPointLight(int index, float3 normal, VS_OUTPUT input)
 	return diffuse + phongSpecularReflection;
 }
 
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.f ? -fold : fold;
+	return normalize(direction);
+}
+
+VS_OUTPUT VSQuantized(VS_INPUT_QUANTIZED input)
+{
+	VS_INPUT decoded = (VS_INPUT)0;
+	decoded.Position = gPositionOffset + input.Position.xyz * gPositionScale;
+	decoded.Normal = DecodeOctahedral(input.Normal);
+	decoded.Tangent = float4(DecodeOctahedral(input.Tangent), input.Position.w * 2.f - 1.f);
+	decoded.TexCoord = input.TexCoord;
+	return VS(decoded);
+}
+
 // Pixel Shader
 float4 PS(VS_OUTPUT input) : SV_TARGET
 {
 	// Get normalmap transform matrix
-	float3 binormal = cross(input.Tangent, input.Normal);
-	float3x3 tangentSpaceAxis = float3x3( input.Tangent, binormal, input.Normal );
+	float3 binormal = cross(input.Tangent.xyz, input.Normal) * input.Tangent.w;
+	float3x3 tangentSpaceAxis = float3x3( input.Tangent.xyz, binormal, input.Normal );
 	
 	SamplerState samplerState = pointSampler;
-	float4 uvColor = gNormalMap.Sample(samplerState, input.TexCoord);
+	float2 normalXY = 2.f * gNormalMap.Sample(samplerState, input.TexCoord).xy - 1.f;
     
-	float3 normal = ( 2.f * uvColor - 1.f).xyz;
+	// Z is rebuilt from X and Y, cooked normal maps are BC5 and only keep those two
+	float3 normal = float3(normalXY, sqrt(saturate(1.f - dot(normalXY, normalXY))));
 	normal = normalize(mul(normal, tangentSpaceAxis));
 
 	float4 finalColor;
@@ -192,4 +224,17 @@ technique11 DefaultTechnique
 		SetGeometryShader( NULL );
 		SetPixelShader( CompileShader( ps_5_0, PS() ));
 	}
-};
\ No newline at end of file
+};
+
+technique11 QuantizedTechnique
+{
+	pass P0
+	{
+		SetRasterizerState(gRasterizerState);
+		SetDepthStencilState(gDepthStencilState, 0);
+		SetBlendState(gBlendState, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+		SetVertexShader( CompileShader( vs_5_0, VSQuantized() ));
+		SetGeometryShader( NULL );
+		SetPixelShader( CompileShader( ps_5_0, PS() ));
+	}
+};
@@ -1,12 +1,25 @@
 float4x4 gWorldViewProj : WorldViewProjection;
 
+// Quantized positions are relative to the mesh bounds
+float3 gPositionOffset = float3(0.f, 0.f, 0.f);
+float3 gPositionScale = float3(1.f, 1.f, 1.f);
+
 Texture2D gDiffuseMap : DiffuseMap;
 
 struct VS_INPUT
 {
 	float3 Position : POSITION;
 	float3 Normal : NORMAL;
-	float3 Tangent : TANGENT;
+	float4 Tangent : TANGENT; // w is the handedness of the bitangent
+	float2 TexCoord : TEXCOORD;
+};
+
+// Matches QuantizedVertex in VertexFormat.h
+struct VS_INPUT_QUANTIZED
+{
+	float4 Position : POSITION;
+	float2 Normal : NORMAL;
+	float2 Tangent : TANGENT;
 	float2 TexCoord : TEXCOORD;
 };
 
@@ -15,7 +28,7 @@ struct VS_OUTPUT
 	float4 Position : SV_POSITION;
 	float4 WorldPosition : COLOR;
 	float3 Normal : NORMAL;
-	float3 Tangent : TANGENT;
+	float4 Tangent : TANGENT;
 	float2 TexCoord : TEXCOORD;
 };
 
@@ -79,6 +92,24 @@ VS_OUTPUT VS(VS_INPUT input)
 	return output;
 }
 
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.f ? -fold : fold;
+	return normalize(direction);
+}
+
+VS_OUTPUT VSQuantized(VS_INPUT_QUANTIZED input)
+{
+	VS_INPUT decoded = (VS_INPUT)0;
+	decoded.Position = gPositionOffset + input.Position.xyz * gPositionScale;
+	decoded.Normal = DecodeOctahedral(input.Normal);
+	decoded.Tangent = float4(DecodeOctahedral(input.Tangent), input.Position.w * 2.f - 1.f);
+	decoded.TexCoord = input.TexCoord;
+	return VS(decoded);
+}
+
 // Pixel Shader
 float4 PS(VS_OUTPUT input) : SV_TARGET
 {
@@ -101,3 +132,16 @@ technique11 DefaultTechnique
 		SetPixelShader( CompileShader( ps_5_0, PS() ));
 	}
 }
+
+technique11 QuantizedTechnique
+{
+	pass P0
+	{
+		SetRasterizerState(gRasterizerState);
+		SetDepthStencilState(gDepthStencilState, 0);
+		SetBlendState(gBlendState, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+		SetVertexShader( CompileShader( vs_5_0, VSQuantized() ));
+		SetGeometryShader( NULL );
+		SetPixelShader( CompileShader( ps_5_0, PS() ));
+	}
+}
@@ -0,0 +1,203 @@
+#include "Test.h"
+
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "OBJParser.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Counts finished jobs, so a test can wait for the jobs it queued with Execute
+	class JobCounter final
+	{
+	public:
+		void Add()
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			++m_Count;
+			m_Condition.notify_all();
+		}
+
+		// False when they did not finish in time, instead of hanging the test run
+		bool WaitFor(size_t count)
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			return m_Condition.wait_for(lock, std::chrono::seconds{ 60 }, [this, count]() { return m_Count >= count; });
+		}
+
+	private:
+		std::mutex m_Mutex{};
+		std::condition_variable m_Condition{};
+		size_t m_Count{};
+	};
+
+	// Everything of an import a worker hands to the main thread for the upload
+	bool IsSameImport(const OBJParseResult& expected, const OBJParseResult& actual)
+	{
+		if (expected.meshes.size() != actual.meshes.size())
+			return false;
+
+		for (size_t i = 0; i < expected.meshes.size(); ++i)
+		{
+			const Mesh_Struct& expectedMesh = expected.meshes[i];
+			const Mesh_Struct& actualMesh = actual.meshes[i];
+			if (expectedMesh.materialName != actualMesh.materialName || expectedMesh.indices != actualMesh.indices || expectedMesh.vertexFormat != actualMesh.vertexFormat
+				|| expectedMesh.vertices.size() != actualMesh.vertices.size() || expectedMesh.lods.size() != actualMesh.lods.size()
+				|| expectedMesh.meshlets.size() != actualMesh.meshlets.size())
+				return false;
+			if (std::memcmp(expectedMesh.vertices.data(), actualMesh.vertices.data(), expectedMesh.vertices.size() * sizeof(Vertex)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool ImportModel(const std::string& model, OBJParseResult& result)
+	{
+		if (!ParseOBJFile(model, true, true, result))
+			return false;
+		for (Mesh_Struct& mesh : result.meshes)
+			ProcessOBJMesh(model, mesh);
+		return true;
+	}
+
+	std::vector<uint8_t> ReadFile(const std::string& filename)
+	{
+		std::ifstream file{ filename, std::ios::binary };
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST(JobSystemRunsEveryJob)
+{
+	JobSystem* pJobSystem = JobSystem::GetInstance();
+	REQUIRE(pJobSystem->GetWorkerCount() > 0);
+
+	constexpr size_t jobCount{ 1000 };
+	std::vector<std::atomic<int>> runs(jobCount);
+	JobCounter counter{};
+	for (size_t i = 0; i < jobCount; ++i)
+	{
+		pJobSystem->Execute([&runs, &counter, i]()
+			{
+				++runs[i];
+				counter.Add();
+			});
+	}
+	REQUIRE(counter.WaitFor(jobCount));
+
+	size_t wrongCount{};
+	for (const std::atomic<int>& run : runs)
+	{
+		if (run != 1)
+			++wrongCount;
+	}
+	CHECK(wrongCount == 0);
+}
+
+TEST(ParallelForRunsEveryIndexOnce)
+{
+	JobSystem* pJobSystem = JobSystem::GetInstance();
+	for (const size_t count : { size_t{ 0 }, size_t{ 1 }, size_t{ 7 }, size_t{ 10000 } })
+	{
+		std::vector<std::atomic<int>> runs(count);
+		pJobSystem->ParallelFor(count, [&runs](size_t i) { ++runs[i]; });
+
+		// Every write of the jobs is visible once it returns
+		size_t wrongCount{};
+		for (const std::atomic<int>& run : runs)
+		{
+			if (run != 1)
+				++wrongCount;
+		}
+		CHECK(wrongCount == 0);
+	}
+}
+
+TEST(ParallelForInsideJobsFinishes)
+{
+	// More jobs than workers that all wait on their own ParallelFor, like imports that build meshlets and BVHs
+	JobSystem* pJobSystem = JobSystem::GetInstance();
+	const size_t jobCount = pJobSystem->GetWorkerCount() * 4;
+	std::vector<size_t> sums(jobCount);
+	JobCounter counter{};
+	for (size_t job = 0; job < jobCount; ++job)
+	{
+		pJobSystem->Execute([pJobSystem, &sums, &counter, job]()
+			{
+				std::atomic<size_t> sum{};
+				pJobSystem->ParallelFor(64, [pJobSystem, &sum](size_t i)
+					{
+						pJobSystem->ParallelFor(16, [&sum, i](size_t j) { sum += i * 16 + j; });
+					});
+				sums[job] = sum;
+				counter.Add();
+			});
+	}
+	REQUIRE(counter.WaitFor(jobCount));
+
+	size_t wrongCount{};
+	for (const size_t sum : sums)
+	{
+		if (sum != 1024 * 1023 / 2)
+			++wrongCount;
+	}
+	CHECK(wrongCount == 0);
+}
+
+TEST(ImportsOnTheWorkersMatchTheMainThread)
+{
+	const std::vector<std::string> models{ "Resources/cube.obj", "Resources/5Props.obj", "Resources/3DScene_NotTriangelized.obj",
+		"Resources/vehicle.obj", "Resources/Models/biplane.obj" };
+	std::vector<OBJParseResult> expected(models.size());
+	for (size_t i = 0; i < models.size(); ++i)
+		REQUIRE(ImportModel(models[i], expected[i]));
+
+	// Every model twice at the same time, the way a scene starts its loads
+	std::vector<OBJParseResult> results(models.size() * 2);
+	std::vector<int> imported(results.size());
+	JobCounter counter{};
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		JobSystem::GetInstance()->Execute([&models, &results, &imported, &counter, i]()
+			{
+				imported[i] = ImportModel(models[i % models.size()], results[i]);
+				counter.Add();
+			});
+	}
+	REQUIRE(counter.WaitFor(results.size()));
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		CHECK(imported[i]);
+		CHECK(IsSameImport(expected[i % models.size()], results[i]));
+	}
+}
+
+TEST(DecodesOnTheWorkersMatchTheMainThread)
+{
+	const std::vector<std::string> filenames{ "Resources/vehicle_diffuse.png", "Resources/T_Distillery_BC_01.jpg", "Resources/heightMap.png",
+		"Resources/vehicle_normal.png", "Resources/missing.png" };
+	const std::vector<Image> images = ImageDecoder::DecodeFiles(filenames);
+	REQUIRE(images.size() == filenames.size());
+
+	for (size_t i = 0; i < filenames.size(); ++i)
+	{
+		const std::vector<uint8_t> file = ReadFile(filenames[i]);
+		Image expected{};
+		const bool decoded = !file.empty() && ImageDecoder::Decode(filenames[i], file.data(), file.size(), expected);
+		CHECK(decoded == images[i].IsValid());
+		CHECK(images[i].width == expected.width && images[i].height == expected.height && images[i].format == expected.format);
+		CHECK(images[i].pixels == expected.pixels);
+	}
+	// A file that is not there stays empty instead of failing the others
+	CHECK(!images.back().IsValid());
+}
@@ -0,0 +1,237 @@
+#include "Test.h"
+
+#include "Bvh.h"
+#include "OBJParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Every submesh of a demo model in one triangle list
+	bool LoadTriangles(const std::string& model, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		OBJParseResult result{};
+		if (!ParseOBJFile(model, true, true, result))
+			return false;
+
+		for (const Mesh_Struct& mesh : result.meshes)
+		{
+			const uint32_t offset = static_cast<uint32_t>(vertices.size());
+			vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			for (const uint32_t index : mesh.indices)
+				indices.push_back(offset + index);
+		}
+		return !indices.empty();
+	}
+
+	struct BruteForceHit
+	{
+		float distance{ FLT_MAX };
+		uint32_t triangle{ UINT32_MAX };
+	};
+
+	// Every triangle with the same Moller-Trumbore test as the tree, so the two only differ in what they skip
+	BruteForceHit RaycastBruteForce(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance)
+	{
+		using namespace DirectX;
+
+		const XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+		const XMVECTOR rayDirection = XMLoadFloat3(&direction);
+		BruteForceHit hit{};
+		hit.distance = maxDistance;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const XMVECTOR vertex = XMLoadFloat3(&vertices[indices[i]].position);
+			const XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&vertices[indices[i + 1]].position), vertex);
+			const XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&vertices[indices[i + 2]].position), vertex);
+			const XMVECTOR p = XMVector3Cross(rayDirection, edge2);
+			const float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+			if (determinant == 0.f)
+				continue;
+
+			const float inverseDeterminant = 1.f / determinant;
+			const XMVECTOR s = XMVectorSubtract(rayOrigin, vertex);
+			const float u = XMVectorGetX(XMVector3Dot(s, p)) * inverseDeterminant;
+			if (u < 0.f || u > 1.f)
+				continue;
+
+			const XMVECTOR q = XMVector3Cross(s, edge1);
+			const float v = XMVectorGetX(XMVector3Dot(rayDirection, q)) * inverseDeterminant;
+			if (v < 0.f || u + v > 1.f)
+				continue;
+
+			const float distance = XMVectorGetX(XMVector3Dot(edge2, q)) * inverseDeterminant;
+			if (distance >= 0.f && distance < hit.distance)
+			{
+				hit.distance = distance;
+				hit.triangle = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		if (hit.triangle == UINT32_MAX)
+			hit.distance = FLT_MAX;
+		return hit;
+	}
+
+	struct Bounds
+	{
+		DirectX::XMFLOAT3 minimum{ FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 maximum{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	};
+
+	Bounds GetBounds(const std::vector<Vertex>& vertices)
+	{
+		Bounds bounds{};
+		for (const Vertex& vertex : vertices)
+		{
+			bounds.minimum = DirectX::XMFLOAT3{ (std::min)(bounds.minimum.x, vertex.position.x), (std::min)(bounds.minimum.y, vertex.position.y),
+				(std::min)(bounds.minimum.z, vertex.position.z) };
+			bounds.maximum = DirectX::XMFLOAT3{ (std::max)(bounds.maximum.x, vertex.position.x), (std::max)(bounds.maximum.y, vertex.position.y),
+				(std::max)(bounds.maximum.z, vertex.position.z) };
+		}
+		return bounds;
+	}
+
+	// Random rays from outside the bounds towards a point inside them, plus some along the axes where the slab test
+	// divides by zero
+	void CheckAgainstBruteForce(const std::string& model, size_t rayCount)
+	{
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+		REQUIRE(LoadTriangles(model, vertices, indices));
+
+		Bvh bvh{};
+		bvh.SetTriangles(vertices.data(), sizeof(Vertex), indices.data(), indices.size());
+		CHECK(!bvh.IsBuilt());
+		bvh.Build();
+		REQUIRE(bvh.IsBuilt());
+		CHECK(bvh.GetTriangleCount() == indices.size() / 3);
+		CHECK(bvh.GetNodeCount() > 0 && bvh.GetNodeCount() <= indices.size() / 3 * 2 + 1);
+
+		const Bounds bounds = GetBounds(vertices);
+		const DirectX::XMFLOAT3 center{ (bounds.minimum.x + bounds.maximum.x) / 2.f, (bounds.minimum.y + bounds.maximum.y) / 2.f,
+			(bounds.minimum.z + bounds.maximum.z) / 2.f };
+		const DirectX::XMFLOAT3 extent{ bounds.maximum.x - bounds.minimum.x, bounds.maximum.y - bounds.minimum.y, bounds.maximum.z - bounds.minimum.z };
+		const float size = (std::max)((std::max)(extent.x, extent.y), extent.z);
+
+		std::mt19937 random{ 1234 };
+		std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+		size_t hitCount{};
+		size_t mismatchCount{};
+		for (size_t ray = 0; ray < rayCount; ++ray)
+		{
+			DirectX::XMFLOAT3 origin{};
+			DirectX::XMFLOAT3 direction{};
+			if (ray % 10 == 0)
+			{
+				// Straight along one axis, through a random point of the bounds
+				const size_t axis = (ray / 10) % 3;
+				origin = DirectX::XMFLOAT3{ center.x + unit(random) * extent.x / 2.f, center.y + unit(random) * extent.y / 2.f, center.z + unit(random) * extent.z / 2.f };
+				(&origin.x)[axis] = (&center.x)[axis] - size;
+				(&direction.x)[axis] = 1.f;
+			}
+			else
+			{
+				origin = DirectX::XMFLOAT3{ center.x + unit(random) * size, center.y + unit(random) * size, center.z + unit(random) * size };
+				const DirectX::XMFLOAT3 target{ center.x + unit(random) * extent.x / 2.f, center.y + unit(random) * extent.y / 2.f, center.z + unit(random) * extent.z / 2.f };
+				// Not normalized, distances are in units of the direction
+				direction = DirectX::XMFLOAT3{ target.x - origin.x, target.y - origin.y, target.z - origin.z };
+			}
+
+			const float maxDistance = ray % 4 == 0 ? 0.5f : FLT_MAX;
+			const BruteForceHit expected = RaycastBruteForce(vertices, indices, origin, direction, maxDistance);
+			Bvh::Hit hit{};
+			const bool found = bvh.Raycast(origin, direction, maxDistance, hit);
+			const bool intersects = bvh.Intersects(origin, direction, maxDistance);
+
+			const bool expectedFound = expected.triangle != UINT32_MAX;
+			if (found != expectedFound || intersects != expectedFound || (found && hit.distance != expected.distance))
+			{
+				++mismatchCount;
+				continue;
+			}
+			if (!found)
+				continue;
+			++hitCount;
+
+			// Two triangles can be hit at the same distance, then either one is right
+			REQUIRE(hit.triangle < indices.size() / 3);
+			CHECK(hit.u >= 0.f && hit.v >= 0.f && hit.u + hit.v <= 1.f);
+			CHECK(std::abs(hit.normal.x * hit.normal.x + hit.normal.y * hit.normal.y + hit.normal.z * hit.normal.z - 1.f) < 1e-4f);
+
+			// The barycentric weights give the same point as the distance
+			const DirectX::XMFLOAT3& p0 = vertices[indices[hit.triangle * 3]].position;
+			const DirectX::XMFLOAT3& p1 = vertices[indices[hit.triangle * 3 + 1]].position;
+			const DirectX::XMFLOAT3& p2 = vertices[indices[hit.triangle * 3 + 2]].position;
+			const float w = 1.f - hit.u - hit.v;
+			const DirectX::XMFLOAT3 onTriangle{ w * p0.x + hit.u * p1.x + hit.v * p2.x, w * p0.y + hit.u * p1.y + hit.v * p2.y, w * p0.z + hit.u * p1.z + hit.v * p2.z };
+			const DirectX::XMFLOAT3 onRay{ origin.x + direction.x * hit.distance, origin.y + direction.y * hit.distance, origin.z + direction.z * hit.distance };
+			const float dx = onTriangle.x - onRay.x;
+			const float dy = onTriangle.y - onRay.y;
+			const float dz = onTriangle.z - onRay.z;
+			CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) <= 1e-4f * size);
+
+			// Just short of the hit there is nothing
+			CHECK(!bvh.Intersects(origin, direction, hit.distance * 0.999f));
+		}
+
+		CHECK(mismatchCount == 0);
+		// A good part of the rays has to hit the model, or the comparison proves little
+		CHECK(hitCount > rayCount / 4);
+	}
+}
+
+TEST(BvhMatchesBruteForceOnTheVehicle)
+{
+	CheckAgainstBruteForce("Resources/vehicle.obj", 300);
+}
+
+// Big enough that the subtrees are built as jobs
+TEST(BvhMatchesBruteForceOnTheBiplane)
+{
+	CheckAgainstBruteForce("Resources/Models/biplane.obj", 300);
+}
+
+TEST(BvhTruncateKeepsTheFirstTriangles)
+{
+	std::vector<Vertex> vertices{};
+	std::vector<uint32_t> indices{};
+	REQUIRE(LoadTriangles("Resources/cube.obj", vertices, indices));
+	REQUIRE(indices.size() == 36);
+
+	// Nothing to hit before it is built
+	Bvh bvh{};
+	Bvh::Hit empty{};
+	CHECK(!bvh.Raycast(DirectX::XMFLOAT3{}, DirectX::XMFLOAT3{ 0.f, 0.f, 1.f }, FLT_MAX, empty));
+
+	bvh.SetTriangles(vertices.data(), sizeof(Vertex), indices.data(), indices.size());
+	bvh.Build();
+	bvh.Truncate(2);
+	CHECK(!bvh.IsBuilt());
+	CHECK(bvh.GetTriangleCount() == 2);
+	bvh.Build();
+
+	// Every ray that hits one of the kept triangles, and only those
+	const Bounds bounds = GetBounds(vertices);
+	const std::vector<uint32_t> kept(indices.begin(), indices.begin() + 6);
+	for (int step = 0; step < 64; ++step)
+	{
+		const float x = bounds.minimum.x + (bounds.maximum.x - bounds.minimum.x) * (static_cast<float>(step % 8) + 0.5f) / 8.f;
+		const float y = bounds.minimum.y + (bounds.maximum.y - bounds.minimum.y) * (static_cast<float>(step / 8) + 0.5f) / 8.f;
+		for (const float side : { -1.f, 1.f })
+		{
+			const DirectX::XMFLOAT3 origin{ x, y, side * 10.f * (bounds.maximum.z - bounds.minimum.z + 1.f) };
+			const DirectX::XMFLOAT3 direction{ 0.01f, 0.02f, -side };
+			const BruteForceHit expected = RaycastBruteForce(vertices, kept, origin, direction, FLT_MAX);
+			Bvh::Hit hit{};
+			CHECK(bvh.Raycast(origin, direction, FLT_MAX, hit) == (expected.triangle != UINT32_MAX));
+			CHECK(hit.triangle == UINT32_MAX || hit.triangle < 2);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace
+{
+	size_t g_FailCount{};
+	bool g_UpdateGoldens{};
+}
+
+std::vector<Test::Case>& Test::GetCases()
+{
+	static std::vector<Case> cases{};
+	return cases;
+}
+
+void Test::Fail(const char* pExpression, const char* pFile, int line)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", pFile, line, pExpression);
+	++g_FailCount;
+}
+
+bool Test::IsUpdatingGoldens()
+{
+	return g_UpdateGoldens;
+}
+
+// Tests.exe [--update-goldens] [resource folder] [test name filter]
+// The tests read the demo resources by their relative path, the folder is the Demo project by default.
+int main(int argc, char* argv[])
+{
+	std::vector<const char*> arguments{};
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--update-goldens") == 0)
+			g_UpdateGoldens = true;
+		else
+			arguments.push_back(argv[i]);
+	}
+
+	const char* pDirectory = arguments.size() > 0 ? arguments[0] : "../Demo";
+	const char* pFilter = arguments.size() > 1 ? arguments[1] : nullptr;
+
+	std::error_code error{};
+	std::filesystem::current_path(pDirectory, error);
+	if (error)
+	{
+		printf("Could not open the resource folder %s\n", pDirectory);
+		return 1;
+	}
+
+	size_t runCount{};
+	size_t failedCount{};
+	for (const Test::Case& testCase : Test::GetCases())
+	{
+		if (pFilter != nullptr && strstr(testCase.pName, pFilter) == nullptr)
+			continue;
+
+		printf("%s\n", testCase.pName);
+		const size_t failCount = g_FailCount;
+		testCase.function();
+
+		++runCount;
+		if (g_FailCount != failCount)
+			++failedCount;
+	}
+
+	printf("%zu of %zu tests passed\n", runCount - failedCount, runCount);
+	return failedCount == 0 ? 0 : 1;
+}
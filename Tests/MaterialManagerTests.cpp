@@ -0,0 +1,65 @@
+#include "Test.h"
+
+#include "Material.h"
+#include "MaterialManager.h"
+#include "Texture.h"
+
+#include <d3d11.h>
+
+namespace
+{
+	// A software device, the tests have no window and may run without a GPU
+	ID3D11Device* CreateDevice()
+	{
+		ID3D11Device* pDevice{};
+		if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, &pDevice, nullptr, nullptr)))
+			return nullptr;
+		return pDevice;
+	}
+
+	std::string GetSavedDiffuseMap(const rapidjson::Document& document, const std::string& name)
+	{
+		for (const auto& material : document["Materials"].GetArray())
+		{
+			if (name == material["Name"].GetString())
+				return material["DiffuseTexture"].GetString();
+		}
+		return {};
+	}
+}
+
+TEST(MaterialsWithTheSameDescriptionKeepTheirOwnMaps)
+{
+	ID3D11Device* pDevice = CreateDevice();
+	REQUIRE(pDevice != nullptr);
+
+	// Like the props of the demo, materials of a .mtl without maps all have the same description
+	MaterialManager* pMaterialManager = MaterialManager::GetInstance();
+	const MaterialDescription description{ "Resources/material_unlit.fx", "" };
+	Material* pFirst = pMaterialManager->AddMaterial("MaterialTestFirst", description, pDevice);
+	Material* pSecond = pMaterialManager->AddMaterial("MaterialTestSecond", description, pDevice);
+	REQUIRE(pFirst != nullptr && pSecond != nullptr);
+
+	CHECK(pFirst != pSecond);
+	CHECK(pMaterialManager->AddMaterial("MaterialTestFirst", description, pDevice) == pFirst);
+	// Only the effect is shared
+	CHECK(pFirst->GetEffect() == pSecond->GetEffect());
+
+	const uint32_t pixels[4]{};
+	pFirst->SetDiffuseMap(new Texture(pDevice, "Resources/MaterialTestFirst.png", 2, 2, pixels));
+	pSecond->SetDiffuseMap(new Texture(pDevice, "Resources/MaterialTestSecond.png", 2, 2, pixels));
+
+	rapidjson::StringBuffer buffer{};
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{ buffer };
+	writer.StartObject();
+	pMaterialManager->Serialize(writer);
+	writer.EndObject();
+
+	rapidjson::Document document{};
+	document.Parse(buffer.GetString());
+	REQUIRE(!document.HasParseError());
+	CHECK(GetSavedDiffuseMap(document, "MaterialTestFirst") == "Resources/MaterialTestFirst.png");
+	CHECK(GetSavedDiffuseMap(document, "MaterialTestSecond") == "Resources/MaterialTestSecond.png");
+
+	pDevice->Release();
+}
@@ -0,0 +1,190 @@
+#include "Test.h"
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	struct Position
+	{
+		float x{};
+		float y{};
+		float z{};
+	};
+
+	constexpr float g_Pi{ 3.14159265f };
+
+	// Flat grid of size by size quads in the xz plane, every vertex can go without moving the surface
+	void CreatePlane(uint32_t size, std::vector<Position>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t z = 0; z <= size; ++z)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+				vertices.push_back(Position{ static_cast<float>(x), 0.f, static_cast<float>(z) });
+		}
+
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const uint32_t corner = z * (size + 1) + x;
+				indices.insert(indices.end(), { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 });
+			}
+		}
+	}
+
+	// Closed unit sphere, the poles are single vertices so it has no borders
+	void CreateSphere(uint32_t rings, uint32_t segments, std::vector<Position>& vertices, std::vector<uint32_t>& indices)
+	{
+		vertices.push_back(Position{ 0.f, 1.f, 0.f });
+		for (uint32_t ring = 1; ring < rings; ++ring)
+		{
+			const float theta = g_Pi * static_cast<float>(ring) / static_cast<float>(rings);
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				const float phi = 2.f * g_Pi * static_cast<float>(segment) / static_cast<float>(segments);
+				vertices.push_back(Position{ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+			}
+		}
+		vertices.push_back(Position{ 0.f, -1.f, 0.f });
+
+		const uint32_t bottom = static_cast<uint32_t>(vertices.size() - 1);
+		auto getVertex = [segments](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * segments + segment % segments; };
+		for (uint32_t segment = 0; segment < segments; ++segment)
+		{
+			indices.insert(indices.end(), { 0, getVertex(1, segment + 1), getVertex(1, segment) });
+			indices.insert(indices.end(), { bottom, getVertex(rings - 1, segment), getVertex(rings - 1, segment + 1) });
+			for (uint32_t ring = 1; ring + 1 < rings; ++ring)
+			{
+				const uint32_t a = getVertex(ring, segment);
+				const uint32_t b = getVertex(ring, segment + 1);
+				const uint32_t c = getVertex(ring + 1, segment);
+				const uint32_t d = getVertex(ring + 1, segment + 1);
+				indices.insert(indices.end(), { a, b, c, b, d, c });
+			}
+		}
+	}
+
+	// Furthest a triangle of the range gets from the unit sphere, measured at the triangle centers
+	float GetSphereDeviation(const std::vector<Position>& vertices, const uint32_t* pIndices, size_t indexCount)
+	{
+		float deviation{};
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const Position& a = vertices[pIndices[i]];
+			const Position& b = vertices[pIndices[i + 1]];
+			const Position& c = vertices[pIndices[i + 2]];
+			const float x = (a.x + b.x + c.x) / 3.f;
+			const float y = (a.y + b.y + c.y) / 3.f;
+			const float z = (a.z + b.z + c.z) / 3.f;
+			deviation = (std::max)(deviation, 1.f - std::sqrt(x * x + y * y + z * z));
+		}
+		return deviation;
+	}
+
+	bool IsValidRange(const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+	{
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			if (pIndices[i] >= vertexCount || pIndices[i + 1] >= vertexCount || pIndices[i + 2] >= vertexCount)
+				return false;
+			if (pIndices[i] == pIndices[i + 1] || pIndices[i + 1] == pIndices[i + 2] || pIndices[i] == pIndices[i + 2])
+				return false;
+		}
+		return indexCount % 3 == 0;
+	}
+}
+
+TEST(SimplifyReachesTheTriangleBudget)
+{
+	std::vector<Position> vertices{};
+	std::vector<uint32_t> indices{};
+	CreatePlane(32, vertices, indices);
+
+	// A plane has no error, so only the budget stops it
+	const size_t target = indices.size() / 4 / 3 * 3;
+	std::vector<uint32_t> simplified(indices.size());
+	float error{ -1.f };
+	const size_t count = MeshSimplifier::Simplify(simplified.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Position),
+		target, 0.01f, &error);
+
+	CHECK(count > 0);
+	CHECK(count <= target);
+	CHECK(error >= 0.f && error < 1e-4f);
+	CHECK(IsValidRange(simplified.data(), count, vertices.size()));
+}
+
+TEST(SimplifyStaysWithinTheErrorBound)
+{
+	std::vector<Position> vertices{};
+	std::vector<uint32_t> indices{};
+	CreateSphere(24, 48, vertices, indices);
+
+	// Asked for almost nothing, the error bound has to stop it long before the budget
+	constexpr float targetError{ 0.01f };
+	std::vector<uint32_t> simplified(indices.size());
+	float error{ -1.f };
+	const size_t count = MeshSimplifier::Simplify(simplified.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Position),
+		3, targetError, &error);
+
+	CHECK(count > 3);
+	CHECK(count < indices.size());
+	CHECK(error > 0.f && error <= targetError);
+	CHECK(IsValidRange(simplified.data(), count, vertices.size()));
+
+	// The error is relative to the size of the mesh. It averages the planes around a vertex, the surface moves up to
+	// about twice as far.
+	const float scale = MeshSimplifier::GetMeshScale(vertices.data(), vertices.size(), sizeof(Position));
+	const float deviation = GetSphereDeviation(vertices, indices.data(), indices.size());
+	CHECK(GetSphereDeviation(vertices, simplified.data(), count) <= deviation + 2.f * error * scale);
+}
+
+TEST(GenerateLodsHalvesTheTrianglesWithinTheErrorBound)
+{
+	std::vector<Position> vertices{};
+	std::vector<uint32_t> indices{};
+	CreateSphere(32, 64, vertices, indices);
+	const size_t indexCount = indices.size();
+
+	const std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::GenerateLods(vertices, indices);
+	REQUIRE(lods.size() > 1);
+	REQUIRE(lods.size() <= MeshSimplifier::g_MaxLods);
+
+	CHECK(lods[0].indexOffset == 0 && lods[0].indexCount == indexCount && lods[0].error == 0.f);
+
+	const float scale = MeshSimplifier::GetMeshScale(vertices.data(), vertices.size(), sizeof(Position));
+	const float deviation = GetSphereDeviation(vertices, indices.data(), indexCount);
+	for (size_t i = 1; i < lods.size(); ++i)
+	{
+		const MeshSimplifier::Lod& lod = lods[i];
+		const MeshSimplifier::Lod& previous = lods[i - 1];
+		CHECK(lod.indexOffset == previous.indexOffset + previous.indexCount);
+		CHECK(lod.indexOffset + lod.indexCount <= indices.size());
+		CHECK(IsValidRange(indices.data() + lod.indexOffset, lod.indexCount, vertices.size()));
+
+		// Every level is about half the previous one and never more than 90%
+		CHECK(lod.indexCount <= previous.indexCount / 2);
+		CHECK(lod.indexCount * 10 <= previous.indexCount * 9);
+
+		// Errors add up over the levels and stay under the limit, the surface moves about twice as far at most
+		CHECK(lod.error >= previous.error);
+		CHECK(lod.error <= MeshSimplifier::g_MaxLodError * scale);
+		CHECK(GetSphereDeviation(vertices, indices.data() + lod.indexOffset, lod.indexCount) <= deviation + 2.f * lod.error);
+	}
+}
+
+TEST(GenerateLodsStopsAtTheErrorLimit)
+{
+	std::vector<Position> vertices{};
+	std::vector<uint32_t> indices{};
+	CreateSphere(32, 64, vertices, indices);
+
+	// Without any error allowed a curved surface can not lose a triangle
+	const std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::GenerateLods(vertices, indices, MeshSimplifier::g_MaxLods, 0.f);
+	CHECK(lods.size() == 1);
+	CHECK(indices.size() == lods[0].indexCount);
+}
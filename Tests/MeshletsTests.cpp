@@ -0,0 +1,269 @@
+#include "Test.h"
+
+#include "OBJParser.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr float g_Pi{ 3.14159265f };
+
+	// A demo model as the importer sees it, with the meshlets of every submesh that is big enough
+	bool ImportModel(const std::string& model, OBJParseResult& result)
+	{
+		if (!ParseOBJFile(model, true, true, result))
+			return false;
+
+		for (size_t i = 0; i < result.meshes.size(); ++i)
+			ProcessOBJMesh(model + " submesh " + std::to_string(i), result.meshes[i]);
+		return true;
+	}
+
+	DirectX::XMFLOAT3 Subtract(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return DirectX::XMFLOAT3{ a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	DirectX::XMFLOAT3 Cross(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return DirectX::XMFLOAT3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	float Dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	float Length(const DirectX::XMFLOAT3& a)
+	{
+		return std::sqrt(Dot(a, a));
+	}
+
+	// Checks everything Build promises: contiguous ranges within the limits that hold the same triangles as before,
+	// spheres around every vertex and cones around every face normal
+	void CheckMeshlets(const Mesh_Struct& mesh, const std::vector<uint32_t>& original, const std::vector<Meshlets::Meshlet>& meshlets,
+		const uint32_t* pIndices, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		REQUIRE(!meshlets.empty());
+
+		uint32_t offset{};
+		for (const Meshlets::Meshlet& meshlet : meshlets)
+		{
+			CHECK(meshlet.indexOffset == offset);
+			CHECK(meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0);
+			CHECK(meshlet.indexCount <= maxTriangles * 3);
+			offset += meshlet.indexCount;
+
+			std::vector<uint32_t> vertices(pIndices + meshlet.indexOffset, pIndices + meshlet.indexOffset + meshlet.indexCount);
+			std::sort(vertices.begin(), vertices.end());
+			CHECK(std::unique(vertices.begin(), vertices.end()) - vertices.begin() <= static_cast<ptrdiff_t>(maxVertices));
+
+			const float sine = std::sqrt((std::max)(0.f, 1.f - meshlet.coneCutoff * meshlet.coneCutoff));
+			for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+			{
+				const DirectX::XMFLOAT3& p0 = mesh.vertices[pIndices[meshlet.indexOffset + i]].position;
+				const DirectX::XMFLOAT3& p1 = mesh.vertices[pIndices[meshlet.indexOffset + i + 1]].position;
+				const DirectX::XMFLOAT3& p2 = mesh.vertices[pIndices[meshlet.indexOffset + i + 2]].position;
+				for (const DirectX::XMFLOAT3* pPosition : { &p0, &p1, &p2 })
+					CHECK(Length(Subtract(*pPosition, meshlet.center)) <= meshlet.radius * 1.0001f + 1e-5f);
+
+				// The cutoff is the sine of the cone angle, every face normal is at most that angle from the axis. Wide cones
+				// have a cutoff close to 1 that only pins the angle down to about 1e-3.
+				const DirectX::XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+				const float length = Length(normal);
+				if (meshlet.coneCutoff < 1.f && length > 0.f)
+					CHECK(Dot(normal, meshlet.coneAxis) / length >= sine - 1e-3f);
+			}
+		}
+		CHECK(offset == original.size());
+
+		// Only the order of the triangles changes, their corners stay in the same order
+		auto sortedTriangles = [](const uint32_t* pTriangles, size_t indexCount)
+		{
+			std::vector<std::array<uint32_t, 3>> triangles(indexCount / 3);
+			for (size_t i = 0; i < triangles.size(); ++i)
+				triangles[i] = { pTriangles[i * 3], pTriangles[i * 3 + 1], pTriangles[i * 3 + 2] };
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		};
+		CHECK(sortedTriangles(pIndices, original.size()) == sortedTriangles(original.data(), original.size()));
+	}
+
+	// Row vector view projection of a camera at eye looking at target, D3D clip space like the engine cameras
+	DirectX::XMFLOAT4X4 GetViewProjection(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& target, float fieldOfView, float nearPlane, float farPlane)
+	{
+		const DirectX::XMFLOAT3 forward = Subtract(target, eye);
+		const float forwardLength = Length(forward);
+		const DirectX::XMFLOAT3 z{ forward.x / forwardLength, forward.y / forwardLength, forward.z / forwardLength };
+		DirectX::XMFLOAT3 x = Cross(DirectX::XMFLOAT3{ 0.f, 1.f, 0.f }, z);
+		const float xLength = Length(x);
+		x = DirectX::XMFLOAT3{ x.x / xLength, x.y / xLength, x.z / xLength };
+		const DirectX::XMFLOAT3 y = Cross(z, x);
+
+		const float view[4][4]
+		{
+			{ x.x, y.x, z.x, 0.f },
+			{ x.y, y.y, z.y, 0.f },
+			{ x.z, y.z, z.z, 0.f },
+			{ -Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.f }
+		};
+
+		const float scale = 1.f / std::tan(fieldOfView / 2.f);
+		const float range = farPlane / (farPlane - nearPlane);
+		const float projection[4][4]
+		{
+			{ scale, 0.f, 0.f, 0.f },
+			{ 0.f, scale, 0.f, 0.f },
+			{ 0.f, 0.f, range, 1.f },
+			{ 0.f, 0.f, -nearPlane * range, 0.f }
+		};
+
+		DirectX::XMFLOAT4X4 result{};
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				float sum{};
+				for (int i = 0; i < 4; ++i)
+					sum += view[row][i] * projection[i][column];
+				result.m[row][column] = sum;
+			}
+		}
+		return result;
+	}
+
+	// Clearly inside the clip volume, points on the border can go either way
+	bool IsInsideClipSpace(const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT3& position)
+	{
+		float clip[4]{};
+		for (int column = 0; column < 4; ++column)
+		{
+			clip[column] = position.x * viewProjection.m[0][column] + position.y * viewProjection.m[1][column]
+				+ position.z * viewProjection.m[2][column] + viewProjection.m[3][column];
+		}
+
+		const float margin = 1e-3f * std::abs(clip[3]);
+		return std::abs(clip[0]) < clip[3] - margin && std::abs(clip[1]) < clip[3] - margin && clip[2] > margin && clip[2] < clip[3] - margin;
+	}
+}
+
+TEST(MeshletsStayWithinTheirLimitsAndBounds)
+{
+	for (const char* pModel : { "Resources/vehicle.obj", "Resources/Models/biplane.obj" })
+	{
+		OBJParseResult result{};
+		REQUIRE(ImportModel(pModel, result));
+
+		size_t meshletCount{};
+		for (Mesh_Struct& mesh : result.meshes)
+		{
+			if (mesh.meshlets.empty())
+				continue;
+			meshletCount += mesh.meshlets.size();
+
+			// The importer reordered the indices already, they are the triangles a second build has to keep
+			const std::vector<uint32_t> original(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].indexCount);
+			CheckMeshlets(mesh, original, mesh.meshlets, mesh.indices.data(), Meshlets::g_MaxVertices, Meshlets::g_MaxTriangles);
+
+			// Small limits split a lot more often
+			std::vector<uint32_t> indices = original;
+			const std::vector<Meshlets::Meshlet> small = Meshlets::Build(indices.data(), indices.size(), mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), 16, 16);
+			CheckMeshlets(mesh, original, small, indices.data(), 16, 16);
+		}
+		CHECK(meshletCount > 0);
+	}
+}
+
+TEST(MeshletsOfSmallMeshesAreNotBuilt)
+{
+	OBJParseResult result{};
+	REQUIRE(ImportModel("Resources/cube.obj", result));
+	REQUIRE(!result.meshes.empty());
+	CHECK(result.meshes[0].meshlets.empty());
+
+	// Nothing to split and limits that can not hold a triangle
+	std::vector<uint32_t> indices = result.meshes[0].indices;
+	const Vertex* pVertices = result.meshes[0].vertices.data();
+	CHECK(Meshlets::Build(indices.data(), 0, pVertices, result.meshes[0].vertices.size(), sizeof(Vertex)).empty());
+	CHECK(Meshlets::Build(indices.data(), indices.size(), pVertices, result.meshes[0].vertices.size(), sizeof(Vertex), 2, 16).empty());
+	CHECK(Meshlets::Build(indices.data(), indices.size(), pVertices, result.meshes[0].vertices.size(), sizeof(Vertex), 64, 0).empty());
+}
+
+TEST(CullKeepsEveryVisibleTriangle)
+{
+	OBJParseResult result{};
+	REQUIRE(ImportModel("Resources/vehicle.obj", result));
+
+	size_t culledCount{};
+	size_t visibleCount{};
+	size_t wronglyCulledCount{};
+	for (const Mesh_Struct& mesh : result.meshes)
+	{
+		if (mesh.meshlets.empty())
+			continue;
+
+		// Cameras all around the mesh and close enough that parts of it are outside the view
+		const Meshlets::Meshlet& first = mesh.meshlets.front();
+		for (uint32_t step = 0; step < 24; ++step)
+		{
+			const float angle = 2.f * g_Pi * static_cast<float>(step) / 24.f;
+			const float distance = 4.f + static_cast<float>(step % 4) * 6.f;
+			const DirectX::XMFLOAT3 eye{ std::cos(angle) * distance, 2.f + static_cast<float>(step % 3) * 3.f, std::sin(angle) * distance };
+			const DirectX::XMFLOAT3 target{ first.center.x * static_cast<float>(step % 2), 0.f, first.center.z * static_cast<float>(step % 2) };
+			const DirectX::XMFLOAT4X4 viewProjection = GetViewProjection(eye, target, g_Pi / 3.f, 0.1f, 100.f);
+
+			for (const bool cullBackFaces : { false, true })
+			{
+				std::vector<Meshlets::DrawRange> ranges{};
+				const Meshlets::CullStatistics statistics = Meshlets::Cull(mesh.meshlets.data(), mesh.meshlets.size(), Meshlets::GetFrustum(viewProjection),
+					eye, cullBackFaces, ranges);
+				CHECK(statistics.visible + statistics.outsideFrustum + statistics.backFacing == mesh.meshlets.size());
+				CHECK(cullBackFaces || statistics.backFacing == 0);
+
+				// Which triangles are drawn, the ranges are merged so they do not line up with the meshlets any more
+				std::vector<uint8_t> drawn(mesh.lods[0].indexCount / 3, 0);
+				uint32_t drawnIndexCount{};
+				for (const Meshlets::DrawRange& range : ranges)
+				{
+					CHECK(range.indexOffset + range.indexCount <= mesh.lods[0].indexCount);
+					std::fill(drawn.begin() + range.indexOffset / 3, drawn.begin() + (range.indexOffset + range.indexCount) / 3, uint8_t{ 1 });
+					drawnIndexCount += range.indexCount;
+				}
+				CHECK(drawnIndexCount == static_cast<size_t>(std::count(drawn.begin(), drawn.end(), uint8_t{ 1 })) * 3);
+
+				for (size_t triangle = 0; triangle < drawn.size(); ++triangle)
+				{
+					if (drawn[triangle])
+					{
+						++visibleCount;
+						continue;
+					}
+					++culledCount;
+
+					const DirectX::XMFLOAT3& p0 = mesh.vertices[mesh.indices[triangle * 3]].position;
+					const DirectX::XMFLOAT3& p1 = mesh.vertices[mesh.indices[triangle * 3 + 1]].position;
+					const DirectX::XMFLOAT3& p2 = mesh.vertices[mesh.indices[triangle * 3 + 2]].position;
+					const bool inside = IsInsideClipSpace(viewProjection, p0) || IsInsideClipSpace(viewProjection, p1) || IsInsideClipSpace(viewProjection, p2);
+					if (!inside)
+						continue;
+
+					// Inside the view, so only a face that points away could be skipped
+					const DirectX::XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+					const DirectX::XMFLOAT3 toEye = Subtract(eye, p0);
+					if (!cullBackFaces || Dot(normal, toEye) > 1e-4f * Length(normal) * Length(toEye))
+						++wronglyCulledCount;
+				}
+			}
+		}
+	}
+
+	CHECK(wronglyCulledCount == 0);
+	// The cameras have to have seen and skipped something, or the test proves nothing
+	CHECK(culledCount > 0);
+	CHECK(visibleCount > 0);
+}
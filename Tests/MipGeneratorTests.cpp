@@ -0,0 +1,138 @@
+#include "Test.h"
+
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	Image CreateRandomImage(uint32_t width, uint32_t height, ImageFormat format, uint32_t seed)
+	{
+		Image image{};
+		image.width = width;
+		image.height = height;
+		image.format = format;
+		image.pixels.resize(image.GetRowPitch() * height);
+
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<int> byte{ 0, 255 };
+		for (uint8_t& value : image.pixels)
+			value = static_cast<uint8_t>(byte(random));
+		return image;
+	}
+
+	int GetValue(const Image& image, size_t index)
+	{
+		if (image.format == ImageFormat::R16)
+			return image.pixels[index * 2] | image.pixels[index * 2 + 1] << 8;
+		return image.pixels[index];
+	}
+
+	// Largest difference of any channel over every level, -1 when the chains do not have the same levels
+	int GetLargestDifference(const std::vector<Image>& expected, const std::vector<Image>& actual)
+	{
+		if (expected.size() != actual.size())
+			return -1;
+
+		int difference{};
+		for (size_t level = 0; level < expected.size(); ++level)
+		{
+			const Image& expectedLevel = expected[level];
+			const Image& actualLevel = actual[level];
+			if (!actualLevel.IsValid() || actualLevel.width != expectedLevel.width || actualLevel.height != expectedLevel.height
+				|| actualLevel.format != expectedLevel.format)
+				return -1;
+
+			const size_t valueCount = expectedLevel.format == ImageFormat::R16 ? expectedLevel.pixels.size() / 2 : expectedLevel.pixels.size();
+			for (size_t i = 0; i < valueCount; ++i)
+				difference = (std::max)(difference, std::abs(GetValue(expectedLevel, i) - GetValue(actualLevel, i)));
+		}
+		return difference;
+	}
+
+	int CompareWithReference(const Image& image, const MipGenerator::Settings& settings)
+	{
+		std::vector<Image> fast{ image };
+		std::vector<Image> reference{ image };
+		MipGenerator::GenerateMips(fast, settings);
+		MipGenerator::GenerateMipsReference(reference, settings);
+		return GetLargestDifference(reference, fast);
+	}
+}
+
+// Odd sizes make the box filter cover three texels, the last one of a row ends at the edge of the source
+TEST(MipsMatchTheReferenceOnOddSizes)
+{
+	const std::pair<uint32_t, uint32_t> sizes[]{ { 55, 57 }, { 93, 95 }, { 117, 163 }, { 1, 57 }, { 57, 1 }, { 64, 64 }, { 300, 7 } };
+	const ImageFormat formats[]{ ImageFormat::RGBA8, ImageFormat::R8, ImageFormat::R16 };
+	uint32_t seed{};
+	for (const auto& [width, height] : sizes)
+	{
+		for (const ImageFormat format : formats)
+		{
+			for (const MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser })
+			{
+				for (const bool srgb : { false, true })
+				{
+					if (srgb && format != ImageFormat::RGBA8)
+						continue;
+
+					const Image image = CreateRandomImage(width, height, format, ++seed);
+					const int difference = CompareWithReference(image, MipGenerator::Settings{ filter, srgb });
+					CHECK(difference >= 0);
+					// Rounding only, SSE adds the taps in another order
+					CHECK(difference <= 1);
+				}
+			}
+		}
+	}
+}
+
+TEST(MipsMatchTheReferenceOnRandomSizes)
+{
+	std::mt19937 random{ 48 };
+	std::uniform_int_distribution<uint32_t> size{ 1, 400 };
+	for (int i = 0; i < 60; ++i)
+	{
+		const Image image = CreateRandomImage(size(random), size(random), ImageFormat::RGBA8, static_cast<uint32_t>(random()));
+		const int difference = CompareWithReference(image, MipGenerator::Settings{ MipGenerator::Filter::Box, false });
+		CHECK(difference >= 0 && difference <= 1);
+	}
+}
+
+TEST(MipChainsEndAtOnePixel)
+{
+	std::vector<Image> levels{ CreateRandomImage(55, 57, ImageFormat::RGBA8, 1) };
+	MipGenerator::GenerateMips(levels, MipGenerator::Settings{});
+	REQUIRE(levels.size() == MipGenerator::GetMipCount(55, 57));
+	CHECK(levels[1].width == 27 && levels[1].height == 28);
+	CHECK(levels.back().width == 1 && levels.back().height == 1);
+}
+
+TEST(BoxFilteredMipsOfOneColorKeepThatColor)
+{
+	// A texel read past the edge of a level would show up as another value
+	for (const auto& [width, height] : { std::pair<uint32_t, uint32_t>{ 55, 57 }, { 163, 117 }, { 95, 1 } })
+	{
+		Image image = CreateRandomImage(width, height, ImageFormat::R8, 0);
+		std::fill(image.pixels.begin(), image.pixels.end(), uint8_t{ 200 });
+		std::vector<Image> levels{ image };
+		MipGenerator::GenerateMips(levels, MipGenerator::Settings{});
+
+		size_t wrongCount{};
+		for (const Image& level : levels)
+		{
+			for (const uint8_t value : level.pixels)
+			{
+				if (value != 200)
+					++wrongCount;
+			}
+		}
+		CHECK(wrongCount == 0);
+	}
+}
@@ -0,0 +1,171 @@
+#include "Test.h"
+
+#include "OBJParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Floats only have to match this closely, the goldens are written by an x64 SSE2 build and the math library does not
+	// give the same last bits with other instruction sets. Counts and offsets have to match exactly.
+	constexpr double g_GoldenTolerance{ 1e-3 };
+	// Every submesh writes about this many meshlets and tangents, spread over the whole range
+	constexpr size_t g_GoldenSamples{ 16 };
+
+	std::filesystem::path GetGoldenPath(const std::string& model)
+	{
+		return std::filesystem::path(__FILE__).parent_path() / "Golden" / (std::filesystem::path(model).stem().string() + ".txt");
+	}
+
+	// The importer output in text form, one record per line
+	std::string DescribeImport(const std::string& model)
+	{
+		OBJParseResult result{};
+		if (!ParseOBJFile(model, true, true, result))
+			return {};
+
+		std::ostringstream stream{};
+		stream.precision(6);
+		stream << std::fixed;
+		stream << "submeshes " << result.meshes.size() << "\n";
+		for (size_t i = 0; i < result.meshes.size(); ++i)
+		{
+			Mesh_Struct& mesh = result.meshes[i];
+			ProcessOBJMesh(model + " submesh " + std::to_string(i), mesh);
+
+			stream << "submesh " << i << " vertices " << mesh.vertices.size() << " indices " << mesh.indices.size()
+				<< " format " << static_cast<uint32_t>(mesh.vertexFormat) << "\n";
+			for (const MeshSimplifier::Lod& lod : mesh.lods)
+				stream << "lod " << lod.indexOffset << " " << lod.indexCount << " " << lod.error << "\n";
+
+			stream << "meshlets " << mesh.meshlets.size() << "\n";
+			const size_t meshletStep = (std::max)(mesh.meshlets.size() / g_GoldenSamples, size_t{ 1 });
+			for (size_t j = 0; j < mesh.meshlets.size(); j += meshletStep)
+			{
+				const Meshlets::Meshlet& meshlet = mesh.meshlets[j];
+				stream << "meshlet " << j << " " << meshlet.indexOffset << " " << meshlet.indexCount
+					<< " " << meshlet.center.x << " " << meshlet.center.y << " " << meshlet.center.z << " " << meshlet.radius;
+				// A cone that never culls can have the average of normals that cancel out as its axis, that one is noise
+				if (meshlet.coneCutoff < 1.f)
+					stream << " cone " << meshlet.coneAxis.x << " " << meshlet.coneAxis.y << " " << meshlet.coneAxis.z << " " << meshlet.coneCutoff;
+				stream << "\n";
+			}
+
+			const size_t vertexStep = (std::max)(mesh.vertices.size() / g_GoldenSamples, size_t{ 1 });
+			for (size_t j = 0; j < mesh.vertices.size(); j += vertexStep)
+			{
+				const Vertex& vertex = mesh.vertices[j];
+				stream << "tangent " << j << " " << vertex.position.x << " " << vertex.position.y << " " << vertex.position.z
+					<< " " << vertex.tangent.x << " " << vertex.tangent.y << " " << vertex.tangent.z << " " << vertex.tangent.w << "\n";
+			}
+		}
+		return stream.str();
+	}
+
+	bool IsFloat(const std::string& word)
+	{
+		return word.find('.') != std::string::npos;
+	}
+
+	// Word by word, prints the first line that differs
+	bool MatchesGolden(const std::string& actual, const std::string& golden)
+	{
+		std::istringstream actualLines{ actual };
+		std::istringstream goldenLines{ golden };
+		std::string actualLine{};
+		std::string goldenLine{};
+		size_t lineNumber{};
+		while (true)
+		{
+			const bool hasActual = static_cast<bool>(std::getline(actualLines, actualLine));
+			const bool hasGolden = static_cast<bool>(std::getline(goldenLines, goldenLine));
+			++lineNumber;
+			if (!hasActual && !hasGolden)
+				return true;
+
+			bool equal = hasActual && hasGolden;
+			std::istringstream actualWords{ actualLine };
+			std::istringstream goldenWords{ goldenLine };
+			std::string actualWord{};
+			std::string goldenWord{};
+			while (equal)
+			{
+				const bool hasActualWord = static_cast<bool>(actualWords >> actualWord);
+				const bool hasGoldenWord = static_cast<bool>(goldenWords >> goldenWord);
+				if (!hasActualWord || !hasGoldenWord)
+				{
+					equal = hasActualWord == hasGoldenWord;
+					break;
+				}
+
+				if (IsFloat(actualWord) && IsFloat(goldenWord))
+					equal = std::abs(std::stod(actualWord) - std::stod(goldenWord)) <= g_GoldenTolerance;
+				else
+					equal = actualWord == goldenWord;
+			}
+
+			if (!equal)
+			{
+				printf("  line %zu: got \"%s\", golden \"%s\"\n", lineNumber, hasActual ? actualLine.c_str() : "", hasGolden ? goldenLine.c_str() : "");
+				return false;
+			}
+		}
+	}
+
+	void CheckGolden(const std::string& model)
+	{
+		const std::string actual = DescribeImport(model);
+		REQUIRE(!actual.empty());
+
+		const std::filesystem::path goldenPath = GetGoldenPath(model);
+		if (Test::IsUpdatingGoldens())
+		{
+			std::filesystem::create_directories(goldenPath.parent_path());
+			std::ofstream file{ goldenPath, std::ios::binary };
+			file << actual;
+			REQUIRE(file.good());
+			printf("  wrote %s\n", goldenPath.string().c_str());
+			return;
+		}
+
+		std::ifstream file{ goldenPath, std::ios::binary };
+		REQUIRE(file.is_open());
+		std::ostringstream golden{};
+		golden << file.rdbuf();
+		CHECK(MatchesGolden(actual, golden.str()));
+	}
+}
+
+// The demo models through the whole importer, a change to the tangents, the optimizer, the lods or the meshlets
+// shows up here. Run with --update-goldens after a change that is meant to alter the output.
+TEST(CubeMatchesItsGolden)
+{
+	CheckGolden("Resources/cube.obj");
+}
+
+TEST(PropsMatchItsGolden)
+{
+	CheckGolden("Resources/5Props.obj");
+}
+
+TEST(NotTriangulatedSceneMatchesItsGolden)
+{
+	CheckGolden("Resources/3DScene_NotTriangelized.obj");
+}
+
+TEST(VehicleMatchesItsGolden)
+{
+	CheckGolden("Resources/vehicle.obj");
+}
+
+TEST(BiplaneMatchesItsGolden)
+{
+	CheckGolden("Resources/Models/biplane.obj");
+}
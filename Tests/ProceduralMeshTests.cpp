@@ -0,0 +1,122 @@
+#include "Test.h"
+
+#include "Mesh.h"
+#include "ProceduralMesh.h"
+
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Below, at and above the minimums of every count
+	const int g_Counts[]{ -1, 0, 1, 2, 3, 4, 7, 16, 64 };
+
+	// The exact sizes the counts promised, indices in range and no triangle without an area, which the poles of the
+	// sphere and the capsule would give when their degenerate halves were not left out
+	void CheckMesh(const ProceduralMesh::Counts& counts, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool checkArea = true)
+	{
+		CHECK(vertices.size() == counts.vertexCount);
+		CHECK(indices.size() == counts.indexCount);
+		REQUIRE(indices.size() % 3 == 0);
+
+		size_t outOfRangeCount{};
+		size_t degenerateCount{};
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size())
+			{
+				++outOfRangeCount;
+				continue;
+			}
+
+			const DirectX::XMFLOAT3& p0 = vertices[indices[i]].position;
+			const DirectX::XMFLOAT3& p1 = vertices[indices[i + 1]].position;
+			const DirectX::XMFLOAT3& p2 = vertices[indices[i + 2]].position;
+			const DirectX::XMFLOAT3 edge1{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			const DirectX::XMFLOAT3 edge2{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			const DirectX::XMFLOAT3 cross{ edge1.y * edge2.z - edge1.z * edge2.y, edge1.z * edge2.x - edge1.x * edge2.z, edge1.x * edge2.y - edge1.y * edge2.x };
+			if (std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z) < 1e-7f)
+				++degenerateCount;
+		}
+		CHECK(outOfRangeCount == 0);
+		CHECK(!checkArea || degenerateCount == 0);
+	}
+}
+
+TEST(ProceduralMeshesMatchTheirCounts)
+{
+	// Filled vectors are replaced, not appended to
+	std::vector<Vertex> vertices(5);
+	std::vector<uint32_t> indices(7);
+
+	ProceduralMesh::GenerateBox(1.f, 2.f, 3.f, vertices, indices);
+	CheckMesh(ProceduralMesh::GetBoxCounts(), vertices, indices);
+
+	for (const int slices : g_Counts)
+	{
+		ProceduralMesh::GenerateCylinder(1.f, 2.f, slices, vertices, indices);
+		CheckMesh(ProceduralMesh::GetCylinderCounts(slices), vertices, indices);
+
+		for (const int stacks : g_Counts)
+		{
+			ProceduralMesh::GenerateSphere(1.f, slices, stacks, vertices, indices);
+			CheckMesh(ProceduralMesh::GetSphereCounts(slices, stacks), vertices, indices);
+
+			ProceduralMesh::GenerateCapsule(1.f, 4.f, slices, stacks, vertices, indices);
+			CheckMesh(ProceduralMesh::GetCapsuleCounts(slices, stacks), vertices, indices);
+			// Shorter than its diameter it is a sphere with its equator ring twice, the band between them is flat
+			ProceduralMesh::GenerateCapsule(1.f, 1.f, slices, stacks, vertices, indices);
+			CheckMesh(ProceduralMesh::GetCapsuleCounts(slices, stacks), vertices, indices, false);
+
+			ProceduralMesh::GeneratePlane(2.f, 3.f, slices, stacks, vertices, indices);
+			CheckMesh(ProceduralMesh::GetPlaneCounts(slices, stacks), vertices, indices);
+		}
+	}
+}
+
+TEST(ProceduralMeshCountsAreClamped)
+{
+	CHECK(ProceduralMesh::GetSphereCounts(0, 0).vertexCount == ProceduralMesh::GetSphereCounts(ProceduralMesh::g_MinSlices, ProceduralMesh::g_MinStacks).vertexCount);
+	CHECK(ProceduralMesh::GetPlaneCounts(-1, 0).indexCount == 6);
+	CHECK(ProceduralMesh::GetCylinderCounts(1).vertexCount == ProceduralMesh::GetCylinderCounts(ProceduralMesh::g_MinSlices).vertexCount);
+	CHECK(ProceduralMesh::GetCapsuleCounts(3, 0).indexCount == ProceduralMesh::GetCapsuleCounts(3, ProceduralMesh::g_MinCapStacks).indexCount);
+
+	// The smallest sphere is two triangle fans around the poles
+	CHECK(ProceduralMesh::GetSphereCounts(3, 2).indexCount == 18);
+}
+
+TEST(ProceduralMeshNamesAreDistinct)
+{
+	// Every parameter on its own against values it is never set to, so no two calls ask for the same mesh
+	std::vector<std::string> names{};
+	for (const float size : { 1.f, 2.f, 0.1f, std::nextafter(0.1f, 1.f), 1e-3f, 100.f })
+	{
+		names.push_back(ProceduralMesh::GetBoxName(size, 0.5f, 0.25f));
+		names.push_back(ProceduralMesh::GetBoxName(0.5f, size, 0.25f));
+		names.push_back(ProceduralMesh::GetBoxName(0.5f, 0.25f, size));
+		for (const int count : { 3, 4, 16 })
+		{
+			names.push_back(ProceduralMesh::GetSphereName(size, count, 8));
+			names.push_back(ProceduralMesh::GetSphereName(size, 8, count));
+			names.push_back(ProceduralMesh::GetPlaneName(size, 0.5f, count, 2));
+			names.push_back(ProceduralMesh::GetPlaneName(0.5f, size, 2, count));
+			names.push_back(ProceduralMesh::GetCylinderName(size, 1000.f, count));
+			names.push_back(ProceduralMesh::GetCylinderName(0.5f, size, count));
+			names.push_back(ProceduralMesh::GetCapsuleName(size, 1000.f, count, 8));
+			names.push_back(ProceduralMesh::GetCapsuleName(size, 1000.f, 8, count));
+		}
+	}
+	const std::set<std::string> uniqueNames(names.begin(), names.end());
+	CHECK(uniqueNames.size() == names.size());
+
+	// A sphere and a box of the same size never share a mesh, the parameters are not mixed up either
+	CHECK(ProceduralMesh::GetSphereName(1.f, 16, 16) != ProceduralMesh::GetBoxName(1.f, 16.f, 16.f));
+	CHECK(ProceduralMesh::GetPlaneName(1.f, 2.f, 1, 1) != ProceduralMesh::GetPlaneName(2.f, 1.f, 1, 1));
+
+	// Parameters that generate the same mesh do share it
+	CHECK(ProceduralMesh::GetSphereName(1.f, 0, 0) == ProceduralMesh::GetSphereName(1.f, ProceduralMesh::g_MinSlices, ProceduralMesh::g_MinStacks));
+	CHECK(ProceduralMesh::GetCapsuleName(1.f, 0.5f, 8, 4) == ProceduralMesh::GetCapsuleName(1.f, 2.f, 8, 4));
+}
@@ -0,0 +1,162 @@
+#include "Test.h"
+
+#include "ResourceBudget.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Entries like the resource manager keeps them, a deque so they stay where they are
+	ResourceEntryBase& AddEntry(std::deque<ResourceEntryBase>& entries, const std::string& name, ResourceType type, bool reloadable = true)
+	{
+		ResourceEntryBase& entry = entries.emplace_back();
+		entry.name = name;
+		entry.type = type;
+		entry.reloadable = reloadable;
+		return entry;
+	}
+
+	// Loaded with one handle referencing it, the way a load for a handle ends
+	void Load(ResourceBudget& budget, ResourceEntryBase& entry, size_t memory)
+	{
+		budget.Acquire(entry);
+		budget.Update(entry, true, memory);
+	}
+
+	void Release(ResourceBudget& budget, ResourceEntryBase& entry)
+	{
+		if (budget.Release(entry))
+			budget.Update(entry, true, entry.memory);
+	}
+
+	// What the resource manager does after a release or a load, returns the names in the order they were evicted
+	std::vector<std::string> EnforceBudget(ResourceBudget& budget)
+	{
+		std::vector<std::string> evicted{};
+		while (ResourceEntryBase* pEntry = budget.GetEvictionCandidate())
+		{
+			evicted.push_back(pEntry->name);
+			budget.Update(*pEntry, false, 0);
+		}
+		return evicted;
+	}
+}
+
+TEST(UnreferencedResourcesAreEvictedLeastRecentlyUsedFirst)
+{
+	ResourceBudget budget{};
+	budget.SetBudget(250);
+	std::deque<ResourceEntryBase> entries{};
+	ResourceEntryBase& a = AddEntry(entries, "a", ResourceType::Mesh);
+	ResourceEntryBase& b = AddEntry(entries, "b", ResourceType::Mesh);
+	ResourceEntryBase& c = AddEntry(entries, "c", ResourceType::Texture);
+	Load(budget, a, 100);
+	Load(budget, b, 100);
+	Load(budget, c, 100);
+
+	// Over budget, but everything is referenced
+	CHECK(budget.GetMemory() == 300);
+	CHECK(budget.GetEvictionCandidate() == nullptr);
+
+	// Released first, so it goes first
+	Release(budget, a);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "a" }));
+	CHECK(budget.GetMemory() == 200);
+	CHECK(a.memory == 0 && !a.inLru);
+
+	// Within the budget they are kept, lowering it evicts them in the order they were released
+	Release(budget, c);
+	Release(budget, b);
+	CHECK(EnforceBudget(budget).empty());
+	budget.SetBudget(150);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "c" }));
+	budget.SetBudget(0);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "b" }));
+	CHECK(budget.GetMemory() == 0);
+}
+
+TEST(ReferencedResourcesAreNotEvicted)
+{
+	ResourceBudget budget{};
+	budget.SetBudget(250);
+	std::deque<ResourceEntryBase> entries{};
+	ResourceEntryBase& a = AddEntry(entries, "a", ResourceType::Mesh);
+	ResourceEntryBase& b = AddEntry(entries, "b", ResourceType::Mesh);
+	Load(budget, a, 100);
+	Load(budget, b, 100);
+	Release(budget, a);
+	Release(budget, b);
+
+	// A new handle to a released resource takes it out of the list, releasing it again makes it the most recent
+	budget.Acquire(a);
+	CHECK(a.referenceCount == 1 && !a.inLru);
+	Release(budget, a);
+	budget.SetBudget(150);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "b" }));
+
+	// Nothing goes while a handle is left, not even with no budget at all
+	budget.Acquire(a);
+	budget.Acquire(a);
+	budget.SetBudget(0);
+	CHECK(!budget.Release(a));
+	CHECK(EnforceBudget(budget).empty());
+	CHECK(budget.GetMemory() == 100);
+	CHECK(budget.Release(a));
+	budget.Update(a, true, a.memory);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "a" }));
+}
+
+TEST(ResourcesThatCanNotBeLoadedAgainAreNeverEvicted)
+{
+	ResourceBudget budget{};
+	budget.SetBudget(0);
+	std::deque<ResourceEntryBase> entries{};
+	ResourceEntryBase& generated = AddEntry(entries, "generated", ResourceType::Mesh, false);
+	ResourceEntryBase& file = AddEntry(entries, "file", ResourceType::Mesh);
+
+	// Added without a handle, the one from a file waits for eviction right away, e.g. the other submeshes of a file
+	budget.Update(generated, true, 100);
+	budget.Update(file, true, 100);
+	CHECK(!generated.inLru && file.inLru);
+	CHECK((EnforceBudget(budget) == std::vector<std::string>{ "file" }));
+	CHECK(budget.GetMemory() == 100);
+
+	budget.Acquire(generated);
+	Release(budget, generated);
+	CHECK(EnforceBudget(budget).empty());
+	CHECK(budget.GetMemory(ResourceType::Mesh) == 100);
+}
+
+TEST(ResourceMemoryIsCountedPerType)
+{
+	ResourceBudget budget{};
+	std::deque<ResourceEntryBase> entries{};
+	ResourceEntryBase& mesh = AddEntry(entries, "mesh", ResourceType::Mesh);
+	ResourceEntryBase& texture = AddEntry(entries, "texture", ResourceType::Texture);
+	Load(budget, mesh, 100);
+	Load(budget, texture, 40);
+	CHECK(budget.GetMemory(ResourceType::Mesh) == 100);
+	CHECK(budget.GetMemory(ResourceType::Texture) == 40);
+	CHECK(budget.GetMemory() == 140);
+
+	// Measured again when it changes, e.g. the mesh built its BVH or the texture streamed mips in
+	budget.Update(mesh, true, 130);
+	budget.Update(texture, true, 10);
+	CHECK(budget.GetMemory(ResourceType::Mesh) == 130);
+	CHECK(budget.GetMemory(ResourceType::Texture) == 10);
+
+	// A replaced resource counts with its own size, an unloaded one not at all
+	budget.Update(mesh, true, 70);
+	budget.Update(texture, false, 0);
+	CHECK(budget.GetMemory() == 70);
+
+	// Forgetting the list leaves the memory alone, the caller destroys the entries afterwards
+	Release(budget, mesh);
+	CHECK(mesh.inLru);
+	budget.Clear();
+	CHECK(!mesh.inLru);
+	budget.SetBudget(0);
+	CHECK(budget.GetEvictionCandidate() == nullptr);
+}
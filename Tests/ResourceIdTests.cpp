@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include "ResourceId.h"
+#include "ResourceManager.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// Same slot as the map picks while it has its first 16 slots, up to 12 ids
+	size_t GetHomeInFirstTable(ResourceId id)
+	{
+		return static_cast<size_t>((id * 11400714819323198485ull) >> 32) & 15;
+	}
+
+	std::vector<ResourceId> FindIdsWithHome(size_t home, size_t count, ResourceId& next)
+	{
+		std::vector<ResourceId> ids{};
+		for (; ids.size() < count; ++next)
+		{
+			if (GetHomeInFirstTable(next) == home)
+				ids.push_back(next);
+		}
+		return ids;
+	}
+}
+
+TEST(ResourceIdsIgnoreTheKindOfSlash)
+{
+	static_assert(GetResourceId("Resources/Models/biplane.obj") == GetResourceId("Resources\\Models\\biplane.obj"));
+	CHECK(GetResourceId("Resources/cube.obj") != GetResourceId("Resources/cube.ob"));
+	CHECK(GetResourceId("") == g_ResourceIdOffset);
+	CHECK(AppendResourceId(GetResourceId("Resources/"), "cube.obj") == GetResourceId("Resources/cube.obj"));
+}
+
+TEST(SubmeshIdsMatchTheirNames)
+{
+	const std::string file{ "Resources/vehicle.obj" };
+	for (const int submeshId : { 0, 1, 9, 10, 12, 123456 })
+		CHECK(ResourceManager::GetSubmeshId(GetResourceId(file), submeshId) == GetResourceId(ResourceManager::GetSubmeshName(file, submeshId)));
+}
+
+TEST(ResourceIdMapMatchesUnorderedMap)
+{
+	ResourceIdMap<int> map{};
+	std::unordered_map<ResourceId, int> expected{};
+	std::mt19937_64 random{ 1 };
+	size_t mismatchCount{};
+	for (int operation = 0; operation < 200000; ++operation)
+	{
+		// Few keys, so the map grows, fills up and erases in long clusters
+		const ResourceId id = random() % 3000 + 1;
+		switch (random() % 3)
+		{
+		case 0:
+			if (map.Insert(id, operation) != expected.emplace(id, operation).second)
+				++mismatchCount;
+			break;
+		case 1:
+			if (map.Erase(id) != (expected.erase(id) > 0))
+				++mismatchCount;
+			break;
+		default:
+		{
+			const int* pValue = map.Find(id);
+			const auto it = expected.find(id);
+			if ((pValue != nullptr) != (it != expected.end()) || (pValue && *pValue != it->second))
+				++mismatchCount;
+			break;
+		}
+		}
+		if (map.GetSize() != expected.size())
+			++mismatchCount;
+	}
+	CHECK(mismatchCount == 0);
+
+	size_t count{};
+	map.ForEach([&](ResourceId id, int value)
+		{
+			++count;
+			const auto it = expected.find(id);
+			CHECK(it != expected.end() && it->second == value);
+		});
+	CHECK(count == expected.size());
+
+	map.Clear();
+	CHECK(map.GetSize() == 0);
+	CHECK(map.Find(1) == nullptr);
+	CHECK(map.Insert(1, 5) && *map.Find(1) == 5);
+}
+
+TEST(ResourceIdMapEraseKeepsTheClusterFindable)
+{
+	// One cluster that wraps around the end of the table: ids that want the last slot, then ids that want the first.
+	// Erasing any of them has to shift the rest back so no lookup stops at the hole.
+	ResourceId next{ 1 };
+	std::vector<ResourceId> ids = FindIdsWithHome(15, 4, next);
+	const std::vector<ResourceId> first = FindIdsWithHome(0, 3, next);
+	ids.insert(ids.end(), first.begin(), first.end());
+	const std::vector<ResourceId> second = FindIdsWithHome(1, 2, next);
+	ids.insert(ids.end(), second.begin(), second.end());
+
+	for (size_t erased = 0; erased < ids.size(); ++erased)
+	{
+		ResourceIdMap<size_t> map{};
+		for (size_t i = 0; i < ids.size(); ++i)
+			REQUIRE(map.Insert(ids[i], i));
+
+		CHECK(map.Erase(ids[erased]));
+		CHECK(!map.Erase(ids[erased]));
+		CHECK(map.GetSize() == ids.size() - 1);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			const size_t* pValue = map.Find(ids[i]);
+			CHECK(i == erased ? pValue == nullptr : pValue != nullptr && *pValue == i);
+		}
+
+		// Erasing the rest in another order empties it again
+		for (size_t i = ids.size(); i-- > 0;)
+		{
+			if (i != erased)
+				CHECK(map.Erase(ids[i]));
+		}
+		CHECK(map.GetSize() == 0);
+		for (const ResourceId id : ids)
+			CHECK(!map.Contains(id));
+	}
+}
+
+TEST(ResourceIdSetKeepsEachIdOnce)
+{
+	ResourceIdSet set{};
+	CHECK(set.Insert(GetResourceId("Resources/cube.obj")));
+	CHECK(!set.Insert(GetResourceId("Resources\\cube.obj")));
+	CHECK(set.Contains(GetResourceId("Resources/cube.obj")));
+	CHECK(set.GetSize() == 1);
+	CHECK(set.Erase(GetResourceId("Resources/cube.obj")));
+	CHECK(!set.Contains(GetResourceId("Resources/cube.obj")));
+}
+
+TEST(NameTableStoresEveryIdOnce)
+{
+	ResourceManager* pResourceManager = ResourceManager::GetInstance();
+	const ResourceId cube = pResourceManager->Intern("ResourceIdTests/cube.obj");
+	const ResourceId vehicle = pResourceManager->Intern("ResourceIdTests/vehicle.obj");
+	CHECK(pResourceManager->Intern("ResourceIdTests\\cube.obj") == cube);
+	CHECK(pResourceManager->GetName(cube) == "ResourceIdTests/cube.obj");
+	CHECK(pResourceManager->GetName(GetResourceId("ResourceIdTests/unknown.obj")).empty());
+
+	pResourceManager->BeginNameTable();
+	pResourceManager->AddToNameTable(vehicle);
+	pResourceManager->AddToNameTable(cube);
+	pResourceManager->AddToNameTable(vehicle);
+	CHECK((pResourceManager->GetNameTable() == std::vector<ResourceId>{ vehicle, cube }));
+	pResourceManager->BeginNameTable();
+	CHECK(pResourceManager->GetNameTable().empty());
+
+	// A scene read back gives its names, an id that does not belong to its name is refused
+	CHECK(pResourceManager->ReadNameTable({ { GetResourceId("ResourceIdTests/biplane.obj"), "ResourceIdTests/biplane.obj" } }));
+	CHECK(pResourceManager->GetName(GetResourceId("ResourceIdTests/biplane.obj")) == "ResourceIdTests/biplane.obj");
+	CHECK(!pResourceManager->ReadNameTable({ { cube, "ResourceIdTests/other.obj" } }));
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// A minimal test runner for the CPU side of the engine. Every TEST registers itself before main runs,
+// a failed CHECK is reported and the test carries on, REQUIRE stops the test.
+namespace Test
+{
+	using Function = void(*)();
+
+	struct Case
+	{
+		const char* pName{};
+		Function function{};
+	};
+
+	std::vector<Case>& GetCases();
+	void Fail(const char* pExpression, const char* pFile, int line);
+	// Set by --update-goldens, the golden tests write what they got instead of comparing against it
+	bool IsUpdatingGoldens();
+
+	struct Registrar
+	{
+		Registrar(const char* pName, Function function)
+		{
+			GetCases().push_back(Case{ pName, function });
+		}
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const Test::Registrar g_##name##Registrar{ #name, name }; \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) Test::Fail(#expression, __FILE__, __LINE__); } while (false)
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { Test::Fail(#expression, __FILE__, __LINE__); return; } } while (false)
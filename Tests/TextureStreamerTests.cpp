@@ -0,0 +1,423 @@
+#include "Test.h"
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// A square RGBA8 texture of size texels, mips from tailMip down are always resident
+	TextureStreamer::TextureInfo CreateInfo(uint32_t size, uint32_t tailMip)
+	{
+		TextureStreamer::TextureInfo info{};
+		info.width = size;
+		info.height = size;
+		info.tailMip = tailMip;
+		for (uint32_t mipSize = size; mipSize > 0; mipSize /= 2)
+			info.mipSizes[info.mipCount++] = size_t(mipSize) * mipSize * 4;
+		return info;
+	}
+
+	// Memory of a texture when the mips from mip down are resident
+	size_t GetSize(const TextureStreamer::TextureInfo& info, uint32_t mip)
+	{
+		size_t size{};
+		for (; mip < info.mipCount; ++mip)
+			size += info.mipSizes[mip];
+		return size;
+	}
+
+	void Update(TextureStreamer& streamer)
+	{
+		std::vector<TextureStreamer::Change> evictions{};
+		streamer.Update(evictions);
+	}
+
+	// Pops a load and finishes it right away, the way the resource manager does when the mips upload
+	bool Load(TextureStreamer& streamer, TextureStreamer::Change& load, std::vector<TextureStreamer::Change>& evictions)
+	{
+		if (!streamer.PopLoad(load, evictions))
+			return false;
+		streamer.SetResidentMip(load.slot, load.mip);
+		return true;
+	}
+}
+
+TEST(StreamedMipsHaveOneTexelPerPixel)
+{
+	CHECK(TextureStreamer::GetMip(256, 256, 256.f) == 0);
+	CHECK(TextureStreamer::GetMip(256, 256, 300.f) == 0);
+	CHECK(TextureStreamer::GetMip(256, 256, 128.f) == 1);
+	CHECK(TextureStreamer::GetMip(256, 256, 100.f) == 1);
+	CHECK(TextureStreamer::GetMip(256, 256, 1.f) == 8);
+	// The longest edge counts
+	CHECK(TextureStreamer::GetMip(64, 256, 64.f) == 2);
+	CHECK(TextureStreamer::GetMip(256, 256, 0.f) == TextureStreamer::g_MaxMipCount);
+}
+
+TEST(RequestsSetTheWantedMip)
+{
+	TextureStreamer streamer{};
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	CHECK(streamer.Register(TextureStreamer::TextureInfo{}) == TextureStreamer::g_InvalidSlot);
+	CHECK(streamer.Register(CreateInfo(256, 9)) == TextureStreamer::g_InvalidSlot);
+
+	// Only the tail is resident to begin with
+	const uint32_t slot = streamer.Register(info);
+	REQUIRE(slot != TextureStreamer::g_InvalidSlot);
+	CHECK(streamer.GetResidentMip(slot) == 5);
+	CHECK(streamer.GetWantedMip(slot) == 5);
+	CHECK(streamer.GetMemory() == GetSize(info, 5));
+
+	// The biggest request of a frame counts
+	streamer.Request(slot, 32.f);
+	streamer.Request(slot, 64.f);
+	streamer.Request(slot, 16.f);
+	Update(streamer);
+	CHECK(streamer.GetWantedMip(slot) == 2);
+	CHECK(streamer.GetStats().queued == 1);
+
+	// Smaller than the tail is the tail, magnified is the full size
+	TextureStreamer other{};
+	const uint32_t small = other.Register(info);
+	const uint32_t large = other.Register(info);
+	other.Request(small, 1.f);
+	other.Request(large, 1000.f);
+	Update(other);
+	CHECK(other.GetWantedMip(small) == 5);
+	CHECK(other.GetWantedMip(large) == 0);
+	CHECK(other.GetStats().queued == 1);
+}
+
+TEST(WantedMipsExpireAfterTheKeepFrames)
+{
+	TextureStreamer streamer{};
+	streamer.SetKeepFrames(3);
+	const uint32_t slot = streamer.Register(CreateInfo(256, 5));
+
+	// Drawn big once, then small every frame
+	streamer.Request(slot, 128.f);
+	Update(streamer);
+	CHECK(streamer.GetWantedMip(slot) == 1);
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		streamer.Request(slot, 32.f);
+		Update(streamer);
+		CHECK(streamer.GetWantedMip(slot) == 1);
+	}
+	streamer.Request(slot, 32.f);
+	Update(streamer);
+	CHECK(streamer.GetWantedMip(slot) == 3);
+
+	// Not drawn at all
+	for (int frame = 0; frame < 3; ++frame)
+		Update(streamer);
+	CHECK(streamer.GetWantedMip(slot) == 3);
+	Update(streamer);
+	CHECK(streamer.GetWantedMip(slot) == 5);
+}
+
+TEST(PopLoadReservesTheMemoryOfTheLoad)
+{
+	TextureStreamer streamer{};
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	const uint32_t closeSlot = streamer.Register(info);
+	const uint32_t distantSlot = streamer.Register(info);
+
+	// Missing the most levels for its size on screen goes first
+	streamer.Request(distantSlot, 32.f);
+	streamer.Request(closeSlot, 256.f);
+	Update(streamer);
+	CHECK(streamer.GetStats().queued == 2);
+
+	std::vector<TextureStreamer::Change> evictions{};
+	TextureStreamer::Change load{};
+	REQUIRE(streamer.PopLoad(load, evictions));
+	CHECK(load.slot == closeSlot && load.mip == 0);
+	CHECK(streamer.IsLoading(closeSlot));
+	CHECK(streamer.GetResidentMip(closeSlot) == 5);
+	CHECK(streamer.GetMemory() == GetSize(info, 0) + GetSize(info, 5));
+	CHECK(streamer.GetStats().loading == 1);
+
+	REQUIRE(streamer.PopLoad(load, evictions));
+	CHECK(load.slot == distantSlot && load.mip == 3);
+	CHECK(!streamer.PopLoad(load, evictions));
+	CHECK(evictions.empty());
+
+	// Finishing a load keeps the memory it reserved
+	streamer.SetResidentMip(closeSlot, 0);
+	streamer.SetResidentMip(distantSlot, 3);
+	CHECK(!streamer.IsLoading(closeSlot) && streamer.GetResidentMip(closeSlot) == 0);
+	CHECK(streamer.GetMemory() == GetSize(info, 0) + GetSize(info, 3));
+	const TextureStreamer::Stats stats = streamer.GetStats();
+	CHECK(stats.loading == 0);
+	CHECK(stats.loadCount == 2);
+
+	// Nothing is queued once the textures have what they want
+	streamer.Request(closeSlot, 256.f);
+	streamer.Request(distantSlot, 32.f);
+	Update(streamer);
+	CHECK(streamer.GetStats().queued == 0);
+}
+
+TEST(PopLoadLoadsAsManyMipsAsFit)
+{
+	TextureStreamer streamer{};
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	streamer.SetBudget(GetSize(info, 2));
+	const uint32_t slot = streamer.Register(info);
+	streamer.Request(slot, 256.f);
+	Update(streamer);
+
+	std::vector<TextureStreamer::Change> evictions{};
+	TextureStreamer::Change load{};
+	REQUIRE(Load(streamer, load, evictions));
+	CHECK(load.mip == 2);
+	CHECK(streamer.GetMemory() == GetSize(info, 2));
+
+	// Still wanted, but nothing can make room
+	streamer.Request(slot, 256.f);
+	Update(streamer);
+	CHECK(!streamer.PopLoad(load, evictions));
+	CHECK(streamer.GetMemory() <= streamer.GetBudget());
+}
+
+TEST(LoadsEvictTheLeastRecentlyUsedMips)
+{
+	TextureStreamer streamer{};
+	streamer.SetKeepFrames(2);
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	// The tails of three textures and two of them at mip 1
+	streamer.SetBudget(GetSize(info, 5) + 2 * GetSize(info, 1));
+	const uint32_t first = streamer.Register(info);
+	const uint32_t second = streamer.Register(info);
+	const uint32_t third = streamer.Register(info);
+
+	std::vector<TextureStreamer::Change> evictions{};
+	TextureStreamer::Change load{};
+	streamer.Request(first, 128.f);
+	streamer.Request(second, 128.f);
+	Update(streamer);
+	CHECK(Load(streamer, load, evictions));
+	CHECK(Load(streamer, load, evictions));
+	CHECK(streamer.GetMemory() == streamer.GetBudget());
+
+	// Both go unused, the first one earlier
+	streamer.Request(second, 128.f);
+	Update(streamer);
+	for (int frame = 0; frame < 3; ++frame)
+		Update(streamer);
+	CHECK(streamer.GetWantedMip(first) == 5);
+	CHECK(streamer.GetWantedMip(second) == 5);
+	// Unused mips stay while they fit
+	CHECK(streamer.GetResidentMip(first) == 1);
+	CHECK(streamer.GetResidentMip(second) == 1);
+
+	streamer.Request(third, 128.f);
+	Update(streamer);
+	REQUIRE(Load(streamer, load, evictions));
+	CHECK(load.slot == third && load.mip == 1);
+	REQUIRE(evictions.size() == 1);
+	CHECK(evictions[0].slot == first && evictions[0].mip == 5);
+	CHECK(streamer.GetResidentMip(first) == 5);
+	CHECK(streamer.GetResidentMip(second) == 1);
+	CHECK(streamer.GetMemory() == streamer.GetBudget());
+	CHECK(streamer.GetStats().evictionCount == 1);
+}
+
+TEST(LoweringTheStreamingBudgetEvicts)
+{
+	TextureStreamer streamer{};
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	const uint32_t first = streamer.Register(info);
+	const uint32_t second = streamer.Register(info);
+
+	std::vector<TextureStreamer::Change> evictions{};
+	TextureStreamer::Change load{};
+	streamer.Request(first, 256.f);
+	streamer.Request(second, 256.f);
+	Update(streamer);
+	CHECK(Load(streamer, load, evictions));
+	CHECK(Load(streamer, load, evictions));
+
+	// Both still wanted, the one that was asked for the longest time ago goes down to its tail
+	streamer.Request(first, 256.f);
+	Update(streamer);
+	streamer.SetBudget(GetSize(info, 0) + GetSize(info, 5));
+	streamer.Request(first, 256.f);
+	streamer.Update(evictions);
+	REQUIRE(evictions.size() == 1);
+	CHECK(evictions[0].slot == second && evictions[0].mip == 5);
+	CHECK(streamer.GetResidentMip(first) == 0);
+	CHECK(streamer.GetMemory() == streamer.GetBudget());
+
+	// Below the tails there is nothing left to evict
+	evictions.clear();
+	streamer.SetBudget(0);
+	streamer.Update(evictions);
+	CHECK(evictions.size() == 1);
+	CHECK(streamer.GetMemory() == 2 * GetSize(info, 5));
+	CHECK(!streamer.PopLoad(load, evictions));
+}
+
+TEST(FailedAndUnregisteredTexturesGiveBackTheirMemory)
+{
+	TextureStreamer streamer{};
+	const TextureStreamer::TextureInfo info = CreateInfo(256, 5);
+	const uint32_t failing = streamer.Register(info);
+	const uint32_t removed = streamer.Register(info);
+	streamer.Request(failing, 256.f);
+	streamer.Request(removed, 256.f);
+	Update(streamer);
+
+	std::vector<TextureStreamer::Change> evictions{};
+	TextureStreamer::Change load{};
+	REQUIRE(streamer.PopLoad(load, evictions));
+	REQUIRE(streamer.PopLoad(load, evictions));
+	CHECK(streamer.GetStats().loading == 2);
+
+	// A failed texture keeps what it has and is not queued again
+	streamer.OnLoadFailed(failing);
+	CHECK(!streamer.IsLoading(failing));
+	CHECK(streamer.GetResidentMip(failing) == 5);
+	CHECK(streamer.GetStats().loading == 1);
+	CHECK(streamer.GetMemory() == GetSize(info, 5) + GetSize(info, 0));
+
+	// Removed while it loads, its reservation goes with it and its slot is used again
+	streamer.Unregister(removed);
+	CHECK(!streamer.IsRegistered(removed));
+	CHECK(streamer.GetStats().loading == 0);
+	CHECK(streamer.GetStats().textureCount == 1);
+	CHECK(streamer.GetMemory() == GetSize(info, 5));
+	streamer.SetResidentMip(removed, 0);
+	CHECK(streamer.GetMemory() == GetSize(info, 5));
+
+	streamer.Request(failing, 256.f);
+	Update(streamer);
+	CHECK(streamer.GetStats().queued == 0);
+
+	const TextureStreamer::TextureInfo smallInfo = CreateInfo(64, 3);
+	CHECK(streamer.Register(smallInfo) == removed);
+	CHECK(streamer.GetResidentMip(removed) == 3);
+	CHECK(streamer.GetMemory() == GetSize(info, 5) + GetSize(smallInfo, 3));
+}
+
+TEST(StreamingBookkeepingStaysConsistent)
+{
+	struct Texture
+	{
+		TextureStreamer::TextureInfo info{};
+		uint32_t resident{};
+		uint32_t loading{};
+		int framesUntilDone{};
+		bool registered{};
+	};
+
+	TextureStreamer streamer{};
+	streamer.SetKeepFrames(10);
+	std::vector<Texture> textures{};
+	std::mt19937 random{ 50 };
+	size_t mismatchCount{};
+	size_t overBudgetCount{};
+
+	const auto applyEvictions = [&textures](const std::vector<TextureStreamer::Change>& evictions)
+		{
+			for (const TextureStreamer::Change& eviction : evictions)
+			{
+				textures[eviction.slot].resident = eviction.mip;
+				textures[eviction.slot].loading = eviction.mip;
+			}
+		};
+
+	for (int frame = 0; frame < 2000; ++frame)
+	{
+		// Textures come and go
+		if (random() % 8 == 0)
+		{
+			const TextureStreamer::TextureInfo info = CreateInfo(1u << (4 + random() % 7), 3);
+			const uint32_t slot = streamer.Register(info);
+			if (slot >= textures.size())
+				textures.resize(slot + 1);
+			textures[slot] = Texture{ info, 3, 3, 0, true };
+		}
+		if (random() % 16 == 0 && !textures.empty())
+		{
+			const uint32_t slot = static_cast<uint32_t>(random() % textures.size());
+			if (textures[slot].registered)
+			{
+				streamer.Unregister(slot);
+				textures[slot].registered = false;
+			}
+		}
+		if (random() % 100 == 0)
+			streamer.SetBudget(size_t(20000) + random() % 400000);
+
+		for (uint32_t slot = 0; slot < textures.size(); ++slot)
+		{
+			if (textures[slot].registered && random() % 3 == 0)
+				streamer.Request(slot, static_cast<float>(random() % 1200));
+		}
+
+		std::vector<TextureStreamer::Change> evictions{};
+		streamer.Update(evictions);
+		applyEvictions(evictions);
+
+		// A few loads start every frame and take some frames, now and then one fails
+		for (int i = 0; i < 3; ++i)
+		{
+			evictions.clear();
+			TextureStreamer::Change load{};
+			// It can evict for a load that does not fit in the end as well
+			const bool started = streamer.PopLoad(load, evictions);
+			applyEvictions(evictions);
+			if (!started)
+				break;
+			textures[load.slot].loading = load.mip;
+			textures[load.slot].framesUntilDone = static_cast<int>(random() % 4);
+			if (streamer.GetMemory() > streamer.GetBudget())
+				++overBudgetCount;
+		}
+		for (uint32_t slot = 0; slot < textures.size(); ++slot)
+		{
+			Texture& texture = textures[slot];
+			if (!texture.registered || texture.loading == texture.resident || texture.framesUntilDone-- > 0)
+				continue;
+
+			if (random() % 20 == 0)
+				streamer.OnLoadFailed(slot);
+			else
+			{
+				streamer.SetResidentMip(slot, texture.loading);
+				texture.resident = texture.loading;
+			}
+			texture.loading = texture.resident;
+		}
+
+		// The memory is what is resident plus what is loading, and every texture is where the evictions put it
+		size_t memory{};
+		uint32_t loading{};
+		size_t registered{};
+		for (uint32_t slot = 0; slot < textures.size(); ++slot)
+		{
+			const Texture& texture = textures[slot];
+			if (!texture.registered)
+				continue;
+			memory += GetSize(texture.info, (std::min)(texture.resident, texture.loading));
+			loading += texture.loading != texture.resident ? 1 : 0;
+			++registered;
+			if (streamer.GetResidentMip(slot) != texture.resident || streamer.IsLoading(slot) != (texture.loading != texture.resident))
+				++mismatchCount;
+		}
+		const TextureStreamer::Stats stats = streamer.GetStats();
+		if (stats.memory != memory || stats.loading != loading || stats.textureCount != registered)
+			++mismatchCount;
+	}
+
+	CHECK(mismatchCount == 0);
+	CHECK(overBudgetCount == 0);
+	CHECK(streamer.GetStats().loadCount > 0);
+	CHECK(streamer.GetStats().evictionCount > 0);
+}
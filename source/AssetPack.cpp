@@ -0,0 +1,339 @@
+#include "AssetPack.h"
+
+#pragma warning (push, 0)
+#include "OBJParser.h"
+#pragma warning(pop)
+
+#include "JobSystem.h"
+#include "Logger.h"
+#include "MeshCache.h"
+#include "ResourceManager.h"
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	inline size_t AlignUp(size_t value)
+	{
+		return (value + AssetPacker::g_EntryAlignment - 1) & ~(AssetPacker::g_EntryAlignment - 1);
+	}
+}
+
+AssetType AssetPacker::GetAssetType(const std::string& filename)
+{
+	std::string extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	if (extension == ".obj")
+		return AssetType::Mesh;
+	if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga" || extension == ".tif" || extension == ".dds"
+		|| extension == ".raw")
+		return AssetType::Texture;
+	if (extension == ".fx" || extension == ".hlsl")
+		return AssetType::Effect;
+	if (extension == ".json")
+		return AssetType::Scene;
+	return AssetType::Other;
+}
+
+std::vector<std::string> AssetPacker::GatherFiles(const std::string& directory)
+{
+	std::vector<std::string> files{};
+	std::error_code error{};
+	for (const auto& file : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (file.is_regular_file())
+			files.emplace_back(file.path().generic_string());
+	}
+
+	// Levels are loaded by their name relative to the working directory
+	for (const auto& file : std::filesystem::directory_iterator(".", error))
+	{
+		if (file.is_regular_file() && file.path().extension() == ".json")
+			files.emplace_back(file.path().filename().generic_string());
+	}
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+bool AssetPacker::Build(const std::string& packFile, const std::vector<std::string>& files, BlockCompressor::Quality textureQuality)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	struct Source
+	{
+		IndexEntry entry{};
+		std::string name{};
+		std::unique_ptr<CookedMesh> pCooked{};
+		std::unique_ptr<MappedFile> pFile{};
+		std::vector<char> cookedTexture{};
+		TextureCooker::Stats textureStats{};
+		const char* pData{};
+	};
+	std::vector<Source> sources(files.size());
+
+	// Cooking dominates, every mesh and texture is cooked on its own worker. The block compressor splits a texture
+	// over the workers again.
+	JobSystem::GetInstance()->ParallelFor(files.size(), [&](size_t i)
+	{
+		Source& source = sources[i];
+		source.name = files[i];
+		source.entry.id = GetResourceId(files[i]);
+		source.entry.type = GetAssetType(files[i]);
+
+		if (source.entry.type == AssetType::Mesh)
+		{
+			source.entry.flags = GetOBJImportFlags(true, true);
+			source.pCooked = ImportOBJ(files[i], true, true);
+			if (source.pCooked == nullptr)
+				return;
+			source.pData = source.pCooked->GetData();
+			source.entry.size = source.pCooked->GetSize();
+		}
+		else
+		{
+			source.pFile = std::make_unique<MappedFile>(files[i]);
+			if (!source.pFile->IsOpen())
+				return;
+			source.pData = source.pFile->GetData();
+			source.entry.size = source.pFile->GetSize();
+
+			// A texture that can not be decoded is stored as is, the engine reports it when it loads the texture
+			const auto* pFileData = reinterpret_cast<const uint8_t*>(source.pData);
+			if (source.entry.type == AssetType::Texture && TextureCooker::CanCook(files[i], pFileData, source.pFile->GetSize())
+				&& TextureCooker::Cook(files[i], pFileData, source.pFile->GetSize(), textureQuality, source.cookedTexture, &source.textureStats))
+			{
+				source.pData = source.cookedTexture.data();
+				source.entry.size = source.cookedTexture.size();
+
+				const TextureCooker::Stats& stats = source.textureStats;
+				char psnr[32]{ ", uncompressed" };
+				if (TextureCooker::IsCompressed(stats.format))
+					std::snprintf(psnr, sizeof(psnr), ", PSNR %.2f dB", stats.psnr);
+				char summary[256]{};
+				std::snprintf(summary, sizeof(summary), " %ux%u %s with %u mips, %zu KB to %zu KB%s in %.2f ms", stats.width, stats.height,
+					TextureCooker::GetFormatName(stats.format), stats.mipCount, stats.uncompressedSize / 1024, stats.cookedSize / 1024, psnr, stats.milliseconds);
+				Logger::GetInstance()->LogInfo("AssetPacker: cooked " + files[i] + summary);
+			}
+		}
+	});
+
+	// Files that could not be read or cooked are left out, the engine falls back to the loose file for them
+	sources.erase(std::remove_if(sources.begin(), sources.end(), [](const Source& source)
+	{
+		if (source.pCooked == nullptr && (source.pFile == nullptr || !source.pFile->IsOpen()))
+		{
+			Logger::GetInstance()->LogWarning("AssetPacker: could not pack " + source.name);
+			return true;
+		}
+		return false;
+	}), sources.end());
+
+	std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.entry.id < b.entry.id; });
+	sources.erase(std::unique(sources.begin(), sources.end(), [](const Source& a, const Source& b)
+	{
+		if (a.entry.id != b.entry.id)
+			return false;
+		Logger::GetInstance()->LogWarning("AssetPacker: " + b.name + " has the same id as " + a.name + ", only the first is packed");
+		return true;
+	}), sources.end());
+
+	FileHeader header{};
+	header.entryCount = static_cast<uint32_t>(sources.size());
+	for (Source& source : sources)
+	{
+		source.entry.nameOffset = header.nameBytes;
+		source.entry.nameLength = static_cast<uint32_t>(source.name.size());
+		header.nameBytes += source.entry.nameLength;
+	}
+
+	size_t offset = AlignUp(sizeof(FileHeader) + sizeof(IndexEntry) * sources.size() + header.nameBytes);
+	for (Source& source : sources)
+	{
+		source.entry.offset = offset;
+		offset = AlignUp(offset + source.entry.size);
+	}
+	const size_t packSize = offset;
+
+	std::error_code error{};
+	if (std::filesystem::path(packFile).has_parent_path())
+		std::filesystem::create_directories(std::filesystem::path(packFile).parent_path(), error);
+
+	const std::string temporary = packFile + ".tmp";
+	{
+		std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			Logger::GetInstance()->LogWarning("AssetPacker: could not write " + temporary);
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const Source& source : sources)
+			file.write(reinterpret_cast<const char*>(&source.entry), sizeof(IndexEntry));
+		for (const Source& source : sources)
+			file.write(source.name.data(), source.name.size());
+
+		static const char padding[g_EntryAlignment]{};
+		size_t position = sizeof(FileHeader) + sizeof(IndexEntry) * sources.size() + header.nameBytes;
+		for (const Source& source : sources)
+		{
+			file.write(padding, source.entry.offset - position);
+			if (source.entry.size > 0)
+				file.write(source.pData, source.entry.size);
+			position = source.entry.offset + source.entry.size;
+		}
+		file.write(padding, packSize - position);
+
+		if (!file)
+		{
+			Logger::GetInstance()->LogWarning("AssetPacker: could not write " + temporary);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, packFile, error);
+	if (error)
+	{
+		Logger::GetInstance()->LogWarning("AssetPacker: could not replace " + packFile + ", is it still mounted?");
+		return false;
+	}
+
+	size_t textureCount{};
+	size_t uncompressedSize{};
+	size_t cookedSize{};
+	for (const Source& source : sources)
+	{
+		if (source.cookedTexture.empty())
+			continue;
+		++textureCount;
+		uncompressedSize += source.textureStats.uncompressedSize;
+		cookedSize += source.textureStats.cookedSize;
+	}
+	if (textureCount > 0)
+	{
+		Logger::GetInstance()->LogInfo("AssetPacker: cooked " + std::to_string(textureCount) + " textures at " + BlockCompressor::GetQualityName(textureQuality)
+			+ " quality, " + std::to_string(uncompressedSize / 1024) + " KB of uncompressed mips to " + std::to_string(cookedSize / 1024) + " KB");
+	}
+
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Logger::GetInstance()->LogInfo("AssetPacker: packed " + std::to_string(sources.size()) + " files into " + packFile + " ("
+		+ std::to_string(packSize / 1024) + " KB) in " + std::to_string(milliseconds) + " ms");
+	return true;
+}
+
+AssetPack::AssetPack(const std::string& filename)
+	: m_File{ filename }
+{
+	Validate();
+}
+
+const AssetPacker::IndexEntry* AssetPack::Find(ResourceId id) const
+{
+	const AssetPacker::IndexEntry* pEnd = m_pEntries + m_EntryCount;
+	const AssetPacker::IndexEntry* pEntry = std::lower_bound(m_pEntries, pEnd, id, [](const AssetPacker::IndexEntry& entry, ResourceId value) { return entry.id < value; });
+	return pEntry != pEnd && pEntry->id == id ? pEntry : nullptr;
+}
+
+std::string_view AssetPack::GetData(const AssetPacker::IndexEntry& entry) const
+{
+	return std::string_view{ m_File.GetData() + entry.offset, static_cast<size_t>(entry.size) };
+}
+
+std::string_view AssetPack::GetName(const AssetPacker::IndexEntry& entry) const
+{
+	return std::string_view{ m_pNames + entry.nameOffset, entry.nameLength };
+}
+
+void AssetPack::Validate()
+{
+	using namespace AssetPacker;
+
+	const size_t size = m_File.GetSize();
+	if (m_File.GetData() == nullptr || size < sizeof(FileHeader))
+		return;
+
+	const auto* pHeader = reinterpret_cast<const FileHeader*>(m_File.GetData());
+	if (pHeader->magic != g_Magic || pHeader->formatVersion != g_FormatVersion)
+		return;
+
+	const size_t tableSize = sizeof(FileHeader) + sizeof(IndexEntry) * size_t(pHeader->entryCount) + pHeader->nameBytes;
+	if (tableSize > size)
+		return;
+
+	const auto* pEntries = reinterpret_cast<const IndexEntry*>(m_File.GetData() + sizeof(FileHeader));
+	for (uint32_t i = 0; i < pHeader->entryCount; ++i)
+	{
+		const IndexEntry& entry = pEntries[i];
+		// The binary search needs every id once, in order
+		if (i > 0 && entry.id <= pEntries[i - 1].id)
+			return;
+		if (entry.offset % g_EntryAlignment != 0 || entry.offset < tableSize || entry.offset > size || size - entry.offset < entry.size)
+			return;
+		if (size_t(entry.nameOffset) + entry.nameLength > pHeader->nameBytes)
+			return;
+	}
+
+	m_pEntries = pEntries;
+	m_EntryCount = pHeader->entryCount;
+	m_pNames = reinterpret_cast<const char*>(pEntries + pHeader->entryCount);
+	m_NameBytes = pHeader->nameBytes;
+	m_Valid = true;
+}
+
+AssetFile::AssetFile(const std::string& filename)
+{
+	// Packed meshes hold the cooked data instead of the source, ImportOBJ looks those up itself
+	if (const AssetPack* pPack = ResourceManager::GetInstance()->GetPack())
+	{
+		const AssetPacker::IndexEntry* pEntry = pPack->Find(GetResourceId(filename));
+		if (pEntry != nullptr && pEntry->type != AssetType::Mesh)
+		{
+			m_Data = pPack->GetData(*pEntry);
+			m_Open = true;
+			m_Packed = true;
+			return;
+		}
+	}
+
+	m_pLooseFile = std::make_unique<MappedFile>(filename);
+	if (!m_pLooseFile->IsOpen())
+		return;
+
+	m_Data = std::string_view{ m_pLooseFile->GetData(), m_pLooseFile->GetSize() };
+	m_Open = true;
+}
+
+AssetStreamBuffer::AssetStreamBuffer(const AssetFile& file)
+{
+	// Only ever read, the get area just wants non const pointers
+	char* pData = const_cast<char*>(file.GetData());
+	setg(pData, pData, pData + file.GetSize());
+}
+
+AssetStreamBuffer::pos_type AssetStreamBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+	if (direction == std::ios_base::cur)
+		offset += gptr() - eback();
+	else if (direction == std::ios_base::end)
+		offset += egptr() - eback();
+
+	return seekpos(pos_type(offset), which);
+}
+
+AssetStreamBuffer::pos_type AssetStreamBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+	const off_type offset = off_type(position);
+	if (!(which & std::ios_base::in) || offset < 0 || offset > egptr() - eback())
+		return pos_type(off_type(-1));
+
+	setg(eback(), eback() + offset, egptr());
+	return position;
+}
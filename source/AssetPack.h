@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "MappedFile.h"
+#include "ResourceId.h"
+
+enum class AssetType : uint32_t
+{
+	Mesh,			// Cooked, see MeshCache
+	Texture,
+	Effect,
+	Scene,
+	Other
+};
+
+// Single file archive of the cooked meshes, cooked textures, effects and level files. It is mapped once at startup so
+// loading a resource does not open a file, the entries are found with a binary search over an index sorted by
+// resource id and handed out as views into the mapping.
+// Layout: FileHeader, IndexEntry[entryCount] sorted by id, name characters, then the data of every entry aligned to
+// g_EntryAlignment.
+namespace AssetPacker
+{
+	constexpr uint32_t g_Magic{ 0x4B415041 }; // "APAK"
+	constexpr uint32_t g_FormatVersion{ 1 };
+	// A cache line, also covers the 16 byte alignment the cooked mesh data is validated against
+	constexpr size_t g_EntryAlignment{ 64 };
+
+	struct FileHeader
+	{
+		uint32_t magic{ g_Magic };
+		uint32_t formatVersion{ g_FormatVersion };
+		uint32_t entryCount{};
+		uint32_t nameBytes{};
+	};
+
+	struct IndexEntry
+	{
+		ResourceId id{};				// Of the path the engine loads the file by
+		uint64_t offset{};
+		uint64_t size{};
+		uint32_t nameOffset{};
+		uint32_t nameLength{};
+		AssetType type{ AssetType::Other };
+		uint32_t flags{};				// Import flags of a cooked mesh
+	};
+
+	AssetType GetAssetType(const std::string& filename);
+
+	// Every file under the directory plus the level files next to it in the working directory
+	std::vector<std::string> GatherFiles(const std::string& directory);
+
+	// OBJ files are cooked with the settings the resource manager imports them with, PNG and JPEG textures are
+	// cooked to block compressed mip chains (see TextureCooker), everything else is stored as is. The pack is written
+	// next to the target first so a failed build never replaces a working pack.
+	bool Build(const std::string& packFile, const std::vector<std::string>& files, BlockCompressor::Quality textureQuality = BlockCompressor::Quality::Normal);
+}
+
+// Read only view of a pack file
+class AssetPack final
+{
+public:
+	explicit AssetPack(const std::string& filename);
+	~AssetPack() = default;
+
+	AssetPack(const AssetPack& other) = delete;
+	AssetPack(AssetPack&& other) noexcept = delete;
+	AssetPack& operator=(const AssetPack& other) = delete;
+	AssetPack& operator=(AssetPack&& other) noexcept = delete;
+
+	bool IsValid() const { return m_Valid; }
+
+	// nullptr when the pack has no entry with the id
+	const AssetPacker::IndexEntry* Find(ResourceId id) const;
+	std::string_view GetData(const AssetPacker::IndexEntry& entry) const;
+	std::string_view GetName(const AssetPacker::IndexEntry& entry) const;
+
+	size_t GetEntryCount() const { return m_EntryCount; }
+	const AssetPacker::IndexEntry& GetEntry(size_t index) const { return m_pEntries[index]; }
+	size_t GetSize() const { return m_File.GetSize(); }
+
+private:
+	// Checks the order of the index and every offset against the file size before anything is handed out
+	void Validate();
+
+	MappedFile m_File;
+	const AssetPacker::IndexEntry* m_pEntries{};
+	size_t m_EntryCount{};
+	const char* m_pNames{};
+	size_t m_NameBytes{};
+	bool m_Valid{ false };
+};
+
+// The bytes of one file. A view into the pack the resource manager mounted when the pack has the file, the loose
+// file mapped on its own otherwise so development builds work without building a pack.
+class AssetFile final
+{
+public:
+	explicit AssetFile(const std::string& filename);
+	~AssetFile() = default;
+
+	AssetFile(const AssetFile& other) = delete;
+	AssetFile(AssetFile&& other) noexcept = delete;
+	AssetFile& operator=(const AssetFile& other) = delete;
+	AssetFile& operator=(AssetFile&& other) noexcept = delete;
+
+	bool IsOpen() const { return m_Open; }
+	bool IsPacked() const { return m_Packed; }
+	const char* GetData() const { return m_Data.data(); }
+	size_t GetSize() const { return m_Data.size(); }
+
+private:
+	std::unique_ptr<MappedFile> m_pLooseFile{};
+	std::string_view m_Data{};
+	bool m_Open{ false };
+	bool m_Packed{ false };
+};
+
+// Lets the readers that take a std::istream (level files) read an asset file without copying it
+class AssetStreamBuffer final : public std::streambuf
+{
+public:
+	explicit AssetStreamBuffer(const AssetFile& file);
+
+protected:
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+};
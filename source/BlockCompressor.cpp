@@ -0,0 +1,1271 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Rows of blocks one job encodes
+	constexpr uint32_t g_BlockRowsPerJob{ 4 };
+
+	struct Block
+	{
+		uint8_t texels[16][4]{};
+	};
+
+	// Partial blocks repeat the last row and column, so the padding does not pull the endpoints away
+	void ReadBlock(const Image& image, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t row = (std::min)(blockY * 4 + y, image.height - 1);
+			const uint8_t* pRow = image.pixels.data() + row * image.GetRowPitch();
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint32_t column = (std::min)(blockX * 4 + x, image.width - 1);
+				std::memcpy(block.texels[y * 4 + x], pRow + column * 4, 4);
+			}
+		}
+	}
+
+	inline float Clamp255(float value)
+	{
+		return (std::min)((std::max)(value, 0.f), 255.f);
+	}
+
+	// Mean and principal axis of the texels in the mask, over the first channelCount channels. The residual is the
+	// squared distance of the texels to the line, how well two endpoints can describe them.
+	struct Line
+	{
+		float mean[4]{};
+		float axis[4]{};
+		float residual{};
+	};
+
+	Line FitLine(const Block& block, uint16_t mask, int channelCount)
+	{
+		Line line{};
+		int count{};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			for (int c = 0; c < channelCount; ++c)
+				line.mean[c] += block.texels[i][c];
+			++count;
+		}
+		if (count == 0)
+			return line;
+		for (int c = 0; c < channelCount; ++c)
+			line.mean[c] /= count;
+
+		float covariance[4][4]{};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			float delta[4]{};
+			for (int c = 0; c < channelCount; ++c)
+				delta[c] = block.texels[i][c] - line.mean[c];
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+					covariance[a][b] += delta[a] * delta[b];
+			}
+		}
+
+		// Power iteration, starting from the column of the channel that varies most
+		int start{};
+		float trace{};
+		for (int c = 0; c < channelCount; ++c)
+		{
+			trace += covariance[c][c];
+			if (covariance[c][c] > covariance[start][start])
+				start = c;
+		}
+		if (trace <= 0.f)
+			return line;
+
+		float axis[4]{};
+		for (int c = 0; c < channelCount; ++c)
+			axis[c] = covariance[c][start];
+
+		float eigenvalue{};
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4]{};
+			float length{};
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			length = std::sqrt(length);
+			if (length <= 0.f)
+				break;
+
+			// Once axis is normalized the length of the product is the eigenvalue
+			for (int c = 0; c < channelCount; ++c)
+				axis[c] = next[c] / length;
+			eigenvalue = length;
+		}
+
+		std::memcpy(line.axis, axis, sizeof(axis));
+		line.residual = (std::max)(trace - eigenvalue, 0.f);
+		return line;
+	}
+
+	// The two ends of the texels projected on the line
+	void GetLineEndpoints(const Block& block, uint16_t mask, int channelCount, const Line& line, float endpoints[2][4])
+	{
+		float minimum{ FLT_MAX };
+		float maximum{ -FLT_MAX };
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			float t{};
+			for (int c = 0; c < channelCount; ++c)
+				t += (block.texels[i][c] - line.mean[c]) * line.axis[c];
+			minimum = (std::min)(minimum, t);
+			maximum = (std::max)(maximum, t);
+		}
+
+		for (int c = 0; c < channelCount; ++c)
+		{
+			endpoints[0][c] = Clamp255(line.mean[c] + line.axis[c] * minimum);
+			endpoints[1][c] = Clamp255(line.mean[c] + line.axis[c] * maximum);
+		}
+	}
+
+	// Least squares endpoints for the texels in the mask given where every texel lies between them (weight / 64).
+	// false when every texel uses the same weight.
+	bool FitEndpoints(const Block& block, uint16_t mask, const uint8_t indices[16], const uint8_t* pWeights, int channelCount, float endpoints[2][4])
+	{
+		float aa{}, ab{}, bb{};
+		float ax[4]{}, bx[4]{};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			const float t = pWeights[indices[i]] / 64.f;
+			const float s = 1.f - t;
+			aa += s * s;
+			ab += s * t;
+			bb += t * t;
+			for (int c = 0; c < channelCount; ++c)
+			{
+				ax[c] += s * block.texels[i][c];
+				bx[c] += t * block.texels[i][c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < channelCount; ++c)
+		{
+			endpoints[0][c] = Clamp255((bb * ax[c] - ab * bx[c]) / determinant);
+			endpoints[1][c] = Clamp255((aa * bx[c] - ab * ax[c]) / determinant);
+		}
+		return true;
+	}
+
+	// BC1 ----------------------------------------------------------------------------------------------------------
+
+	// Where the BC1 palette entries lie between color0 and color1, in 64ths like the BC7 weights
+	constexpr uint8_t g_BC1Weights[4]{ 0, 64, 21, 43 };
+
+	inline int Expand5(int value) { return (value << 3) | (value >> 2); }
+	inline int Expand6(int value) { return (value << 2) | (value >> 4); }
+
+	uint16_t Pack565(const float color[3])
+	{
+		const int r = static_cast<int>(std::lround(Clamp255(color[0]) * 31.f / 255.f));
+		const int g = static_cast<int>(std::lround(Clamp255(color[1]) * 63.f / 255.f));
+		const int b = static_cast<int>(std::lround(Clamp255(color[2]) * 31.f / 255.f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void Unpack565(uint16_t color, int rgb[3])
+	{
+		rgb[0] = Expand5(color >> 11);
+		rgb[1] = Expand6((color >> 5) & 63);
+		rgb[2] = Expand5(color & 31);
+	}
+
+	// Four colors when color0 > color1 (always in BC3), otherwise three and transparent black
+	void GetBC1Palette(uint16_t color0, uint16_t color1, bool fourColors, int palette[4][4])
+	{
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		for (int c = 0; c < 3; ++c)
+		{
+			if (fourColors)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[3][3] = fourColors ? 255 : 0;
+	}
+
+	// Picks the closest of the four colors for every texel, returns the squared error over RGB
+	uint32_t FindBC1Indices(const Block& block, uint16_t color0, uint16_t color1, uint8_t indices[16])
+	{
+		int palette[4][4]{};
+		GetBC1Palette(color0, color1, true, palette);
+
+		uint32_t error{};
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t bestError{ UINT32_MAX };
+			for (uint8_t index = 0; index < 4; ++index)
+			{
+				uint32_t distance{};
+				for (int c = 0; c < 3; ++c)
+				{
+					const int delta = block.texels[i][c] - palette[index][c];
+					distance += delta * delta;
+				}
+				if (distance < bestError)
+				{
+					bestError = distance;
+					indices[i] = index;
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	// The pair of 5 or 6 bit values whose 1/3 interpolation is closest to every 8 bit value, flat blocks get more
+	// precision out of those than out of the endpoints alone
+	struct BC1SingleColorTables
+	{
+		uint8_t match5[256][2]{};
+		uint8_t match6[256][2]{};
+
+		BC1SingleColorTables()
+		{
+			Build(match5, 31, Expand5);
+			Build(match6, 63, Expand6);
+		}
+
+		static void Build(uint8_t table[256][2], int maximum, int (*expand)(int))
+		{
+			for (int value = 0; value < 256; ++value)
+			{
+				int bestError{ INT32_MAX };
+				for (int a = 0; a <= maximum; ++a)
+				{
+					for (int b = 0; b <= maximum; ++b)
+					{
+						const int error = std::abs((2 * expand(a) + expand(b) + 1) / 3 - value);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[value][0] = static_cast<uint8_t>(a);
+							table[value][1] = static_cast<uint8_t>(b);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const BC1SingleColorTables& GetBC1SingleColorTables()
+	{
+		static const BC1SingleColorTables tables{};
+		return tables;
+	}
+
+	// color0 is kept above color1 so the block is read with four colors
+	void WriteBC1(uint16_t color0, uint16_t color1, uint8_t indices[16], uint8_t* pOutput)
+	{
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			for (int i = 0; i < 16; ++i)
+				indices[i] ^= 1;
+		}
+		if (color0 == color1)
+			std::fill(indices, indices + 16, uint8_t{ 0 });
+
+		uint32_t bits{};
+		for (int i = 0; i < 16; ++i)
+			bits |= uint32_t(indices[i]) << (i * 2);
+
+		pOutput[0] = static_cast<uint8_t>(color0);
+		pOutput[1] = static_cast<uint8_t>(color0 >> 8);
+		pOutput[2] = static_cast<uint8_t>(color1);
+		pOutput[3] = static_cast<uint8_t>(color1 >> 8);
+		std::memcpy(pOutput + 4, &bits, sizeof(bits));
+	}
+
+	void EncodeBC1(const Block& block, BlockCompressor::Quality quality, uint8_t* pOutput)
+	{
+		uint8_t indices[16]{};
+
+		bool flat{ true };
+		for (int i = 1; i < 16 && flat; ++i)
+			flat = std::memcmp(block.texels[i], block.texels[0], 3) == 0;
+		if (flat)
+		{
+			const BC1SingleColorTables& tables = GetBC1SingleColorTables();
+			const uint8_t* pRed = tables.match5[block.texels[0][0]];
+			const uint8_t* pGreen = tables.match6[block.texels[0][1]];
+			const uint8_t* pBlue = tables.match5[block.texels[0][2]];
+			std::fill(indices, indices + 16, uint8_t{ 2 });
+			WriteBC1(static_cast<uint16_t>((pRed[0] << 11) | (pGreen[0] << 5) | pBlue[0]),
+				static_cast<uint16_t>((pRed[1] << 11) | (pGreen[1] << 5) | pBlue[1]), indices, pOutput);
+			return;
+		}
+
+		float endpoints[2][4]{};
+		GetLineEndpoints(block, 0xFFFF, 3, FitLine(block, 0xFFFF, 3), endpoints);
+
+		uint16_t color0 = Pack565(endpoints[0]);
+		uint16_t color1 = Pack565(endpoints[1]);
+		uint32_t error = FindBC1Indices(block, color0, color1, indices);
+
+		const int passes = quality == BlockCompressor::Quality::Fast ? 0 : quality == BlockCompressor::Quality::Normal ? 2 : 6;
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			if (!FitEndpoints(block, 0xFFFF, indices, g_BC1Weights, 3, endpoints))
+				break;
+
+			const uint16_t fitted0 = Pack565(endpoints[0]);
+			const uint16_t fitted1 = Pack565(endpoints[1]);
+			if (fitted0 == color0 && fitted1 == color1)
+				break;
+
+			uint8_t fittedIndices[16]{};
+			const uint32_t fittedError = FindBC1Indices(block, fitted0, fitted1, fittedIndices);
+			if (fittedError >= error)
+				break;
+
+			color0 = fitted0;
+			color1 = fitted1;
+			error = fittedError;
+			std::memcpy(indices, fittedIndices, sizeof(indices));
+		}
+
+		WriteBC1(color0, color1, indices, pOutput);
+	}
+
+	// BC4 ----------------------------------------------------------------------------------------------------------
+
+	// Weights of the eight value mode in 64ths, for the least squares fit
+	constexpr uint8_t g_BC4Weights[8]{ 0, 64, 9, 18, 27, 37, 46, 55 };
+
+	// Eight interpolated values when value0 > value1, otherwise six and 0 and 255
+	void GetBC4Palette(int value0, int value1, int palette[8])
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1)
+		{
+			for (int i = 2; i < 8; ++i)
+				palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+				palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	uint32_t FindBC4Indices(const uint8_t values[16], int value0, int value1, uint8_t indices[16])
+	{
+		int palette[8]{};
+		GetBC4Palette(value0, value1, palette);
+
+		uint32_t error{};
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t bestError{ UINT32_MAX };
+			for (uint8_t index = 0; index < 8; ++index)
+			{
+				const int delta = values[i] - palette[index];
+				const uint32_t distance = delta * delta;
+				if (distance < bestError)
+				{
+					bestError = distance;
+					indices[i] = index;
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	void EncodeBC4(const uint8_t values[16], BlockCompressor::Quality quality, uint8_t* pOutput)
+	{
+		const auto [pMinimum, pMaximum] = std::minmax_element(values, values + 16);
+		int best0{ *pMaximum };
+		int best1{ *pMinimum };
+		uint8_t bestIndices[16]{};
+		uint32_t bestError = FindBC4Indices(values, best0, best1, bestIndices);
+
+		auto tryEndpoints = [&](int value0, int value1)
+		{
+			uint8_t indices[16]{};
+			const uint32_t error = FindBC4Indices(values, value0, value1, indices);
+			if (error >= bestError)
+				return false;
+
+			best0 = value0;
+			best1 = value1;
+			bestError = error;
+			std::memcpy(bestIndices, indices, sizeof(bestIndices));
+			return true;
+		};
+
+		if (quality != BlockCompressor::Quality::Fast && bestError > 0)
+		{
+			// Least squares in the eight value mode, weights are the same in every channel so a fake block does
+			Block block{};
+			for (int i = 0; i < 16; ++i)
+				block.texels[i][0] = values[i];
+
+			const int passes = quality == BlockCompressor::Quality::Normal ? 2 : 6;
+			for (int pass = 0; pass < passes; ++pass)
+			{
+				float endpoints[2][4]{};
+				if (!FitEndpoints(block, 0xFFFF, bestIndices, g_BC4Weights, 1, endpoints))
+					break;
+				const int value0 = static_cast<int>(std::lround(endpoints[0][0]));
+				const int value1 = static_cast<int>(std::lround(endpoints[1][0]));
+				if (value0 <= value1 || !tryEndpoints(value0, value1))
+					break;
+			}
+
+			// The six value mode with 0 and 255 for the texels at the ends of the range
+			int inner0{ 255 };
+			int inner1{ 0 };
+			for (int i = 0; i < 16; ++i)
+			{
+				if (values[i] == 0 || values[i] == 255)
+					continue;
+				inner0 = (std::min)(inner0, int(values[i]));
+				inner1 = (std::max)(inner1, int(values[i]));
+			}
+			if (inner0 <= inner1 && (*pMinimum == 0 || *pMaximum == 255))
+				tryEndpoints(inner0, inner1);
+
+			if (quality == BlockCompressor::Quality::High)
+			{
+				const int start0 = best0;
+				const int start1 = best1;
+				for (int value0 = (std::max)(start0 - 3, 0); value0 <= (std::min)(start0 + 3, 255); ++value0)
+				{
+					for (int value1 = (std::max)(start1 - 3, 0); value1 <= (std::min)(start1 + 3, 255); ++value1)
+					{
+						// Stays in the mode it started in
+						if ((value0 > value1) == (start0 > start1))
+							tryEndpoints(value0, value1);
+					}
+				}
+			}
+		}
+
+		uint64_t bits{};
+		for (int i = 0; i < 16; ++i)
+			bits |= uint64_t(bestIndices[i]) << (i * 3);
+
+		pOutput[0] = static_cast<uint8_t>(best0);
+		pOutput[1] = static_cast<uint8_t>(best1);
+		for (int i = 0; i < 6; ++i)
+			pOutput[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+
+	void EncodeBC4Channel(const Block& block, int channel, BlockCompressor::Quality quality, uint8_t* pOutput)
+	{
+		uint8_t values[16]{};
+		for (int i = 0; i < 16; ++i)
+			values[i] = block.texels[i][channel];
+		EncodeBC4(values, quality, pOutput);
+	}
+
+	// BC7 ----------------------------------------------------------------------------------------------------------
+	// Only mode 6 (one subset, RGBA, 4 bit indices) and, for opaque blocks, mode 1 (two subsets, RGB, 3 bit indices)
+	// are written. Together they get most of the quality of a full search at a fraction of the time.
+
+	constexpr uint8_t g_BC7Weights3[8]{ 0, 9, 18, 27, 37, 46, 55, 64 };
+	constexpr uint8_t g_BC7Weights4[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Subset of every texel for the 64 two subset partitions
+	constexpr uint8_t g_BC7Partitions2[64][16]
+	{
+		{ 0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1 }, { 0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1 }, { 0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1 }, { 0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1 },
+		{ 0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1 },
+		{ 0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1 },
+		{ 0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1 }, { 0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1 },
+		{ 0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1 }, { 0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0 }, { 0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0 },
+		{ 0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1 },
+		{ 0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0 }, { 0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0 },
+		{ 0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0 }, { 0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0 }, { 0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0 }, { 0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0 },
+		{ 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 }, { 0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1 }, { 0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0 }, { 0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0 },
+		{ 0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0 }, { 0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0 }, { 0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1 }, { 0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1 },
+		{ 0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0 }, { 0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0 }, { 0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0 }, { 0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0 },
+		{ 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0 }, { 0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1 }, { 0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1 }, { 0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0 },
+		{ 0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0 }, { 0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0 }, { 0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0 }, { 0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0 },
+		{ 0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0 }, { 0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0 },
+		{ 0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1 }, { 0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1 }, { 0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1 },
+		{ 0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1 }, { 0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0 }, { 0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0 }, { 0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1 }
+	};
+
+	// The texel of the second subset whose index loses its top bit
+	constexpr uint8_t g_BC7Anchors2[64]
+	{
+		15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+		15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+		15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+		 6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15
+	};
+
+	// The texels of the second subset of every partition as bits
+	constexpr std::array<uint16_t, 64> g_BC7PartitionMasks = []
+	{
+		std::array<uint16_t, 64> masks{};
+		for (int partition = 0; partition < 64; ++partition)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				if (g_BC7Partitions2[partition][i] == 1)
+					masks[partition] |= static_cast<uint16_t>(1 << i);
+			}
+		}
+		return masks;
+	}();
+
+	// Sums of the RGB values of some texels and of their products, enough to tell how well a line fits them without
+	// going over the texels again. The moments of a subset are the block minus the other subset.
+	struct Moments
+	{
+		float count{};
+		float sums[3]{};
+		float products[6]{};	// rr, rg, rb, gg, gb, bb
+
+		void Add(const uint8_t texel[4])
+		{
+			const float r = texel[0], g = texel[1], b = texel[2];
+			count += 1.f;
+			sums[0] += r;
+			sums[1] += g;
+			sums[2] += b;
+			products[0] += r * r;
+			products[1] += r * g;
+			products[2] += r * b;
+			products[3] += g * g;
+			products[4] += g * b;
+			products[5] += b * b;
+		}
+
+		Moments operator-(const Moments& other) const
+		{
+			Moments result{ *this };
+			result.count -= other.count;
+			for (int i = 0; i < 3; ++i)
+				result.sums[i] -= other.sums[i];
+			for (int i = 0; i < 6; ++i)
+				result.products[i] -= other.products[i];
+			return result;
+		}
+
+		// Squared distance of the texels to their principal axis, the same as Line::residual
+		float GetResidual() const
+		{
+			if (count <= 0.f)
+				return 0.f;
+
+			const float covariance[3][3]
+			{
+				{ products[0] - sums[0] * sums[0] / count, products[1] - sums[0] * sums[1] / count, products[2] - sums[0] * sums[2] / count },
+				{ products[1] - sums[0] * sums[1] / count, products[3] - sums[1] * sums[1] / count, products[4] - sums[1] * sums[2] / count },
+				{ products[2] - sums[0] * sums[2] / count, products[4] - sums[1] * sums[2] / count, products[5] - sums[2] * sums[2] / count }
+			};
+			const float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+			if (trace <= 0.f)
+				return 0.f;
+
+			int start{};
+			for (int c = 1; c < 3; ++c)
+			{
+				if (covariance[c][c] > covariance[start][start])
+					start = c;
+			}
+
+			float axis[3]{ covariance[0][start], covariance[1][start], covariance[2][start] };
+			float eigenvalue{};
+			for (int iteration = 0; iteration < 4; ++iteration)
+			{
+				float next[3]{};
+				for (int a = 0; a < 3; ++a)
+					next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+				const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+				if (length <= 0.f)
+					break;
+				for (int c = 0; c < 3; ++c)
+					axis[c] = next[c] / length;
+				eigenvalue = length;
+			}
+			return (std::max)(trace - eigenvalue, 0.f);
+		}
+	};
+
+	struct BC7Mode
+	{
+		int number{};
+		int endpointBits{};		// Without the p-bit
+		bool sharedPBit{};		// One p-bit for both endpoints of a subset
+		int indexBits{};
+		int channelCount{};
+	};
+	constexpr BC7Mode g_BC7Mode1{ 1, 6, true, 3, 3 };
+	constexpr BC7Mode g_BC7Mode6{ 6, 7, false, 4, 4 };
+
+	const uint8_t* GetBC7Weights(int indexBits)
+	{
+		return indexBits == 3 ? g_BC7Weights3 : g_BC7Weights4;
+	}
+
+	// Endpoint with the p-bit below it, its top bits repeated to fill 8 bits
+	inline int UnquantizeBC7(const BC7Mode& mode, int value, int pBit)
+	{
+		const int bits = mode.endpointBits + 1;
+		const int full = (value << 1) | pBit;
+		return ((full << (8 - bits)) | (full >> (2 * bits - 8))) & 255;
+	}
+
+	// The closest endpoint value for every 8 bit value and p-bit, for both modes
+	struct BC7QuantizeTables
+	{
+		uint8_t mode1[2][256]{};
+		uint8_t mode6[2][256]{};
+
+		BC7QuantizeTables()
+		{
+			Build(g_BC7Mode1, mode1);
+			Build(g_BC7Mode6, mode6);
+		}
+
+		static void Build(const BC7Mode& mode, uint8_t table[2][256])
+		{
+			for (int pBit = 0; pBit < 2; ++pBit)
+			{
+				for (int value = 0; value < 256; ++value)
+				{
+					int bestError{ INT32_MAX };
+					for (int quantized = 0; quantized < (1 << mode.endpointBits); ++quantized)
+					{
+						const int error = std::abs(UnquantizeBC7(mode, quantized, pBit) - value);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[pBit][value] = static_cast<uint8_t>(quantized);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const BC7QuantizeTables& GetBC7QuantizeTables()
+	{
+		static const BC7QuantizeTables tables{};
+		return tables;
+	}
+
+	struct BC7Subset
+	{
+		uint8_t quantized[2][4]{};	// Stored endpoint values, without the p-bit
+		uint8_t pBits[2]{};
+		int colors[2][4]{};			// What the endpoints decode to
+	};
+
+	// Rounds the endpoints to the precision of the mode, with the p-bits that keep them closest
+	void QuantizeBC7Endpoints(const BC7Mode& mode, const float endpoints[2][4], BC7Subset& subset)
+	{
+		const BC7QuantizeTables& tables = GetBC7QuantizeTables();
+		const auto& table = mode.number == 1 ? tables.mode1 : tables.mode6;
+
+		auto quantize = [&](int endpoint, int pBit, uint8_t quantized[4], int colors[4])
+		{
+			int error{};
+			for (int c = 0; c < mode.channelCount; ++c)
+			{
+				const int value = static_cast<int>(std::lround(endpoints[endpoint][c]));
+				quantized[c] = table[pBit][value];
+				colors[c] = UnquantizeBC7(mode, quantized[c], pBit);
+				error += (colors[c] - value) * (colors[c] - value);
+			}
+			return error;
+		};
+
+		int bestError{ INT32_MAX };
+		for (int pBit0 = 0; pBit0 < 2; ++pBit0)
+		{
+			for (int pBit1 = 0; pBit1 < 2; ++pBit1)
+			{
+				if (mode.sharedPBit && pBit0 != pBit1)
+					continue;
+
+				BC7Subset candidate{};
+				candidate.pBits[0] = static_cast<uint8_t>(pBit0);
+				candidate.pBits[1] = static_cast<uint8_t>(pBit1);
+				const int error = quantize(0, pBit0, candidate.quantized[0], candidate.colors[0]) + quantize(1, pBit1, candidate.quantized[1], candidate.colors[1]);
+				if (error < bestError)
+				{
+					bestError = error;
+					subset = candidate;
+				}
+			}
+		}
+
+		// Modes without alpha decode it as opaque
+		for (int c = mode.channelCount; c < 4; ++c)
+			subset.colors[0][c] = subset.colors[1][c] = 255;
+	}
+
+	inline int InterpolateBC7(int color0, int color1, int weight)
+	{
+		return ((64 - weight) * color0 + weight * color1 + 32) >> 6;
+	}
+
+	// Picks the closest palette entry for every texel in the mask, returns the squared error over RGBA
+	uint32_t FindBC7Indices(const Block& block, uint16_t mask, const BC7Mode& mode, const BC7Subset& subset, uint8_t indices[16])
+	{
+		const int entryCount = 1 << mode.indexBits;
+		const uint8_t* pWeights = GetBC7Weights(mode.indexBits);
+		int palette[16][4]{};
+		for (int i = 0; i < entryCount; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+				palette[i][c] = InterpolateBC7(subset.colors[0][c], subset.colors[1][c], pWeights[i]);
+		}
+
+		uint32_t error{};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+
+			uint32_t bestError{ UINT32_MAX };
+			for (int index = 0; index < entryCount; ++index)
+			{
+				uint32_t distance{};
+				for (int c = 0; c < 4; ++c)
+				{
+					const int delta = block.texels[i][c] - palette[index][c];
+					distance += delta * delta;
+				}
+				if (distance < bestError)
+				{
+					bestError = distance;
+					indices[i] = static_cast<uint8_t>(index);
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	// Endpoints and indices of the texels in the mask, refined passes times. Returns the squared error.
+	uint32_t EncodeBC7Subset(const Block& block, uint16_t mask, const BC7Mode& mode, int passes, BC7Subset& subset, uint8_t indices[16])
+	{
+		float endpoints[2][4]{};
+		GetLineEndpoints(block, mask, mode.channelCount, FitLine(block, mask, mode.channelCount), endpoints);
+		QuantizeBC7Endpoints(mode, endpoints, subset);
+		uint32_t error = FindBC7Indices(block, mask, mode, subset, indices);
+
+		for (int pass = 0; pass < passes && error > 0; ++pass)
+		{
+			if (!FitEndpoints(block, mask, indices, GetBC7Weights(mode.indexBits), mode.channelCount, endpoints))
+				break;
+
+			BC7Subset fitted{};
+			QuantizeBC7Endpoints(mode, endpoints, fitted);
+			uint8_t fittedIndices[16]{};
+			const uint32_t fittedError = FindBC7Indices(block, mask, mode, fitted, fittedIndices);
+			if (fittedError >= error)
+				break;
+
+			subset = fitted;
+			error = fittedError;
+			for (int i = 0; i < 16; ++i)
+			{
+				if (mask & (1 << i))
+					indices[i] = fittedIndices[i];
+			}
+		}
+		return error;
+	}
+
+	// Appends bits from the lowest bit of the block up
+	class BitWriter final
+	{
+	public:
+		explicit BitWriter(uint8_t* pBlock)
+			: m_pBlock{ pBlock }
+		{
+			std::memset(m_pBlock, 0, 16);
+		}
+
+		void Write(uint32_t value, int bitCount)
+		{
+			for (int i = 0; i < bitCount; ++i, ++m_Position)
+				m_pBlock[m_Position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (m_Position & 7));
+		}
+
+	private:
+		uint8_t* m_pBlock;
+		int m_Position{};
+	};
+
+	class BitReader final
+	{
+	public:
+		explicit BitReader(const uint8_t* pBlock)
+			: m_pBlock{ pBlock }
+		{
+		}
+
+		uint32_t Read(int bitCount)
+		{
+			uint32_t value{};
+			for (int i = 0; i < bitCount; ++i, ++m_Position)
+				value |= uint32_t((m_pBlock[m_Position >> 3] >> (m_Position & 7)) & 1) << i;
+			return value;
+		}
+
+	private:
+		const uint8_t* m_pBlock;
+		int m_Position{};
+	};
+
+	// The top bit of the anchor index is not stored, the endpoints are swapped when it is set
+	void FixBC7Anchor(BC7Subset& subset, int indexBits, int anchor, uint16_t mask, uint8_t indices[16])
+	{
+		const int highest = (1 << indexBits) - 1;
+		if (!(indices[anchor] >> (indexBits - 1)))
+			return;
+
+		std::swap(subset.quantized[0], subset.quantized[1]);
+		std::swap(subset.pBits[0], subset.pBits[1]);
+		std::swap(subset.colors[0], subset.colors[1]);
+		for (int i = 0; i < 16; ++i)
+		{
+			if (mask & (1 << i))
+				indices[i] = static_cast<uint8_t>(highest - indices[i]);
+		}
+	}
+
+	void WriteBC7Mode6(BC7Subset& subset, uint8_t indices[16], uint8_t* pOutput)
+	{
+		FixBC7Anchor(subset, 4, 0, 0xFFFF, indices);
+
+		BitWriter writer{ pOutput };
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(subset.quantized[0][c], 7);
+			writer.Write(subset.quantized[1][c], 7);
+		}
+		writer.Write(subset.pBits[0], 1);
+		writer.Write(subset.pBits[1], 1);
+		for (int i = 0; i < 16; ++i)
+			writer.Write(indices[i], i == 0 ? 3 : 4);
+	}
+
+	void WriteBC7Mode1(int partition, BC7Subset subsets[2], uint8_t indices[16], uint8_t* pOutput)
+	{
+		const uint16_t mask1 = g_BC7PartitionMasks[partition];
+		const int anchor1 = g_BC7Anchors2[partition];
+		FixBC7Anchor(subsets[0], 3, 0, static_cast<uint16_t>(~mask1), indices);
+		FixBC7Anchor(subsets[1], 3, anchor1, mask1, indices);
+
+		BitWriter writer{ pOutput };
+		writer.Write(1 << 1, 2);
+		writer.Write(partition, 6);
+		for (int c = 0; c < 3; ++c)
+		{
+			for (int s = 0; s < 2; ++s)
+			{
+				writer.Write(subsets[s].quantized[0][c], 6);
+				writer.Write(subsets[s].quantized[1][c], 6);
+			}
+		}
+		writer.Write(subsets[0].pBits[0], 1);
+		writer.Write(subsets[1].pBits[0], 1);
+		for (int i = 0; i < 16; ++i)
+			writer.Write(indices[i], i == 0 || i == anchor1 ? 2 : 3);
+	}
+
+	void EncodeBC7(const Block& block, BlockCompressor::Quality quality, uint8_t* pOutput)
+	{
+		const int passes = quality == BlockCompressor::Quality::Fast ? 0 : quality == BlockCompressor::Quality::Normal ? 2 : 4;
+
+		BC7Subset subset{};
+		uint8_t indices[16]{};
+		const uint32_t error = EncodeBC7Subset(block, 0xFFFF, g_BC7Mode6, passes, subset, indices);
+
+		bool opaque{ true };
+		for (int i = 0; i < 16 && opaque; ++i)
+			opaque = block.texels[i][3] == 255;
+		if (quality == BlockCompressor::Quality::Fast || !opaque || error == 0)
+		{
+			WriteBC7Mode6(subset, indices, pOutput);
+			return;
+		}
+
+		// The partitions whose subsets lie closest to a line each are encoded for real
+		struct Candidate
+		{
+			float estimate{};
+			int partition{};
+		};
+		Moments blockMoments{};
+		for (int i = 0; i < 16; ++i)
+			blockMoments.Add(block.texels[i]);
+
+		Candidate candidates[64]{};
+		for (int partition = 0; partition < 64; ++partition)
+		{
+			Moments moments1{};
+			for (int i = 0; i < 16; ++i)
+			{
+				if (g_BC7Partitions2[partition][i] == 1)
+					moments1.Add(block.texels[i]);
+			}
+			candidates[partition].partition = partition;
+			candidates[partition].estimate = (blockMoments - moments1).GetResidual() + moments1.GetResidual();
+		}
+
+		const int candidateCount = quality == BlockCompressor::Quality::Normal ? 4 : 16;
+		std::partial_sort(candidates, candidates + candidateCount, candidates + 64, [](const Candidate& a, const Candidate& b) { return a.estimate < b.estimate; });
+
+		int bestPartition{ -1 };
+		uint32_t bestError{ error };
+		BC7Subset bestSubsets[2]{};
+		uint8_t bestIndices[16]{};
+		for (int i = 0; i < candidateCount; ++i)
+		{
+			const int partition = candidates[i].partition;
+			const uint16_t mask1 = g_BC7PartitionMasks[partition];
+
+			BC7Subset subsets[2]{};
+			uint8_t partitionIndices[16]{};
+			const uint32_t partitionError = EncodeBC7Subset(block, static_cast<uint16_t>(~mask1), g_BC7Mode1, passes, subsets[0], partitionIndices)
+				+ EncodeBC7Subset(block, mask1, g_BC7Mode1, passes, subsets[1], partitionIndices);
+			if (partitionError < bestError)
+			{
+				bestError = partitionError;
+				bestPartition = partition;
+				bestSubsets[0] = subsets[0];
+				bestSubsets[1] = subsets[1];
+				std::memcpy(bestIndices, partitionIndices, sizeof(bestIndices));
+			}
+		}
+
+		if (bestPartition < 0)
+			WriteBC7Mode6(subset, indices, pOutput);
+		else
+			WriteBC7Mode1(bestPartition, bestSubsets, bestIndices, pOutput);
+	}
+
+	void EncodeBlock(const Block& block, BlockCompressor::Format format, BlockCompressor::Quality quality, uint8_t* pOutput)
+	{
+		switch (format)
+		{
+		case BlockCompressor::Format::BC1:
+			EncodeBC1(block, quality, pOutput);
+			break;
+		case BlockCompressor::Format::BC3:
+			EncodeBC4Channel(block, 3, quality, pOutput);
+			EncodeBC1(block, quality, pOutput + 8);
+			break;
+		case BlockCompressor::Format::BC4:
+			EncodeBC4Channel(block, 0, quality, pOutput);
+			break;
+		case BlockCompressor::Format::BC5:
+			EncodeBC4Channel(block, 0, quality, pOutput);
+			EncodeBC4Channel(block, 1, quality, pOutput + 8);
+			break;
+		case BlockCompressor::Format::BC7:
+			EncodeBC7(block, quality, pOutput);
+			break;
+		}
+	}
+
+	// Decoding -----------------------------------------------------------------------------------------------------
+
+	void DecodeBC1(const uint8_t* pBlock, bool fourColors, uint8_t texels[16][4])
+	{
+		const uint16_t color0 = static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8));
+		const uint16_t color1 = static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8));
+		uint32_t bits{};
+		std::memcpy(&bits, pBlock + 4, sizeof(bits));
+
+		int palette[4][4]{};
+		GetBC1Palette(color0, color1, fourColors || color0 > color1, palette);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int index = (bits >> (i * 2)) & 3;
+			for (int c = 0; c < 4; ++c)
+				texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+		}
+	}
+
+	void DecodeBC4(const uint8_t* pBlock, int channel, uint8_t texels[16][4])
+	{
+		int palette[8]{};
+		GetBC4Palette(pBlock[0], pBlock[1], palette);
+		uint64_t bits{};
+		for (int i = 0; i < 6; ++i)
+			bits |= uint64_t(pBlock[2 + i]) << (i * 8);
+
+		for (int i = 0; i < 16; ++i)
+			texels[i][channel] = static_cast<uint8_t>(palette[(bits >> (i * 3)) & 7]);
+	}
+
+	// The modes the encoder writes, other blocks decode to transparent black
+	void DecodeBC7(const uint8_t* pBlock, uint8_t texels[16][4])
+	{
+		std::memset(texels, 0, 16 * 4);
+		BitReader reader{ pBlock };
+		int modeNumber{};
+		while (modeNumber < 8 && reader.Read(1) == 0)
+			++modeNumber;
+		if (modeNumber != 1 && modeNumber != 6)
+			return;
+
+		const BC7Mode& mode = modeNumber == 1 ? g_BC7Mode1 : g_BC7Mode6;
+		const int subsetCount = modeNumber == 1 ? 2 : 1;
+		const int partition = modeNumber == 1 ? static_cast<int>(reader.Read(6)) : 0;
+
+		BC7Subset subsets[2]{};
+		for (int c = 0; c < mode.channelCount; ++c)
+		{
+			for (int s = 0; s < subsetCount; ++s)
+			{
+				subsets[s].quantized[0][c] = static_cast<uint8_t>(reader.Read(mode.endpointBits));
+				subsets[s].quantized[1][c] = static_cast<uint8_t>(reader.Read(mode.endpointBits));
+			}
+		}
+		for (int s = 0; s < subsetCount; ++s)
+		{
+			subsets[s].pBits[0] = static_cast<uint8_t>(reader.Read(1));
+			subsets[s].pBits[1] = mode.sharedPBit ? subsets[s].pBits[0] : static_cast<uint8_t>(reader.Read(1));
+			for (int e = 0; e < 2; ++e)
+			{
+				for (int c = 0; c < 4; ++c)
+					subsets[s].colors[e][c] = c < mode.channelCount ? UnquantizeBC7(mode, subsets[s].quantized[e][c], subsets[s].pBits[e]) : 255;
+			}
+		}
+
+		const uint8_t* pWeights = GetBC7Weights(mode.indexBits);
+		const int anchor1 = modeNumber == 1 ? g_BC7Anchors2[partition] : -1;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int subset = modeNumber == 1 ? g_BC7Partitions2[partition][i] : 0;
+			const bool anchor = i == 0 || i == anchor1;
+			const int index = static_cast<int>(reader.Read(anchor ? mode.indexBits - 1 : mode.indexBits));
+			for (int c = 0; c < 4; ++c)
+				texels[i][c] = static_cast<uint8_t>(InterpolateBC7(subsets[subset].colors[0][c], subsets[subset].colors[1][c], pWeights[index]));
+		}
+	}
+
+	void DecodeBlock(const uint8_t* pBlock, BlockCompressor::Format format, uint8_t texels[16][4])
+	{
+		switch (format)
+		{
+		case BlockCompressor::Format::BC1:
+			DecodeBC1(pBlock, false, texels);
+			break;
+		case BlockCompressor::Format::BC3:
+			DecodeBC1(pBlock + 8, true, texels);
+			DecodeBC4(pBlock, 3, texels);
+			break;
+		case BlockCompressor::Format::BC4:
+			std::memset(texels, 0, 16 * 4);
+			DecodeBC4(pBlock, 0, texels);
+			for (int i = 0; i < 16; ++i)
+				texels[i][3] = 255;
+			break;
+		case BlockCompressor::Format::BC5:
+			std::memset(texels, 0, 16 * 4);
+			DecodeBC4(pBlock, 0, texels);
+			DecodeBC4(pBlock + 8, 1, texels);
+			for (int i = 0; i < 16; ++i)
+				texels[i][3] = 255;
+			break;
+		case BlockCompressor::Format::BC7:
+			DecodeBC7(pBlock, texels);
+			break;
+		}
+	}
+}
+
+const char* BlockCompressor::GetFormatName(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return "BC1";
+	case Format::BC3:
+		return "BC3";
+	case Format::BC4:
+		return "BC4";
+	case Format::BC5:
+		return "BC5";
+	case Format::BC7:
+		return "BC7";
+	default:
+		return "Unknown";
+	}
+}
+
+const char* BlockCompressor::GetQualityName(Quality quality)
+{
+	switch (quality)
+	{
+	case Quality::Fast:
+		return "Fast";
+	case Quality::Normal:
+		return "Normal";
+	case Quality::High:
+		return "High";
+	default:
+		return "Unknown";
+	}
+}
+
+size_t BlockCompressor::GetBlockSize(Format format)
+{
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+size_t BlockCompressor::GetRowPitch(Format format, uint32_t width)
+{
+	return size_t((width + 3) / 4) * GetBlockSize(format);
+}
+
+size_t BlockCompressor::GetCompressedSize(Format format, uint32_t width, uint32_t height)
+{
+	return GetRowPitch(format, width) * ((height + 3) / 4);
+}
+
+uint32_t BlockCompressor::GetChannelCount(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return 3;
+	case Format::BC4:
+		return 1;
+	case Format::BC5:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+std::vector<uint8_t> BlockCompressor::Compress(const Image& image, Format format, Quality quality)
+{
+	if (!image.IsValid() || image.format != ImageFormat::RGBA8)
+		return {};
+
+	std::vector<uint8_t> data(GetCompressedSize(format, image.width, image.height));
+	const uint32_t blocksX = (image.width + 3) / 4;
+	const uint32_t blocksY = (image.height + 3) / 4;
+	const size_t blockSize = GetBlockSize(format);
+
+	auto encodeRows = [&](size_t job)
+	{
+		const uint32_t first = static_cast<uint32_t>(job) * g_BlockRowsPerJob;
+		const uint32_t last = (std::min)(first + g_BlockRowsPerJob, blocksY);
+		Block block{};
+		for (uint32_t y = first; y < last; ++y)
+		{
+			for (uint32_t x = 0; x < blocksX; ++x)
+			{
+				ReadBlock(image, x, y, block);
+				EncodeBlock(block, format, quality, data.data() + (size_t(y) * blocksX + x) * blockSize);
+			}
+		}
+	};
+
+	const uint32_t jobCount = (blocksY + g_BlockRowsPerJob - 1) / g_BlockRowsPerJob;
+	if (jobCount > 1)
+		JobSystem::GetInstance()->ParallelFor(jobCount, encodeRows);
+	else
+		encodeRows(0);
+	return data;
+}
+
+Image BlockCompressor::Decompress(const uint8_t* pData, uint32_t width, uint32_t height, Format format)
+{
+	Image image{};
+	image.width = width;
+	image.height = height;
+	image.format = ImageFormat::RGBA8;
+	image.pixels.resize(image.GetRowPitch() * height);
+
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = GetBlockSize(format);
+	uint8_t texels[16][4]{};
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			DecodeBlock(pData + (size_t(blockY) * blocksX + blockX) * blockSize, format, texels);
+			for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y)
+			{
+				uint8_t* pRow = image.pixels.data() + (blockY * 4 + y) * image.GetRowPitch();
+				for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x)
+					std::memcpy(pRow + (blockX * 4 + x) * 4, texels[y * 4 + x], 4);
+			}
+		}
+	}
+	return image;
+}
+
+double BlockCompressor::GetPSNR(const Image& source, const Image& compressed, Format format)
+{
+	if (source.width != compressed.width || source.height != compressed.height || source.pixels.size() != compressed.pixels.size())
+		return 0.0;
+
+	const uint32_t channelCount = GetChannelCount(format);
+	const size_t pixelCount = size_t(source.width) * source.height;
+	uint64_t squaredError{};
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			const int delta = source.pixels[i * 4 + c] - compressed.pixels[i * 4 + c];
+			squaredError += delta * delta;
+		}
+	}
+
+	if (squaredError == 0)
+		return 99.0;
+	const double meanSquaredError = static_cast<double>(squaredError) / (double(pixelCount) * channelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
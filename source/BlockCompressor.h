@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+// Encodes images into the block compressed formats the GPU samples directly, every 4x4 block of texels becomes
+// 8 or 16 bytes. Runs on the CPU without any platform API so the asset cooker can use it, blocks are split over the
+// job threads in rows.
+namespace BlockCompressor
+{
+	enum class Format
+	{
+		BC1,	// RGB, 8 bytes per block, alpha is ignored
+		BC3,	// RGBA, BC1 color and a BC4 alpha block
+		BC4,	// R only, 8 bytes per block
+		BC5,	// RG, two BC4 blocks, for normal maps
+		BC7		// RGBA, 16 bytes per block, the best quality
+	};
+
+	// Speed against quality of the search, the formats are the same
+	enum class Quality
+	{
+		Fast,		// Endpoints from the principal axis of the block, no refinement
+		Normal,		// Least squares refinement, the most likely BC7 partitions
+		High		// More refinement passes and every BC7 partition
+	};
+
+	const char* GetFormatName(Format format);
+	const char* GetQualityName(Quality quality);
+
+	size_t GetBlockSize(Format format);
+	// Partial blocks at the right and bottom edge are stored whole
+	size_t GetRowPitch(Format format, uint32_t width);
+	size_t GetCompressedSize(Format format, uint32_t width, uint32_t height);
+	// The channels a format keeps, the others decompress to 0 (or 255 for alpha)
+	uint32_t GetChannelCount(Format format);
+
+	// RGBA8 images only, BC4 reads the red channel and BC5 red and green. Texels outside the image in a partial block
+	// repeat the last row and column.
+	std::vector<uint8_t> Compress(const Image& image, Format format, Quality quality);
+	// Back to RGBA8 the way the GPU samples it, for measuring the error
+	Image Decompress(const uint8_t* pData, uint32_t width, uint32_t height, Format format);
+
+	// Peak signal to noise ratio in dB over the channels the format keeps, higher is better. 99 for identical images.
+	double GetPSNR(const Image& source, const Image& compressed, Format format);
+}
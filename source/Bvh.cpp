@@ -0,0 +1,453 @@
+#include "Bvh.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+	constexpr uint32_t g_BinCount{ 16 };
+	// Deeper nodes become leaves, this bounds the traversal stack
+	constexpr uint32_t g_MaxDepth{ 64 };
+	// Nodes with fewer triangles are built by one job
+	constexpr uint32_t g_MinJobTriangles{ 16384 };
+	// Cost of visiting a node relative to testing one triangle
+	constexpr float g_TraversalCost{ 2.f };
+
+	// Min and max in SIMD registers, growing a box is two instructions
+	struct Bounds
+	{
+		DirectX::XMVECTOR minimum{ DirectX::XMVectorReplicate(FLT_MAX) };
+		DirectX::XMVECTOR maximum{ DirectX::XMVectorReplicate(-FLT_MAX) };
+
+		void Grow(const Bounds& other)
+		{
+			minimum = DirectX::XMVectorMin(minimum, other.minimum);
+			maximum = DirectX::XMVectorMax(maximum, other.maximum);
+		}
+
+		void Grow(DirectX::FXMVECTOR point)
+		{
+			minimum = DirectX::XMVectorMin(minimum, point);
+			maximum = DirectX::XMVectorMax(maximum, point);
+		}
+
+		// Half the surface area, the SAH only compares ratios
+		float GetArea() const
+		{
+			DirectX::XMFLOAT3 extent{};
+			DirectX::XMStoreFloat3(&extent, DirectX::XMVectorSubtract(maximum, minimum));
+			return extent.x < 0.f ? 0.f : extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+		}
+	};
+
+	inline DirectX::XMFLOAT3 GetPosition(const void* pVertices, size_t vertexSize, uint32_t index)
+	{
+		DirectX::XMFLOAT3 position{};
+		memcpy(&position, static_cast<const char*>(pVertices) + vertexSize * index, sizeof(position));
+		return position;
+	}
+}
+
+// Bounds of every triangle, partitioned in place so a node always reads one contiguous range
+struct Bvh::BuildData
+{
+	struct Reference
+	{
+		Bounds bounds;
+		uint32_t triangle;
+	};
+
+	std::vector<Reference> references{};
+	std::atomic<uint32_t> nodeCount{};
+};
+
+void Bvh::SetTriangles(const void* pVertices, size_t vertexSize, const uint32_t* pIndices, size_t indexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	m_Nodes.clear();
+	m_Triangles.resize(triangleCount);
+	m_TriangleIds.resize(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		const DirectX::XMFLOAT3 p0 = GetPosition(pVertices, vertexSize, pIndices[i * 3]);
+		const DirectX::XMFLOAT3 p1 = GetPosition(pVertices, vertexSize, pIndices[i * 3 + 1]);
+		const DirectX::XMFLOAT3 p2 = GetPosition(pVertices, vertexSize, pIndices[i * 3 + 2]);
+		m_Triangles[i] = Triangle{ p0, { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z }, { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z } };
+		m_TriangleIds[i] = static_cast<uint32_t>(i);
+	}
+}
+
+void Bvh::Truncate(size_t triangleCount)
+{
+	if (triangleCount >= m_Triangles.size())
+		return;
+
+	// Put back in the original order first, a built tree has them sorted by leaf
+	std::vector<Triangle> triangles(m_Triangles.size());
+	for (size_t i = 0; i < m_Triangles.size(); ++i)
+		triangles[m_TriangleIds[i]] = m_Triangles[i];
+
+	triangles.resize(triangleCount);
+	m_Triangles = std::move(triangles);
+	m_TriangleIds.resize(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+		m_TriangleIds[i] = static_cast<uint32_t>(i);
+	m_Nodes.clear();
+}
+
+void Bvh::Build()
+{
+	m_Nodes.clear();
+	const uint32_t triangleCount = static_cast<uint32_t>(m_Triangles.size());
+	if (triangleCount == 0)
+		return;
+
+	BuildData data{};
+	data.references.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		const Triangle& triangle = m_Triangles[i];
+		const DirectX::XMVECTOR vertex = DirectX::XMLoadFloat3(&triangle.vertex);
+		BuildData::Reference& reference = data.references[i];
+		reference.bounds = Bounds{};
+		reference.bounds.Grow(vertex);
+		reference.bounds.Grow(DirectX::XMVectorAdd(vertex, DirectX::XMLoadFloat3(&triangle.edge1)));
+		reference.bounds.Grow(DirectX::XMVectorAdd(vertex, DirectX::XMLoadFloat3(&triangle.edge2)));
+		reference.triangle = i;
+	}
+
+	// A binary tree with one triangle per leaf has 2n - 1 nodes, the second node is skipped so siblings share a cache line
+	m_Nodes.resize(size_t(triangleCount) * 2 + 1);
+	m_Nodes[0].leftFirst = 0;
+	m_Nodes[0].count = triangleCount;
+	data.nodeCount = 2;
+	UpdateBounds(0, data);
+
+	// Split the top of the tree here until the nodes are small enough to hand out as jobs
+	std::vector<std::pair<uint32_t, uint32_t>> open{ { 0, 0 } };
+	std::vector<std::pair<uint32_t, uint32_t>> jobs{};
+	while (!open.empty())
+	{
+		const auto [nodeIndex, depth] = open.back();
+		open.pop_back();
+		if (m_Nodes[nodeIndex].count >= g_MinJobTriangles && depth < g_MaxDepth && Split(nodeIndex, data))
+		{
+			open.emplace_back(m_Nodes[nodeIndex].leftFirst, depth + 1);
+			open.emplace_back(m_Nodes[nodeIndex].leftFirst + 1, depth + 1);
+		}
+		else
+			jobs.emplace_back(nodeIndex, depth);
+	}
+
+	JobSystem::GetInstance()->ParallelFor(jobs.size(), [&](size_t i)
+		{
+			std::vector<std::pair<uint32_t, uint32_t>> stack{ jobs[i] };
+			while (!stack.empty())
+			{
+				const auto [nodeIndex, depth] = stack.back();
+				stack.pop_back();
+				if (depth < g_MaxDepth && Split(nodeIndex, data))
+				{
+					stack.emplace_back(m_Nodes[nodeIndex].leftFirst, depth + 1);
+					stack.emplace_back(m_Nodes[nodeIndex].leftFirst + 1, depth + 1);
+				}
+			}
+		});
+	m_Nodes.resize(data.nodeCount);
+
+	// Store the triangles in leaf order so a leaf reads one contiguous range
+	std::vector<Triangle> triangles(triangleCount);
+	std::vector<uint32_t> triangleIds(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		triangles[i] = m_Triangles[data.references[i].triangle];
+		triangleIds[i] = m_TriangleIds[data.references[i].triangle];
+	}
+	m_Triangles = std::move(triangles);
+	m_TriangleIds = std::move(triangleIds);
+}
+
+bool Bvh::IsBuilt() const
+{
+	return !m_Nodes.empty();
+}
+
+void Bvh::UpdateBounds(uint32_t nodeIndex, const BuildData& data)
+{
+	Node& node = m_Nodes[nodeIndex];
+	Bounds bounds{};
+	for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+		bounds.Grow(data.references[i].bounds);
+	DirectX::XMStoreFloat3(&node.minimum, bounds.minimum);
+	DirectX::XMStoreFloat3(&node.maximum, bounds.maximum);
+}
+
+bool Bvh::Split(uint32_t nodeIndex, BuildData& data)
+{
+	Node& node = m_Nodes[nodeIndex];
+	if (node.count <= 1)
+		return false;
+
+	// Centroids are kept doubled (minimum + maximum), only their relative position matters
+	Bounds centroidBounds{};
+	for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+		centroidBounds.Grow(DirectX::XMVectorAdd(data.references[i].bounds.minimum, data.references[i].bounds.maximum));
+
+	DirectX::XMFLOAT3 extent{};
+	DirectX::XMStoreFloat3(&extent, DirectX::XMVectorSubtract(centroidBounds.maximum, centroidBounds.minimum));
+	const float binsPerUnit[3]
+	{
+		extent.x > 0.f ? g_BinCount / extent.x : 0.f,
+		extent.y > 0.f ? g_BinCount / extent.y : 0.f,
+		extent.z > 0.f ? g_BinCount / extent.z : 0.f
+	};
+	const DirectX::XMVECTOR scale = DirectX::XMVectorSet(binsPerUnit[0], binsPerUnit[1], binsPerUnit[2], 0.f);
+	auto getBins = [&](const Bounds& bounds, uint32_t bins[3])
+	{
+		DirectX::XMFLOAT3 position{};
+		DirectX::XMStoreFloat3(&position, DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(DirectX::XMVectorAdd(bounds.minimum, bounds.maximum), centroidBounds.minimum), scale));
+		bins[0] = (std::min)(g_BinCount - 1, static_cast<uint32_t>(position.x));
+		bins[1] = (std::min)(g_BinCount - 1, static_cast<uint32_t>(position.y));
+		bins[2] = (std::min)(g_BinCount - 1, static_cast<uint32_t>(position.z));
+	};
+
+	// Binned SAH: the triangles are sorted into bins along every axis in one pass and each boundary between bins is a candidate
+	Bounds binBounds[3][g_BinCount]{};
+	uint32_t binCounts[3][g_BinCount]{};
+	for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+	{
+		const BuildData::Reference& reference = data.references[i];
+		uint32_t bins[3]{};
+		getBins(reference.bounds, bins);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			binBounds[axis][bins[axis]].Grow(reference.bounds);
+			++binCounts[axis][bins[axis]];
+		}
+	}
+
+	float bestCost{ FLT_MAX };
+	int bestAxis{ -1 };
+	uint32_t bestSplit{};
+	Bounds bestLeft{};
+	Bounds bestRight{};
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (binsPerUnit[axis] == 0.f)
+			continue;
+
+		// Sweep from both sides, split i puts bins [0, i] on the left
+		Bounds lefts[g_BinCount - 1]{};
+		uint32_t leftCounts[g_BinCount - 1]{};
+		Bounds left{};
+		uint32_t leftCount{};
+		for (uint32_t i = 0; i < g_BinCount - 1; ++i)
+		{
+			left.Grow(binBounds[axis][i]);
+			leftCount += binCounts[axis][i];
+			lefts[i] = left;
+			leftCounts[i] = leftCount;
+		}
+
+		Bounds right{};
+		uint32_t rightCount{};
+		for (uint32_t i = g_BinCount - 1; i > 0; --i)
+		{
+			right.Grow(binBounds[axis][i]);
+			rightCount += binCounts[axis][i];
+			if (leftCounts[i - 1] == 0 || rightCount == 0)
+				continue;
+
+			const float cost = leftCounts[i - 1] * lefts[i - 1].GetArea() + rightCount * right.GetArea();
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i - 1;
+				bestLeft = lefts[i - 1];
+				bestRight = right;
+			}
+		}
+	}
+
+	// Every centroid in the same spot, nothing left to split
+	if (bestAxis < 0)
+		return false;
+
+	// Small nodes stay a leaf unless splitting is cheaper than testing every triangle
+	const float area = Bounds{ DirectX::XMLoadFloat3(&node.minimum), DirectX::XMLoadFloat3(&node.maximum) }.GetArea();
+	if (node.count <= g_MaxLeafTriangles && (area <= 0.f || g_TraversalCost + bestCost / area >= node.count))
+		return false;
+
+	const auto first = data.references.begin() + node.leftFirst;
+	const auto middle = std::partition(first, first + node.count, [&](const BuildData::Reference& reference)
+		{
+			uint32_t bins[3]{};
+			getBins(reference.bounds, bins);
+			return bins[bestAxis] <= bestSplit;
+		});
+
+	const uint32_t leftCount = static_cast<uint32_t>(middle - first);
+	if (leftCount == 0 || leftCount == node.count)
+		return false;
+
+	// The bins already hold the bounds of both halves
+	const uint32_t leftIndex = data.nodeCount.fetch_add(2);
+	Node& left = m_Nodes[leftIndex];
+	DirectX::XMStoreFloat3(&left.minimum, bestLeft.minimum);
+	DirectX::XMStoreFloat3(&left.maximum, bestLeft.maximum);
+	left.leftFirst = node.leftFirst;
+	left.count = leftCount;
+
+	Node& right = m_Nodes[leftIndex + 1];
+	DirectX::XMStoreFloat3(&right.minimum, bestRight.minimum);
+	DirectX::XMStoreFloat3(&right.maximum, bestRight.maximum);
+	right.leftFirst = node.leftFirst + leftCount;
+	right.count = node.count - leftCount;
+
+	node.leftFirst = leftIndex;
+	node.count = 0;
+	return true;
+}
+
+bool Bvh::Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Hit& hit) const
+{
+	return Traverse<false>(origin, direction, maxDistance, hit);
+}
+
+bool Bvh::Intersects(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance) const
+{
+	Hit hit{};
+	return Traverse<true>(origin, direction, maxDistance, hit);
+}
+
+template<bool anyHit>
+bool Bvh::Traverse(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Hit& hit) const
+{
+	using namespace DirectX;
+
+	if (m_Nodes.empty())
+		return false;
+
+	// Zero components would turn into NaNs in the slab test, a tiny value gives the same answer
+	auto safe = [](float value) { return std::fabs(value) < 1e-20f ? (value < 0.f ? -1e-20f : 1e-20f) : value; };
+	const XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+	const XMVECTOR rayDirection = XMLoadFloat3(&direction);
+	const XMVECTOR inverseDirection = XMVectorDivide(XMVectorReplicate(1.f), XMVectorSet(safe(direction.x), safe(direction.y), safe(direction.z), 1.f));
+
+	float closest = maxDistance;
+
+	// Slab test on all three axes at once, returns the entry distance or FLT_MAX on a miss
+	auto intersectBox = [&](const Node& node)
+	{
+		const XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.minimum), rayOrigin), inverseDirection);
+		const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&node.maximum), rayOrigin), inverseDirection);
+		const XMVECTOR entries = XMVectorMin(t0, t1);
+		const XMVECTOR exits = XMVectorMax(t0, t1);
+		const float entry = XMVectorGetX(XMVectorMax(XMVectorMax(XMVectorSplatX(entries), XMVectorSplatY(entries)), XMVectorSplatZ(entries)));
+		const float exit = XMVectorGetX(XMVectorMin(XMVectorMin(XMVectorSplatX(exits), XMVectorSplatY(exits)), XMVectorSplatZ(exits)));
+		return exit >= (std::max)(entry, 0.f) && entry < closest ? entry : FLT_MAX;
+	};
+
+	bool found{};
+	// Every level pushes at most one node, the distance is kept to skip it once something closer was hit
+	std::pair<uint32_t, float> stack[g_MaxDepth + 1];
+	uint32_t stackSize{};
+	uint32_t nodeIndex{};
+	if (intersectBox(m_Nodes[0]) == FLT_MAX)
+		return false;
+
+	while (true)
+	{
+		const Node& node = m_Nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			// Moller-Trumbore, both sides count as a hit
+			for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+			{
+				const Triangle& triangle = m_Triangles[i];
+				const XMVECTOR edge1 = XMLoadFloat3(&triangle.edge1);
+				const XMVECTOR edge2 = XMLoadFloat3(&triangle.edge2);
+				const XMVECTOR p = XMVector3Cross(rayDirection, edge2);
+				const float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+				if (determinant == 0.f)
+					continue;
+
+				const float inverseDeterminant = 1.f / determinant;
+				const XMVECTOR s = XMVectorSubtract(rayOrigin, XMLoadFloat3(&triangle.vertex));
+				const float u = XMVectorGetX(XMVector3Dot(s, p)) * inverseDeterminant;
+				if (u < 0.f || u > 1.f)
+					continue;
+
+				const XMVECTOR q = XMVector3Cross(s, edge1);
+				const float v = XMVectorGetX(XMVector3Dot(rayDirection, q)) * inverseDeterminant;
+				if (v < 0.f || u + v > 1.f)
+					continue;
+
+				const float distance = XMVectorGetX(XMVector3Dot(edge2, q)) * inverseDeterminant;
+				if (distance < 0.f || distance >= closest)
+					continue;
+
+				if constexpr (anyHit)
+					return true;
+
+				closest = distance;
+				found = true;
+				hit.distance = distance;
+				hit.triangle = m_TriangleIds[i];
+				hit.u = u;
+				hit.v = v;
+				XMStoreFloat3(&hit.normal, XMVector3Normalize(XMVector3Cross(edge1, edge2)));
+			}
+		}
+		else
+		{
+			// Nearest child first, the other one waits on the stack
+			uint32_t nearIndex = node.leftFirst;
+			uint32_t farIndex = node.leftFirst + 1;
+			float nearDistance = intersectBox(m_Nodes[nearIndex]);
+			float farDistance = intersectBox(m_Nodes[farIndex]);
+			if (farDistance < nearDistance)
+			{
+				std::swap(nearIndex, farIndex);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if (nearDistance != FLT_MAX)
+			{
+				if (farDistance != FLT_MAX)
+					stack[stackSize++] = { farIndex, farDistance };
+				nodeIndex = nearIndex;
+				continue;
+			}
+		}
+
+		do
+		{
+			if (stackSize == 0)
+				return found;
+			--stackSize;
+		} while (stack[stackSize].second >= closest);
+		nodeIndex = stack[stackSize].first;
+	}
+
+}
+
+size_t Bvh::GetTriangleCount() const
+{
+	return m_Triangles.size();
+}
+
+size_t Bvh::GetNodeCount() const
+{
+	return m_Nodes.size();
+}
+
+size_t Bvh::GetMemory() const
+{
+	return m_Nodes.size() * sizeof(Node) + m_Triangles.size() * sizeof(Triangle) + m_TriangleIds.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+
+// Bounding volume hierarchy over the triangles of one mesh for CPU raycasts (picking, line of sight).
+// Built with the surface area heuristic and flattened into one array, the two children of a node are neighbours.
+class Bvh final
+{
+public:
+	// Leaves hold at most this many triangles unless they can not be split any further
+	static constexpr uint32_t g_MaxLeafTriangles{ 4 };
+
+	struct Hit
+	{
+		float distance{ FLT_MAX };		// In units of the ray direction
+		uint32_t triangle{ UINT32_MAX };	// Index in the triangle list that was given to SetTriangles
+		float u{};						// Barycentric weights of the second and third corner
+		float v{};
+		DirectX::XMFLOAT3 normal{};		// Unit face normal
+	};
+
+	// Copies the triangle positions, positions are read as 3 floats at the start of every vertex. Clears the tree.
+	void SetTriangles(const void* pVertices, size_t vertexSize, const uint32_t* pIndices, size_t indexCount);
+	// Keeps the first triangleCount triangles, e.g. only the first lod of an index buffer. Clears the tree.
+	void Truncate(size_t triangleCount);
+
+	// Builds the tree over the triangles, subtrees are split over the job system
+	void Build();
+	bool IsBuilt() const;
+
+	// Closest hit along the ray within maxDistance, the direction does not have to be normalized
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Hit& hit) const;
+	// Stops at the first hit, for visibility queries
+	bool Intersects(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance) const;
+
+	size_t GetTriangleCount() const;
+	size_t GetNodeCount() const;
+	size_t GetMemory() const;
+
+private:
+	// 32 bytes, a leaf when count > 0. leftFirst is the left child of an inner node or the first triangle of a leaf.
+	struct Node
+	{
+		DirectX::XMFLOAT3 minimum;
+		uint32_t leftFirst;
+		DirectX::XMFLOAT3 maximum;
+		uint32_t count;
+	};
+
+	// Stored the way the intersection test needs them
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 vertex;
+		DirectX::XMFLOAT3 edge1;
+		DirectX::XMFLOAT3 edge2;
+	};
+
+	struct BuildData;
+	void UpdateBounds(uint32_t nodeIndex, const BuildData& data);
+	bool Split(uint32_t nodeIndex, BuildData& data);
+
+	template<bool anyHit>
+	bool Traverse(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Hit& hit) const;
+
+	std::vector<Node> m_Nodes{};
+	std::vector<Triangle> m_Triangles{};
+	// Original index of every triangle, they are reordered to match the leaves
+	std::vector<uint32_t> m_TriangleIds{};
+};
@@ -166,4 +166,15 @@ void Camera::UpdateMatrix()
 	DirectX::XMStoreFloat4x4(&m_ViewInv, viewInv);
 	DirectX::XMStoreFloat4x4(&m_ViewProjection, view * projection);
 	DirectX::XMStoreFloat4x4(&m_ViewProjectionInv, viewProjectionInv);
-}
\ No newline at end of file
+}
+
+void Camera::ScreenToRay(float x, float y, DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction) const
+{
+	// Unproject the point on the near and the far plane, D3D clip space depth goes from 0 to 1
+	const DirectX::XMMATRIX viewProjectionInv = DirectX::XMLoadFloat4x4(&m_ViewProjectionInv);
+	const DirectX::XMVECTOR nearPoint = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x * 2.f - 1.f, 1.f - y * 2.f, 0.f, 1.f), viewProjectionInv);
+	const DirectX::XMVECTOR farPoint = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x * 2.f - 1.f, 1.f - y * 2.f, 1.f, 1.f), viewProjectionInv);
+
+	DirectX::XMStoreFloat3(&origin, nearPoint);
+	DirectX::XMStoreFloat3(&direction, DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(farPoint, nearPoint)));
+}
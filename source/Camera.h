@@ -24,6 +24,10 @@ public:
 	DirectX::XMFLOAT4X4 GetProjectionMatrix() const { return m_ProjectionMatrix; };
 	DirectX::XMFLOAT4X4 GetViewProjection() const { return m_ViewProjection; };
 	DirectX::XMFLOAT4X4 GetViewProjectionMatrix() const { return m_ViewProjection; };
+	DirectX::XMFLOAT4X4 GetViewProjectionInv() const { return m_ViewProjectionInv; };
+
+	// World space ray through a point on the screen, x and y go from 0 to 1 starting at the top left
+	void ScreenToRay(float x, float y, DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction) const;
 
 	DirectX::XMFLOAT2 GetAbsoluteRotation() const { return m_AbsoluteRotation; }
 
@@ -0,0 +1,316 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr size_t g_MinMatch{ 4 };
+	constexpr size_t g_LastLiterals{ 5 };
+	constexpr size_t g_MatchFindLimit{ 12 };
+	constexpr size_t g_MaxOffset{ 65535 };
+	constexpr uint32_t g_HashLog{ 16 };
+	constexpr uint32_t g_StoredFlag{ 0x80000000 };
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - g_HashLog);
+	}
+
+	// Writes the 255 continuation bytes of a length that did not fit in the token
+	inline bool WriteLength(uint8_t*& op, const uint8_t* oend, size_t length)
+	{
+		while (length >= 255)
+		{
+			if (op >= oend) return false;
+			*op++ = 255;
+			length -= 255;
+		}
+		if (op >= oend) return false;
+		*op++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	inline bool ReadLength(const uint8_t*& ip, const uint8_t* iend, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (ip >= iend) return false;
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	bool WriteSequence(uint8_t*& op, const uint8_t* oend, const uint8_t* pLiterals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		if (op >= oend) return false;
+		uint8_t* pToken = op++;
+
+		if (literalLength >= 15)
+		{
+			*pToken = 15 << 4;
+			if (!WriteLength(op, oend, literalLength - 15)) return false;
+		}
+		else
+			*pToken = static_cast<uint8_t>(literalLength << 4);
+
+		if (op + literalLength > oend) return false;
+		memcpy(op, pLiterals, literalLength);
+		op += literalLength;
+
+		// The last sequence only holds literals
+		if (matchLength == 0)
+			return true;
+
+		if (op + 2 > oend) return false;
+		*op++ = static_cast<uint8_t>(offset & 0xFF);
+		*op++ = static_cast<uint8_t>(offset >> 8);
+
+		matchLength -= g_MinMatch;
+		if (matchLength >= 15)
+		{
+			*pToken |= 15;
+			return WriteLength(op, oend, matchLength - 15);
+		}
+
+		*pToken |= static_cast<uint8_t>(matchLength);
+		return true;
+	}
+}
+
+size_t Compression::CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t Compression::CompressBlock(const char* pSrc, size_t srcSize, char* pDst, size_t dstCapacity)
+{
+	const uint8_t* pBase = reinterpret_cast<const uint8_t*>(pSrc);
+	const uint8_t* ip = pBase;
+	const uint8_t* pAnchor = pBase;
+	const uint8_t* iend = pBase + srcSize;
+
+	uint8_t* op = reinterpret_cast<uint8_t*>(pDst);
+	const uint8_t* oend = op + dstCapacity;
+
+	if (srcSize > g_MatchFindLimit)
+	{
+		const uint8_t* pMatchFindLimit = iend - g_MatchFindLimit;
+		const uint8_t* pMatchLimit = iend - g_LastLiterals;
+
+		std::vector<uint32_t> hashTable(size_t(1) << g_HashLog, 0);
+
+		while (ip < pMatchFindLimit)
+		{
+			const uint32_t hash = Hash(Read32(ip));
+			const uint8_t* pRef = pBase + hashTable[hash];
+			hashTable[hash] = static_cast<uint32_t>(ip - pBase);
+
+			if (pRef >= ip || static_cast<size_t>(ip - pRef) > g_MaxOffset || Read32(pRef) != Read32(ip))
+			{
+				// Skip faster through data that does not compress
+				ip += 1 + ((ip - pAnchor) >> 6);
+				continue;
+			}
+
+			// Extend the match backwards into the pending literals
+			while (ip > pAnchor && pRef > pBase && ip[-1] == pRef[-1])
+			{
+				--ip;
+				--pRef;
+			}
+
+			size_t matchLength = g_MinMatch;
+			while (ip + matchLength < pMatchLimit && ip[matchLength] == pRef[matchLength])
+				++matchLength;
+
+			if (!WriteSequence(op, oend, pAnchor, ip - pAnchor, ip - pRef, matchLength))
+				return 0;
+
+			ip += matchLength;
+			pAnchor = ip;
+
+			if (ip < pMatchFindLimit)
+				hashTable[Hash(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - pBase);
+		}
+	}
+
+	if (!WriteSequence(op, oend, pAnchor, iend - pAnchor, 0, 0))
+		return 0;
+
+	return op - reinterpret_cast<uint8_t*>(pDst);
+}
+
+size_t Compression::DecompressBlock(const char* pSrc, size_t srcSize, char* pDst, size_t dstCapacity)
+{
+	const uint8_t* ip = reinterpret_cast<const uint8_t*>(pSrc);
+	const uint8_t* iend = ip + srcSize;
+
+	uint8_t* pBase = reinterpret_cast<uint8_t*>(pDst);
+	uint8_t* op = pBase;
+	const uint8_t* oend = op + dstCapacity;
+
+	while (ip < iend)
+	{
+		const uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+			return 0;
+
+		if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op))
+			return 0;
+
+		memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return 0;
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > static_cast<size_t>(op - pBase))
+			return 0;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+			return 0;
+		matchLength += g_MinMatch;
+
+		if (matchLength > static_cast<size_t>(oend - op))
+			return 0;
+
+		const uint8_t* pMatch = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, pMatch, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			// Overlapping copy, repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; ++i)
+				*op++ = pMatch[i];
+		}
+	}
+
+	return op - pBase;
+}
+
+bool Compression::WriteCompressed(std::ostream& stream, const char* pData, size_t size)
+{
+	FileHeader header{};
+	header.uncompressedSize = size;
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<char> compressed(CompressBound(g_BlockSize));
+	for (size_t offset = 0; offset < size; offset += g_BlockSize)
+	{
+		const uint32_t rawSize = static_cast<uint32_t>(std::min<size_t>(g_BlockSize, size - offset));
+		uint32_t compressedSize = static_cast<uint32_t>(CompressBlock(pData + offset, rawSize, compressed.data(), compressed.size()));
+
+		// Store blocks that do not shrink as they are
+		const bool stored = compressedSize == 0 || compressedSize >= rawSize;
+		const uint32_t blockHeader[2]{ stored ? (rawSize | g_StoredFlag) : compressedSize, rawSize };
+		stream.write(reinterpret_cast<const char*>(blockHeader), sizeof(blockHeader));
+		stream.write(stored ? pData + offset : compressed.data(), stored ? rawSize : compressedSize);
+	}
+
+	const uint32_t endMarker[2]{};
+	stream.write(reinterpret_cast<const char*>(endMarker), sizeof(endMarker));
+
+	return stream.good();
+}
+
+bool Compression::IsCompressed(std::istream& stream)
+{
+	const auto start = stream.tellg();
+
+	uint32_t magic{};
+	stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	const bool compressed = stream.gcount() == sizeof(magic) && magic == g_Magic;
+
+	stream.clear();
+	stream.seekg(start);
+	return compressed;
+}
+
+CompressedInputStream::CompressedInputStream(std::istream& stream)
+	: m_Stream{ stream }
+{
+	Compression::FileHeader header{};
+	m_Stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!m_Stream || header.magic != Compression::g_Magic || header.blockSize == 0)
+		return;
+
+	m_BlockSize = header.blockSize;
+	m_UncompressedSize = header.uncompressedSize;
+	m_Valid = true;
+	m_Compressed.reserve(Compression::CompressBound(m_BlockSize));
+	m_Block.reserve(m_BlockSize);
+
+	ReadBlock();
+}
+
+void CompressedInputStream::ReadBlock()
+{
+	m_Consumed += m_Block.size();
+	m_Current = 0;
+	m_Block.clear();
+
+	uint32_t blockHeader[2]{};
+	m_Stream.read(reinterpret_cast<char*>(blockHeader), sizeof(blockHeader));
+	if (!m_Stream)
+	{
+		// A truncated file, only the end marker ends the data
+		m_Valid = false;
+		return;
+	}
+	if (blockHeader[0] == 0)
+	{
+		if (m_Consumed != m_UncompressedSize)
+			m_Valid = false;
+		return;
+	}
+
+	const bool stored = (blockHeader[0] & g_StoredFlag) != 0;
+	const uint32_t compressedSize = blockHeader[0] & ~g_StoredFlag;
+	const uint32_t rawSize = blockHeader[1];
+	if (rawSize > m_BlockSize || compressedSize > Compression::CompressBound(m_BlockSize))
+	{
+		m_Valid = false;
+		return;
+	}
+
+	m_Block.resize(rawSize);
+	if (stored)
+	{
+		m_Stream.read(m_Block.data(), rawSize);
+		if (!m_Stream)
+		{
+			m_Block.clear();
+			m_Valid = false;
+		}
+		return;
+	}
+
+	m_Compressed.resize(compressedSize);
+	m_Stream.read(m_Compressed.data(), compressedSize);
+	if (!m_Stream || Compression::DecompressBlock(m_Compressed.data(), compressedSize, m_Block.data(), rawSize) != rawSize)
+	{
+		m_Block.clear();
+		m_Valid = false;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LZ4 style block compression used for the save files.
+// A compressed file starts with a small header so files without it are still read as plain text.
+namespace Compression
+{
+	constexpr uint32_t g_Magic{ 0x315A454D }; // "MEZ1"
+	constexpr uint32_t g_BlockSize{ 256 * 1024 };
+
+	struct FileHeader
+	{
+		uint32_t magic{ g_Magic };
+		uint32_t blockSize{ g_BlockSize };
+		uint64_t uncompressedSize{};
+	};
+
+	// Worst case size of a compressed block
+	size_t CompressBound(size_t size);
+
+	// Returns the amount of bytes written to dst, 0 when dst is too small
+	size_t CompressBlock(const char* pSrc, size_t srcSize, char* pDst, size_t dstCapacity);
+	// Returns the amount of bytes written to dst, 0 when the block is corrupt
+	size_t DecompressBlock(const char* pSrc, size_t srcSize, char* pDst, size_t dstCapacity);
+
+	bool WriteCompressed(std::ostream& stream, const char* pData, size_t size);
+	bool IsCompressed(std::istream& stream);
+}
+
+// Input stream that decompresses one block at a time, follows the rapidjson stream concept
+// so it can be handed straight to Document::ParseStream
+class CompressedInputStream final
+{
+public:
+	typedef char Ch;
+
+	explicit CompressedInputStream(std::istream& stream);
+
+	CompressedInputStream(const CompressedInputStream& other) = delete;
+	CompressedInputStream(CompressedInputStream&& other) noexcept = delete;
+	CompressedInputStream& operator=(const CompressedInputStream& other) = delete;
+	CompressedInputStream& operator=(CompressedInputStream&& other) noexcept = delete;
+
+	Ch Peek() const { return m_Current < m_Block.size() ? m_Block[m_Current] : '\0'; }
+	Ch Take()
+	{
+		if (m_Current >= m_Block.size())
+			return '\0';
+
+		const Ch c = m_Block[m_Current++];
+		if (m_Current == m_Block.size())
+			ReadBlock();
+		return c;
+	}
+	size_t Tell() const { return m_Consumed + m_Current; }
+
+	// Not implemented, the stream is read only
+	Ch* PutBegin() { return nullptr; }
+	void Put(Ch) {}
+	void Flush() {}
+	size_t PutEnd(Ch*) { return 0; }
+
+	// False when a block is corrupt or the file ends before its end marker
+	bool IsValid() const { return m_Valid; }
+
+private:
+	void ReadBlock();
+
+	std::istream& m_Stream;
+	std::vector<char> m_Compressed{};
+	std::vector<char> m_Block{};
+
+	size_t m_Current{};
+	size_t m_Consumed{};
+	uint64_t m_UncompressedSize{};
+	uint32_t m_BlockSize{};
+	bool m_Valid{ false };
+};
@@ -6,7 +6,7 @@
 #include "MyEngine.h"
 #include "Camera.h"
 #include "MyApplication.h"
-#include "Material.h"
+#include "EffectCache.h"
 #include "Logger.h"
 #include "Scene.h"
 
@@ -160,7 +160,7 @@ void DebugRenderer::BuildInputLayout()
 
 DebugRenderer::DebugRenderer()
 {
-	m_pEffect = Material::LoadEffect(MyEngine::GetSingleton()->GetDevice(), L"Resources/DebugRenderer.fx");
+	m_pEffect = EffectCache::GetInstance()->GetEffect(MyEngine::GetSingleton()->GetDevice(), "Resources/DebugRenderer.fx");
 	m_pTechnique = m_pEffect->GetTechniqueByIndex(0);
 	BuildInputLayout();
 
@@ -0,0 +1,147 @@
+#include "DirectoryModel.h"
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+DirectoryModel::DirectoryModel(const std::string& directory)
+{
+	// Spelled the same way as the paths of the watcher events
+	m_Root.path = std::filesystem::path(directory).generic_string();
+	while (m_Root.path.size() > 1 && m_Root.path.back() == '/')
+		m_Root.path.pop_back();
+	m_Root.name = m_Root.path;
+	m_Root.isDirectory = true;
+
+	Rebuild();
+}
+
+void DirectoryModel::Rebuild()
+{
+	m_Root.children.clear();
+	Scan(m_Root);
+	++m_Version;
+}
+
+void DirectoryModel::Apply(const FileEvent& event)
+{
+	const size_t slash = event.path.find_last_of('/');
+	if (slash == std::string::npos)
+		return;
+	const std::string_view name{ event.path.data() + slash + 1, event.path.size() - slash - 1 };
+	const auto isNamed = [name](const std::unique_ptr<DirectoryNode>& pNode) { return pNode->name == name; };
+
+	switch (event.type)
+	{
+	case FileEvent::Type::Overflow:
+		Rebuild();
+		break;
+	case FileEvent::Type::Added:
+	{
+		DirectoryNode* pParent = Find(event.path.substr(0, slash), true);
+		if (pParent == nullptr || !pParent->isDirectory || name.empty())
+			return;
+		// Already there when the watcher reported the files of a new directory as well
+		if (std::any_of(pParent->children.begin(), pParent->children.end(), isNamed))
+			return;
+
+		auto pNode = std::make_unique<DirectoryNode>();
+		pNode->name = name;
+		pNode->path = event.path;
+		pNode->isDirectory = event.isDirectory;
+		DirectoryNode* pAdded = Insert(*pParent, std::move(pNode));
+		// A directory that was moved in comes with its files, not every platform reports those
+		if (pAdded->isDirectory)
+			Scan(*pAdded);
+		++m_Version;
+		break;
+	}
+	case FileEvent::Type::Removed:
+	{
+		DirectoryNode* pParent = Find(event.path.substr(0, slash), false);
+		if (pParent == nullptr)
+			return;
+
+		const auto iter = std::find_if(pParent->children.begin(), pParent->children.end(), isNamed);
+		if (iter == pParent->children.end())
+			return;
+		pParent->children.erase(iter);
+		++m_Version;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+const DirectoryNode* DirectoryModel::Find(const std::string& path) const
+{
+	return const_cast<DirectoryModel*>(this)->Find(path, false);
+}
+
+DirectoryNode* DirectoryModel::Find(const std::string& path, bool create)
+{
+	if (path == m_Root.path)
+		return &m_Root;
+	if (path.size() <= m_Root.path.size() || path.compare(0, m_Root.path.size(), m_Root.path) != 0 || path[m_Root.path.size()] != '/')
+		return nullptr;
+
+	DirectoryNode* pNode = &m_Root;
+	for (size_t start = m_Root.path.size() + 1; start < path.size(); )
+	{
+		size_t end = path.find('/', start);
+		if (end == std::string::npos)
+			end = path.size();
+
+		const std::string_view name{ path.data() + start, end - start };
+		start = end + 1;
+		if (name.empty())
+			continue;
+
+		const auto iter = std::find_if(pNode->children.begin(), pNode->children.end(), [name](const auto& pChild) { return pChild->name == name; });
+		if (iter != pNode->children.end())
+		{
+			pNode = iter->get();
+			continue;
+		}
+		if (!create)
+			return nullptr;
+
+		auto pDirectory = std::make_unique<DirectoryNode>();
+		pDirectory->name = name;
+		pDirectory->path = path.substr(0, end);
+		pDirectory->isDirectory = true;
+		pNode = Insert(*pNode, std::move(pDirectory));
+		++m_Version;
+	}
+
+	return pNode;
+}
+
+DirectoryNode* DirectoryModel::Insert(DirectoryNode& parent, std::unique_ptr<DirectoryNode> pNode)
+{
+	const auto iter = std::lower_bound(parent.children.begin(), parent.children.end(), pNode, [](const auto& pA, const auto& pB)
+	{
+		if (pA->isDirectory != pB->isDirectory)
+			return pA->isDirectory;
+		return pA->name < pB->name;
+	});
+	return parent.children.insert(iter, std::move(pNode))->get();
+}
+
+void DirectoryModel::Scan(DirectoryNode& node)
+{
+	std::error_code error{};
+	for (const auto& entry : std::filesystem::directory_iterator(node.path, error))
+	{
+		auto pNode = std::make_unique<DirectoryNode>();
+		pNode->name = entry.path().filename().generic_string();
+		pNode->path = node.path + "/" + pNode->name;
+		pNode->isDirectory = entry.is_directory(error);
+
+		DirectoryNode* pAdded = Insert(node, std::move(pNode));
+		if (pAdded->isDirectory)
+			Scan(*pAdded);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FileEvent;
+
+struct DirectoryNode
+{
+	std::string name{};
+	std::string path{};			// Relative like the directory of the model, '/' separated
+	bool isDirectory{};
+	std::vector<std::unique_ptr<DirectoryNode>> children{};		// Directories first, then by name
+};
+
+// The files under a directory for the editor. Walked once and then kept up to date from the events of a
+// FileWatcher, so drawing it never touches the file system.
+class DirectoryModel final
+{
+public:
+	explicit DirectoryModel(const std::string& directory);
+	~DirectoryModel() = default;
+
+	DirectoryModel(const DirectoryModel& other) = delete;
+	DirectoryModel(DirectoryModel&& other) noexcept = delete;
+	DirectoryModel& operator=(const DirectoryModel& other) = delete;
+	DirectoryModel& operator=(DirectoryModel&& other) noexcept = delete;
+
+	// Walks the whole directory again, an overflow event does this as well
+	void Rebuild();
+	void Apply(const FileEvent& event);
+
+	const DirectoryNode& GetRoot() const { return m_Root; }
+	// nullptr when the path is not under the directory or does not exist
+	const DirectoryNode* Find(const std::string& path) const;
+	// Changes whenever the tree changed
+	uint32_t GetVersion() const { return m_Version; }
+
+private:
+	// The node of the path, with create the directories that are missing on the way are added
+	DirectoryNode* Find(const std::string& path, bool create);
+	static DirectoryNode* Insert(DirectoryNode& parent, std::unique_ptr<DirectoryNode> pNode);
+	static void Scan(DirectoryNode& node);
+
+	DirectoryNode m_Root{};
+	uint32_t m_Version{};
+};
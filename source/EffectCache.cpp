@@ -0,0 +1,200 @@
+#include "EffectCache.h"
+
+#include "AssetPack.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "MyEngine.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+EffectCache* EffectCache::m_pEffectCache;
+
+namespace
+{
+	uint64_t HashDefines(const EffectDefines& defines)
+	{
+		uint64_t hash{};
+		for (const auto& [name, value] : defines)
+		{
+			hash = HashBytes(name.data(), name.size(), hash);
+			hash = HashBytes(value.data(), value.size(), hash);
+		}
+		return hash;
+	}
+
+	uint32_t GetShaderFlags()
+	{
+		uint32_t shaderFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+		shaderFlags |= D3DCOMPILE_DEBUG;
+		shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+		return shaderFlags;
+	}
+
+	bool Matches(const EffectBytecodeCache::Key& a, const EffectBytecodeCache::Key& b)
+	{
+		return a.sourceHash == b.sourceHash && a.sourceSize == b.sourceSize && a.definesHash == b.definesHash
+			&& a.shaderFlags == b.shaderFlags && a.compilerVersion == b.compilerVersion;
+	}
+
+	// Written next to the target first so a crash never leaves a half written file behind
+	bool WriteBytecode(const std::string& filename, const EffectBytecodeCache::FileHeader& header, const void* pBytecode)
+	{
+		std::error_code error{};
+		std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+		const std::string temporary = filename + ".tmp";
+		{
+			std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(static_cast<const char*>(pBytecode), header.bytecodeSize);
+			if (!file)
+				return false;
+		}
+
+		std::filesystem::rename(temporary, filename, error);
+		return !error;
+	}
+}
+
+std::string EffectBytecodeCache::GetCachePath(const std::string& sourcePath, uint64_t definesHash)
+{
+	std::string name = std::filesystem::path(sourcePath).lexically_normal().generic_string();
+	std::replace_if(name.begin(), name.end(), [](char c) { return c == '/' || c == '\\' || c == ':' || c == '.'; }, '_');
+
+	return "Cache/Effects/" + name + "_" + std::to_string(definesHash) + ".fxo";
+}
+
+EffectCache::~EffectCache()
+{
+	m_pEffects.ForEach([](ResourceId, ID3DX11Effect* pEffect) { pEffect->Release(); });
+	m_pEffects.Clear();
+}
+
+EffectCache* EffectCache::GetInstance()
+{
+	if (m_pEffectCache == nullptr) m_pEffectCache = new EffectCache();
+
+	return m_pEffectCache;
+}
+
+ID3DX11Effect* EffectCache::GetEffect(ID3D11Device* pDevice, const std::string& file, const EffectDefines& defines)
+{
+	ResourceId id = GetResourceId(file);
+	for (const auto& [name, value] : defines)
+		id = AppendResourceId(AppendResourceId(AppendResourceId(AppendResourceId(id, "\n"), name), "="), value);
+
+	if (ID3DX11Effect** ppEffect = m_pEffects.Find(id))
+	{
+		(*ppEffect)->AddRef();
+		return *ppEffect;
+	}
+
+	ID3DX11Effect* pEffect = LoadEffect(pDevice, file, defines);
+	if (pEffect == nullptr)
+		return nullptr;
+
+	// The cache keeps the reference of the load, the caller gets one of its own
+	m_pEffects.Insert(id, pEffect);
+	pEffect->AddRef();
+	return pEffect;
+}
+
+ID3DX11Effect* EffectCache::LoadEffect(ID3D11Device* pDevice, const std::string& file, const EffectDefines& defines)
+{
+	using namespace EffectBytecodeCache;
+
+	const auto start = std::chrono::steady_clock::now();
+	auto logTime = [&](const std::string& message)
+	{
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Logger::GetInstance()->LogDebug("EffectCache: " + file + " " + message + " in " + std::to_string(milliseconds) + " ms");
+	};
+
+	AssetFile source{ file };
+	if (!source.IsOpen())
+	{
+		Logger::GetInstance()->LogWarning("EffectCache: could not read " + file);
+		return nullptr;
+	}
+
+	Key key{};
+	key.sourceHash = HashBytes(source.GetData(), source.GetSize());
+	key.sourceSize = source.GetSize();
+	key.definesHash = HashDefines(defines);
+	key.shaderFlags = GetShaderFlags();
+	key.compilerVersion = D3D_COMPILER_VERSION;
+
+	const std::string cachePath = GetCachePath(file, key.definesHash);
+	{
+		MappedFile cached{ cachePath };
+		if (cached.IsOpen() && cached.GetSize() >= sizeof(FileHeader))
+		{
+			FileHeader header{};
+			memcpy(&header, cached.GetData(), sizeof(header));
+			if (header.magic == g_Magic && header.formatVersion == g_FormatVersion && Matches(header.key, key)
+				&& header.bytecodeSize == cached.GetSize() - sizeof(FileHeader))
+			{
+				ID3DX11Effect* pEffect{};
+				if (SUCCEEDED(D3DX11CreateEffectFromMemory(cached.GetData() + sizeof(FileHeader), static_cast<SIZE_T>(header.bytecodeSize), 0, pDevice, &pEffect)))
+				{
+					logTime("created from compiled bytecode");
+					return pEffect;
+				}
+			}
+		}
+	}
+
+	std::vector<D3D_SHADER_MACRO> macros{};
+	for (const auto& [name, value] : defines)
+		macros.push_back(D3D_SHADER_MACRO{ name.c_str(), value.c_str() });
+	macros.push_back(D3D_SHADER_MACRO{ nullptr, nullptr });
+
+	ID3DBlob* pBytecode{};
+	ID3DBlob* pErrors{};
+	const HRESULT result = D3DCompile(source.GetData(), source.GetSize(), file.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		nullptr, "fx_5_0", key.shaderFlags, 0, &pBytecode, &pErrors);
+
+	if (pErrors != nullptr)
+	{
+		const std::string errors(static_cast<const char*>(pErrors->GetBufferPointer()), pErrors->GetBufferSize());
+		pErrors->Release();
+		if (FAILED(result))
+			Logger::GetInstance()->LogWarning("EffectCache: could not compile " + file + "\n" + errors);
+	}
+	if (FAILED(result))
+	{
+		if (pBytecode != nullptr)
+			pBytecode->Release();
+		return nullptr;
+	}
+
+	ID3DX11Effect* pEffect{};
+	if (FAILED(D3DX11CreateEffectFromMemory(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), 0, pDevice, &pEffect)))
+	{
+		Logger::GetInstance()->LogWarning("EffectCache: could not create the effect of " + file);
+		pBytecode->Release();
+		return nullptr;
+	}
+
+	FileHeader header{};
+	header.key = key;
+	header.bytecodeSize = pBytecode->GetBufferSize();
+	if (!WriteBytecode(cachePath, header, pBytecode->GetBufferPointer()))
+		Logger::GetInstance()->LogWarning("EffectCache: could not write the compiled effect " + cachePath);
+	pBytecode->Release();
+
+	logTime("compiled");
+	return pEffect;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ResourceId.h"
+
+struct ID3D11Device;
+struct ID3DX11Effect;
+
+// Preprocessor defines an effect is compiled with, name and value
+using EffectDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Compiled bytecode of an effect in Cache/Effects, one file per source file and set of defines.
+// Layout: FileHeader, then the bytecode.
+namespace EffectBytecodeCache
+{
+	constexpr uint32_t g_Magic{ 0x3158464D }; // "MFX1"
+	constexpr uint32_t g_FormatVersion{ 1 };
+
+	// A cached file is only used when all of these match the source it was compiled from. Included files are not part
+	// of the key, the effects do not include anything.
+	struct Key
+	{
+		uint64_t sourceHash{};
+		uint64_t sourceSize{};
+		uint64_t definesHash{};
+		uint32_t shaderFlags{};
+		uint32_t compilerVersion{};
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic{ g_Magic };
+		uint32_t formatVersion{ g_FormatVersion };
+		Key key{};
+		uint64_t bytecodeSize{};
+	};
+
+	std::string GetCachePath(const std::string& sourcePath, uint64_t definesHash);
+}
+
+// Every effect the engine uses, compiled once per file and set of defines and shared by everything that draws with
+// it. The effects stay loaded until the cache is deleted so materials and emitters that come and go never compile.
+// Main thread only.
+class EffectCache final
+{
+public:
+	~EffectCache();
+
+	EffectCache(const EffectCache& other) = delete;
+	EffectCache(EffectCache&& other) noexcept = delete;
+	EffectCache& operator=(const EffectCache& other) = delete;
+	EffectCache& operator=(EffectCache&& other) noexcept = delete;
+
+	static EffectCache* GetInstance();
+
+	// The effect with a reference for the caller, who releases it. nullptr when the file can not be read or does not
+	// compile. The variables of an effect are shared, set them before every draw.
+	ID3DX11Effect* GetEffect(ID3D11Device* pDevice, const std::string& file, const EffectDefines& defines = {});
+
+	size_t GetEffectCount() const { return m_pEffects.GetSize(); }
+
+private:
+	EffectCache() = default;
+
+	// From the bytecode cache when it matches the source, compiled and written to it otherwise
+	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::string& file, const EffectDefines& defines);
+
+	static EffectCache* m_pEffectCache;
+
+	ResourceIdMap<ID3DX11Effect*> m_pEffects{};
+};
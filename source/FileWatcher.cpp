@@ -0,0 +1,260 @@
+#include "FileWatcher.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(const std::string& directory)
+	: m_Directory{ std::filesystem::path(directory).generic_string() }
+{
+	while (m_Directory.size() > 1 && m_Directory.back() == '/')
+		m_Directory.pop_back();
+
+#ifdef _WIN32
+	const std::wstring path{ m_Directory.begin(), m_Directory.end() };
+	HANDLE directoryHandle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directoryHandle == INVALID_HANDLE_VALUE)
+	{
+		Logger::GetInstance()->LogWarning("FileWatcher: could not watch " + m_Directory);
+		return;
+	}
+	m_pDirectoryHandle = directoryHandle;
+	m_pStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#else
+	m_Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	m_Stop = eventfd(0, EFD_CLOEXEC);
+	if (m_Notify < 0 || m_Stop < 0)
+	{
+		Logger::GetInstance()->LogWarning("FileWatcher: could not watch " + m_Directory);
+		return;
+	}
+	AddWatches(m_Directory, false);
+#endif
+
+	m_Thread = std::thread(&FileWatcher::Run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef _WIN32
+	if (m_pStopEvent)
+		SetEvent(m_pStopEvent);
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	if (m_pStopEvent)
+		CloseHandle(m_pStopEvent);
+	if (m_pDirectoryHandle)
+		CloseHandle(m_pDirectoryHandle);
+#else
+	if (m_Stop >= 0)
+	{
+		const uint64_t stop{ 1 };
+		[[maybe_unused]] const ssize_t written = write(m_Stop, &stop, sizeof(stop));
+	}
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	if (m_Notify >= 0)
+		close(m_Notify);
+	if (m_Stop >= 0)
+		close(m_Stop);
+#endif
+}
+
+void FileWatcher::Poll(std::vector<FileEvent>& events)
+{
+	events.clear();
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	std::swap(events, m_Events);
+}
+
+void FileWatcher::Push(FileEvent::Type type, const std::string& path, bool isDirectory)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	m_Events.push_back(FileEvent{ type, path, isDirectory });
+}
+
+#ifdef _WIN32
+void FileWatcher::Run()
+{
+	HANDLE directoryHandle = m_pDirectoryHandle;
+	HANDLE ioEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	const std::wstring directory{ m_Directory.begin(), m_Directory.end() };
+
+	// FILE_NOTIFY_INFORMATION has to be DWORD aligned
+	std::vector<DWORD> buffer(16 * 1024);
+	while (true)
+	{
+		OVERLAPPED overlapped{};
+		overlapped.hEvent = ioEvent;
+		ResetEvent(ioEvent);
+		if (!ReadDirectoryChangesW(directoryHandle, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)), TRUE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr))
+			break;
+
+		const HANDLE handles[2]{ ioEvent, m_pStopEvent };
+		DWORD bytes{};
+		if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+		{
+			CancelIo(directoryHandle);
+			GetOverlappedResult(directoryHandle, &overlapped, &bytes, TRUE);
+			break;
+		}
+		if (!GetOverlappedResult(directoryHandle, &overlapped, &bytes, FALSE))
+			break;
+
+		// The buffer overflowed, the changes are lost
+		if (bytes == 0)
+		{
+			Push(FileEvent::Type::Overflow, m_Directory, true);
+			continue;
+		}
+
+		for (const char* pData = reinterpret_cast<const char*>(buffer.data()); ; )
+		{
+			const auto* pInformation = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pData);
+			const std::wstring name(pInformation->FileName, pInformation->FileNameLength / sizeof(WCHAR));
+
+			std::string relative(WideCharToMultiByte(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), nullptr, 0, nullptr, nullptr), '\0');
+			WideCharToMultiByte(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), relative.data(), static_cast<int>(relative.size()), nullptr, nullptr);
+			std::replace(relative.begin(), relative.end(), '\\', '/');
+			const std::string path = m_Directory + "/" + relative;
+
+			const DWORD attributes = GetFileAttributesW((directory + L"\\" + name).c_str());
+			const bool isDirectory = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+			switch (pInformation->Action)
+			{
+			case FILE_ACTION_ADDED:
+			case FILE_ACTION_RENAMED_NEW_NAME:
+				Push(FileEvent::Type::Added, path, isDirectory);
+				break;
+			case FILE_ACTION_REMOVED:
+			case FILE_ACTION_RENAMED_OLD_NAME:
+				Push(FileEvent::Type::Removed, path, false);
+				break;
+			case FILE_ACTION_MODIFIED:
+				// Directories report every change of their contents as well
+				if (!isDirectory)
+					Push(FileEvent::Type::Modified, path, false);
+				break;
+			default:
+				break;
+			}
+
+			if (pInformation->NextEntryOffset == 0)
+				break;
+			pData += pInformation->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(ioEvent);
+}
+#else
+void FileWatcher::AddWatches(const std::string& directory, bool reportFiles)
+{
+	const int watch = inotify_add_watch(m_Notify, directory.c_str(), IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+	if (watch < 0)
+		return;
+	m_WatchPaths[watch] = directory;
+
+	std::error_code error{};
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		const std::string path = directory + "/" + entry.path().filename().generic_string();
+		const bool isDirectory = entry.is_directory(error);
+		if (reportFiles)
+			Push(FileEvent::Type::Added, path, isDirectory);
+		if (isDirectory)
+			AddWatches(path, reportFiles);
+	}
+}
+
+void FileWatcher::Run()
+{
+	alignas(inotify_event) char buffer[16 * 1024];
+	pollfd descriptors[2]{ { m_Notify, POLLIN, 0 }, { m_Stop, POLLIN, 0 } };
+	while (true)
+	{
+		if (poll(descriptors, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (descriptors[1].revents != 0)
+			break;
+
+		ssize_t size{};
+		while ((size = read(m_Notify, buffer, sizeof(buffer))) > 0)
+		{
+			for (ssize_t offset = 0; offset < size; )
+			{
+				const auto* pEvent = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + pEvent->len;
+
+				if (pEvent->mask & IN_Q_OVERFLOW)
+				{
+					Push(FileEvent::Type::Overflow, m_Directory, true);
+					continue;
+				}
+				if (pEvent->mask & IN_IGNORED)
+				{
+					m_WatchPaths.erase(pEvent->wd);
+					continue;
+				}
+
+				const auto watch = m_WatchPaths.find(pEvent->wd);
+				if (watch == m_WatchPaths.end() || pEvent->len == 0)
+					continue;
+
+				const std::string path = watch->second + "/" + pEvent->name;
+				const bool isDirectory = (pEvent->mask & IN_ISDIR) != 0;
+				if (pEvent->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					Push(FileEvent::Type::Added, path, isDirectory);
+					// Files can be created in it before its watch exists
+					if (isDirectory)
+						AddWatches(path, true);
+				}
+				else if (pEvent->mask & (IN_DELETE | IN_MOVED_FROM))
+				{
+					Push(FileEvent::Type::Removed, path, isDirectory);
+
+					// A directory that was moved away keeps its watches under paths that no longer exist
+					if (isDirectory && (pEvent->mask & IN_MOVED_FROM))
+					{
+						for (auto iter = m_WatchPaths.begin(); iter != m_WatchPaths.end(); )
+						{
+							if (iter->second == path || iter->second.compare(0, path.size() + 1, path + "/") == 0)
+							{
+								inotify_rm_watch(m_Notify, iter->first);
+								iter = m_WatchPaths.erase(iter);
+							}
+							else
+								++iter;
+						}
+					}
+				}
+				else if (pEvent->mask & IN_CLOSE_WRITE)
+				{
+					// Only once the writer closed the file, not for every write
+					Push(FileEvent::Type::Modified, path, false);
+				}
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <unordered_map>
+#endif
+
+struct FileEvent
+{
+	enum class Type
+	{
+		Added,			// Also the new name of a rename, editors often save by renaming a temporary file
+		Removed,		// Also the old name of a rename
+		Modified,
+		Overflow		// Events were lost, everything under the directory may have changed
+	};
+
+	Type type{};
+	std::string path{};			// The watched directory joined with the relative path, '/' separated
+	bool isDirectory{};
+};
+
+// Watches a directory and everything under it on a background thread, ReadDirectoryChangesW on Windows and inotify
+// elsewhere. The events are queued until the main thread polls them.
+class FileWatcher final
+{
+public:
+	explicit FileWatcher(const std::string& directory);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher& other) = delete;
+	FileWatcher(FileWatcher&& other) noexcept = delete;
+	FileWatcher& operator=(const FileWatcher& other) = delete;
+	FileWatcher& operator=(FileWatcher&& other) noexcept = delete;
+
+	bool IsWatching() const { return m_Thread.joinable(); }
+	const std::string& GetDirectory() const { return m_Directory; }
+
+	// Replaces the contents of events with what happened since the last call, in order
+	void Poll(std::vector<FileEvent>& events);
+
+private:
+	void Run();
+	void Push(FileEvent::Type type, const std::string& path, bool isDirectory);
+
+	std::string m_Directory{};
+	std::thread m_Thread{};
+	std::mutex m_Mutex{};
+	std::vector<FileEvent> m_Events{};
+
+	// Platform handles, kept opaque so this header does not pull in windows.h
+#ifdef _WIN32
+	void* m_pDirectoryHandle{ nullptr };
+	void* m_pStopEvent{ nullptr };
+#else
+	// Watches every directory on its own and reports new files of a directory that was created before its watch
+	void AddWatches(const std::string& directory, bool reportFiles);
+
+	int m_Notify{ -1 };
+	int m_Stop{ -1 };
+	std::unordered_map<int, std::string> m_WatchPaths{};	// Only touched by the watcher thread once it runs
+#endif
+};
@@ -0,0 +1,118 @@
+#include "ImageDecoder.h"
+#include "AssetPack.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+	bool Fail(std::string* pError, const char* pMessage)
+	{
+		if (pError)
+			*pError = pMessage;
+		return false;
+	}
+
+	// The side of a square image with this many pixels, 0 when it is not square
+	uint32_t GetSquareSide(size_t pixelCount)
+	{
+		const uint32_t side = static_cast<uint32_t>(std::lround(std::sqrt(static_cast<double>(pixelCount))));
+		return side > 0 && size_t(side) * side == pixelCount ? side : 0;
+	}
+}
+
+size_t Image::GetPixelSize() const
+{
+	switch (format)
+	{
+	case ImageFormat::R8:
+		return 1;
+	case ImageFormat::R16:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+ImageDecoder::FileType ImageDecoder::GetFileType(const std::string& filename, const uint8_t* pData, size_t size)
+{
+	constexpr uint8_t pngSignature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (size >= sizeof(pngSignature) && memcmp(pData, pngSignature, sizeof(pngSignature)) == 0)
+		return FileType::Png;
+	if (size >= 3 && pData[0] == 0xFF && pData[1] == 0xD8 && pData[2] == 0xFF)
+		return FileType::Jpeg;
+
+	std::string extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	if (extension == ".raw")
+		return FileType::Raw;
+	return FileType::Unknown;
+}
+
+bool ImageDecoder::Decode(const std::string& filename, const uint8_t* pData, size_t size, Image& image, std::string* pError)
+{
+	bool result{};
+	switch (GetFileType(filename, pData, size))
+	{
+	case FileType::Png:
+		result = DecodePng(pData, size, image, pError);
+		break;
+	case FileType::Jpeg:
+		result = DecodeJpeg(pData, size, image, pError);
+		break;
+	case FileType::Raw:
+		result = DecodeRaw(pData, size, image, pError);
+		break;
+	default:
+		return Fail(pError, "unknown image type");
+	}
+
+	// Nothing half decoded is left behind
+	if (!result)
+		image = Image{};
+	return result;
+}
+
+bool ImageDecoder::DecodeRaw(const uint8_t* pData, size_t size, uint32_t width, uint32_t height, ImageFormat format, Image& image, std::string* pError)
+{
+	image.width = width;
+	image.height = height;
+	image.format = format;
+	const size_t imageSize = image.GetRowPitch() * height;
+	if (width == 0 || height == 0 || size < imageSize)
+	{
+		image = Image{};
+		return Fail(pError, "file is smaller than the image");
+	}
+
+	image.pixels.assign(pData, pData + imageSize);
+	return true;
+}
+
+bool ImageDecoder::DecodeRaw(const uint8_t* pData, size_t size, Image& image, std::string* pError)
+{
+	if (size % 2 == 0)
+	{
+		if (const uint32_t side = GetSquareSide(size / 2); side > 0)
+			return DecodeRaw(pData, size, side, side, ImageFormat::R16, image, pError);
+	}
+	if (const uint32_t side = GetSquareSide(size); side > 0)
+		return DecodeRaw(pData, size, side, side, ImageFormat::R8, image, pError);
+	return Fail(pError, "raw file is not a square image");
+}
+
+std::vector<Image> ImageDecoder::DecodeFiles(const std::vector<std::string>& filenames)
+{
+	std::vector<Image> images(filenames.size());
+	JobSystem::GetInstance()->ParallelFor(filenames.size(), [&filenames, &images](size_t i)
+	{
+		AssetFile file{ filenames[i] };
+		if (file.IsOpen())
+			Decode(filenames[i], reinterpret_cast<const uint8_t*>(file.GetData()), file.GetSize(), images[i]);
+	});
+	return images;
+}
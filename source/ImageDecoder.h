@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ImageFormat
+{
+	RGBA8,
+	R8,
+	R16
+};
+
+// Decoded pixels on the CPU, rows are tightly packed top to bottom
+struct Image
+{
+	uint32_t width{};
+	uint32_t height{};
+	ImageFormat format{ ImageFormat::RGBA8 };
+	std::vector<uint8_t> pixels{};
+
+	size_t GetPixelSize() const;
+	size_t GetRowPitch() const { return width * GetPixelSize(); }
+	bool IsValid() const { return width > 0 && height > 0 && pixels.size() == GetRowPitch() * height; }
+};
+
+// Turns PNG, baseline JPEG and raw files into images without any platform API, so decoding can run on the job
+// threads and in tools that have no device. Creating the GPU texture is a separate step (Texture).
+namespace ImageDecoder
+{
+	enum class FileType
+	{
+		Unknown,
+		Png,
+		Jpeg,
+		Raw
+	};
+
+	// PNG and JPEG are recognized by their signature, raw files only by their extension
+	FileType GetFileType(const std::string& filename, const uint8_t* pData, size_t size);
+
+	// false when the file is not a type this decoder knows or it is corrupt, pError then says why
+	bool Decode(const std::string& filename, const uint8_t* pData, size_t size, Image& image, std::string* pError = nullptr);
+
+	// Every PNG color type and bit depth, interlaced or not. Always RGBA8, 16 bit channels keep their high byte.
+	bool DecodePng(const uint8_t* pData, size_t size, Image& image, std::string* pError = nullptr);
+	// Baseline and extended Huffman JPEG with one or three components and any chroma subsampling. Progressive
+	// files are refused. Always RGBA8.
+	bool DecodeJpeg(const uint8_t* pData, size_t size, Image& image, std::string* pError = nullptr);
+	// Pixels without a header. The size is known from the caller, R16 is little endian like the terrain heightmaps.
+	bool DecodeRaw(const uint8_t* pData, size_t size, uint32_t width, uint32_t height, ImageFormat format, Image& image, std::string* pError = nullptr);
+	// A raw file without known dimensions is taken to be a square R16 heightmap, or a square R8 one when the size
+	// does not fit that
+	bool DecodeRaw(const uint8_t* pData, size_t size, Image& image, std::string* pError = nullptr);
+
+	// Reads and decodes the files in parallel on the job threads, images that failed stay empty
+	std::vector<Image> DecodeFiles(const std::vector<std::string>& filenames);
+}
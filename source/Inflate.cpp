@@ -0,0 +1,420 @@
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr int g_FastBits{ 10 };
+	constexpr int g_MaxCodeLength{ 15 };
+	constexpr int g_LiteralCount{ 288 };
+	constexpr int g_DistanceCount{ 32 };
+	constexpr int g_EndOfBlock{ 256 };
+
+	constexpr uint16_t g_LengthBase[29]{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t g_LengthExtra[29]{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t g_DistanceBase[30]{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+		6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t g_DistanceExtra[30]{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	// The order the code length code lengths are stored in
+	constexpr uint8_t g_CodeLengthOrder[19]{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	inline uint32_t ReverseBits(uint32_t value, int count)
+	{
+		uint32_t result{};
+		for (int i = 0; i < count; ++i)
+		{
+			result = (result << 1) | (value & 1);
+			value >>= 1;
+		}
+		return result;
+	}
+
+	// Canonical Huffman code. Codes up to g_FastBits long are found with one lookup, longer ones by comparing
+	// against the last code of every length.
+	struct Huffman
+	{
+		// (length << 9) | symbol, 0 when the code is longer than g_FastBits
+		uint16_t fast[1 << g_FastBits]{};
+		// One past the last code of every length, left aligned to 16 bits
+		uint32_t maxCode[g_MaxCodeLength + 2]{};
+		uint16_t firstCode[g_MaxCodeLength + 1]{};
+		uint16_t firstSymbol[g_MaxCodeLength + 1]{};
+		uint16_t symbols[g_LiteralCount]{};
+
+		bool Build(const uint8_t* pLengths, int count)
+		{
+			int lengthCounts[g_MaxCodeLength + 1]{};
+			for (int i = 0; i < count; ++i)
+				++lengthCounts[pLengths[i]];
+			lengthCounts[0] = 0;
+
+			std::fill(std::begin(fast), std::end(fast), uint16_t(0));
+
+			uint32_t nextCode[g_MaxCodeLength + 1]{};
+			uint32_t code{};
+			int symbol{};
+			for (int length = 1; length <= g_MaxCodeLength; ++length)
+			{
+				nextCode[length] = code;
+				firstCode[length] = static_cast<uint16_t>(code);
+				firstSymbol[length] = static_cast<uint16_t>(symbol);
+				code += lengthCounts[length];
+				// Oversubscribed, more codes than fit in this many bits
+				if (lengthCounts[length] > 0 && code > (1u << length))
+					return false;
+				maxCode[length] = code << (16 - length);
+				code <<= 1;
+				symbol += lengthCounts[length];
+			}
+			maxCode[g_MaxCodeLength + 1] = 0x10000;
+
+			for (int i = 0; i < count; ++i)
+			{
+				const int length = pLengths[i];
+				if (length == 0)
+					continue;
+
+				symbols[nextCode[length] - firstCode[length] + firstSymbol[length]] = static_cast<uint16_t>(i);
+				if (length <= g_FastBits)
+				{
+					// The stream holds codes with their first bit lowest, the table is indexed the same way
+					for (uint32_t j = ReverseBits(nextCode[length], length); j < (1u << g_FastBits); j += 1u << length)
+						fast[j] = static_cast<uint16_t>((length << 9) | i);
+				}
+				++nextCode[length];
+			}
+			return true;
+		}
+	};
+
+	class Inflater final
+	{
+	public:
+		Inflater(const uint8_t* pSrc, size_t srcSize, std::vector<uint8_t>& dst)
+			: m_pIn{ pSrc }
+			, m_pEnd{ pSrc + srcSize }
+			, m_Out{ dst }
+			, m_OutSize{ dst.size() }
+		{
+		}
+
+		bool Run(size_t expectedSize)
+		{
+			m_Out.resize((std::max)(m_OutSize + expectedSize, m_OutSize + size_t(4096)));
+
+			bool result{ true };
+			bool last{};
+			while (result && !last)
+			{
+				last = GetBits(1) != 0;
+				switch (GetBits(2))
+				{
+				case 0:
+					result = StoredBlock();
+					break;
+				case 1:
+					result = FixedBlock();
+					break;
+				case 2:
+					result = DynamicBlock();
+					break;
+				default:
+					result = false;
+					break;
+				}
+				result = result && !IsOverrun();
+			}
+
+			m_Out.resize(m_OutSize);
+			return result;
+		}
+
+		// Skips to the next whole byte and returns where the next unread byte is
+		const uint8_t* AlignToByte()
+		{
+			DropBits(m_BitCount & 7);
+			const size_t buffered = (std::max)(m_BitCount / 8 - static_cast<int>(m_Overrun), 0);
+			m_pIn -= buffered;
+			m_BitBuffer = 0;
+			m_BitCount = 0;
+			m_Overrun = 0;
+			return m_pIn;
+		}
+
+	private:
+		void Refill()
+		{
+			while (m_BitCount <= 56)
+			{
+				// Past the end zeros are shifted in, IsOverrun tells when they were used
+				if (m_pIn < m_pEnd)
+					m_BitBuffer |= uint64_t(*m_pIn++) << m_BitCount;
+				else
+					++m_Overrun;
+				m_BitCount += 8;
+			}
+		}
+
+		bool IsOverrun() const
+		{
+			return m_BitCount < static_cast<int>(m_Overrun) * 8;
+		}
+
+		void DropBits(int count)
+		{
+			m_BitBuffer >>= count;
+			m_BitCount -= count;
+		}
+
+		uint32_t GetBits(int count)
+		{
+			if (m_BitCount < count)
+				Refill();
+			const uint32_t value = static_cast<uint32_t>(m_BitBuffer & ((uint64_t(1) << count) - 1));
+			DropBits(count);
+			return value;
+		}
+
+		// -1 for a code that is not in the table
+		int Decode(const Huffman& huffman)
+		{
+			if (m_BitCount < 16)
+				Refill();
+
+			const uint16_t entry = huffman.fast[m_BitBuffer & ((1 << g_FastBits) - 1)];
+			if (entry != 0)
+			{
+				DropBits(entry >> 9);
+				return entry & 511;
+			}
+
+			const uint32_t code = ReverseBits(static_cast<uint32_t>(m_BitBuffer & 0xFFFF), 16);
+			int length = g_FastBits + 1;
+			while (code >= huffman.maxCode[length])
+				++length;
+			if (length > g_MaxCodeLength)
+				return -1;
+
+			const uint32_t index = (code >> (16 - length)) - huffman.firstCode[length] + huffman.firstSymbol[length];
+			if (index >= g_LiteralCount)
+				return -1;
+			DropBits(length);
+			return huffman.symbols[index];
+		}
+
+		uint8_t* Reserve(size_t count)
+		{
+			if (m_OutSize + count > m_Out.size())
+				m_Out.resize((std::max)(m_Out.size() * 2, m_OutSize + count));
+			uint8_t* pOut = m_Out.data() + m_OutSize;
+			m_OutSize += count;
+			return pOut;
+		}
+
+		bool StoredBlock()
+		{
+			const uint8_t* pIn = AlignToByte();
+			if (m_pEnd - pIn < 4)
+				return false;
+
+			const uint32_t length = pIn[0] | (pIn[1] << 8);
+			const uint32_t inverse = pIn[2] | (pIn[3] << 8);
+			if ((length ^ 0xFFFF) != inverse || static_cast<size_t>(m_pEnd - pIn - 4) < length)
+				return false;
+
+			memcpy(Reserve(length), pIn + 4, length);
+			m_pIn = pIn + 4 + length;
+			return true;
+		}
+
+		bool FixedBlock()
+		{
+			if (!m_FixedBuilt)
+			{
+				uint8_t lengths[g_LiteralCount + g_DistanceCount];
+				std::fill(lengths, lengths + 144, uint8_t(8));
+				std::fill(lengths + 144, lengths + 256, uint8_t(9));
+				std::fill(lengths + 256, lengths + 280, uint8_t(7));
+				std::fill(lengths + 280, lengths + 288, uint8_t(8));
+				std::fill(lengths + 288, lengths + 320, uint8_t(5));
+				m_FixedLiterals.Build(lengths, g_LiteralCount);
+				m_FixedDistances.Build(lengths + g_LiteralCount, g_DistanceCount);
+				m_FixedBuilt = true;
+			}
+			return Block(m_FixedLiterals, m_FixedDistances);
+		}
+
+		bool DynamicBlock()
+		{
+			const int literalCount = static_cast<int>(GetBits(5)) + 257;
+			const int distanceCount = static_cast<int>(GetBits(5)) + 1;
+			const int codeLengthCount = static_cast<int>(GetBits(4)) + 4;
+			if (literalCount > 286 || distanceCount > 30)
+				return false;
+
+			uint8_t codeLengthLengths[19]{};
+			for (int i = 0; i < codeLengthCount; ++i)
+				codeLengthLengths[g_CodeLengthOrder[i]] = static_cast<uint8_t>(GetBits(3));
+
+			Huffman codeLengths{};
+			if (!codeLengths.Build(codeLengthLengths, 19))
+				return false;
+
+			uint8_t lengths[g_LiteralCount + g_DistanceCount]{};
+			const int total = literalCount + distanceCount;
+			int count{};
+			while (count < total)
+			{
+				const int symbol = Decode(codeLengths);
+				if (symbol < 0)
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[count++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				uint8_t value{};
+				int repeat{};
+				if (symbol == 16)
+				{
+					if (count == 0)
+						return false;
+					value = lengths[count - 1];
+					repeat = 3 + static_cast<int>(GetBits(2));
+				}
+				else if (symbol == 17)
+					repeat = 3 + static_cast<int>(GetBits(3));
+				else
+					repeat = 11 + static_cast<int>(GetBits(7));
+
+				if (count + repeat > total)
+					return false;
+				std::fill(lengths + count, lengths + count + repeat, value);
+				count += repeat;
+			}
+			if (IsOverrun() || lengths[g_EndOfBlock] == 0)
+				return false;
+
+			// The distance lengths directly follow the literal lengths, move them to their own table
+			uint8_t distanceLengths[g_DistanceCount]{};
+			std::copy(lengths + literalCount, lengths + total, distanceLengths);
+
+			if (!m_Literals.Build(lengths, literalCount) || !m_Distances.Build(distanceLengths, distanceCount))
+				return false;
+			return Block(m_Literals, m_Distances);
+		}
+
+		bool Block(const Huffman& literals, const Huffman& distances)
+		{
+			while (true)
+			{
+				// Corrupt data can decode the zeros past the end forever
+				int symbol = Decode(literals);
+				if (symbol < 0 || IsOverrun())
+					return false;
+
+				if (symbol < g_EndOfBlock)
+				{
+					*Reserve(1) = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				if (symbol == g_EndOfBlock)
+					return true;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+				const size_t length = g_LengthBase[symbol] + GetBits(g_LengthExtra[symbol]);
+
+				const int distanceSymbol = Decode(distances);
+				if (distanceSymbol < 0 || distanceSymbol >= 30)
+					return false;
+				const size_t distance = g_DistanceBase[distanceSymbol] + GetBits(g_DistanceExtra[distanceSymbol]);
+				if (distance > m_OutSize)
+					return false;
+
+				uint8_t* pOut = Reserve(length);
+				const uint8_t* pMatch = pOut - distance;
+				// Overlapping matches repeat the last distance bytes, they have to be copied one at a time
+				if (distance >= length)
+					memcpy(pOut, pMatch, length);
+				else
+				{
+					for (size_t i = 0; i < length; ++i)
+						pOut[i] = pMatch[i];
+				}
+			}
+		}
+
+		const uint8_t* m_pIn;
+		const uint8_t* m_pEnd;
+		std::vector<uint8_t>& m_Out;
+		size_t m_OutSize;
+
+		uint64_t m_BitBuffer{};
+		int m_BitCount{};
+		size_t m_Overrun{};
+
+		Huffman m_Literals{};
+		Huffman m_Distances{};
+		Huffman m_FixedLiterals{};
+		Huffman m_FixedDistances{};
+		bool m_FixedBuilt{ false };
+	};
+}
+
+bool Inflate::Decompress(const uint8_t* pSrc, size_t srcSize, std::vector<uint8_t>& dst, size_t expectedSize)
+{
+	Inflater inflater{ pSrc, srcSize, dst };
+	return inflater.Run(expectedSize);
+}
+
+bool Inflate::DecompressZlib(const uint8_t* pSrc, size_t srcSize, std::vector<uint8_t>& dst, size_t expectedSize)
+{
+	if (srcSize < 6)
+		return false;
+
+	// Deflate with a window of at most 32 KB, no preset dictionary
+	const uint8_t method = pSrc[0];
+	const uint8_t flags = pSrc[1];
+	if ((method & 15) != 8 || (method >> 4) > 7 || ((method << 8) | flags) % 31 != 0 || (flags & 32) != 0)
+		return false;
+
+	const size_t start = dst.size();
+	Inflater inflater{ pSrc + 2, srcSize - 2, dst };
+	if (!inflater.Run(expectedSize))
+		return false;
+
+	const uint8_t* pChecksum = inflater.AlignToByte();
+	if (pSrc + srcSize - pChecksum < 4)
+		return false;
+	const uint32_t checksum = (uint32_t(pChecksum[0]) << 24) | (uint32_t(pChecksum[1]) << 16) | (uint32_t(pChecksum[2]) << 8) | pChecksum[3];
+	return checksum == Adler32(dst.data() + start, dst.size() - start);
+}
+
+uint32_t Inflate::Adler32(const uint8_t* pData, size_t size, uint32_t adler)
+{
+	constexpr uint32_t modulo{ 65521 };
+	// The most bytes that can be summed before b overflows 32 bits
+	constexpr size_t chunkSize{ 5552 };
+
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while (size > 0)
+	{
+		const size_t count = (std::min)(size, chunkSize);
+		for (size_t i = 0; i < count; ++i)
+		{
+			a += pData[i];
+			b += a;
+		}
+		a %= modulo;
+		b %= modulo;
+		pData += count;
+		size -= count;
+	}
+	return (b << 16) | a;
+}
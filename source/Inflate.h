@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deflate decoder (RFC 1951) for the image data in PNG files. Only the decoder, nothing in the engine writes deflate.
+namespace Inflate
+{
+	// Appends the decompressed bytes to dst. expectedSize is reserved up front when the caller knows it.
+	// false when the data is corrupt or truncated, dst then holds what was decoded so far.
+	bool Decompress(const uint8_t* pSrc, size_t srcSize, std::vector<uint8_t>& dst, size_t expectedSize = 0);
+	// The same for a zlib stream (RFC 1950), checks its header and checksum
+	bool DecompressZlib(const uint8_t* pSrc, size_t srcSize, std::vector<uint8_t>& dst, size_t expectedSize = 0);
+
+	uint32_t Adler32(const uint8_t* pData, size_t size, uint32_t adler = 1);
+}
@@ -0,0 +1,114 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+JobSystem* JobSystem::m_pJobSystem{};
+
+JobSystem::JobSystem()
+{
+	// Leave one core for the main thread, it joins in on ParallelFor anyway
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	const unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+	m_Workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+
+	m_pJobSystem = nullptr;
+}
+
+JobSystem* JobSystem::GetInstance()
+{
+	if (m_pJobSystem == nullptr) m_pJobSystem = new JobSystem();
+
+	return m_pJobSystem;
+}
+
+void JobSystem::Execute(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Jobs.emplace_back(std::move(job));
+	}
+	m_Condition.notify_one();
+}
+
+void JobSystem::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1)
+	{
+		job(0);
+		return;
+	}
+
+	struct SharedState
+	{
+		std::atomic<size_t> next{};
+		std::atomic<size_t> finished{};
+		std::mutex mutex{};
+		std::condition_variable done{};
+	};
+
+	// Helpers that start after everything is done find no index left and never touch job,
+	// only the shared state has to outlive this call
+	auto pState = std::make_shared<SharedState>();
+	auto runJobs = [pState, count, &job]()
+	{
+		size_t index;
+		while ((index = pState->next.fetch_add(1)) < count)
+		{
+			job(index);
+			if (pState->finished.fetch_add(1) + 1 == count)
+			{
+				std::lock_guard<std::mutex> lock{ pState->mutex };
+				pState->done.notify_all();
+			}
+		}
+	};
+
+	const size_t helperCount = (std::min)(count - 1, m_Workers.size());
+	for (size_t i = 0; i < helperCount; ++i)
+		Execute(runJobs);
+
+	runJobs();
+
+	std::unique_lock<std::mutex> lock{ pState->mutex };
+	pState->done.wait(lock, [&]() { return pState->finished.load() == count; });
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_Condition.wait(lock, [this]() { return m_Stop || !m_Jobs.empty(); });
+
+			if (m_Stop && m_Jobs.empty())
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+
+		job();
+	}
+}
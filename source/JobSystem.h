@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads shared by the engine for CPU heavy work (importing, decoding, cooking)
+class JobSystem final
+{
+public:
+	~JobSystem();
+	JobSystem(const JobSystem& other) = delete;
+	JobSystem(JobSystem&& other) noexcept = delete;
+	JobSystem& operator=(const JobSystem& other) = delete;
+	JobSystem& operator=(JobSystem&& other) noexcept = delete;
+
+	static JobSystem* GetInstance();
+
+	// Queues a job on the workers and returns immediately
+	void Execute(std::function<void()> job);
+
+	// Runs job(i) for every i in [0, count) and returns when all of them finished.
+	// The calling thread takes part in the work so this is safe to call from inside a job.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+	size_t GetWorkerCount() const { return m_Workers.size(); }
+
+private:
+	JobSystem();
+	static JobSystem* m_pJobSystem;
+
+	void WorkerLoop();
+
+	std::vector<std::thread> m_Workers{};
+	std::deque<std::function<void()>> m_Jobs{};
+	std::mutex m_Mutex{};
+	std::condition_variable m_Condition{};
+	bool m_Stop{ false };
+};
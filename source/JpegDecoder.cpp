@@ -0,0 +1,679 @@
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// The largest side accepted, keeps the size calculations far away from overflowing
+	constexpr uint32_t g_MaxSize{ 1 << 15 };
+	constexpr int g_FastBits{ 9 };
+	constexpr int g_MaxComponents{ 3 };
+
+	// Natural order index of every coefficient in the zigzag order of the file, padded so a corrupt run can not
+	// read past it before it is caught
+	constexpr uint8_t g_ZigZag[64 + 16]{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+		63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63 };
+
+	struct Huffman
+	{
+		// Symbol and length of the codes up to g_FastBits long, length 0 when the code is longer
+		uint8_t fastSymbol[1 << g_FastBits]{};
+		uint8_t fastLength[1 << g_FastBits]{};
+		// Largest code of every length, -1 when there are none
+		int32_t maxCode[17]{};
+		// Added to a code of that length to get the index of its symbol
+		int32_t valueOffset[17]{};
+		uint8_t values[256]{};
+		bool defined{};
+
+		bool Build(const uint8_t* pCounts, const uint8_t* pValues, size_t valueCount)
+		{
+			std::copy(pValues, pValues + valueCount, values);
+			std::fill(std::begin(fastLength), std::end(fastLength), uint8_t(0));
+
+			int32_t code{};
+			int32_t index{};
+			for (int length = 1; length <= 16; ++length)
+			{
+				const int count = pCounts[length - 1];
+				// Oversubscribed, more codes than fit in this many bits
+				if (code + count > (1 << length))
+					return false;
+				valueOffset[length] = index - code;
+				for (int i = 0; i < count; ++i, ++code, ++index)
+				{
+					if (length > g_FastBits)
+						continue;
+					// Every lookup index that starts with this code
+					const int shift = g_FastBits - length;
+					for (int j = 0; j < (1 << shift); ++j)
+					{
+						fastSymbol[(code << shift) | j] = values[index];
+						fastLength[(code << shift) | j] = static_cast<uint8_t>(length);
+					}
+				}
+				maxCode[length] = count > 0 ? code - 1 : -1;
+				code <<= 1;
+			}
+			defined = true;
+			return true;
+		}
+	};
+
+	// Reads the entropy coded data, highest bit first. Stuffed zero bytes are skipped, at a marker it stops and
+	// returns zeros from then on.
+	class BitReader final
+	{
+	public:
+		BitReader(const uint8_t* pData, const uint8_t* pEnd)
+			: m_pData{ pData }
+			, m_pEnd{ pEnd }
+		{
+		}
+
+		void Fill()
+		{
+			while (m_Count <= 56)
+			{
+				uint64_t byte{};
+				if (!m_AtMarker && m_pData < m_pEnd)
+				{
+					byte = *m_pData;
+					if (byte != 0xFF)
+						++m_pData;
+					else if (m_pData + 1 < m_pEnd && m_pData[1] == 0)
+						m_pData += 2;
+					else
+					{
+						m_AtMarker = true;
+						byte = 0;
+					}
+				}
+				m_Buffer |= byte << (56 - m_Count);
+				m_Count += 8;
+			}
+		}
+
+		uint32_t GetBits(int count)
+		{
+			if (count == 0)
+				return 0;
+			if (m_Count < count)
+				Fill();
+			const uint32_t value = static_cast<uint32_t>(m_Buffer >> (64 - count));
+			m_Buffer <<= count;
+			m_Count -= count;
+			return value;
+		}
+
+		// A value of category bits, the lower half of every category is negative
+		int32_t Receive(int bits)
+		{
+			const int32_t value = static_cast<int32_t>(GetBits(bits));
+			return bits > 0 && value < (1 << (bits - 1)) ? value - (1 << bits) + 1 : value;
+		}
+
+		// -1 for a code that is not in the table
+		int Decode(const Huffman& huffman)
+		{
+			if (m_Count < 16)
+				Fill();
+
+			const uint32_t fastIndex = static_cast<uint32_t>(m_Buffer >> (64 - g_FastBits));
+			if (const int length = huffman.fastLength[fastIndex]; length > 0)
+			{
+				m_Buffer <<= length;
+				m_Count -= length;
+				return huffman.fastSymbol[fastIndex];
+			}
+
+			for (int length = g_FastBits + 1; length <= 16; ++length)
+			{
+				const int32_t code = static_cast<int32_t>(m_Buffer >> (64 - length));
+				if (code <= huffman.maxCode[length])
+				{
+					m_Buffer <<= length;
+					m_Count -= length;
+					return huffman.values[(code + huffman.valueOffset[length]) & 255];
+				}
+			}
+			return -1;
+		}
+
+		// Skips the restart marker the data stopped at and starts over behind it
+		void Restart()
+		{
+			m_Buffer = 0;
+			m_Count = 0;
+			m_AtMarker = false;
+			if (m_pEnd - m_pData >= 2 && m_pData[0] == 0xFF && m_pData[1] >= 0xD0 && m_pData[1] <= 0xD7)
+				m_pData += 2;
+		}
+
+		const uint8_t* GetPosition() const { return m_pData; }
+
+	private:
+		const uint8_t* m_pData;
+		const uint8_t* m_pEnd;
+		uint64_t m_Buffer{};
+		int m_Count{};
+		bool m_AtMarker{};
+	};
+
+	struct Component
+	{
+		uint8_t id{};
+		int samplingX{};
+		int samplingY{};
+		int quantTable{};
+		int dcTable{};
+		int acTable{};
+		int dcPrediction{};
+
+		// Samples, padded to whole MCUs
+		std::vector<uint8_t> plane{};
+		uint32_t planeWidth{};
+		uint32_t planeHeight{};
+		bool decoded{};
+	};
+
+	// Basis of the inverse DCT, scale(u) * cos((2x + 1) u pi / 16)
+	struct IdctTable
+	{
+		float weights[8][8]{};
+
+		IdctTable()
+		{
+			const float pi = 3.14159265358979f;
+			for (int u = 0; u < 8; ++u)
+			{
+				const float scale = u == 0 ? 0.5f / std::sqrt(2.f) : 0.5f;
+				for (int x = 0; x < 8; ++x)
+					weights[u][x] = scale * std::cos((2 * x + 1) * u * pi / 16.f);
+			}
+		}
+	};
+	const IdctTable g_Idct{};
+
+	inline uint8_t ClampSample(float value)
+	{
+		// Truncating rounds wrong below 0, those are clamped to 0 anyway
+		const int sample = static_cast<int>(value + 128.5f);
+		return static_cast<uint8_t>(std::clamp(sample, 0, 255));
+	}
+
+	// Separable float IDCT of one dequantized block, written straight into the plane. Rows without coefficients
+	// are skipped, in most blocks only the first few have any.
+	void InverseDct(const float* pBlock, uint8_t* pDst, size_t stride)
+	{
+		float rows[8][8]{};
+		bool used[8]{};
+		for (int v = 0; v < 8; ++v)
+		{
+			for (int u = 0; u < 8; ++u)
+			{
+				const float coefficient = pBlock[v * 8 + u];
+				if (coefficient == 0.f)
+					continue;
+				for (int x = 0; x < 8; ++x)
+					rows[v][x] += coefficient * g_Idct.weights[u][x];
+				used[v] = true;
+			}
+		}
+
+		float columns[8][8]{};
+		for (int v = 0; v < 8; ++v)
+		{
+			if (!used[v])
+				continue;
+			for (int y = 0; y < 8; ++y)
+			{
+				const float weight = g_Idct.weights[v][y];
+				for (int x = 0; x < 8; ++x)
+					columns[y][x] += rows[v][x] * weight;
+			}
+		}
+
+		for (int y = 0; y < 8; ++y)
+		{
+			for (int x = 0; x < 8; ++x)
+				pDst[y * stride + x] = ClampSample(columns[y][x]);
+		}
+	}
+
+	class Decoder final
+	{
+	public:
+		Decoder(const uint8_t* pData, size_t size)
+			: m_pData{ pData }
+			, m_pEnd{ pData + size }
+		{
+		}
+
+		bool Decode(Image& image)
+		{
+			if (m_pEnd - m_pData < 2 || m_pData[0] != 0xFF || m_pData[1] != 0xD8)
+				return Fail("not a JPEG file");
+
+			const uint8_t* p = m_pData + 2;
+			while (true)
+			{
+				// Any number of fill bytes can come before a marker
+				while (p < m_pEnd && *p != 0xFF)
+					++p;
+				while (p < m_pEnd && *p == 0xFF)
+					++p;
+				if (p >= m_pEnd)
+					break;
+
+				const uint8_t marker = *p++;
+				if (marker == 0xD9)
+					break;
+				if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+					continue;
+
+				if (m_pEnd - p < 2)
+					return Fail("truncated marker");
+				const size_t length = (size_t(p[0]) << 8) | p[1];
+				if (length < 2 || static_cast<size_t>(m_pEnd - p) < length)
+					return Fail("truncated marker");
+				const uint8_t* pSegment = p + 2;
+				const size_t segmentSize = length - 2;
+				p += length;
+
+				bool result{ true };
+				switch (marker)
+				{
+				case 0xC0: case 0xC1:
+					result = ReadFrame(pSegment, segmentSize);
+					break;
+				case 0xC2: case 0xC6: case 0xCA: case 0xCE:
+					return Fail("progressive JPEG is not supported");
+				case 0xC3: case 0xC5: case 0xC7: case 0xC9: case 0xCB: case 0xCD: case 0xCF:
+					return Fail("lossless and arithmetic coded JPEG are not supported");
+				case 0xC4:
+					result = ReadHuffmanTables(pSegment, segmentSize);
+					break;
+				case 0xDB:
+					result = ReadQuantTables(pSegment, segmentSize);
+					break;
+				case 0xDD:
+					if (segmentSize < 2)
+						return Fail("bad restart interval");
+					m_RestartInterval = (uint32_t(pSegment[0]) << 8) | pSegment[1];
+					break;
+				case 0xEE:
+					// Adobe, its transform flag says whether three components are YCbCr or RGB
+					if (segmentSize >= 12 && memcmp(pSegment, "Adobe", 5) == 0)
+					{
+						m_HasAdobe = true;
+						m_AdobeTransform = pSegment[11];
+					}
+					break;
+				case 0xDA:
+				{
+					const uint8_t* pScanEnd{};
+					result = ReadScan(pSegment, segmentSize, pScanEnd);
+					p = pScanEnd;
+					break;
+				}
+				default:
+					// APPn, COM and everything else that does not change the pixels
+					break;
+				}
+				if (!result)
+					return false;
+			}
+
+			if (!m_HasFrame || std::any_of(m_Components, m_Components + m_ComponentCount, [](const Component& component) { return !component.decoded; }))
+				return Fail("missing image data");
+
+			ConvertToRgba(image);
+			return true;
+		}
+
+		const char* GetError() const { return m_pError; }
+
+	private:
+		bool Fail(const char* pError)
+		{
+			m_pError = pError;
+			return false;
+		}
+
+		bool ReadQuantTables(const uint8_t* p, size_t size)
+		{
+			while (size > 0)
+			{
+				const int precision = p[0] >> 4;
+				const int index = p[0] & 15;
+				const size_t tableSize = 1 + 64 * (precision + 1);
+				if (index > 3 || precision > 1 || size < tableSize)
+					return Fail("bad quantization table");
+
+				for (int i = 0; i < 64; ++i)
+					m_QuantTables[index][i] = precision == 0 ? p[1 + i] : static_cast<uint16_t>((p[1 + i * 2] << 8) | p[2 + i * 2]);
+				p += tableSize;
+				size -= tableSize;
+			}
+			return true;
+		}
+
+		bool ReadHuffmanTables(const uint8_t* p, size_t size)
+		{
+			while (size > 0)
+			{
+				if (size < 17)
+					return Fail("bad Huffman table");
+				const int tableClass = p[0] >> 4;
+				const int index = p[0] & 15;
+				size_t valueCount{};
+				for (int i = 0; i < 16; ++i)
+					valueCount += p[1 + i];
+				if (tableClass > 1 || index > 3 || valueCount > 256 || size < 17 + valueCount)
+					return Fail("bad Huffman table");
+
+				Huffman& huffman = tableClass == 0 ? m_DcTables[index] : m_AcTables[index];
+				if (!huffman.Build(p + 1, p + 17, valueCount))
+					return Fail("bad Huffman table");
+				p += 17 + valueCount;
+				size -= 17 + valueCount;
+			}
+			return true;
+		}
+
+		bool ReadFrame(const uint8_t* p, size_t size)
+		{
+			if (m_HasFrame)
+				return Fail("more than one frame");
+			if (size < 6)
+				return Fail("bad frame header");
+
+			const int precision = p[0];
+			m_Height = (uint32_t(p[1]) << 8) | p[2];
+			m_Width = (uint32_t(p[3]) << 8) | p[4];
+			m_ComponentCount = p[5];
+			if (precision != 8)
+				return Fail("only 8 bit JPEG is supported");
+			if (m_Width == 0 || m_Height == 0 || m_Width > g_MaxSize || m_Height > g_MaxSize)
+				return Fail("unsupported image size");
+			if (m_ComponentCount == 4)
+				return Fail("CMYK JPEG is not supported");
+			if ((m_ComponentCount != 1 && m_ComponentCount != 3) || size < 6 + size_t(m_ComponentCount) * 3)
+				return Fail("bad frame header");
+
+			for (int i = 0; i < m_ComponentCount; ++i)
+			{
+				Component& component = m_Components[i];
+				component.id = p[6 + i * 3];
+				component.samplingX = p[7 + i * 3] >> 4;
+				component.samplingY = p[7 + i * 3] & 15;
+				component.quantTable = p[8 + i * 3];
+				if (component.samplingX < 1 || component.samplingX > 4 || component.samplingY < 1 || component.samplingY > 4 || component.quantTable > 3)
+					return Fail("bad frame header");
+
+				m_MaxSamplingX = (std::max)(m_MaxSamplingX, component.samplingX);
+				m_MaxSamplingY = (std::max)(m_MaxSamplingY, component.samplingY);
+			}
+
+			m_McuCountX = (m_Width + m_MaxSamplingX * 8 - 1) / (m_MaxSamplingX * 8);
+			m_McuCountY = (m_Height + m_MaxSamplingY * 8 - 1) / (m_MaxSamplingY * 8);
+			for (int i = 0; i < m_ComponentCount; ++i)
+			{
+				Component& component = m_Components[i];
+				component.planeWidth = m_McuCountX * component.samplingX * 8;
+				component.planeHeight = m_McuCountY * component.samplingY * 8;
+				component.plane.resize(size_t(component.planeWidth) * component.planeHeight);
+			}
+
+			m_HasFrame = true;
+			return true;
+		}
+
+		bool DecodeBlock(BitReader& reader, Component& component, uint8_t* pDst, size_t stride)
+		{
+			const Huffman& dcTable = m_DcTables[component.dcTable];
+			const Huffman& acTable = m_AcTables[component.acTable];
+			const uint16_t* pQuant = m_QuantTables[component.quantTable];
+
+			const int category = reader.Decode(dcTable);
+			if (category < 0 || category > 11)
+				return Fail("corrupt image data");
+			component.dcPrediction += reader.Receive(category);
+
+			float block[64]{};
+			block[0] = static_cast<float>(component.dcPrediction * pQuant[0]);
+
+			bool hasAc{};
+			for (int k = 1; k < 64;)
+			{
+				const int symbol = reader.Decode(acTable);
+				if (symbol < 0)
+					return Fail("corrupt image data");
+
+				const int run = symbol >> 4;
+				const int bits = symbol & 15;
+				if (bits == 0)
+				{
+					// End of block, or 16 zeros
+					if (run != 15)
+						break;
+					k += 16;
+					continue;
+				}
+
+				k += run;
+				if (k > 63)
+					return Fail("corrupt image data");
+				block[g_ZigZag[k]] = static_cast<float>(reader.Receive(bits) * pQuant[k]);
+				hasAc = true;
+				++k;
+			}
+
+			// Most blocks in smooth areas are flat
+			if (!hasAc)
+			{
+				const uint8_t value = ClampSample(block[0] / 8.f);
+				for (int y = 0; y < 8; ++y)
+					memset(pDst + y * stride, value, 8);
+				return true;
+			}
+
+			InverseDct(block, pDst, stride);
+			return true;
+		}
+
+		bool ReadScan(const uint8_t* p, size_t size, const uint8_t*& pScanEnd)
+		{
+			if (!m_HasFrame)
+				return Fail("scan before the frame header");
+			if (size < 1)
+				return Fail("bad scan header");
+
+			const int scanCount = p[0];
+			if (scanCount < 1 || scanCount > m_ComponentCount || size < 4 + size_t(scanCount) * 2)
+				return Fail("bad scan header");
+
+			Component* pScanComponents[g_MaxComponents]{};
+			for (int i = 0; i < scanCount; ++i)
+			{
+				const uint8_t id = p[1 + i * 2];
+				Component* pComponent = std::find_if(m_Components, m_Components + m_ComponentCount, [id](const Component& component) { return component.id == id; });
+				if (pComponent == m_Components + m_ComponentCount || pComponent->decoded)
+					return Fail("bad scan header");
+
+				pComponent->dcTable = p[2 + i * 2] >> 4;
+				pComponent->acTable = p[2 + i * 2] & 15;
+				if (pComponent->dcTable > 3 || pComponent->acTable > 3 || !m_DcTables[pComponent->dcTable].defined || !m_AcTables[pComponent->acTable].defined)
+					return Fail("missing Huffman table");
+				pComponent->dcPrediction = 0;
+				pScanComponents[i] = pComponent;
+			}
+
+			BitReader reader{ p + size, m_pEnd };
+
+			// One component on its own is stored block by block, only the blocks that hold image pixels
+			uint32_t mcuCountX = m_McuCountX;
+			uint32_t mcuCountY = m_McuCountY;
+			if (scanCount == 1)
+			{
+				const Component& component = *pScanComponents[0];
+				const uint32_t width = (m_Width * component.samplingX + m_MaxSamplingX - 1) / m_MaxSamplingX;
+				const uint32_t height = (m_Height * component.samplingY + m_MaxSamplingY - 1) / m_MaxSamplingY;
+				mcuCountX = (width + 7) / 8;
+				mcuCountY = (height + 7) / 8;
+			}
+
+			uint32_t restartsLeft = m_RestartInterval;
+			for (uint32_t mcuY = 0; mcuY < mcuCountY; ++mcuY)
+			{
+				for (uint32_t mcuX = 0; mcuX < mcuCountX; ++mcuX)
+				{
+					if (m_RestartInterval > 0)
+					{
+						if (restartsLeft == 0)
+						{
+							reader.Restart();
+							for (int i = 0; i < scanCount; ++i)
+								pScanComponents[i]->dcPrediction = 0;
+							restartsLeft = m_RestartInterval;
+						}
+						--restartsLeft;
+					}
+
+					for (int i = 0; i < scanCount; ++i)
+					{
+						Component& component = *pScanComponents[i];
+						const int blocksX = scanCount == 1 ? 1 : component.samplingX;
+						const int blocksY = scanCount == 1 ? 1 : component.samplingY;
+						for (int blockY = 0; blockY < blocksY; ++blockY)
+						{
+							for (int blockX = 0; blockX < blocksX; ++blockX)
+							{
+								const size_t x = (size_t(mcuX) * blocksX + blockX) * 8;
+								const size_t y = (size_t(mcuY) * blocksY + blockY) * 8;
+								if (!DecodeBlock(reader, component, component.plane.data() + y * component.planeWidth + x, component.planeWidth))
+									return false;
+							}
+						}
+					}
+				}
+			}
+
+			for (int i = 0; i < scanCount; ++i)
+				pScanComponents[i]->decoded = true;
+
+			// The next marker is somewhere after what the reader used, skip to it
+			pScanEnd = reader.GetPosition();
+			while (pScanEnd + 1 < m_pEnd && !(pScanEnd[0] == 0xFF && pScanEnd[1] != 0 && (pScanEnd[1] < 0xD0 || pScanEnd[1] > 0xD7)))
+				++pScanEnd;
+			return true;
+		}
+
+		void ConvertToRgba(Image& image) const
+		{
+			image.width = m_Width;
+			image.height = m_Height;
+			image.format = ImageFormat::RGBA8;
+			image.pixels.resize(size_t(m_Width) * m_Height * 4);
+
+			// Chroma is scaled up by repeating samples. The column of every output pixel is looked up once.
+			std::vector<uint32_t> columns[g_MaxComponents]{};
+			for (int i = 0; i < m_ComponentCount; ++i)
+			{
+				columns[i].resize(m_Width);
+				for (uint32_t x = 0; x < m_Width; ++x)
+					columns[i][x] = x * m_Components[i].samplingX / m_MaxSamplingX;
+			}
+
+			// Three components are YCbCr unless the file says otherwise
+			const bool isRgb = m_ComponentCount == 3 && ((m_HasAdobe && m_AdobeTransform == 0)
+				|| (m_Components[0].id == 'R' && m_Components[1].id == 'G' && m_Components[2].id == 'B'));
+
+			for (uint32_t y = 0; y < m_Height; ++y)
+			{
+				uint8_t* pDst = image.pixels.data() + size_t(y) * m_Width * 4;
+				const uint8_t* pRows[g_MaxComponents]{};
+				for (int i = 0; i < m_ComponentCount; ++i)
+				{
+					const Component& component = m_Components[i];
+					pRows[i] = component.plane.data() + size_t(y * component.samplingY / m_MaxSamplingY) * component.planeWidth;
+				}
+
+				if (m_ComponentCount == 1)
+				{
+					for (uint32_t x = 0; x < m_Width; ++x, pDst += 4)
+					{
+						const uint8_t gray = pRows[0][x];
+						pDst[0] = gray;
+						pDst[1] = gray;
+						pDst[2] = gray;
+						pDst[3] = 255;
+					}
+					continue;
+				}
+
+				for (uint32_t x = 0; x < m_Width; ++x, pDst += 4)
+				{
+					const int c0 = pRows[0][columns[0][x]];
+					const int c1 = pRows[1][columns[1][x]];
+					const int c2 = pRows[2][columns[2][x]];
+					if (isRgb)
+					{
+						pDst[0] = static_cast<uint8_t>(c0);
+						pDst[1] = static_cast<uint8_t>(c1);
+						pDst[2] = static_cast<uint8_t>(c2);
+					}
+					else
+					{
+						// JFIF YCbCr in 16 bit fixed point
+						const int cb = c1 - 128;
+						const int cr = c2 - 128;
+						pDst[0] = static_cast<uint8_t>(std::clamp(c0 + ((91881 * cr + 32768) >> 16), 0, 255));
+						pDst[1] = static_cast<uint8_t>(std::clamp(c0 + ((-22554 * cb - 46802 * cr + 32768) >> 16), 0, 255));
+						pDst[2] = static_cast<uint8_t>(std::clamp(c0 + ((116130 * cb + 32768) >> 16), 0, 255));
+					}
+					pDst[3] = 255;
+				}
+			}
+		}
+
+		const uint8_t* m_pData;
+		const uint8_t* m_pEnd;
+		const char* m_pError{ "" };
+
+		uint16_t m_QuantTables[4][64]{};
+		Huffman m_DcTables[4]{};
+		Huffman m_AcTables[4]{};
+		uint32_t m_RestartInterval{};
+		bool m_HasAdobe{};
+		uint8_t m_AdobeTransform{};
+
+		bool m_HasFrame{};
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		int m_ComponentCount{};
+		Component m_Components[g_MaxComponents]{};
+		int m_MaxSamplingX{ 1 };
+		int m_MaxSamplingY{ 1 };
+		uint32_t m_McuCountX{};
+		uint32_t m_McuCountY{};
+	};
+}
+
+bool ImageDecoder::DecodeJpeg(const uint8_t* pData, size_t size, Image& image, std::string* pError)
+{
+	Decoder decoder{ pData, size };
+	if (decoder.Decode(image))
+		return true;
+
+	if (pError)
+		*pError = decoder.GetError();
+	return false;
+}
@@ -3,6 +3,7 @@
 
 void LogWindow::AddLog(const char* fmt, ...)
 {
+    std::lock_guard<std::mutex> lock{ m_Mutex };
     int old_size = Buf.size();
     va_list args;
     va_start(args, fmt);
@@ -19,11 +20,17 @@ LogWindow::LogWindow(std::string title, ImVec2 size)
 {
 }
 
-void LogWindow::Clear() { Buf.clear(); LineOffsets.clear(); }
+void LogWindow::Clear()
+{
+    std::lock_guard<std::mutex> lock{ m_Mutex };
+    Buf.clear();
+    LineOffsets.clear();
+}
 
 void LogWindow::Draw()
 {
     if (ImGui::Button("Clear")) Clear();
+    std::lock_guard<std::mutex> lock{ m_Mutex };
     ImGui::SameLine();
     bool copy = ImGui::Button("Copy");
     ImGui::SameLine();
@@ -1,6 +1,7 @@
 #pragma once
 #include <imgui.h>
 #include <imconfig.h>
+#include <mutex>
 
 #include "EditorWindow.h"
 
@@ -24,5 +25,7 @@ private:
     ImGuiTextFilter     Filter;
     ImVector<int>       LineOffsets;        // Index to lines offset
     bool                ScrollToBottom;
+    // Workers log too (importing, loading), the buffer is drawn on the main thread
+    std::mutex          m_Mutex;
 };
 
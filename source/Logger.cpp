@@ -3,6 +3,8 @@
 #include "MyEngine.h"
 #include "MyApplication.h"
 
+#include <iostream>
+
 Logger* Logger::m_pInstance{};
 
 Logger* Logger::GetInstance()
@@ -101,9 +103,16 @@ std::string Logger::SimplifyPath(const std::string& str, size_t dirSize) const
 
 Logger::Logger()
 {
-	m_pLogWindow = new LogWindow();
+	// Without an application (the tests) there is no editor, the log only goes to the console
+	MyApplication* pApplication = MyEngine::GetSingleton()->GetApplication();
+	if (pApplication == nullptr)
+	{
+		m_os = &std::cout;
+		return;
+	}
 
-	MyEngine::GetSingleton()->GetApplication()->AddWindowEditor(m_pLogWindow);
+	m_pLogWindow = new LogWindow();
+	pApplication->AddWindowEditor(m_pLogWindow);
 }
 
 std::vector<std::string> Logger::Split(const std::string& str, const std::string& delim, const bool trim_empty) const
@@ -211,19 +220,26 @@ void Logger::Log(LogLevel level, const std::string& msg, const std::source_locat
 
 	stream << ": " << msg << '\n';
 
-	if (m_os)
 	{
-		(*m_os) << stream.str();
-		m_os->flush();
+		// Only around the stream, the log window locks itself and jobs must not wait on the message box
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (m_os)
+		{
+			(*m_os) << stream.str();
+			m_os->flush();
+		}
 	}
 
+	if (m_pLogWindow == nullptr)
+		return;
+
+	m_pLogWindow->AddLog(stream.str().c_str());
+
 	//if error, break
 	if (level == LogLevel::Error)
 	{
 		MessageBoxA(0, msg.c_str(), "ERROR", MB_OK | MB_ICONERROR);
 	}
-
-	m_pLogWindow->AddLog(stream.str().c_str());
 }
 
 void Logger::LogDebug(const std::string& msg, const std::source_location location) const
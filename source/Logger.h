@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <mutex>
 #include <source_location>
 
 
@@ -66,4 +67,7 @@ private:
 	bool m_AppendTimestamp{ false };
 
 	void* m_ConsoleHandle{ nullptr };
+
+	// Jobs log from the worker threads
+	mutable std::mutex m_Mutex{};
 };
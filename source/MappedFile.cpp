@@ -0,0 +1,117 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	m_pFile = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size))
+	{
+		Close();
+		return;
+	}
+
+	m_Size = static_cast<size_t>(size.QuadPart);
+	m_Open = true;
+
+	// Empty files can not be mapped but are still valid
+	if (m_Size == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		Close();
+		return;
+	}
+	m_pMapping = mapping;
+
+	m_pData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_pData == nullptr)
+		Close();
+#else
+	const int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+	m_pFile = reinterpret_cast<void*>(static_cast<intptr_t>(file) + 1);
+
+	struct stat fileStat {};
+	if (fstat(file, &fileStat) != 0)
+	{
+		Close();
+		return;
+	}
+
+	m_Size = static_cast<size_t>(fileStat.st_size);
+	m_Open = true;
+
+	if (m_Size == 0)
+		return;
+
+	void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (pData == MAP_FAILED)
+	{
+		Close();
+		return;
+	}
+
+	madvise(pData, m_Size, MADV_SEQUENTIAL);
+	m_pData = static_cast<const char*>(pData);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::IsOpen() const
+{
+	return m_Open;
+}
+
+const char* MappedFile::GetData() const
+{
+	return m_pData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return m_Size;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_pMapping)
+		CloseHandle(m_pMapping);
+	if (m_pFile)
+		CloseHandle(m_pFile);
+#else
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+	if (m_pFile)
+		close(static_cast<int>(reinterpret_cast<intptr_t>(m_pFile) - 1));
+#endif
+
+	m_pData = nullptr;
+	m_pMapping = nullptr;
+	m_pFile = nullptr;
+	m_Size = 0;
+	m_Open = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+
+// Read only view of a file mapped into memory
+class MappedFile final
+{
+public:
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) noexcept = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile& operator=(MappedFile&& other) noexcept = delete;
+
+	bool IsOpen() const;
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	void Close();
+
+	const char* m_pData{ nullptr };
+	size_t m_Size{};
+	bool m_Open{ false };
+
+	// Platform handles, kept opaque so this header does not pull in windows.h
+	void* m_pFile{ nullptr };
+	void* m_pMapping{ nullptr };
+};
@@ -1,22 +1,37 @@
 #include "Material.h"
 
 #include <cassert>
-#include <sstream>
+#include <chrono>
 
+#include "EffectCache.h"
 #include "Texture.h"
 #include "Scene.h"
 #include "MaterialManager.h"
+#include "ResourceManager.h"
 
-Material::Material(ID3D11Device* pDevice, const std::string& assertFile, const std::string& name)
+Material::Material(ID3D11Device* pDevice, const std::string& assertFile, const std::string& name, const EffectDefines& defines)
 	: m_Name{name}
 	, m_AssertFile{assertFile}
 {
-	std::wstring file{ m_AssertFile.begin(), m_AssertFile.end() };
-	m_pEffect = LoadEffect(pDevice, file);
+	const auto start = std::chrono::steady_clock::now();
+	m_pEffect = EffectCache::GetInstance()->GetEffect(pDevice, m_AssertFile, defines);
 
 	m_pTechnique = m_pEffect->GetTechniqueByName("DefaultTechnique");
 	assert(m_pTechnique->IsValid());
 
+	// Optional, only the mesh effects decode quantized vertices
+	m_pQuantizedTechnique = m_pEffect->GetTechniqueByName("QuantizedTechnique");
+	if (!m_pQuantizedTechnique->IsValid())
+		m_pQuantizedTechnique = nullptr;
+
+	m_pPositionOffsetVariable = m_pEffect->GetVariableByName("gPositionOffset")->AsVector();
+	m_pPositionScaleVariable = m_pEffect->GetVariableByName("gPositionScale")->AsVector();
+
+	auto pRasterizerState = m_pEffect->GetVariableByName("gRasterizerState")->AsRasterizer();
+	D3D11_RASTERIZER_DESC rasterizerDesc{};
+	if (pRasterizerState->IsValid() && SUCCEEDED(pRasterizerState->GetBackingStore(0, &rasterizerDesc)))
+		m_CullsBackFaces = rasterizerDesc.CullMode == D3D11_CULL_BACK && !rasterizerDesc.FrontCounterClockwise;
+
 	m_pMatWorldViewProjVariable = m_pEffect->GetVariableByName("gWorldViewProj")->AsMatrix();
 	if (!m_pMatWorldViewProjVariable->IsValid())
 		OutputDebugStringW(L"m_pMatWorldViewProjVariable is invalid");
@@ -24,6 +39,8 @@ Material::Material(ID3D11Device* pDevice, const std::string& assertFile, const s
 	m_pDiffuseMapVariable = m_pEffect->GetVariableByName("gDiffuseMap")->AsShaderResource();
 	if(!m_pDiffuseMapVariable->IsValid())
 		OutputDebugStringW(L"m_pDiffuseMapVariable is invalid");
+
+	m_LoadMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 Material::~Material()
@@ -52,6 +69,11 @@ ID3DX11EffectTechnique* Material::GetTechnique() const
 	return m_pTechnique;
 }
 
+ID3DX11EffectTechnique* Material::GetTechnique(VertexFormat vertexFormat) const
+{
+	return vertexFormat == VertexFormat::Quantized ? m_pQuantizedTechnique : m_pTechnique;
+}
+
 ID3DX11EffectMatrixVariable* Material::GetMatWorldViewProjMatrix() const
 {
 	return m_pMatWorldViewProjVariable;
@@ -62,75 +84,74 @@ void Material::SetDiffuseMap(Texture* pTexture)
 	if (m_pTexture != nullptr) delete m_pTexture;
 
 	m_pTexture = pTexture;
-
-	if (m_pDiffuseMapVariable->IsValid())
-		m_pDiffuseMapVariable->SetResource(pTexture->GetTextureShaderResource());
+	m_DiffuseMap.Reset();
 }
 
-void Material::SetName(const std::string& name)
+void Material::SetDiffuseMap(const TextureHandle& texture)
 {
-	m_Name = name;
+	delete m_pTexture;
+	m_pTexture = nullptr;
+	// The handle keeps it referenced, so the view that is bound is never evicted
+	m_DiffuseMap = texture;
 }
 
-std::string Material::GetName() const
+void Material::BindDiffuseMap()
 {
-	return m_Name;
+	if (!m_pDiffuseMapVariable->IsValid())
+		return;
+
+	const Texture* pTexture = m_pTexture != nullptr ? m_pTexture : m_DiffuseMap.Get();
+	m_pDiffuseMapVariable->SetResource(pTexture != nullptr ? pTexture->GetTextureShaderResource() : nullptr);
 }
 
-ID3DX11Effect* Material::LoadEffect(ID3D11Device* pDevice, const std::wstring& assertFile)
+void Material::RequestTextureSize(float pixels) const
 {
-	HRESULT result = S_OK;
-	ID3D10Blob* pErrorBlob = nullptr;
-	ID3DX11Effect* pEffect;
-
-	DWORD shaderFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)
-	shaderFlags |= D3DCOMPILE_DEBUG;
-	shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	const Texture* pTexture = m_pTexture != nullptr ? m_pTexture : m_DiffuseMap.Get();
+	ResourceManager::GetInstance()->RequestTextureSize(pTexture, pixels);
+}
 
-	result = D3DX11CompileEffectFromFile(assertFile.c_str(),
-		nullptr,
-		nullptr,
-		shaderFlags,
-		0,
-		pDevice,
-		&pEffect,
-		&pErrorBlob);
+void Material::SetPositionDequantization(const VertexQuantization::Dequantization& dequantization)
+{
+	if (m_pPositionOffsetVariable->IsValid())
+		m_pPositionOffsetVariable->SetFloatVector(&dequantization.offset.x);
+	if (m_pPositionScaleVariable->IsValid())
+		m_pPositionScaleVariable->SetFloatVector(&dequantization.scale.x);
+}
 
-	if (FAILED(result))
-	{
-		if (pErrorBlob != nullptr)
-		{
-			char* pErrors = (char*)pErrorBlob->GetBufferPointer();
+bool Material::CullsBackFaces() const
+{
+	return m_CullsBackFaces;
+}
 
-			std::wstringstream ss;
-			for (unsigned int i = 0; i < pErrorBlob->GetBufferSize(); i++)
-				ss << pErrors[i];
+void Material::SetName(const std::string& name)
+{
+	m_Name = name;
+}
 
-			OutputDebugStringW(ss.str().c_str());
-			pErrorBlob->Release();
-			pErrorBlob = nullptr;
+std::string Material::GetName() const
+{
+	return m_Name;
+}
 
-			OutputDebugStringW(ss.str().c_str());
-		}
-		else
-		{
-			std::wstringstream ss;
-			ss << "EffectLoader: Failed to CreateEffectFromFile! \nPath: " << assertFile;
+const std::string& Material::GetEffectFile() const
+{
+	return m_AssertFile;
+}
 
-			OutputDebugStringW(ss.str().c_str());
-			return nullptr;
-		}
-	}
+size_t Material::GetCpuMemory() const
+{
+	return sizeof(Material) + m_Name.capacity() + m_AssertFile.capacity();
+}
 
-	return pEffect;
+float Material::GetLoadMilliseconds() const
+{
+	return m_LoadMilliseconds;
 }
 
 void Material::Serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer)
 {
 	writer.Key("DiffuseTexture");
-	writer.String(m_pTexture->GetPath().c_str());
+	writer.String(m_pTexture != nullptr ? m_pTexture->GetPath().c_str() : m_DiffuseMap.GetName().c_str());
 
 	writer.Key("AssertFile");
 	writer.String(m_AssertFile.c_str());
@@ -140,7 +161,9 @@ Material* Material::Deserialize(Scene* , const rapidjson::Value& value)
 {
 	auto pMaterial = new Material(MyEngine::GetSingleton()->GetDevice(), value["AssertFile"].GetString(), value["Name"].GetString());
 
-	pMaterial->SetDiffuseMap(new Texture(MyEngine::GetSingleton()->GetDevice(), value["DiffuseTexture"].GetString()));
+	// Usually read on a worker already, Scene::Deserialize starts the loads of the whole level first. The handle
+	// keeps the name of a texture that fails to load so it is saved again.
+	pMaterial->SetDiffuseMap(ResourceManager::GetInstance()->LoadTextureAsync(value["DiffuseTexture"].GetString()));
 
 	return pMaterial;
 }
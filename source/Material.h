@@ -7,7 +7,9 @@
 #include "DataTypes.h"
 #pragma warning(pop)
 
+#include "EffectCache.h"
 #include "Mesh.h"
+#include "ResourceHandle.h"
 
 #include <memory>
 #include <stringbuffer.h>
@@ -25,7 +27,8 @@ class Texture;
 class Material
 {
 public:
-	Material(ID3D11Device* pDevice, const std::string& assertFile, const std::string& name = "grid_material");				// Constructor
+	// The effect comes from the EffectCache, materials of the same file and defines share it
+	Material(ID3D11Device* pDevice, const std::string& assertFile, const std::string& name = "grid_material", const EffectDefines& defines = {});				// Constructor
 	virtual ~Material();				// Destructor
 
 	// Copy/move constructors and assignment operators
@@ -37,15 +40,31 @@ public:
 	
 	ID3DX11Effect* GetEffect() const;
 	ID3DX11EffectTechnique* GetTechnique() const;
+	// nullptr when the effect has no technique for the vertex format
+	ID3DX11EffectTechnique* GetTechnique(VertexFormat vertexFormat) const;
 
 	ID3DX11EffectMatrixVariable* GetMatWorldViewProjMatrix() const;
 
+	// Takes ownership
 	void SetDiffuseMap(Texture* pTexture);
+	// Shared through the resource manager, the placeholder is drawn while it loads
+	void SetDiffuseMap(const TextureHandle& texture);
+	// Materials of the same effect file share the effect and with it its variables, so the diffuse map is bound
+	// before every draw. Also picks up a texture that finished loading or was reloaded.
+	void BindDiffuseMap();
+	// Asks for the mips of the diffuse map it needs when it covers that many pixels on screen, see TextureStreamer
+	void RequestTextureSize(float pixels) const;
+	void SetPositionDequantization(const VertexQuantization::Dequantization& dequantization);
+	// True when the rasterizer state of the effect drops back faces, only then can whole clusters of them be skipped
+	bool CullsBackFaces() const;
 	
 	void SetName(const std::string& name);
 	std::string GetName() const;
-
-	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assertFile);
+	const std::string& GetEffectFile() const;
+	// The effect is shared through the EffectCache and the diffuse map through the resource manager, neither is counted
+	size_t GetCpuMemory() const;
+	// Creating the material, a compile of its effect when it was the first to use it
+	float GetLoadMilliseconds() const;
 
 	void Serialize(rapidjson::PrettyWriter< rapidjson::StringBuffer>& writer);
 	static Material* Deserialize(Scene* pScene, const rapidjson::Value& value);
@@ -57,13 +76,19 @@ protected:
 	// Datamembers								
 	ID3DX11Effect* m_pEffect{ nullptr };
 	ID3DX11EffectTechnique* m_pTechnique{ nullptr };
+	ID3DX11EffectTechnique* m_pQuantizedTechnique{ nullptr };
 
 	ID3DX11EffectMatrixVariable* m_pMatWorldViewProjVariable{ nullptr };
 	ID3DX11EffectShaderResourceVariable* m_pDiffuseMapVariable{ nullptr };
+	ID3DX11EffectVectorVariable* m_pPositionOffsetVariable{ nullptr };
+	ID3DX11EffectVectorVariable* m_pPositionScaleVariable{ nullptr };
+	bool m_CullsBackFaces{ false };
 
-	Texture* m_pTexture;
+	Texture* m_pTexture{ nullptr };
+	TextureHandle m_DiffuseMap{};
 	std::string m_Name;
 	std::string m_AssertFile;
+	float m_LoadMilliseconds{};
 
 };
 #endif
@@ -1,9 +1,16 @@
 #include "MaterialManager.h"
 #include "Material.h"
+#include "ResourceManager.h"
+#include "ResourceReport.h"
 
 MaterialManager* MaterialManager::m_pMaterialManager;
 
 MaterialManager::~MaterialManager()
+{
+    Clear();
+}
+
+void MaterialManager::Clear()
 {
     for (auto iter = m_pMaterials.begin(); iter != m_pMaterials.end(); ++iter)
         delete iter->second;
@@ -21,19 +28,35 @@ MaterialManager* MaterialManager::GetInstance()
 void MaterialManager::AddMaterial(const std::string& name, Material* pMaterial)
 {
     if (pMaterial == nullptr) return;
-    if (m_pMaterials[name] != nullptr)
+    if (m_pMaterials.find(name) != m_pMaterials.end())
     {
         delete pMaterial;
         return;
     }
 
+    // Only this name refers to it
+    if (pMaterial->GetName() != name) pMaterial->SetName(name);
+    m_pMaterials[name] = pMaterial;
+}
+
+Material* MaterialManager::AddMaterial(const std::string& name, const MaterialDescription& description, ID3D11Device* pDevice)
+{
+    if (auto iter = m_pMaterials.find(name); iter != m_pMaterials.end())
+        return iter->second;
+
+    // Only a few pointers of its own, the effect and the texture are shared with the materials that use them too
+    Material* pMaterial = new Material(pDevice != nullptr ? pDevice : MyEngine::GetSingleton()->GetDevice(), description.effectFile, name);
+    if (!description.diffuseMap.empty())
+        pMaterial->SetDiffuseMap(ResourceManager::GetInstance()->LoadTextureAsync(description.diffuseMap));
+
     m_pMaterials[name] = pMaterial;
+    return pMaterial;
 }
 
 Material* MaterialManager::GetMaterial(const std::string& name)
 {
-    if (m_pMaterials[name] != nullptr && m_pMaterials[name]->GetName() != name) m_pMaterials[name]->SetName(name);
-    return m_pMaterials[name];
+    const auto iter = m_pMaterials.find(name);
+    return iter != m_pMaterials.end() ? iter->second : nullptr;
 }
 
 Material* MaterialManager::GetLatestMaterial()
@@ -41,6 +64,23 @@ Material* MaterialManager::GetLatestMaterial()
     return m_pMaterials.rbegin()->second;
 }
 
+void MaterialManager::GetRecords(std::vector<ResourceRecord>& records) const
+{
+    for (const auto& [name, pMaterial] : m_pMaterials)
+    {
+        if (pMaterial == nullptr) continue;
+
+        ResourceRecord& record = records.emplace_back();
+        record.type = ResourceRecordType::Material;
+        record.name = pMaterial->GetName();
+        record.source = pMaterial->GetEffectFile();
+        record.cpuMemory = pMaterial->GetCpuMemory();
+        record.loadMilliseconds = pMaterial->GetLoadMilliseconds();
+        record.referenceCount = 1;
+        record.loaded = true;
+    }
+}
+
 void MaterialManager::Serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer)
 {
     writer.Key("Materials");
@@ -54,7 +94,7 @@ void MaterialManager::Serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>
         writer.String(typeid(*material.second).name());
 
         writer.Key("Name");
-        writer.String(material.second->GetName().c_str());
+        writer.String(material.first.c_str());
 
         material.second->Serialize(writer);
 
@@ -66,16 +106,13 @@ void MaterialManager::Serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>
 
 void MaterialManager::Deserialize(Scene* /*pScene*/, const rapidjson::Value& value)
 {
-    for (auto iter = m_pMaterials.begin(); iter != m_pMaterials.end(); ++iter)
-        delete iter->second;
-
-    m_pMaterials.clear();
+    Clear();
 
     for (auto& mat : value["Materials"].GetArray())
     {
         // Factory create material type
         auto name = mat["Name"].GetString();
 
-        AddMaterial(name, Material::Deserialize(nullptr, mat));
+        AddMaterial(name, MaterialDescription{ mat["AssertFile"].GetString(), mat["DiffuseTexture"].GetString() });
     }
 }
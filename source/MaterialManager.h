@@ -1,6 +1,7 @@
 #pragma once
 #include <map>
 #include <string>
+#include <vector>
 
 #include <stringbuffer.h>
 #include <prettywriter.h>
@@ -10,6 +11,16 @@
 
 class Material;
 class Scene;
+struct ID3D11Device;
+struct ResourceRecord;
+
+// What a material is made of. Every name gets its own material, materials of the same description share the
+// effect through the EffectCache and the diffuse map through the resource manager.
+struct MaterialDescription
+{
+	std::string effectFile{};
+	std::string diffuseMap{};		// Loaded through the resource manager, empty for none
+};
 
 class MaterialManager
 {
@@ -18,9 +29,16 @@ public:
 
 	static MaterialManager* GetInstance();
 
+	// Takes ownership, a material that is added under a name that is taken already is deleted
 	void AddMaterial(const std::string& name, Material* pMaterial);
+	// The material of the name, a new material of the description when the name is new. The maps of the materials
+	// can be changed on their own afterwards. Without a device the device of the engine is used.
+	Material* AddMaterial(const std::string& name, const MaterialDescription& description, ID3D11Device* pDevice = nullptr);
+	// nullptr when there is no material with the name
 	Material* GetMaterial(const std::string& name);
 	Material* GetLatestMaterial();
+	// Appends one record per material
+	void GetRecords(std::vector<ResourceRecord>& records) const;
 
 	void Serialize(rapidjson::PrettyWriter< rapidjson::StringBuffer>& writer);
 	void Deserialize(Scene* pScene, const rapidjson::Value& value);
@@ -30,6 +48,8 @@ public:
 private:
 	MaterialManager() = default;
 
+	void Clear();
+
 	static MaterialManager* m_pMaterialManager;
 
 	std::map<std::string, Material*> m_pMaterials{};
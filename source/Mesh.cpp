@@ -8,36 +8,30 @@
 #include "Component.h"
 #include "ResourceManager.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
 
 Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& name)
 	: m_pMaterial{ MaterialManager::GetInstance()->GetMaterial("default")}
+	, m_Filename{ name }
+	, m_SubmeshId{ 0 }
 {
+	auto worldmatrix = DirectX::XMMatrixIdentity();
+	DirectX::XMStoreFloat4x4(&m_WorldMatrix, worldmatrix);
 
-
+	Initialize(pDevice, hWnd, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()), VertexFormat::Float);
+	// Registered once the buffers exist so the resource manager can count their memory
 	ResourceManager::GetInstance()->AddMesh(name, this);
-	Initialize(pDevice, hWnd, vertices, indices);
 }
 
-// The mesh causes a memory leak that i cant find at the moment and i think it has something to with the material
-// i have been looking for it for a while and i'm gonna move on for not future me should be able to find it 
-Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const std::string& filePath, Material* pMaterial)
-	: m_pMaterial{ pMaterial }
-	, m_Filename{filePath}
+Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& filePath, int submeshId, Material* pMaterial, VertexFormat vertexFormat)
+	: Mesh(pDevice, hWnd, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()), filePath, submeshId, pMaterial, vertexFormat)
 {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-
-	auto worldmatrix = DirectX::XMMatrixIdentity();
-	DirectX::XMStoreFloat4x4(&m_WorldMatrix, worldmatrix);
-
-	if (!ParseOBJ(filePath, m_pSubmeshes))
-		return;
-
-	ResourceManager::GetInstance()->AddMesh(filePath, this);
-	Initialize(pDevice, hWnd, vertices, indices);
 }
 
-Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& filePath, int submeshId, Material* pMaterial)
+Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const Vertex* pVertices, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount, const std::string& filePath, int submeshId, Material* pMaterial, VertexFormat vertexFormat)
 	: m_pMaterial{ pMaterial}
 	, m_Filename{filePath}
 	, m_SubmeshId{submeshId}
@@ -46,11 +40,8 @@ Mesh::Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices
 	auto worldmatrix = DirectX::XMMatrixIdentity();
 	DirectX::XMStoreFloat4x4(&m_WorldMatrix, worldmatrix);
 
-	if (m_SubmeshId == 0)
-		ResourceManager::GetInstance()->AddMesh(filePath, this);
-	else
-		ResourceManager::GetInstance()->AddMesh(filePath + std::to_string(m_SubmeshId), this);
-	Initialize(pDevice, hWnd, vertices, indices);
+	Initialize(pDevice, hWnd, pVertices, vertexCount, pIndices, indexCount, vertexFormat);
+	ResourceManager::GetInstance()->AddMesh(ResourceManager::GetSubmeshName(filePath, m_SubmeshId), this);
 }
 
 Mesh::~Mesh()
@@ -86,6 +77,16 @@ Mesh::Mesh(const Mesh& other)
 
 	m_WorldMatrix = other.m_WorldMatrix;
 	m_AmountIndices = other.m_AmountIndices;
+	m_AmountVertices = other.m_AmountVertices;
+	m_VertexFormat = other.m_VertexFormat;
+	m_VertexStride = other.m_VertexStride;
+	m_IndexFormat = other.m_IndexFormat;
+	m_Dequantization = other.m_Dequantization;
+	m_Lods = other.m_Lods;
+	m_Meshlets = other.m_Meshlets;
+	m_Bvh = other.m_Bvh;
+	m_BoundsCenter = other.m_BoundsCenter;
+	m_BoundsRadius = other.m_BoundsRadius;
 }
 
 Mesh& Mesh::operator=(const Mesh& other)
@@ -100,19 +101,33 @@ Mesh& Mesh::operator=(const Mesh& other)
 
 	m_WorldMatrix = other.m_WorldMatrix;
 	m_AmountIndices = other.m_AmountIndices;
+	m_AmountVertices = other.m_AmountVertices;
+	m_VertexFormat = other.m_VertexFormat;
+	m_VertexStride = other.m_VertexStride;
+	m_IndexFormat = other.m_IndexFormat;
+	m_Dequantization = other.m_Dequantization;
+	m_Lods = other.m_Lods;
+	m_Meshlets = other.m_Meshlets;
+	m_Bvh = other.m_Bvh;
+	m_BoundsCenter = other.m_BoundsCenter;
+	m_BoundsRadius = other.m_BoundsRadius;
 
 	return *this;
 }
 
-void Mesh::Render(ID3D11DeviceContext* pDeviceContext, Camera* pCamera)
+void Mesh::Render(ID3D11DeviceContext* pDeviceContext, Camera* pCamera, int lod)
 {
+	ID3DX11EffectTechnique* pTechnique = GetTechnique();
+	if (pTechnique == nullptr)
+		return;
+
 	//Set vertex buffer
-	UINT stride = sizeof(Vertex);
+	UINT stride = m_VertexStride;
 	UINT offset = 0;
 	pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
 
 	//Set index buffer
-	pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, m_IndexFormat, 0);
 
 	// Set the input layout
 	pDeviceContext->IASetInputLayout(m_pVertexLayout);
@@ -130,14 +145,45 @@ void Mesh::Render(ID3D11DeviceContext* pDeviceContext, Camera* pCamera)
 	DirectX::XMStoreFloat4x4(&worldViewPorjectionMatrix, worldViewPorjection);
 
 	m_pMaterial->GetMatWorldViewProjMatrix()->SetMatrix(&worldViewPorjectionMatrix.m[0][0]);
+	m_pMaterial->BindDiffuseMap();
+	if (m_VertexFormat == VertexFormat::Quantized)
+		m_pMaterial->SetPositionDequantization(m_Dequantization);
+
+	UINT indexCount = m_AmountIndices;
+	UINT startIndex = 0;
+	if (lod >= 0 && lod < static_cast<int>(m_Lods.size()))
+	{
+		indexCount = m_Lods[lod].indexCount;
+		startIndex = m_Lods[lod].indexOffset;
+	}
+
+	m_DrawRanges.clear();
+	if (lod == 0 && !m_Meshlets.empty())
+	{
+		// Culling happens in object space, so the camera is moved into it instead of moving every cluster out
+		DirectX::XMVECTOR determinant{};
+		const auto inverseWorld = DirectX::XMMatrixInverse(&determinant, worldMatrix);
+		const DirectX::XMFLOAT3 cameraPosition = pCamera->GetPosition();
+		DirectX::XMFLOAT3 viewPosition{};
+		DirectX::XMStoreFloat3(&viewPosition, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&cameraPosition), inverseWorld));
+
+		// A mirroring world matrix turns the front faces around
+		const bool cullBackFaces = m_pMaterial->CullsBackFaces() && DirectX::XMVectorGetX(determinant) > 0.f;
+		m_MeshletStatistics = Meshlets::Cull(m_Meshlets.data(), m_Meshlets.size(), Meshlets::GetFrustum(worldViewPorjectionMatrix), viewPosition, cullBackFaces, m_DrawRanges);
+	}
+	else
+	{
+		m_DrawRanges.push_back(Meshlets::DrawRange{ startIndex, indexCount });
+	}
 
 	// Render a triangle
 	D3DX11_TECHNIQUE_DESC techDesc;
-	m_pMaterial->GetTechnique()->GetDesc(&techDesc);
+	pTechnique->GetDesc(&techDesc);
 	for (UINT p = 0; p < techDesc.Passes; ++p)
 	{
-		m_pMaterial->GetTechnique()->GetPassByIndex(p)->Apply(0, pDeviceContext);
-		pDeviceContext->DrawIndexed(m_AmountIndices, 0, 0);
+		pTechnique->GetPassByIndex(p)->Apply(0, pDeviceContext);
+		for (const auto& range : m_DrawRanges)
+			pDeviceContext->DrawIndexed(range.indexCount, range.indexOffset, 0);
 	}
 }
 
@@ -161,13 +207,6 @@ Material* Mesh::GetMaterial(const std::string&) const
 	return m_pMaterial;
 }
 
-Mesh* Mesh::GetSubMesh(int index)
-{
-	if (m_pSubmeshes.empty() && index == 0) return this;
-
-	return m_pSubmeshes[index];
-}
-
 std::string Mesh::GetFilename()
 {
 	return m_Filename;
@@ -178,45 +217,226 @@ int Mesh::GetSubmeshID()
 	return m_SubmeshId;
 }
 
+void Mesh::SetLods(const std::vector<MeshSimplifier::Lod>& lods)
+{
+	m_Lods.clear();
+	for (const auto& lod : lods)
+	{
+		if (static_cast<uint64_t>(lod.indexOffset) + lod.indexCount <= m_AmountIndices)
+			m_Lods.push_back(lod);
+	}
+
+	// The coarser lods follow the first one in the index buffer, raycasts only need the full detail
+	if (!m_Lods.empty() && m_Lods[0].indexOffset == 0)
+		m_Bvh.Truncate(m_Lods[0].indexCount / 3);
+}
+
+int Mesh::GetLodCount() const
+{
+	return m_Lods.empty() ? 1 : static_cast<int>(m_Lods.size());
+}
+
+int Mesh::SelectLod(const Camera* pCamera, float screenHeight, float maxPixelError) const
+{
+	if (m_Lods.size() < 2 || pCamera == nullptr)
+		return 0;
+
+	const DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&m_WorldMatrix);
+	const DirectX::XMVECTOR center = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&m_BoundsCenter), world);
+
+	// Errors scale with the largest axis of the world matrix
+	float scale = 0.f;
+	for (int axis = 0; axis < 3; ++axis)
+		scale = (std::max)(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[axis])));
+
+	const DirectX::XMFLOAT3 cameraPosition = pCamera->GetPosition();
+	const float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&cameraPosition)))) - m_BoundsRadius * scale;
+	if (distance <= 0.f)
+		return 0;
+
+	// Pixels per world unit at that distance, the projection holds 1 / tan(fov / 2)
+	const float pixelsPerUnit = pCamera->GetProjectionMatrix()._22 * screenHeight * 0.5f / distance;
+
+	int lod = 0;
+	for (int i = 1; i < static_cast<int>(m_Lods.size()); ++i)
+	{
+		if (m_Lods[i].error * scale * pixelsPerUnit > maxPixelError)
+			break;
+		lod = i;
+	}
+	return lod;
+}
+
+float Mesh::GetScreenSize(const Camera* pCamera, float screenHeight) const
+{
+	if (pCamera == nullptr)
+		return screenHeight;
+
+	const DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&m_WorldMatrix);
+	const DirectX::XMVECTOR center = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&m_BoundsCenter), world);
+
+	float scale = 0.f;
+	for (int axis = 0; axis < 3; ++axis)
+		scale = (std::max)(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[axis])));
+
+	// Inside the bounds the texture can be seen as close as it gets
+	const DirectX::XMFLOAT3 cameraPosition = pCamera->GetPosition();
+	const float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&cameraPosition)))) - m_BoundsRadius * scale;
+	if (distance <= 0.f)
+		return FLT_MAX;
+
+	return 2.f * m_BoundsRadius * scale * pCamera->GetProjectionMatrix()._22 * screenHeight * 0.5f / distance;
+}
+
+void Mesh::SetMeshlets(const std::vector<Meshlets::Meshlet>& meshlets)
+{
+	m_Meshlets.clear();
+	for (const auto& meshlet : meshlets)
+	{
+		if (static_cast<uint64_t>(meshlet.indexOffset) + meshlet.indexCount <= m_AmountIndices)
+			m_Meshlets.push_back(meshlet);
+	}
+}
+
+size_t Mesh::GetMeshletCount() const
+{
+	return m_Meshlets.size();
+}
+
+const Meshlets::CullStatistics& Mesh::GetMeshletStatistics() const
+{
+	return m_MeshletStatistics;
+}
+
+bool Mesh::Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Bvh::Hit& hit)
+{
+	BuildBvh();
+	return m_Bvh.Raycast(origin, direction, maxDistance, hit);
+}
+
+bool Mesh::Intersects(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance)
+{
+	BuildBvh();
+	return m_Bvh.Intersects(origin, direction, maxDistance);
+}
+
+void Mesh::BuildBvh()
+{
+	if (!m_Bvh.IsBuilt())
+		m_Bvh.Build();
+}
+
+const Bvh& Mesh::GetBvh() const
+{
+	return m_Bvh;
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsCenter() const
+{
+	return m_BoundsCenter;
+}
+
+float Mesh::GetBoundsRadius() const
+{
+	return m_BoundsRadius;
+}
+
+VertexFormat Mesh::GetVertexFormat() const
+{
+	return m_VertexFormat;
+}
+
+size_t Mesh::GetGpuMemory() const
+{
+	const size_t indexSize = m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+	return size_t(m_VertexStride) * m_AmountVertices + indexSize * m_AmountIndices;
+}
+
+size_t Mesh::GetCpuMemory() const
+{
+	return sizeof(Mesh) + m_Filename.capacity() + m_Lods.capacity() * sizeof(MeshSimplifier::Lod) + m_Meshlets.capacity() * sizeof(Meshlets::Meshlet)
+		+ m_DrawRanges.capacity() * sizeof(Meshlets::DrawRange) + m_Bvh.GetMemory();
+}
+
+ID3DX11EffectTechnique* Mesh::GetTechnique() const
+{
+	if (m_pMaterial == nullptr)
+		return nullptr;
+
+	return m_pMaterial->GetTechnique(m_VertexFormat);
+}
+
 //void Mesh::AddMaterial(const std::string& materialName, Material* pMaterial)
 //{
 //	m_pMaterials[materialName] = pMaterial;
 //}
 
-void Mesh::Initialize(ID3D11Device* pDevice, HWND, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+void Mesh::Initialize(ID3D11Device* pDevice, HWND, const Vertex* pVertices, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount, VertexFormat vertexFormat)
 {
 	// http://www.rastertek.com/dx11tut04.html
 
+	// Materials without a quantized technique can only draw full float vertices
+	m_VertexFormat = vertexFormat;
+	if (GetTechnique() == nullptr)
+		m_VertexFormat = VertexFormat::Float;
+	m_VertexStride = static_cast<UINT>(VertexQuantization::GetStride(m_VertexFormat));
+
 	// Create Vertex_Input Layout
 	HRESULT result = S_OK;
 	static const uint32_t numElement{ 4 };
 	//D3D11_INPUT_ELEMENT_DESC vertexDesc[numElement]{};
 	D3D11_INPUT_ELEMENT_DESC vertexDesc[numElement]{};
 
-	vertexDesc[0].SemanticName = "POSITION";
-	vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[0].AlignedByteOffset = 0;
-	vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[1].SemanticName = "NORMAL";
-	vertexDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[1].AlignedByteOffset = 12;
-	vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[2].SemanticName = "TANGENT";
-	vertexDesc[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	vertexDesc[2].AlignedByteOffset = 24;
-	vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-
-	vertexDesc[3].SemanticName = "TEXCOORD";
-	vertexDesc[3].Format = DXGI_FORMAT_R32G32_FLOAT;
-	vertexDesc[3].AlignedByteOffset = 36;
-	vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	if (m_VertexFormat == VertexFormat::Quantized)
+	{
+		// See QuantizedVertex, decoded by the vertex shader of the QuantizedTechnique
+		vertexDesc[0].SemanticName = "POSITION";
+		vertexDesc[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+		vertexDesc[0].AlignedByteOffset = 0;
+		vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[1].SemanticName = "NORMAL";
+		vertexDesc[1].Format = DXGI_FORMAT_R16G16_SNORM;
+		vertexDesc[1].AlignedByteOffset = 8;
+		vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[2].SemanticName = "TANGENT";
+		vertexDesc[2].Format = DXGI_FORMAT_R16G16_SNORM;
+		vertexDesc[2].AlignedByteOffset = 12;
+		vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[3].SemanticName = "TEXCOORD";
+		vertexDesc[3].Format = DXGI_FORMAT_R16G16_FLOAT;
+		vertexDesc[3].AlignedByteOffset = 16;
+		vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	}
+	else
+	{
+		vertexDesc[0].SemanticName = "POSITION";
+		vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[0].AlignedByteOffset = 0;
+		vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[1].SemanticName = "NORMAL";
+		vertexDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		vertexDesc[1].AlignedByteOffset = 12;
+		vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[2].SemanticName = "TANGENT";
+		vertexDesc[2].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		vertexDesc[2].AlignedByteOffset = 24;
+		vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+		vertexDesc[3].SemanticName = "TEXCOORD";
+		vertexDesc[3].Format = DXGI_FORMAT_R32G32_FLOAT;
+		vertexDesc[3].AlignedByteOffset = 40;
+		vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	}
 
 
 	// Create the input layout
 	D3DX11_PASS_DESC passDesc;
-	m_pMaterial->GetTechnique()->GetPassByIndex(0)->GetDesc(&passDesc);
+	GetTechnique()->GetPassByIndex(0)->GetDesc(&passDesc);
 	result = pDevice->CreateInputLayout(
 		vertexDesc,
 		numElement,
@@ -228,27 +448,74 @@ void Mesh::Initialize(ID3D11Device* pDevice, HWND, const std::vector<Vertex>& ve
 	if (FAILED(result))
 		return;
 
+	// Bounding sphere around the center of the box, good enough for lod selection
+	if (vertexCount > 0)
+	{
+		DirectX::XMVECTOR minimum = DirectX::XMLoadFloat3(&pVertices[0].position);
+		DirectX::XMVECTOR maximum = minimum;
+		for (uint32_t i = 1; i < vertexCount; ++i)
+		{
+			minimum = DirectX::XMVectorMin(minimum, DirectX::XMLoadFloat3(&pVertices[i].position));
+			maximum = DirectX::XMVectorMax(maximum, DirectX::XMLoadFloat3(&pVertices[i].position));
+		}
+
+		const DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(minimum, maximum), 0.5f);
+		DirectX::XMStoreFloat3(&m_BoundsCenter, center);
+
+		float radiusSquared = 0.f;
+		for (uint32_t i = 0; i < vertexCount; ++i)
+			radiusSquared = (std::max)(radiusSquared, DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pVertices[i].position), center))));
+		m_BoundsRadius = std::sqrt(radiusSquared);
+	}
+
+	m_Bvh.SetTriangles(pVertices, sizeof(Vertex), pIndices, indexCount);
+
+	// Encode into a temporary copy, the given vertices stay untouched for the CPU side
+	std::vector<QuantizedVertex> quantizedVertices{};
+	const void* pVertexData = pVertices;
+	if (m_VertexFormat == VertexFormat::Quantized)
+	{
+		m_Dequantization = VertexQuantization::GetDequantization(pVertices, vertexCount);
+		quantizedVertices.resize(vertexCount);
+		VertexQuantization::Quantize(quantizedVertices.data(), pVertices, vertexCount, m_Dequantization);
+		pVertexData = quantizedVertices.data();
+	}
+
 	// Create vertex buffer
+	m_AmountVertices = vertexCount;
 	D3D11_BUFFER_DESC bd = {};
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.ByteWidth = sizeof(Vertex) * (uint32_t)vertices.size();
+	bd.ByteWidth = m_VertexStride * vertexCount;
 	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
 	D3D11_SUBRESOURCE_DATA initData = { 0 };
-	initData.pSysMem = vertices.data();
+	initData.pSysMem = pVertexData;
 	result = pDevice->CreateBuffer(&bd, &initData, &m_pVertexBuffer);
 	if (FAILED(result))
 		return;
 
+	// Halve the index buffer when every vertex fits in 16 bits
+	std::vector<uint16_t> shortIndices{};
+	const void* pIndexData = pIndices;
+	UINT indexSize = sizeof(uint32_t);
+	m_IndexFormat = DXGI_FORMAT_R32_UINT;
+	if (VertexQuantization::CanUse16BitIndices(vertexCount))
+	{
+		shortIndices.assign(pIndices, pIndices + indexCount);
+		pIndexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+		m_IndexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
 	// Create index buffer
-	m_AmountIndices = (uint32_t)indices.size();
+	m_AmountIndices = indexCount;
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.ByteWidth = sizeof(uint32_t) * m_AmountIndices;
+	bd.ByteWidth = indexSize * m_AmountIndices;
 	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
-	initData.pSysMem = indices.data();
+	initData.pSysMem = pIndexData;
 	result = pDevice->CreateBuffer(&bd, &initData, &m_pIndexBuffer);
 	if (FAILED(result))
 		return;
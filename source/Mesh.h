@@ -6,6 +6,10 @@
 #pragma warning(pop)
 
 #include "MyEngine.h"
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+#include "Meshlets.h"
+#include "Bvh.h"
 #include <DirectXMath.h>
 #include <map>
 
@@ -18,7 +22,7 @@ struct Vertex
 {
 	DirectX::XMFLOAT3 position;
 	DirectX::XMFLOAT3 normal;
-	DirectX::XMFLOAT3 tangent;
+	DirectX::XMFLOAT4 tangent;	// w is the handedness of the bitangent
 	DirectX::XMFLOAT2 uv;
 	//RGBColor color;
 };
@@ -27,8 +31,8 @@ class Mesh final
 {
 public:
 	Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& name);
-	Mesh(ID3D11Device* pDevice, HWND hWnd, const std::string& filePath, Material* pMaterial);				// Constructor
-	Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& filePath, int submeshId, Material* pMaterial);				// Constructor
+	Mesh(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::string& filePath, int submeshId, Material* pMaterial, VertexFormat vertexFormat = VertexFormat::Float);				// Constructor
+	Mesh(ID3D11Device* pDevice, HWND hWnd, const Vertex* pVertices, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount, const std::string& filePath, int submeshId, Material* pMaterial, VertexFormat vertexFormat = VertexFormat::Float);	// Constructor, uploads straight from the given memory (e.g. a mapped cooked mesh)
 	~Mesh();				// Destructor
 
 	// Copy/move constructors and assignment operators
@@ -37,7 +41,7 @@ public:
 	Mesh& operator=(const Mesh& other) ;
 	Mesh& operator=(Mesh&& other)	noexcept = delete;
 
-	void Render(ID3D11DeviceContext* pDeviceContext, Camera* pCamera);
+	void Render(ID3D11DeviceContext* pDeviceContext, Camera* pCamera, int lod = 0);
 
 	DirectX::XMFLOAT4X4 GetWorldMatrix() const;
 	void SetWorldMatrix(const DirectX::XMFLOAT4X4& worldMatrix);
@@ -45,14 +49,44 @@ public:
 	//void AddMaterial(const std::string& materialName, Material* pMaterial);
 	void SetMaterial(const std::string& name, Material* m_pMaterial);
 	Material* GetMaterial(const std::string& name) const;
-	Mesh* GetSubMesh(int index);
 
 	std::string GetFilename();
 	int GetSubmeshID();
 
+	// Index ranges of the simplified versions, all of them live in the one index buffer
+	void SetLods(const std::vector<MeshSimplifier::Lod>& lods);
+	int GetLodCount() const;
+	// Coarsest lod whose error stays under maxPixelError on screen with the current world matrix
+	int SelectLod(const Camera* pCamera, float screenHeight, float maxPixelError = 1.f) const;
+	// Pixels the bounding sphere covers across on screen with the current world matrix, for picking texture mips
+	float GetScreenSize(const Camera* pCamera, float screenHeight) const;
+
+	// Clusters of the first lod, culled against the camera every time it is rendered
+	void SetMeshlets(const std::vector<Meshlets::Meshlet>& meshlets);
+	size_t GetMeshletCount() const;
+	const Meshlets::CullStatistics& GetMeshletStatistics() const;
+
+	// Object space raycasts against the first lod, the BVH is built on the first query
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, Bvh::Hit& hit);
+	bool Intersects(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance);
+	void BuildBvh();
+	const Bvh& GetBvh() const;
+
+	// Bounding sphere in object space
+	DirectX::XMFLOAT3 GetBoundsCenter() const;
+	float GetBoundsRadius() const;
+
+	VertexFormat GetVertexFormat() const;
+	// Size of the vertex and index buffer on the GPU
+	size_t GetGpuMemory() const;
+	// The mesh itself with its lods, meshlets and BVH
+	size_t GetCpuMemory() const;
+
 private:
 	// Private member functions		
-	void Initialize(ID3D11Device* pDevice, HWND hWnd, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	void Initialize(ID3D11Device* pDevice, HWND hWnd, const Vertex* pVertices, uint32_t vertexCount, const uint32_t* pIndices, uint32_t indexCount, VertexFormat vertexFormat);
+	// The technique matching the vertex format, nullptr when the material can not draw it
+	ID3DX11EffectTechnique* GetTechnique() const;
 
 	// Datamembers
 	ID3D11InputLayout* m_pVertexLayout{ nullptr };
@@ -60,7 +94,6 @@ private:
 	ID3D11Buffer* m_pIndexBuffer{ nullptr };
 
 	std::string m_Filename;
-	std::vector<Mesh*> m_pSubmeshes{};
 	int m_SubmeshId;
 
 	Material* m_pMaterial{ nullptr };
@@ -68,5 +101,24 @@ private:
 	DirectX::XMFLOAT4X4 m_WorldMatrix{};
 
 	uint32_t m_AmountIndices{};
+	uint32_t m_AmountVertices{};
+
+	VertexFormat m_VertexFormat{ VertexFormat::Float };
+	UINT m_VertexStride{ sizeof(Vertex) };
+	DXGI_FORMAT m_IndexFormat{ DXGI_FORMAT_R32_UINT };
+	VertexQuantization::Dequantization m_Dequantization{};
+
+	std::vector<MeshSimplifier::Lod> m_Lods{};
+	std::vector<Meshlets::Meshlet> m_Meshlets{};
+	Meshlets::CullStatistics m_MeshletStatistics{};
+	// Reused every frame, the index ranges that survived culling
+	std::vector<Meshlets::DrawRange> m_DrawRanges{};
+
+	// CPU copy of the triangles for raycasts
+	Bvh m_Bvh{};
+
+	// Bounding sphere in object space
+	DirectX::XMFLOAT3 m_BoundsCenter{};
+	float m_BoundsRadius{};
 };
 
@@ -0,0 +1,310 @@
+#include "MeshCache.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	constexpr size_t g_DataAlignment{ 16 };
+
+	inline size_t AlignUp(size_t value)
+	{
+		return (value + g_DataAlignment - 1) & ~(g_DataAlignment - 1);
+	}
+
+	void ComputeBounds(const Vertex* pVertices, uint32_t vertexCount, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax)
+	{
+		if (vertexCount == 0)
+		{
+			boundsMin = boundsMax = DirectX::XMFLOAT3{};
+			return;
+		}
+
+		DirectX::XMVECTOR minimum = DirectX::XMLoadFloat3(&pVertices[0].position);
+		DirectX::XMVECTOR maximum = minimum;
+		for (uint32_t i = 1; i < vertexCount; ++i)
+		{
+			const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&pVertices[i].position);
+			minimum = DirectX::XMVectorMin(minimum, position);
+			maximum = DirectX::XMVectorMax(maximum, position);
+		}
+
+		DirectX::XMStoreFloat3(&boundsMin, minimum);
+		DirectX::XMStoreFloat3(&boundsMax, maximum);
+	}
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath, uint32_t flags)
+{
+	std::string name = std::filesystem::path(sourcePath).lexically_normal().generic_string();
+	std::replace_if(name.begin(), name.end(), [](char c) { return c == '/' || c == '\\' || c == ':' || c == '.'; }, '_');
+
+	return "Cache/Meshes/" + name + "_" + std::to_string(flags) + ".mesh";
+}
+
+std::vector<char> MeshCache::Cook(const Key& key, const std::vector<std::string>& materialNames, const std::vector<std::string>& materialLibraries,
+	const std::vector<Submesh>& submeshes)
+{
+	FileHeader header{};
+	header.key = key;
+	header.vertexStride = sizeof(Vertex);
+	header.submeshCount = static_cast<uint32_t>(submeshes.size());
+	header.materialCount = static_cast<uint32_t>(materialNames.size());
+	header.libraryCount = static_cast<uint32_t>(materialLibraries.size());
+
+	// The libraries follow the materials, both are just names
+	std::vector<std::string_view> names(materialNames.begin(), materialNames.end());
+	names.insert(names.end(), materialLibraries.begin(), materialLibraries.end());
+
+	std::vector<MaterialEntry> materials(names.size());
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		materials[i].nameOffset = header.nameBytes;
+		materials[i].nameLength = static_cast<uint32_t>(names[i].size());
+		header.nameBytes += materials[i].nameLength;
+	}
+
+	std::vector<MeshSimplifier::Lod> lods{};
+	for (const Submesh& submesh : submeshes)
+	{
+		if (submesh.lodCount > 0)
+			lods.insert(lods.end(), submesh.pLods, submesh.pLods + submesh.lodCount);
+	}
+	header.lodCount = static_cast<uint32_t>(lods.size());
+
+	std::vector<Meshlets::Meshlet> meshlets{};
+	for (const Submesh& submesh : submeshes)
+	{
+		if (submesh.meshletCount > 0)
+			meshlets.insert(meshlets.end(), submesh.pMeshlets, submesh.pMeshlets + submesh.meshletCount);
+	}
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+
+	size_t offset = AlignUp(sizeof(FileHeader) + sizeof(SubmeshEntry) * submeshes.size() + sizeof(MaterialEntry) * materials.size()
+		+ sizeof(MeshSimplifier::Lod) * lods.size() + sizeof(Meshlets::Meshlet) * meshlets.size() + header.nameBytes);
+
+	header.boundsMin = DirectX::XMFLOAT3{ FLT_MAX, FLT_MAX, FLT_MAX };
+	header.boundsMax = DirectX::XMFLOAT3{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	std::vector<SubmeshEntry> entries(submeshes.size());
+	uint32_t firstLod{};
+	uint32_t firstMeshlet{};
+	for (size_t i = 0; i < submeshes.size(); ++i)
+	{
+		const Submesh& submesh = submeshes[i];
+		SubmeshEntry& entry = entries[i];
+
+		entry.vertexCount = submesh.vertexCount;
+		entry.indexCount = submesh.indexCount;
+		entry.firstLod = firstLod;
+		entry.lodCount = submesh.lodCount;
+		entry.vertexFormat = submesh.vertexFormat;
+		firstLod += submesh.lodCount;
+		entry.firstMeshlet = firstMeshlet;
+		entry.meshletCount = submesh.meshletCount;
+		firstMeshlet += submesh.meshletCount;
+		entry.vertexOffset = offset;
+		offset = AlignUp(offset + sizeof(Vertex) * submesh.vertexCount);
+		entry.indexOffset = offset;
+		offset = AlignUp(offset + sizeof(uint32_t) * submesh.indexCount);
+
+		const auto material = std::find(materialNames.begin(), materialNames.end(), submesh.materialName);
+		if (material != materialNames.end())
+			entry.material = static_cast<uint32_t>(material - materialNames.begin());
+
+		ComputeBounds(submesh.pVertices, submesh.vertexCount, entry.boundsMin, entry.boundsMax);
+		if (submesh.vertexCount > 0)
+		{
+			header.boundsMin = DirectX::XMFLOAT3{ (std::min)(header.boundsMin.x, entry.boundsMin.x), (std::min)(header.boundsMin.y, entry.boundsMin.y), (std::min)(header.boundsMin.z, entry.boundsMin.z) };
+			header.boundsMax = DirectX::XMFLOAT3{ (std::max)(header.boundsMax.x, entry.boundsMax.x), (std::max)(header.boundsMax.y, entry.boundsMax.y), (std::max)(header.boundsMax.z, entry.boundsMax.z) };
+		}
+	}
+
+	if (header.boundsMin.x > header.boundsMax.x)
+		header.boundsMin = header.boundsMax = DirectX::XMFLOAT3{};
+
+	std::vector<char> data(offset, 0);
+	char* pWrite = data.data();
+	memcpy(pWrite, &header, sizeof(header));
+	pWrite += sizeof(header);
+	if (!entries.empty())
+		memcpy(pWrite, entries.data(), sizeof(SubmeshEntry) * entries.size());
+	pWrite += sizeof(SubmeshEntry) * entries.size();
+	if (!materials.empty())
+		memcpy(pWrite, materials.data(), sizeof(MaterialEntry) * materials.size());
+	pWrite += sizeof(MaterialEntry) * materials.size();
+	if (!lods.empty())
+		memcpy(pWrite, lods.data(), sizeof(MeshSimplifier::Lod) * lods.size());
+	pWrite += sizeof(MeshSimplifier::Lod) * lods.size();
+	if (!meshlets.empty())
+		memcpy(pWrite, meshlets.data(), sizeof(Meshlets::Meshlet) * meshlets.size());
+	pWrite += sizeof(Meshlets::Meshlet) * meshlets.size();
+	for (const auto& name : names)
+	{
+		memcpy(pWrite, name.data(), name.size());
+		pWrite += name.size();
+	}
+
+	for (size_t i = 0; i < submeshes.size(); ++i)
+	{
+		if (submeshes[i].vertexCount > 0)
+			memcpy(data.data() + entries[i].vertexOffset, submeshes[i].pVertices, sizeof(Vertex) * submeshes[i].vertexCount);
+		if (submeshes[i].indexCount > 0)
+			memcpy(data.data() + entries[i].indexOffset, submeshes[i].pIndices, sizeof(uint32_t) * submeshes[i].indexCount);
+	}
+
+	return data;
+}
+
+bool MeshCache::WriteFile(const std::string& filename, const std::vector<char>& data)
+{
+	std::error_code error{};
+	std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+
+	// Write to a temporary file first so a crash never leaves a half written cache entry behind
+	const std::string temporary = filename + ".tmp";
+	{
+		std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+		if (!file)
+			return false;
+
+		file.write(data.data(), data.size());
+		if (!file)
+			return false;
+	}
+
+	std::filesystem::rename(temporary, filename, error);
+	return !error;
+}
+
+CookedMesh::CookedMesh(const std::string& filename)
+	: m_pFile{ std::make_unique<MappedFile>(filename) }
+{
+	if (!m_pFile->IsOpen())
+		return;
+
+	m_pData = m_pFile->GetData();
+	m_Size = m_pFile->GetSize();
+	Validate();
+}
+
+CookedMesh::CookedMesh(std::vector<char>&& data)
+	: m_Data{ std::move(data) }
+{
+	m_pData = m_Data.data();
+	m_Size = m_Data.size();
+	Validate();
+}
+
+CookedMesh::CookedMesh(std::string_view data)
+{
+	m_pData = data.data();
+	m_Size = data.size();
+	Validate();
+}
+
+bool CookedMesh::Matches(const MeshCache::Key& key) const
+{
+	if (!m_Valid)
+		return false;
+
+	const MeshCache::Key& cookedKey = m_pHeader->key;
+	return cookedKey.sourceHash == key.sourceHash && cookedKey.sourceSize == key.sourceSize
+		&& cookedKey.importerVersion == key.importerVersion && cookedKey.flags == key.flags;
+}
+
+void CookedMesh::Validate()
+{
+	using namespace MeshCache;
+
+	if (m_pData == nullptr || m_Size < sizeof(FileHeader))
+		return;
+
+	m_pHeader = reinterpret_cast<const FileHeader*>(m_pData);
+	if (m_pHeader->magic != g_Magic || m_pHeader->formatVersion != g_FormatVersion || m_pHeader->vertexStride != sizeof(Vertex))
+		return;
+
+	const size_t tableSize = sizeof(FileHeader) + sizeof(SubmeshEntry) * size_t(m_pHeader->submeshCount)
+		+ sizeof(MaterialEntry) * (size_t(m_pHeader->materialCount) + m_pHeader->libraryCount) + sizeof(MeshSimplifier::Lod) * size_t(m_pHeader->lodCount)
+		+ sizeof(Meshlets::Meshlet) * size_t(m_pHeader->meshletCount) + m_pHeader->nameBytes;
+	if (tableSize > m_Size)
+		return;
+
+	const auto* pEntries = reinterpret_cast<const SubmeshEntry*>(m_pData + sizeof(FileHeader));
+	const auto* pMaterials = reinterpret_cast<const MaterialEntry*>(pEntries + m_pHeader->submeshCount);
+	const auto* pLods = reinterpret_cast<const MeshSimplifier::Lod*>(pMaterials + m_pHeader->materialCount + m_pHeader->libraryCount);
+	const auto* pMeshlets = reinterpret_cast<const Meshlets::Meshlet*>(pLods + m_pHeader->lodCount);
+	const char* pNames = reinterpret_cast<const char*>(pMeshlets + m_pHeader->meshletCount);
+
+	m_MaterialNames.reserve(m_pHeader->materialCount);
+	m_MaterialLibraries.reserve(m_pHeader->libraryCount);
+	for (uint32_t i = 0; i < m_pHeader->materialCount + m_pHeader->libraryCount; ++i)
+	{
+		const MaterialEntry& material = pMaterials[i];
+		if (size_t(material.nameOffset) + material.nameLength > m_pHeader->nameBytes)
+			return;
+
+		auto& names = i < m_pHeader->materialCount ? m_MaterialNames : m_MaterialLibraries;
+		names.emplace_back(pNames + material.nameOffset, material.nameLength);
+	}
+
+	m_Submeshes.reserve(m_pHeader->submeshCount);
+	for (uint32_t i = 0; i < m_pHeader->submeshCount; ++i)
+	{
+		const SubmeshEntry& entry = pEntries[i];
+		if (entry.vertexOffset % g_DataAlignment != 0 || entry.indexOffset % g_DataAlignment != 0)
+			return;
+		if (entry.vertexOffset > m_Size || (m_Size - entry.vertexOffset) / sizeof(Vertex) < entry.vertexCount)
+			return;
+		if (entry.indexOffset > m_Size || (m_Size - entry.indexOffset) / sizeof(uint32_t) < entry.indexCount)
+			return;
+		if (entry.material != g_NoMaterial && entry.material >= m_pHeader->materialCount)
+			return;
+		if (size_t(entry.firstLod) + entry.lodCount > m_pHeader->lodCount)
+			return;
+		if (size_t(entry.firstMeshlet) + entry.meshletCount > m_pHeader->meshletCount)
+			return;
+		for (uint32_t meshlet = entry.firstMeshlet; meshlet < entry.firstMeshlet + entry.meshletCount; ++meshlet)
+		{
+			if (size_t(pMeshlets[meshlet].indexOffset) + pMeshlets[meshlet].indexCount > entry.indexCount)
+				return;
+		}
+		if (entry.vertexFormat != VertexFormat::Float && entry.vertexFormat != VertexFormat::Quantized)
+			return;
+		for (uint32_t lod = entry.firstLod; lod < entry.firstLod + entry.lodCount; ++lod)
+		{
+			if (size_t(pLods[lod].indexOffset) + pLods[lod].indexCount > entry.indexCount)
+				return;
+		}
+
+		Submesh submesh{};
+		submesh.pVertices = reinterpret_cast<const Vertex*>(m_pData + entry.vertexOffset);
+		submesh.vertexCount = entry.vertexCount;
+		submesh.pIndices = reinterpret_cast<const uint32_t*>(m_pData + entry.indexOffset);
+		submesh.indexCount = entry.indexCount;
+		submesh.pLods = entry.lodCount > 0 ? pLods + entry.firstLod : nullptr;
+		submesh.lodCount = entry.lodCount;
+		submesh.pMeshlets = entry.meshletCount > 0 ? pMeshlets + entry.firstMeshlet : nullptr;
+		submesh.meshletCount = entry.meshletCount;
+		submesh.vertexFormat = entry.vertexFormat;
+		submesh.boundsMin = entry.boundsMin;
+		submesh.boundsMax = entry.boundsMax;
+		if (entry.material != g_NoMaterial)
+			submesh.materialName = m_MaterialNames[entry.material];
+
+		// Indices are fed to the GPU unchecked, make sure a corrupt file can not read out of bounds
+		for (uint32_t index = 0; index < entry.indexCount; ++index)
+		{
+			if (submesh.pIndices[index] >= entry.vertexCount)
+				return;
+		}
+
+		m_Submeshes.push_back(submesh);
+	}
+
+	m_Valid = true;
+}
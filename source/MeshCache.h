@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "VertexFormat.h"
+
+struct Vertex;
+
+// Cooked binary mesh format, holds the importer output (welded vertices with tangents, indices,
+// submeshes, material names, material libraries and bounds) so it can be mapped and uploaded without parsing.
+// Layout: FileHeader, SubmeshEntry[submeshCount], MaterialEntry[materialCount + libraryCount], Lod[lodCount],
+// Meshlet[meshletCount], name characters, then the 16 byte aligned vertex and index data of every submesh. The lods
+// and meshlets index into the submesh indices, the material libraries are stored as names after the materials.
+namespace MeshCache
+{
+	constexpr uint32_t g_Magic{ 0x3148534D }; // "MSH1"
+	constexpr uint32_t g_FormatVersion{ 6 };
+	constexpr uint32_t g_NoMaterial{ UINT32_MAX };
+
+	// A cooked file is only used when all of these match the source it was cooked from
+	struct Key
+	{
+		uint64_t sourceHash{};
+		uint64_t sourceSize{};
+		uint32_t importerVersion{};
+		uint32_t flags{};
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic{ g_Magic };
+		uint32_t formatVersion{ g_FormatVersion };
+		Key key{};
+		uint32_t vertexStride{};
+		uint32_t submeshCount{};
+		uint32_t materialCount{};
+		uint32_t lodCount{};
+		uint32_t nameBytes{};
+		DirectX::XMFLOAT3 boundsMin{};
+		DirectX::XMFLOAT3 boundsMax{};
+		uint32_t meshletCount{};
+		uint32_t libraryCount{};
+	};
+
+	struct SubmeshEntry
+	{
+		uint64_t vertexOffset{};
+		uint64_t indexOffset{};
+		uint32_t vertexCount{};
+		uint32_t indexCount{};
+		uint32_t material{ g_NoMaterial };
+		uint32_t firstLod{};
+		uint32_t lodCount{};
+		VertexFormat vertexFormat{ VertexFormat::Float };
+		uint32_t firstMeshlet{};
+		uint32_t meshletCount{};
+		DirectX::XMFLOAT3 boundsMin{};
+		DirectX::XMFLOAT3 boundsMax{};
+	};
+
+	struct MaterialEntry
+	{
+		uint32_t nameOffset{};
+		uint32_t nameLength{};
+	};
+
+	// View on the data of one submesh, points into the cooked data
+	struct Submesh
+	{
+		const Vertex* pVertices{};
+		uint32_t vertexCount{};
+		const uint32_t* pIndices{};
+		uint32_t indexCount{};
+		const MeshSimplifier::Lod* pLods{};
+		uint32_t lodCount{};
+		// Clusters of the first lod, empty for small meshes
+		const Meshlets::Meshlet* pMeshlets{};
+		uint32_t meshletCount{};
+		// GPU layout picked at import, the cooked vertices are always full Vertex
+		VertexFormat vertexFormat{ VertexFormat::Float };
+		std::string_view materialName{};
+		DirectX::XMFLOAT3 boundsMin{};
+		DirectX::XMFLOAT3 boundsMax{};
+	};
+
+	// Cached files live in Cache/Meshes, one per source file and import setting
+	std::string GetCachePath(const std::string& sourcePath, uint32_t flags);
+
+	// Builds the cooked file in memory, the bounds are computed here. The material libraries are the .mtl files the
+	// materials are described in, resolved against the directory of the source.
+	std::vector<char> Cook(const Key& key, const std::vector<std::string>& materialNames, const std::vector<std::string>& materialLibraries,
+		const std::vector<Submesh>& submeshes);
+	bool WriteFile(const std::string& filename, const std::vector<char>& data);
+}
+
+// Cooked mesh either mapped from the cache or held in memory right after cooking
+class CookedMesh final
+{
+public:
+	explicit CookedMesh(const std::string& filename);
+	explicit CookedMesh(std::vector<char>&& data);
+	// Views data owned by someone else (a mounted asset pack), it has to outlive the cooked mesh
+	explicit CookedMesh(std::string_view data);
+	~CookedMesh() = default;
+
+	CookedMesh(const CookedMesh& other) = delete;
+	CookedMesh(CookedMesh&& other) noexcept = delete;
+	CookedMesh& operator=(const CookedMesh& other) = delete;
+	CookedMesh& operator=(CookedMesh&& other) noexcept = delete;
+
+	bool IsValid() const { return m_Valid; }
+	bool Matches(const MeshCache::Key& key) const;
+
+	size_t GetSubmeshCount() const { return m_Submeshes.size(); }
+	const MeshCache::Submesh& GetSubmesh(size_t index) const { return m_Submeshes[index]; }
+	const std::vector<std::string_view>& GetMaterialNames() const { return m_MaterialNames; }
+	const std::vector<std::string_view>& GetMaterialLibraries() const { return m_MaterialLibraries; }
+	const char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+	DirectX::XMFLOAT3 GetBoundsMin() const { return m_pHeader->boundsMin; }
+	DirectX::XMFLOAT3 GetBoundsMax() const { return m_pHeader->boundsMax; }
+
+private:
+	// Checks every offset and count against the data size before anything is handed out
+	void Validate();
+
+	std::unique_ptr<MappedFile> m_pFile{};
+	std::vector<char> m_Data{};
+
+	const char* m_pData{};
+	size_t m_Size{};
+	const MeshCache::FileHeader* m_pHeader{};
+
+	std::vector<MeshCache::Submesh> m_Submeshes{};
+	std::vector<std::string_view> m_MaterialNames{};
+	std::vector<std::string_view> m_MaterialLibraries{};
+	bool m_Valid{ false };
+};
@@ -2,6 +2,7 @@
 #include "Factory.h"
 #include "TransformComponent.h"
 #include "Mesh.h"
+#include "Material.h"
 #include "ResourceManager.h"
 #include "GameObject.h"
 #include "Scene.h"
@@ -13,7 +14,13 @@ const Creator<IComponent, MeshComponent> g_MeshComponent{};
 
 MeshComponent::MeshComponent(Mesh* pMesh)
 	: IComponent{}
-	, m_pMesh{ pMesh }
+	, m_Mesh{ ResourceManager::GetInstance()->GetMesh(pMesh) }
+{
+}
+
+MeshComponent::MeshComponent(const MeshHandle& mesh)
+	: IComponent{}
+	, m_Mesh{ mesh }
 {
 }
 
@@ -25,17 +32,27 @@ MeshComponent::~MeshComponent()
 void MeshComponent::Start()
 {
 	m_pTransform = m_pGameobject->GetComponent<TransformComponent>();
-	if (m_pMesh == nullptr) return;
+	Mesh* pMesh = m_Mesh.Get();
+	if (pMesh == nullptr) return;
 
-	m_pMesh->SetWorldMatrix(m_pTransform->GetWorldMatrix());
+	pMesh->SetWorldMatrix(m_pTransform->GetWorldMatrix());
 }
 
 void MeshComponent::Render()
 {
-	if (m_pMesh == nullptr) return;
-
-	m_pMesh->SetWorldMatrix(m_pTransform->GetWorldMatrix());
-	m_pMesh->Render(MyEngine::GetSingleton()->GetDeviceContext(), m_pGameobject->GetScene()->GetCamera());
+	Mesh* pMesh = m_Mesh.Get();
+	if (pMesh == nullptr) return;
+
+	Camera* pCamera = m_pGameobject->GetScene()->GetCamera();
+
+	if (m_pMaterial != nullptr)
+		pMesh->SetMaterial("", m_pMaterial);
+	pMesh->SetWorldMatrix(m_pTransform->GetWorldMatrix());
+	m_CurrentLod = pMesh->SelectLod(pCamera, MyEngine::GetSingleton()->GetWindowHeight(), m_LodPixelError);
+	// Textures are taken to cover the mesh once, the mips they need follow how big it is on screen
+	if (Material* pMaterial = pMesh->GetMaterial(""); pMaterial != nullptr)
+		pMaterial->RequestTextureSize(pMesh->GetScreenSize(pCamera, MyEngine::GetSingleton()->GetWindowHeight()));
+	pMesh->Render(MyEngine::GetSingleton()->GetDeviceContext(), pCamera, m_CurrentLod);
 }
 
 void MeshComponent::Update()
@@ -45,19 +62,19 @@ void MeshComponent::Update()
 void MeshComponent::RenderGUI()
 {
 	static ImGuiComboFlags flags = 0;
-	auto names = ResourceManager::GetInstance()->GetMeshNames();
-	static int item_current_idx = 0; // Here we store our selection data as an index.
-	const char* combo_preview_value = names[item_current_idx].c_str();  // Pass in the preview value visible before opening the combo (it could be anything)
+	const auto pResourceManager = ResourceManager::GetInstance();
+	// The id list is kept by the manager, only the names that are drawn are looked up
+	const char* combo_preview_value = m_Mesh.GetName().c_str();
 	if (ImGui::BeginCombo("combo 1", combo_preview_value, flags))
 	{
-		for (int n = 0; n < names.size(); n++)
+		// Indexed, selecting a file loads it and that adds its submeshes to the list
+		const auto& ids = pResourceManager->GetMeshIds();
+		for (size_t n = 0; n < ids.size(); n++)
 		{
-			const bool is_selected = (item_current_idx == n);
-			if (ImGui::Selectable(names[n].c_str(), is_selected))
-			{
-				item_current_idx = n;
-				SetMesh(names[n]);
-			}
+			const ResourceId id = ids[n];
+			const bool is_selected = (m_Mesh.GetId() == id);
+			if (ImGui::Selectable(pResourceManager->GetName(id).c_str(), is_selected))
+				SetMesh(id);
 
 			// Set the initial focus when opening the combo (scrolling + keyboard navigation focus)
 			if (is_selected)
@@ -68,46 +85,84 @@ void MeshComponent::RenderGUI()
 		ImGui::EndCombo();
 	}
 
-	if (m_pMesh == nullptr) return;
+	if (m_Mesh.IsLoading())
+	{
+		ImGui::Text("Loading %s (%zu loads queued)", m_Mesh.GetName().c_str(), pResourceManager->GetLoadingCount());
+		return;
+	}
+
+	Mesh* pMesh = m_Mesh.Get();
+	if (pMesh == nullptr) return;
 
-	int submeshId = m_pMesh->GetSubmeshID();
+	int submeshId = pMesh->GetSubmeshID();
 	if (ImGui::InputInt("Submesh", &submeshId))
-		m_pMesh = ResourceManager::GetInstance()->GetMesh(m_pMesh->GetFilename() + std::to_string(submeshId));
+	{
+		m_Mesh = pResourceManager->LoadMeshAsync(pMesh->GetFilename(), submeshId);
+		pMesh = m_Mesh.Get();
+	}
+	if (pMesh == nullptr || m_Mesh.IsLoading()) return;
+
+	ImGui::DragFloat("Lod pixel error", &m_LodPixelError, 0.1f, 0.f, 100.f);
+	ImGui::Text("Lod %d / %d", m_CurrentLod, pMesh->GetLodCount());
+	if (pMesh->GetMeshletCount() > 0)
+	{
+		const auto& statistics = pMesh->GetMeshletStatistics();
+		ImGui::Text("Meshlets %u / %zu visible (%u outside, %u back facing)", statistics.visible, pMesh->GetMeshletCount(), statistics.outsideFrustum, statistics.backFacing);
+	}
+	ImGui::Text("%s vertices, %.1f KB on the GPU", pMesh->GetVertexFormat() == VertexFormat::Quantized ? "Quantized" : "Float", pMesh->GetGpuMemory() / 1024.f);
+	if (pMesh->GetBvh().IsBuilt())
+		ImGui::Text("BVH %zu nodes over %zu triangles, %.1f KB", pMesh->GetBvh().GetNodeCount(), pMesh->GetBvh().GetTriangleCount(), pMesh->GetBvh().GetMemory() / 1024.f);
+
+	ImGui::Text("Resources %.1f MB meshes, %.1f MB textures, budget %.1f MB (%zu evicted)",
+		pResourceManager->GetMemory(ResourceType::Mesh) / (1024.f * 1024.f), pResourceManager->GetMemory(ResourceType::Texture) / (1024.f * 1024.f),
+		pResourceManager->GetMemoryBudget() / (1024.f * 1024.f), pResourceManager->GetEvictionCount());
 }
 
 void MeshComponent::Serialize(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer)
 {
-	writer.Key("MeshPath");
-	writer.String(m_pMesh->GetFilename().c_str());
+	// Not the placeholder. A mesh that could not be loaded keeps the file it refers to.
+	Mesh* pMesh = m_Mesh.Wait();
+	const std::string file = pMesh != nullptr ? pMesh->GetFilename() : m_Mesh.GetFile();
+	const int submeshId = pMesh != nullptr ? pMesh->GetSubmeshID() : m_Mesh.GetSubmeshId();
+	// The material of the component is applied when it renders, it may not have been yet
+	Material* pMaterial = m_pMaterial != nullptr ? m_pMaterial : pMesh != nullptr ? pMesh->GetMaterial("") : nullptr;
+
+	const auto pResourceManager = ResourceManager::GetInstance();
+	// The scene writes the names of the ids in its name table
+	writer.Key("Mesh");
+	writer.Uint64(pResourceManager->AddToNameTable(pResourceManager->Intern(file)));
 	writer.Key("SubmeshId");
-	writer.Int(m_pMesh->GetSubmeshID());
+	writer.Int(submeshId);
 	writer.Key("Material");
-	writer.String(m_pMesh->GetMaterial("")->GetName().c_str());
+	writer.String(pMaterial != nullptr ? pMaterial->GetName().c_str() : "");
 }
 
 void MeshComponent::Deserialize(const rapidjson::Value& value)
 {
-	m_pMesh = ResourceManager::GetInstance()->GetMesh(value["MeshPath"].GetString())->GetSubMesh(value["SubmeshId"].GetInt());
+	// The placeholder is drawn until the mesh is loaded, the material is applied when it is rendered
+	if (value.HasMember("Mesh"))
+		m_Mesh = ResourceManager::GetInstance()->LoadMeshAsync(ResourceId{ value["Mesh"].GetUint64() }, value["SubmeshId"].GetInt());
+	else // Scenes saved before the name table
+		m_Mesh = ResourceManager::GetInstance()->LoadMeshAsync(value["MeshPath"].GetString(), value["SubmeshId"].GetInt());
 
-	auto p = MaterialManager::GetInstance();
-	Material* mat = MaterialManager::GetInstance()->GetMaterial(value["Material"].GetString());
-	m_pMesh->SetMaterial(mat->GetName(), mat);
-	p = nullptr;
+	m_pMaterial = MaterialManager::GetInstance()->GetMaterial(value["Material"].GetString());
 }
 
 void MeshComponent::SetMesh(Mesh* pMesh)
 {
-	m_pMesh = pMesh;
+	m_Mesh = ResourceManager::GetInstance()->GetMesh(pMesh);
+	m_pMaterial = nullptr;
 }
 
 Mesh* MeshComponent::GetMesh() const
 {
-	return m_pMesh;
+	return m_Mesh.Get();
 }
 
-void MeshComponent::SetMesh(const std::string& name)
+void MeshComponent::SetMesh(ResourceId id)
 {
-	if (m_pMesh == ResourceManager::GetInstance()->GetMesh(name)) return;
+	if (m_Mesh.GetId() == id) return;
 
-	m_pMesh = ResourceManager::GetInstance()->GetMesh(name);
+	m_Mesh = ResourceManager::GetInstance()->LoadMeshAsync(id);
+	m_pMaterial = nullptr;
 }
\ No newline at end of file
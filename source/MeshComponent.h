@@ -1,10 +1,14 @@
 #pragma once
 #include "Component.h"
+#include "ResourceHandle.h"
+
+class Material;
 
 class MeshComponent : public IComponent
 {
 public:
 	MeshComponent(Mesh* pMesh = nullptr);
+	explicit MeshComponent(const MeshHandle& mesh);
 	~MeshComponent();
 
 	void Start() override;
@@ -19,8 +23,14 @@ public:
 	void SetMesh(Mesh* pMesh);
 	Mesh* GetMesh() const;
 private:
-	void SetMesh(const std::string& meshpath);
+	void SetMesh(ResourceId id);
 
-	Mesh* m_pMesh{};
+	MeshHandle m_Mesh{};
+	// Set when a scene is loaded, applied again after the mesh was evicted and loaded again
+	Material* m_pMaterial{};
 	TransformComponent* m_pTransform;
+
+	// Switches to a coarser lod once its error is smaller than this on screen
+	float m_LodPixelError{ 1.f };
+	int m_CurrentLod{};
 };
@@ -0,0 +1,347 @@
+#include "MeshOptimizer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Triangles that use each vertex, stored as one flat array with an offset per vertex
+	struct TriangleAdjacency
+	{
+		std::vector<uint32_t> counts{};
+		std::vector<uint32_t> offsets{};
+		std::vector<uint32_t> triangles{};
+	};
+
+	void BuildAdjacency(TriangleAdjacency& adjacency, const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.resize(vertexCount);
+		adjacency.triangles.resize(indexCount);
+
+		for (size_t i = 0; i < indexCount; ++i)
+			++adjacency.counts[pIndices[i]];
+
+		uint32_t offset{};
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			adjacency.offsets[vertex] = offset;
+			offset += adjacency.counts[vertex];
+		}
+
+		std::vector<uint32_t> fill = adjacency.offsets;
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency.triangles[fill[pIndices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	inline const float* GetPosition(const void* pVertices, size_t vertexSize, uint32_t index)
+	{
+		return reinterpret_cast<const float*>(static_cast<const char*>(pVertices) + vertexSize * index);
+	}
+
+	// Cache misses of a range of triangles when it is drawn on its own
+	size_t CountCacheMisses(const uint32_t* pIndices, size_t firstTriangle, size_t lastTriangle, std::vector<uint32_t>& cacheTimestamps, uint32_t& timestamp, uint32_t cacheSize)
+	{
+		// Jump ahead so everything that is still in the cache from a previous range counts as a miss
+		timestamp += cacheSize + 1;
+
+		size_t misses{};
+		for (size_t i = firstTriangle * 3; i < lastTriangle * 3; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (timestamp - cacheTimestamps[index] > cacheSize)
+			{
+				cacheTimestamps[index] = timestamp++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStatistics statistics{};
+	if (indexCount < 3 || vertexCount == 0)
+		return statistics;
+
+	// A vertex is in the cache when it was added less than cacheSize misses ago
+	std::vector<size_t> cacheTimestamps(vertexCount, 0);
+	size_t timestamp = cacheSize + 1;
+	size_t misses{};
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t index = pIndices[i];
+		if (index >= vertexCount)
+			continue;
+
+		if (timestamp - cacheTimestamps[index] > cacheSize)
+		{
+			cacheTimestamps[index] = timestamp++;
+			++misses;
+		}
+	}
+
+	size_t usedVertices{};
+	for (size_t cacheTimestamp : cacheTimestamps)
+		usedVertices += cacheTimestamp > 0 ? 1 : 0;
+
+	statistics.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	statistics.atvr = usedVertices > 0 ? static_cast<float>(misses) / static_cast<float>(usedVertices) : 0.f;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	TriangleAdjacency adjacency{};
+	BuildAdjacency(adjacency, pIndices, triangleCount * 3, vertexCount);
+
+	// Triangles that still have to be emitted per vertex
+	std::vector<uint32_t> liveTriangles = adjacency.counts;
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> deadEndStack{};
+	deadEndStack.reserve(indexCount);
+	std::vector<uint32_t> candidates{};
+	candidates.reserve(cacheSize * 3);
+
+	uint32_t timestamp = cacheSize + 1;
+	size_t scanCursor{};
+	size_t outputIndex{};
+
+	int64_t fanningVertex{};
+	while (fanningVertex >= 0)
+	{
+		const uint32_t vertex = static_cast<uint32_t>(fanningVertex);
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		const uint32_t* pTriangles = adjacency.triangles.data() + adjacency.offsets[vertex];
+		for (uint32_t i = 0; i < adjacency.counts[vertex]; ++i)
+		{
+			const uint32_t triangle = pTriangles[i];
+			if (emitted[triangle])
+				continue;
+
+			emitted[triangle] = true;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t index = pIndices[triangle * 3 + corner];
+				pDestination[outputIndex++] = index;
+
+				deadEndStack.push_back(index);
+				candidates.push_back(index);
+				--liveTriangles[index];
+
+				if (timestamp - cacheTimestamps[index] > cacheSize)
+					cacheTimestamps[index] = timestamp++;
+			}
+		}
+
+		// Prefer the candidate that stays in the cache the longest while all its triangles are emitted
+		fanningVertex = -1;
+		int64_t bestPriority = -1;
+		for (const uint32_t candidate : candidates)
+		{
+			if (liveTriangles[candidate] == 0)
+				continue;
+
+			int64_t priority{};
+			if (timestamp - cacheTimestamps[candidate] + 2 * liveTriangles[candidate] <= cacheSize)
+				priority = timestamp - cacheTimestamps[candidate];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = candidate;
+			}
+		}
+
+		if (fanningVertex >= 0)
+			continue;
+
+		// Dead end, go back to recently used vertices first and only then to the next unused one
+		while (!deadEndStack.empty() && fanningVertex < 0)
+		{
+			const uint32_t candidate = deadEndStack.back();
+			deadEndStack.pop_back();
+			if (liveTriangles[candidate] > 0)
+				fanningVertex = candidate;
+		}
+
+		while (fanningVertex < 0 && scanCursor < vertexCount)
+		{
+			if (liveTriangles[scanCursor] > 0)
+				fanningVertex = static_cast<int64_t>(scanCursor);
+			++scanCursor;
+		}
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize, float threshold, uint32_t cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	// Hard boundaries where the cache is flushed anyway, a triangle that misses on all of its corners
+	std::vector<size_t> hardBoundaries{};
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		uint32_t misses{};
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t index = pIndices[triangle * 3 + corner];
+			if (timestamp - cacheTimestamps[index] > cacheSize)
+			{
+				cacheTimestamps[index] = timestamp++;
+				++misses;
+			}
+		}
+
+		if (misses == 3 || triangle == 0)
+			hardBoundaries.push_back(triangle);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries split the hard clusters further as long as each part stays close to the ACMR of the whole cluster
+	std::vector<size_t> clusters{};
+	std::fill(cacheTimestamps.begin(), cacheTimestamps.end(), 0);
+	for (size_t cluster = 0; cluster + 1 < hardBoundaries.size(); ++cluster)
+	{
+		const size_t start = hardBoundaries[cluster];
+		const size_t end = hardBoundaries[cluster + 1];
+		const float clusterAcmr = static_cast<float>(CountCacheMisses(pIndices, start, end, cacheTimestamps, timestamp, cacheSize)) / static_cast<float>(end - start);
+
+		clusters.push_back(start);
+		if (threshold <= 1.f)
+			continue;
+
+		timestamp += cacheSize + 1;
+		size_t subStart = start;
+		size_t subMisses{};
+		for (size_t triangle = start; triangle < end; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t index = pIndices[triangle * 3 + corner];
+				if (timestamp - cacheTimestamps[index] > cacheSize)
+				{
+					cacheTimestamps[index] = timestamp++;
+					++subMisses;
+				}
+			}
+
+			const size_t subTriangles = triangle + 1 - subStart;
+			if (triangle + 1 < end && subTriangles >= 8 && static_cast<float>(subMisses) / subTriangles <= clusterAcmr * threshold)
+			{
+				// Start the next cluster with a cold cache, that is what it gets when it is moved
+				clusters.push_back(triangle + 1);
+				subStart = triangle + 1;
+				subMisses = 0;
+				timestamp += cacheSize + 1;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Sort the clusters on how much they face away from the mesh center
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<float> meshCenter(3, 0.f);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		const float* pPosition = GetPosition(pVertices, vertexSize, pIndices[i]);
+		for (int axis = 0; axis < 3; ++axis)
+			meshCenter[axis] += pPosition[axis];
+	}
+	for (int axis = 0; axis < 3; ++axis)
+		meshCenter[axis] /= static_cast<float>(triangleCount * 3);
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		float center[3]{};
+		float normal[3]{};
+		float totalArea{};
+
+		for (size_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; ++triangle)
+		{
+			const float* p0 = GetPosition(pVertices, vertexSize, pIndices[triangle * 3]);
+			const float* p1 = GetPosition(pVertices, vertexSize, pIndices[triangle * 3 + 1]);
+			const float* p2 = GetPosition(pVertices, vertexSize, pIndices[triangle * 3 + 2]);
+
+			const float edge0[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float edge1[3]{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float cross[3]{ edge0[1] * edge1[2] - edge0[2] * edge1[1], edge0[2] * edge1[0] - edge0[0] * edge1[2], edge0[0] * edge1[1] - edge0[1] * edge1[0] };
+			const float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				center[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.f * area;
+				normal[axis] += cross[axis];
+			}
+			totalArea += area;
+		}
+
+		const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (totalArea <= 0.f || normalLength <= 0.f)
+			continue;
+
+		float key{};
+		for (int axis = 0; axis < 3; ++axis)
+			key += (center[axis] / totalArea - meshCenter[axis]) * (normal[axis] / normalLength);
+		sortKeys[cluster] = key;
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t i = 0; i < clusterCount; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	size_t outputIndex{};
+	for (const size_t cluster : order)
+	{
+		const size_t count = (clusters[cluster + 1] - clusters[cluster]) * 3;
+		memcpy(pDestination + outputIndex, pIndices + clusters[cluster] * 3, count * sizeof(uint32_t));
+		outputIndex += count;
+	}
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void* pDestination, uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t nextVertex{};
+
+	char* pWrite = static_cast<char*>(pDestination);
+	const char* pRead = static_cast<const char*>(pVertices);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t& newIndex = remap[pIndices[i]];
+		if (newIndex == UINT32_MAX)
+		{
+			memcpy(pWrite + vertexSize * nextVertex, pRead + vertexSize * pIndices[i], vertexSize);
+			newIndex = nextVertex++;
+		}
+		pIndices[i] = newIndex;
+	}
+
+	return nextVertex;
+}
+
+void MeshOptimizer::LogStatistics(const std::string& name, const OptimizeStatistics& statistics)
+{
+	Logger::GetInstance()->LogDebug("MeshOptimizer: " + name + " ACMR " + std::to_string(statistics.before.acmr) + " -> " + std::to_string(statistics.after.acmr)
+		+ ", ATVR " + std::to_string(statistics.before.atvr) + " -> " + std::to_string(statistics.after.atvr));
+}
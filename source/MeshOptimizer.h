@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// CPU side index buffer analysis and optimization, does not need a device
+namespace MeshOptimizer
+{
+	constexpr uint32_t g_CacheSize{ 16 };
+	constexpr float g_OverdrawThreshold{ 1.05f };
+
+	struct VertexCacheStatistics
+	{
+		float acmr{}; // Average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+		float atvr{}; // Average transformed vertex ratio, transformed vertices per unique vertex (1.0 is optimal)
+	};
+
+	struct OptimizeStatistics
+	{
+		VertexCacheStatistics before{};
+		VertexCacheStatistics after{};
+	};
+
+	// Simulates a FIFO post transform cache of the given size
+	VertexCacheStatistics AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = g_CacheSize);
+
+	// Reorders triangles for post transform cache locality (Tipsify, Sander et al. 2007), runs in linear time.
+	// pDestination may not overlap pIndices.
+	void OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = g_CacheSize);
+
+	// Splits a cache optimized index buffer into clusters and draws the clusters facing away from the mesh center first,
+	// so they occlude the rest. threshold is how much worse the ACMR may get to allow smaller clusters (1.0 keeps it as is).
+	// Positions are read as 3 floats at the start of every vertex. pDestination may not overlap pIndices.
+	void OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize,
+		float threshold = g_OverdrawThreshold, uint32_t cacheSize = g_CacheSize);
+
+	// Orders the vertices by first use so the vertex fetch reads memory linearly and remaps the indices in place.
+	// Unused vertices are dropped, returns the amount of vertices written to pDestination.
+	size_t OptimizeVertexFetch(void* pDestination, uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize);
+
+	void LogStatistics(const std::string& name, const OptimizeStatistics& statistics);
+
+	// Runs vertex cache, overdraw and vertex fetch optimization on an indexed triangle list.
+	// The vertex type has to start with its position.
+	template<typename VertexType>
+	OptimizeStatistics OptimizeMesh(std::vector<VertexType>& vertices, std::vector<uint32_t>& indices, float overdrawThreshold = g_OverdrawThreshold)
+	{
+		OptimizeStatistics statistics{};
+		statistics.before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		if (indices.size() < 3 || vertices.empty())
+		{
+			statistics.after = statistics.before;
+			return statistics;
+		}
+
+		std::vector<uint32_t> cacheOptimized(indices.size());
+		OptimizeVertexCache(cacheOptimized.data(), indices.data(), indices.size(), vertices.size());
+		OptimizeOverdraw(indices.data(), cacheOptimized.data(), indices.size(), vertices.data(), vertices.size(), sizeof(VertexType), overdrawThreshold);
+
+		std::vector<VertexType> fetchOptimized(vertices.size());
+		fetchOptimized.resize(OptimizeVertexFetch(fetchOptimized.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(VertexType)));
+		vertices = std::move(fetchOptimized);
+
+		statistics.after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		return statistics;
+	}
+}
@@ -0,0 +1,409 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	enum class VertexKind : uint8_t
+	{
+		Manifold, // Inside the surface, can collapse onto any neighbour
+		Border,   // On an open edge, only collapses along the border
+		Locked    // UV seam or non manifold, never collapses
+	};
+
+	// Symmetric 4x4 error quadric, stored as the plane products it was built from
+	struct Quadric
+	{
+		double a2{}, b2{}, c2{}, ab{}, ac{}, bc{}, ad{}, bd{}, cd{}, d2{};
+		double weight{};
+
+		void AddPlane(double a, double b, double c, double d, double planeWeight)
+		{
+			a2 += a * a * planeWeight; b2 += b * b * planeWeight; c2 += c * c * planeWeight;
+			ab += a * b * planeWeight; ac += a * c * planeWeight; bc += b * c * planeWeight;
+			ad += a * d * planeWeight; bd += b * d * planeWeight; cd += c * d * planeWeight;
+			d2 += d * d * planeWeight;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a2 += other.a2; b2 += other.b2; c2 += other.c2;
+			ab += other.ab; ac += other.ac; bc += other.bc;
+			ad += other.ad; bd += other.bd; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		// Weighted average squared distance of the point to the planes
+		double Error(const float* p) const
+		{
+			const double x = p[0], y = p[1], z = p[2];
+			const double error = a2 * x * x + b2 * y * y + c2 * z * z
+				+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+				+ 2.0 * (ad * x + bd * y + cd * z) + d2;
+
+			return weight > 0.0 ? std::fabs(error) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from{};
+		uint32_t to{};
+		float error{};
+	};
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	inline Float3 Subtract(const float* a, const float* b)
+	{
+		return Float3{ a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+	}
+
+	inline Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return Float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	inline float Dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// Positions scaled to the unit cube so errors are relative to the mesh size
+	float NormalizePositions(std::vector<float>& positions, const void* pVertices, size_t vertexCount, size_t vertexSize)
+	{
+		positions.resize(vertexCount * 3);
+
+		float minimum[3]{ FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3]{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const float* pPosition = reinterpret_cast<const float*>(static_cast<const char*>(pVertices) + vertexSize * i);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				positions[i * 3 + axis] = pPosition[axis];
+				minimum[axis] = (std::min)(minimum[axis], pPosition[axis]);
+				maximum[axis] = (std::max)(maximum[axis], pPosition[axis]);
+			}
+		}
+
+		const float extent = (std::max)((std::max)(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+		const float scale = extent > 0.f ? 1.f / extent : 1.f;
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+				positions[i * 3 + axis] = (positions[i * 3 + axis] - minimum[axis]) * scale;
+		}
+
+		return extent;
+	}
+
+	// Maps every vertex to the first vertex with the same position, wedges of a UV seam share one position
+	void BuildPositionRemap(std::vector<uint32_t>& remap, std::vector<uint32_t>& wedgeCounts, const std::vector<float>& positions, size_t vertexCount)
+	{
+		struct PositionHash
+		{
+			const float* pPositions;
+			size_t operator()(uint32_t index) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, pPositions + index * 3, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			const float* pPositions;
+			bool operator()(uint32_t a, uint32_t b) const
+			{
+				return memcmp(pPositions + a * 3, pPositions + b * 3, sizeof(float) * 3) == 0;
+			}
+		};
+
+		std::unordered_map<uint32_t, uint32_t, PositionHash, PositionEqual> unique(vertexCount, PositionHash{ positions.data() }, PositionEqual{ positions.data() });
+
+		remap.resize(vertexCount);
+		wedgeCounts.assign(vertexCount, 0);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			remap[i] = unique.try_emplace(i, i).first->second;
+			++wedgeCounts[remap[i]];
+		}
+	}
+}
+
+float MeshSimplifier::GetMeshScale(const void* pVertices, size_t vertexCount, size_t vertexSize)
+{
+	std::vector<float> positions{};
+	return NormalizePositions(positions, pVertices, vertexCount, vertexSize);
+}
+
+size_t MeshSimplifier::Simplify(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize,
+	size_t targetIndexCount, float targetError, float* pResultError)
+{
+	indexCount = indexCount / 3 * 3;
+	memcpy(pDestination, pIndices, indexCount * sizeof(uint32_t));
+	if (pResultError)
+		*pResultError = 0.f;
+
+	if (indexCount == 0 || vertexCount == 0)
+		return indexCount;
+
+	std::vector<float> positions{};
+	NormalizePositions(positions, pVertices, vertexCount, vertexSize);
+
+	std::vector<uint32_t> positionRemap{};
+	std::vector<uint32_t> wedgeCounts{};
+	BuildPositionRemap(positionRemap, wedgeCounts, positions, vertexCount);
+
+	// Directed edges between positions, an edge without its opposite is an open border
+	std::vector<uint32_t> edgeOffsets(vertexCount + 1, 0);
+	std::vector<uint32_t> edgeTargets(indexCount);
+	auto buildEdges = [&]()
+	{
+		std::fill(edgeOffsets.begin(), edgeOffsets.end(), 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			++edgeOffsets[positionRemap[pDestination[i]] + 1];
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			edgeOffsets[vertex + 1] += edgeOffsets[vertex];
+
+		std::vector<uint32_t> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t from = positionRemap[pDestination[i]];
+			const uint32_t to = positionRemap[pDestination[i - i % 3 + (i + 1) % 3]];
+			edgeTargets[fill[from]++] = to;
+		}
+	};
+	auto hasEdge = [&](uint32_t from, uint32_t to)
+	{
+		for (uint32_t i = edgeOffsets[from]; i < edgeOffsets[from + 1]; ++i)
+		{
+			if (edgeTargets[i] == to)
+				return true;
+		}
+		return false;
+	};
+
+	// Plane quadrics of every triangle, border edges add a perpendicular plane so the outline stays in place
+	std::vector<Quadric> quadrics(vertexCount);
+	std::vector<VertexKind> kinds(vertexCount);
+	buildEdges();
+
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const uint32_t corners[3]{ positionRemap[pDestination[i]], positionRemap[pDestination[i + 1]], positionRemap[pDestination[i + 2]] };
+		const float* p0 = &positions[corners[0] * 3];
+		const float* p1 = &positions[corners[1] * 3];
+		const float* p2 = &positions[corners[2] * 3];
+
+		Float3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		const float length = std::sqrt(Dot(normal, normal));
+		if (length <= 0.f)
+			continue;
+
+		normal = Float3{ normal.x / length, normal.y / length, normal.z / length };
+		const float d = -(normal.x * p0[0] + normal.y * p0[1] + normal.z * p0[2]);
+		const float area = length * 0.5f;
+		for (uint32_t corner : corners)
+			quadrics[corner].AddPlane(normal.x, normal.y, normal.z, d, area);
+
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const uint32_t from = corners[edge];
+			const uint32_t to = corners[(edge + 1) % 3];
+			if (hasEdge(to, from))
+				continue;
+
+			const Float3 direction = Subtract(&positions[to * 3], &positions[from * 3]);
+			Float3 borderNormal = Cross(direction, normal);
+			const float borderLength = std::sqrt(Dot(borderNormal, borderNormal));
+			if (borderLength <= 0.f)
+				continue;
+
+			borderNormal = Float3{ borderNormal.x / borderLength, borderNormal.y / borderLength, borderNormal.z / borderLength };
+			const float borderD = -(borderNormal.x * positions[from * 3] + borderNormal.y * positions[from * 3 + 1] + borderNormal.z * positions[from * 3 + 2]);
+			const float borderWeight = Dot(direction, direction) * 10.f;
+			quadrics[from].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, borderWeight);
+			quadrics[to].AddPlane(borderNormal.x, borderNormal.y, borderNormal.z, borderD, borderWeight);
+		}
+	}
+
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<Collapse> collapses{};
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> triangles(indexCount);
+	float resultError{};
+
+	while (indexCount > targetIndexCount)
+	{
+		buildEdges();
+
+		// Classify the positions, seams and anything that is not a simple surface are kept
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			if (positionRemap[vertex] != vertex)
+				continue;
+
+			VertexKind kind = wedgeCounts[vertex] > 1 ? VertexKind::Locked : VertexKind::Manifold;
+			uint32_t borderEdges{};
+			for (uint32_t i = edgeOffsets[vertex]; i < edgeOffsets[vertex + 1]; ++i)
+			{
+				if (!hasEdge(edgeTargets[i], static_cast<uint32_t>(vertex)))
+					++borderEdges;
+			}
+
+			if (kind == VertexKind::Manifold && borderEdges > 0)
+				kind = borderEdges == 1 ? VertexKind::Border : VertexKind::Locked;
+			kinds[vertex] = kind;
+		}
+
+		// Triangles around every position, used to reject collapses that flip a triangle
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			++triangleOffsets[positionRemap[pDestination[i]] + 1];
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < indexCount; ++i)
+				triangles[fill[positionRemap[pDestination[i]]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		// Cheapest direction of every edge that may collapse
+		collapses.clear();
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t from = pDestination[i];
+			const uint32_t to = pDestination[i - i % 3 + (i + 1) % 3];
+			const uint32_t fromPosition = positionRemap[from];
+			const uint32_t toPosition = positionRemap[to];
+			if (fromPosition == toPosition)
+				continue;
+
+			const bool isBorderEdge = !hasEdge(toPosition, fromPosition);
+			auto canCollapse = [&](uint32_t source, uint32_t target)
+			{
+				switch (kinds[source])
+				{
+				case VertexKind::Manifold:
+					return true;
+				case VertexKind::Border:
+					return isBorderEdge && kinds[target] != VertexKind::Manifold;
+				default:
+					return false;
+				}
+			};
+
+			Quadric quadric = quadrics[fromPosition];
+			quadric.Add(quadrics[toPosition]);
+
+			Collapse best{ 0, 0, FLT_MAX };
+			if (canCollapse(fromPosition, toPosition))
+				best = Collapse{ from, to, static_cast<float>(quadric.Error(&positions[toPosition * 3])) };
+			if (canCollapse(toPosition, fromPosition))
+			{
+				const float error = static_cast<float>(quadric.Error(&positions[fromPosition * 3]));
+				if (error < best.error)
+					best = Collapse{ to, from, error };
+			}
+
+			if (best.error < FLT_MAX)
+				collapses.push_back(best);
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+			collapseRemap[vertex] = vertex;
+		std::fill(touched.begin(), touched.end(), uint8_t(0));
+
+		// Collapses of one pass may not share a neighbourhood, otherwise the flip test would be wrong
+		const size_t trianglesToRemove = (indexCount - targetIndexCount) / 3;
+		size_t removedTriangles{};
+		size_t collapseCount{};
+		for (const Collapse& collapse : collapses)
+		{
+			if (std::sqrt(collapse.error) > targetError || removedTriangles >= trianglesToRemove)
+				break;
+
+			const uint32_t fromPosition = positionRemap[collapse.from];
+			const uint32_t toPosition = positionRemap[collapse.to];
+			if (touched[fromPosition] || touched[toPosition])
+				continue;
+
+			bool flips = false;
+			size_t removed{};
+			for (uint32_t i = triangleOffsets[fromPosition]; i < triangleOffsets[fromPosition + 1] && !flips; ++i)
+			{
+				const uint32_t* pTriangle = pDestination + triangles[i] * 3;
+				const uint32_t corners[3]{ positionRemap[pTriangle[0]], positionRemap[pTriangle[1]], positionRemap[pTriangle[2]] };
+				if (corners[0] == toPosition || corners[1] == toPosition || corners[2] == toPosition)
+				{
+					++removed;
+					continue;
+				}
+
+				const float* p0 = &positions[corners[0] * 3];
+				const float* p1 = &positions[corners[1] * 3];
+				const float* p2 = &positions[corners[2] * 3];
+				const Float3 before = Cross(Subtract(p1, p0), Subtract(p2, p0));
+
+				const float* q0 = corners[0] == fromPosition ? &positions[toPosition * 3] : p0;
+				const float* q1 = corners[1] == fromPosition ? &positions[toPosition * 3] : p1;
+				const float* q2 = corners[2] == fromPosition ? &positions[toPosition * 3] : p2;
+				const Float3 after = Cross(Subtract(q1, q0), Subtract(q2, q0));
+
+				flips = Dot(before, after) <= 0.f;
+			}
+			if (flips)
+				continue;
+
+			for (uint32_t i = triangleOffsets[fromPosition]; i < triangleOffsets[fromPosition + 1]; ++i)
+			{
+				const uint32_t* pTriangle = pDestination + triangles[i] * 3;
+				for (int corner = 0; corner < 3; ++corner)
+					touched[positionRemap[pTriangle[corner]]] = 1;
+			}
+
+			collapseRemap[collapse.from] = collapse.to;
+			quadrics[toPosition].Add(quadrics[fromPosition]);
+			resultError = (std::max)(resultError, std::sqrt(collapse.error));
+			removedTriangles += removed;
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t writeIndex{};
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const uint32_t a = collapseRemap[pDestination[i]];
+			const uint32_t b = collapseRemap[pDestination[i + 1]];
+			const uint32_t c = collapseRemap[pDestination[i + 2]];
+			if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[a] == positionRemap[c])
+				continue;
+
+			pDestination[writeIndex++] = a;
+			pDestination[writeIndex++] = b;
+			pDestination[writeIndex++] = c;
+		}
+		indexCount = writeIndex;
+	}
+
+	if (pResultError)
+		*pResultError = resultError;
+	return indexCount;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+// Quadric error metric simplification (Garland and Heckbert 1997) used to build LOD chains, CPU only
+namespace MeshSimplifier
+{
+	constexpr uint32_t g_MaxLods{ 4 };
+	constexpr float g_MaxLodError{ 0.05f };
+
+	// Range of one level of detail inside the index buffer, error is in object space units
+	struct Lod
+	{
+		uint32_t indexOffset{};
+		uint32_t indexCount{};
+		float error{};
+	};
+
+	// Collapses the edges with the lowest quadric error until the index count drops to targetIndexCount
+	// or the next collapse would be further than targetError away from the surface (relative to the mesh size).
+	// Vertices are never moved so the result indexes the same vertex buffer. Open borders only collapse along
+	// themselves and vertices on a UV seam are kept. Returns the new index count, pResultError receives the error.
+	size_t Simplify(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize,
+		size_t targetIndexCount, float targetError, float* pResultError = nullptr);
+
+	// Largest extent of the mesh, converts the relative errors of Simplify into object space
+	float GetMeshScale(const void* pVertices, size_t vertexCount, size_t vertexSize);
+
+	// Appends simplified levels to the index buffer, each with about half the triangles of the previous one.
+	// The first lod is the index buffer as it is. Stops early when a level can not be reduced any further.
+	template<typename VertexType>
+	std::vector<Lod> GenerateLods(const std::vector<VertexType>& vertices, std::vector<uint32_t>& indices, uint32_t lodCount = g_MaxLods, float maxError = g_MaxLodError)
+	{
+		std::vector<Lod> lods{ Lod{ 0, static_cast<uint32_t>(indices.size()), 0.f } };
+		if (indices.empty() || vertices.empty())
+			return lods;
+
+		const float scale = GetMeshScale(vertices.data(), vertices.size(), sizeof(VertexType));
+		std::vector<uint32_t> simplified(indices.size());
+		float relativeError{};
+
+		while (lods.size() < lodCount)
+		{
+			const Lod previous = lods.back();
+			const size_t target = (previous.indexCount / 2) / 3 * 3;
+
+			float error{};
+			const size_t count = Simplify(simplified.data(), indices.data() + previous.indexOffset, previous.indexCount,
+				vertices.data(), vertices.size(), sizeof(VertexType), target, maxError - relativeError, &error);
+
+			// Not worth an extra draw range when less than 10% is gone
+			if (count == 0 || count > previous.indexCount * 9 / 10)
+				break;
+
+			// Every level is simplified from the previous one, so the errors add up
+			relativeError += error;
+
+			Lod lod{};
+			lod.indexOffset = static_cast<uint32_t>(indices.size());
+			lod.indexCount = static_cast<uint32_t>(count);
+			lod.error = relativeError * scale;
+
+			indices.resize(indices.size() + count);
+			MeshOptimizer::OptimizeVertexCache(indices.data() + lod.indexOffset, simplified.data(), count, vertices.size());
+			lods.push_back(lod);
+		}
+
+		return lods;
+	}
+}
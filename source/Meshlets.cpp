@@ -0,0 +1,302 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	inline DirectX::XMFLOAT3 GetPosition(const void* pVertices, size_t vertexSize, uint32_t index)
+	{
+		DirectX::XMFLOAT3 position{};
+		memcpy(&position, static_cast<const char*>(pVertices) + vertexSize * index, sizeof(position));
+		return position;
+	}
+
+	struct PositionHash
+	{
+		size_t operator()(const DirectX::XMFLOAT3& position) const
+		{
+			uint32_t bits[3]{};
+			memcpy(bits, &position, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	};
+
+	// First vertex with the same position, uv and normal seams split vertices but the triangles are still neighbours
+	std::vector<uint32_t> WeldPositions(const void* pVertices, size_t vertexCount, size_t vertexSize)
+	{
+		std::vector<uint32_t> remap(vertexCount);
+		std::unordered_map<DirectX::XMFLOAT3, uint32_t, PositionHash, PositionEqual> first{};
+		first.reserve(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			remap[vertex] = first.try_emplace(GetPosition(pVertices, vertexSize, static_cast<uint32_t>(vertex)), static_cast<uint32_t>(vertex)).first->second;
+		return remap;
+	}
+
+	// Triangles that use each welded vertex, one flat array with an offset per vertex
+	void BuildAdjacency(std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles, const uint32_t* pIndices, size_t indexCount,
+		const std::vector<uint32_t>& remap)
+	{
+		offsets.assign(remap.size() + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			++offsets[remap[pIndices[i]] + 1];
+		for (size_t vertex = 0; vertex < remap.size(); ++vertex)
+			offsets[vertex + 1] += offsets[vertex];
+
+		triangles.resize(indexCount);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			triangles[fill[remap[pIndices[i]]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	void ComputeBounds(Meshlets::Meshlet& meshlet, const uint32_t* pIndices, const void* pVertices, size_t vertexSize)
+	{
+		using namespace DirectX;
+
+		const uint32_t* pMeshletIndices = pIndices + meshlet.indexOffset;
+
+		// Sphere around the center of the box, then grown to fit every corner
+		const XMFLOAT3 first = GetPosition(pVertices, vertexSize, pMeshletIndices[0]);
+		XMVECTOR minimum = XMLoadFloat3(&first);
+		XMVECTOR maximum = minimum;
+		for (uint32_t i = 1; i < meshlet.indexCount; ++i)
+		{
+			const XMFLOAT3 position = GetPosition(pVertices, vertexSize, pMeshletIndices[i]);
+			minimum = XMVectorMin(minimum, XMLoadFloat3(&position));
+			maximum = XMVectorMax(maximum, XMLoadFloat3(&position));
+		}
+
+		const XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+		float radiusSquared{};
+		for (uint32_t i = 0; i < meshlet.indexCount; ++i)
+		{
+			const XMFLOAT3 position = GetPosition(pVertices, vertexSize, pMeshletIndices[i]);
+			radiusSquared = (std::max)(radiusSquared, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&position), center))));
+		}
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = std::sqrt(radiusSquared);
+
+		// Normal cone: the average face normal and the widest angle any face makes with it
+		std::vector<XMVECTOR> normals{};
+		normals.reserve(meshlet.indexCount / 3);
+		XMVECTOR sum = XMVectorZero();
+		for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3)
+		{
+			const XMFLOAT3 p0 = GetPosition(pVertices, vertexSize, pMeshletIndices[i]);
+			const XMFLOAT3 p1 = GetPosition(pVertices, vertexSize, pMeshletIndices[i + 1]);
+			const XMFLOAT3 p2 = GetPosition(pVertices, vertexSize, pMeshletIndices[i + 2]);
+
+			// Front faces are clockwise, this normal points to the side they are seen from
+			const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), XMLoadFloat3(&p0)), XMVectorSubtract(XMLoadFloat3(&p2), XMLoadFloat3(&p0)));
+			if (XMVectorGetX(XMVector3LengthSq(normal)) <= 0.f)
+				continue;
+
+			normals.push_back(XMVector3Normalize(normal));
+			sum = XMVectorAdd(sum, normals.back());
+		}
+
+		meshlet.coneAxis = XMFLOAT3{ 0.f, 0.f, 0.f };
+		meshlet.coneCutoff = 1.f;
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(sum)) <= 0.f)
+			return;
+
+		const XMVECTOR axis = XMVector3Normalize(sum);
+		float minimumDot{ 1.f };
+		for (const XMVECTOR& normal : normals)
+			minimumDot = (std::min)(minimumDot, XMVectorGetX(XMVector3Dot(axis, normal)));
+
+		// A cone of 90 degrees or wider always has a face towards the camera
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		if (minimumDot > 0.f)
+			meshlet.coneCutoff = std::sqrt(1.f - minimumDot * minimumDot);
+	}
+}
+
+std::vector<Meshlets::Meshlet> Meshlets::Build(uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	std::vector<Meshlet> meshlets{};
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0)
+		return meshlets;
+
+	const std::vector<uint32_t> remap = WeldPositions(pVertices, vertexCount, vertexSize);
+	std::vector<uint32_t> adjacencyOffsets{};
+	std::vector<uint32_t> adjacentTriangles{};
+	BuildAdjacency(adjacencyOffsets, adjacentTriangles, pIndices, triangleCount * 3, remap);
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	// Meshlet the vertex was last added to, plus one so zero means none
+	std::vector<uint32_t> vertexMeshlet(vertexCount, 0);
+	std::vector<uint32_t> vertices{};
+	vertices.reserve(maxVertices);
+
+	std::vector<uint32_t> ordered{};
+	ordered.reserve(triangleCount * 3);
+
+	auto newVertexCount = [&](uint32_t triangle)
+	{
+		const uint32_t stamp = static_cast<uint32_t>(meshlets.size()) + 1;
+		uint32_t count{};
+		for (size_t corner = 0; corner < 3; ++corner)
+			count += vertexMeshlet[pIndices[triangle * 3 + corner]] != stamp ? 1 : 0;
+		return count;
+	};
+
+	Meshlet meshlet{};
+	auto emit = [&](uint32_t triangle)
+	{
+		const uint32_t stamp = static_cast<uint32_t>(meshlets.size()) + 1;
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t index = pIndices[triangle * 3 + corner];
+			if (vertexMeshlet[index] != stamp)
+			{
+				vertexMeshlet[index] = stamp;
+				vertices.push_back(index);
+			}
+			ordered.push_back(index);
+		}
+		emitted[triangle] = 1;
+		meshlet.indexCount += 3;
+	};
+
+	// The input is cache optimized, so the next unused triangle in order is a good seed for the next meshlet
+	size_t seed{};
+	while (true)
+	{
+		while (seed < triangleCount && emitted[seed])
+			++seed;
+		if (seed == triangleCount)
+			break;
+
+		meshlet = Meshlet{};
+		meshlet.indexOffset = static_cast<uint32_t>(ordered.size());
+		vertices.clear();
+		emit(static_cast<uint32_t>(seed));
+
+		// Grow along shared vertices, preferring triangles that add the fewest new vertices
+		while (meshlet.indexCount / 3 < maxTriangles)
+		{
+			uint32_t best{ UINT32_MAX };
+			uint32_t bestNewVertices{ UINT32_MAX };
+			for (const uint32_t vertex : vertices)
+			{
+				const uint32_t welded = remap[vertex];
+				for (uint32_t i = adjacencyOffsets[welded]; i < adjacencyOffsets[welded + 1]; ++i)
+				{
+					const uint32_t triangle = adjacentTriangles[i];
+					if (emitted[triangle])
+						continue;
+
+					const uint32_t added = newVertexCount(triangle);
+					if (vertices.size() + added <= maxVertices && added < bestNewVertices)
+					{
+						best = triangle;
+						bestNewVertices = added;
+					}
+				}
+
+				if (bestNewVertices == 0)
+					break;
+			}
+
+			if (best == UINT32_MAX)
+				break;
+			emit(best);
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	memcpy(pIndices, ordered.data(), ordered.size() * sizeof(uint32_t));
+	for (Meshlet& cluster : meshlets)
+		ComputeBounds(cluster, pIndices, pVertices, vertexSize);
+
+	return meshlets;
+}
+
+Meshlets::Frustum Meshlets::GetFrustum(const DirectX::XMFLOAT4X4& viewProjection)
+{
+	// Gribb and Hartmann, row vectors so the planes are built from the columns
+	const auto& m = viewProjection.m;
+	auto column = [&](int index) { return DirectX::XMVectorSet(m[0][index], m[1][index], m[2][index], m[3][index]); };
+
+	const DirectX::XMVECTOR x = column(0);
+	const DirectX::XMVECTOR y = column(1);
+	const DirectX::XMVECTOR z = column(2);
+	const DirectX::XMVECTOR w = column(3);
+
+	const DirectX::XMVECTOR planes[6]
+	{
+		DirectX::XMVectorAdd(w, x),
+		DirectX::XMVectorSubtract(w, x),
+		DirectX::XMVectorAdd(w, y),
+		DirectX::XMVectorSubtract(w, y),
+		z,	// D3D clip space depth starts at 0
+		DirectX::XMVectorSubtract(w, z)
+	};
+
+	Frustum frustum{};
+	for (int i = 0; i < 6; ++i)
+	{
+		// Normalized so the distance can be compared with a radius
+		const float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(planes[i]));
+		DirectX::XMStoreFloat4(&frustum.planes[i], length > 0.f ? DirectX::XMVectorScale(planes[i], 1.f / length) : planes[i]);
+	}
+	return frustum;
+}
+
+Meshlets::CullStatistics Meshlets::Cull(const Meshlet* pMeshlets, size_t meshletCount, const Frustum& frustum, const DirectX::XMFLOAT3& viewPosition,
+	bool cullBackFaces, std::vector<DrawRange>& ranges)
+{
+	CullStatistics statistics{};
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		const Meshlet& meshlet = pMeshlets[i];
+		const DirectX::XMFLOAT3& center = meshlet.center;
+
+		bool inside{ true };
+		for (const DirectX::XMFLOAT4& plane : frustum.planes)
+		{
+			if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -meshlet.radius)
+			{
+				inside = false;
+				break;
+			}
+		}
+		if (!inside)
+		{
+			++statistics.outsideFrustum;
+			continue;
+		}
+
+		// Every face points away when the view direction is inside the cone, widened by the sphere
+		if (cullBackFaces && meshlet.coneCutoff < 1.f)
+		{
+			const DirectX::XMFLOAT3 toCenter{ center.x - viewPosition.x, center.y - viewPosition.y, center.z - viewPosition.z };
+			const float distance = std::sqrt(toCenter.x * toCenter.x + toCenter.y * toCenter.y + toCenter.z * toCenter.z);
+			const float alongAxis = toCenter.x * meshlet.coneAxis.x + toCenter.y * meshlet.coneAxis.y + toCenter.z * meshlet.coneAxis.z;
+			if (alongAxis >= meshlet.coneCutoff * distance + meshlet.radius)
+			{
+				++statistics.backFacing;
+				continue;
+			}
+		}
+
+		++statistics.visible;
+		if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset)
+			ranges.back().indexCount += meshlet.indexCount;
+		else
+			ranges.push_back(DrawRange{ meshlet.indexOffset, meshlet.indexCount });
+	}
+
+	return statistics;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+
+// Splits an index buffer into small clusters that can be culled on the CPU one by one
+namespace Meshlets
+{
+	constexpr uint32_t g_MaxVertices{ 64 };
+	constexpr uint32_t g_MaxTriangles{ 124 };
+	// Smaller meshes are drawn in one go, culling them per cluster costs more than it saves
+	constexpr uint32_t g_MinTriangles{ 8 * g_MaxTriangles };
+
+	// One cluster, a contiguous range in the index buffer. Bounds and cone are in object space.
+	struct Meshlet
+	{
+		uint32_t indexOffset{};
+		uint32_t indexCount{};
+		DirectX::XMFLOAT3 center{};
+		float radius{};
+		DirectX::XMFLOAT3 coneAxis{};
+		float coneCutoff{ 1.f }; // Sine of the cone angle, 1 when the triangles face too many ways to cull
+	};
+
+	struct DrawRange
+	{
+		uint32_t indexOffset{};
+		uint32_t indexCount{};
+	};
+
+	// Object space planes, a point is inside when dot(plane.xyz, point) + plane.w >= 0 for all of them
+	struct Frustum
+	{
+		DirectX::XMFLOAT4 planes[6]{};
+	};
+
+	struct CullStatistics
+	{
+		uint32_t visible{};
+		uint32_t outsideFrustum{};
+		uint32_t backFacing{};
+	};
+
+	// Groups neighbouring triangles into meshlets of at most maxVertices unique vertices and maxTriangles triangles
+	// and reorders the indices in place so every meshlet is one range. Offsets are relative to pIndices.
+	// Positions are read as 3 floats at the start of every vertex.
+	std::vector<Meshlet> Build(uint32_t* pIndices, size_t indexCount, const void* pVertices, size_t vertexCount, size_t vertexSize,
+		uint32_t maxVertices = g_MaxVertices, uint32_t maxTriangles = g_MaxTriangles);
+
+	// Planes of a (world) view projection matrix, D3D clip space
+	Frustum GetFrustum(const DirectX::XMFLOAT4X4& viewProjection);
+
+	// Appends the ranges of the meshlets that are inside the frustum and not facing away from viewPosition,
+	// neighbouring ranges are merged so every range is one draw. Back face culling only holds for materials that cull them.
+	CullStatistics Cull(const Meshlet* pMeshlets, size_t meshletCount, const Frustum& frustum, const DirectX::XMFLOAT3& viewPosition,
+		bool cullBackFaces, std::vector<DrawRange>& ranges);
+}
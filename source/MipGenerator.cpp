@@ -0,0 +1,511 @@
+#include "MipGenerator.h"
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE
+#endif
+
+namespace
+{
+	// The Kaiser kernel reaches this many texels of the smaller level to both sides
+	constexpr float g_KaiserRadius{ 2.f };
+	constexpr float g_KaiserAlpha{ 4.f };
+	constexpr float g_Pi{ 3.14159265358979f };
+	// Rows of the smaller level one job filters, levels with fewer rows stay on the calling thread
+	constexpr uint32_t g_RowsPerJob{ 16 };
+
+	// A level while the chain is built, the next level is filtered from this and not from the rounded pixels
+	struct FloatImage
+	{
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t channels{};
+		std::vector<float> data{};
+
+		size_t GetRowSize() const { return size_t(width) * channels; }
+		float* GetRow(uint32_t y) { return data.data() + y * GetRowSize(); }
+		const float* GetRow(uint32_t y) const { return data.data() + y * GetRowSize(); }
+	};
+
+	// The source texels every texel of the smaller level is made of along one axis. Every texel has the same
+	// amount of taps, the ones that are not needed have a weight of 0.
+	struct Kernel
+	{
+		uint32_t taps{};
+		std::vector<uint32_t> indices{};
+		std::vector<float> weights{};
+	};
+
+	constexpr uint32_t g_SrgbBuckets{ 4096 };
+
+	struct SrgbTables
+	{
+		float toLinear[256]{};
+		// The linear value halfway between every two sRGB values, [0] is below everything
+		float thresholds[256]{};
+		// The sRGB value at the start of every equal slice of [0, 1], the search starts there
+		uint8_t bucketStart[g_SrgbBuckets + 1]{};
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				toLinear[i] = ToLinear(i / 255.f);
+				thresholds[i] = i == 0 ? -FLT_MAX : ToLinear((i - 0.5f) / 255.f);
+			}
+
+			uint8_t value{};
+			for (uint32_t i = 0; i <= g_SrgbBuckets; ++i)
+			{
+				while (value < 255 && thresholds[value + 1] <= static_cast<float>(i) / g_SrgbBuckets)
+					++value;
+				bucketStart[i] = value;
+			}
+		}
+
+		static float ToLinear(float value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+	};
+	const SrgbTables g_Srgb{};
+
+	// The closest sRGB value. A slice holds at most a few sRGB values, even in the dark end where they are closest.
+	inline uint8_t ToSrgb(float value)
+	{
+		if (!(value > 0.f))
+			return 0;
+		if (value >= 1.f)
+			return 255;
+
+		uint32_t index = g_Srgb.bucketStart[static_cast<uint32_t>(value * g_SrgbBuckets)];
+		while (index < 255 && g_Srgb.thresholds[index + 1] <= value)
+			++index;
+		return static_cast<uint8_t>(index);
+	}
+
+	inline uint32_t ToUnorm(float value, float scale)
+	{
+		return static_cast<uint32_t>(std::clamp(value, 0.f, 1.f) * scale + 0.5f);
+	}
+
+	float BesselI0(float x)
+	{
+		float sum{ 1.f };
+		float term{ 1.f };
+		const float halfX = x * 0.5f;
+		for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float KaiserWeight(float x)
+	{
+		if (std::abs(x) >= g_KaiserRadius)
+			return 0.f;
+
+		const float sinc = x == 0.f ? 1.f : std::sin(g_Pi * x) / (g_Pi * x);
+		const float t = x / g_KaiserRadius;
+		return sinc * BesselI0(g_KaiserAlpha * std::sqrt(1.f - t * t)) / BesselI0(g_KaiserAlpha);
+	}
+
+	Kernel BuildKernel(uint32_t srcSize, uint32_t dstSize, MipGenerator::Filter filter)
+	{
+		const float scale = static_cast<float>(srcSize) / dstSize;
+		std::vector<std::vector<std::pair<uint32_t, float>>> texels(dstSize);
+		Kernel kernel{};
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			auto& taps = texels[i];
+			if (srcSize == dstSize)
+				taps.emplace_back(i, 1.f);
+			else if (filter == MipGenerator::Filter::Box)
+			{
+				// How much of every source texel the destination texel covers, an odd size makes that 3 texels
+				const float low = i * scale;
+				const float high = (i + 1) * scale;
+				// Rounding can put the end of the last texel just past the source, that sliver is not a texel
+				const int end = (std::min)(static_cast<int>(std::ceil(high)), static_cast<int>(srcSize));
+				for (int j = static_cast<int>(low); j < end; ++j)
+				{
+					const float weight = (std::min)(high, j + 1.f) - (std::max)(low, static_cast<float>(j));
+					if (weight > 1e-6f)
+						taps.emplace_back(static_cast<uint32_t>(j), weight);
+				}
+			}
+			else
+			{
+				// The edges are clamped, texels past them repeat the border texel
+				const float center = (i + 0.5f) * scale;
+				const float radius = g_KaiserRadius * scale;
+				for (int j = static_cast<int>(std::floor(center - radius)); j <= static_cast<int>(std::ceil(center + radius)); ++j)
+				{
+					const float weight = KaiserWeight((j + 0.5f - center) / scale);
+					if (weight != 0.f)
+						taps.emplace_back(static_cast<uint32_t>(std::clamp(j, 0, static_cast<int>(srcSize) - 1)), weight);
+				}
+			}
+
+			float total{};
+			for (const auto& tap : taps)
+				total += tap.second;
+			for (auto& tap : taps)
+				tap.second /= total;
+			kernel.taps = (std::max)(kernel.taps, static_cast<uint32_t>(taps.size()));
+		}
+
+		kernel.indices.resize(size_t(dstSize) * kernel.taps);
+		kernel.weights.resize(size_t(dstSize) * kernel.taps);
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			for (uint32_t t = 0; t < kernel.taps; ++t)
+			{
+				const bool used = t < texels[i].size();
+				kernel.indices[i * kernel.taps + t] = used ? texels[i][t].first : texels[i][0].first;
+				kernel.weights[i * kernel.taps + t] = used ? texels[i][t].second : 0.f;
+			}
+		}
+		return kernel;
+	}
+
+	void ToFloatRow(const Image& image, uint32_t y, bool srgb, float* pDst)
+	{
+		const uint8_t* pSrc = image.pixels.data() + y * image.GetRowPitch();
+		switch (image.format)
+		{
+		case ImageFormat::RGBA8:
+			for (uint32_t x = 0; x < image.width; ++x, pSrc += 4, pDst += 4)
+			{
+				for (int c = 0; c < 3; ++c)
+					pDst[c] = srgb ? g_Srgb.toLinear[pSrc[c]] : pSrc[c] / 255.f;
+				pDst[3] = pSrc[3] / 255.f;
+			}
+			break;
+		case ImageFormat::R8:
+			for (uint32_t x = 0; x < image.width; ++x)
+				pDst[x] = pSrc[x] / 255.f;
+			break;
+		case ImageFormat::R16:
+			for (uint32_t x = 0; x < image.width; ++x)
+				pDst[x] = (pSrc[x * 2] | (pSrc[x * 2 + 1] << 8)) / 65535.f;
+			break;
+		}
+	}
+
+	void ToImageRow(const float* pSrc, uint32_t y, bool srgb, bool simd, Image& image)
+	{
+		uint8_t* pDst = image.pixels.data() + y * image.GetRowPitch();
+		switch (image.format)
+		{
+		case ImageFormat::RGBA8:
+			if (srgb)
+			{
+				for (uint32_t x = 0; x < image.width; ++x, pSrc += 4, pDst += 4)
+				{
+					for (int c = 0; c < 3; ++c)
+						pDst[c] = ToSrgb(pSrc[c]);
+					pDst[3] = static_cast<uint8_t>(ToUnorm(pSrc[3], 255.f));
+				}
+				break;
+			}
+#ifdef MIP_GENERATOR_SSE
+			if (simd)
+			{
+				// One texel per register, the same clamp, scale and round as ToUnorm
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 one = _mm_set1_ps(1.f);
+				const __m128 scale = _mm_set1_ps(255.f);
+				const __m128 half = _mm_set1_ps(0.5f);
+				for (uint32_t x = 0; x < image.width; ++x, pSrc += 4, pDst += 4)
+				{
+					const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc), zero), one), scale), half);
+					const __m128i integer = _mm_cvttps_epi32(value);
+					const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(integer, integer), integer);
+					const int texel = _mm_cvtsi128_si32(packed);
+					memcpy(pDst, &texel, 4);
+				}
+				break;
+			}
+#endif
+			for (uint32_t x = 0; x < image.width * 4; ++x)
+				pDst[x] = static_cast<uint8_t>(ToUnorm(pSrc[x], 255.f));
+			break;
+		case ImageFormat::R8:
+			for (uint32_t x = 0; x < image.width; ++x)
+				pDst[x] = static_cast<uint8_t>(ToUnorm(pSrc[x], 255.f));
+			break;
+		case ImageFormat::R16:
+			for (uint32_t x = 0; x < image.width; ++x)
+			{
+				const uint32_t value = ToUnorm(pSrc[x], 65535.f);
+				pDst[x * 2] = static_cast<uint8_t>(value);
+				pDst[x * 2 + 1] = static_cast<uint8_t>(value >> 8);
+			}
+			break;
+		}
+	}
+
+	// One row of the smaller level, first down the columns into pTemp and then along the row
+	void FilterRow(const FloatImage& src, FloatImage& dst, const Kernel& vertical, const Kernel& horizontal, uint32_t y, float* pTemp, bool simd)
+	{
+		const size_t rowSize = src.GetRowSize();
+		const uint32_t* pRows = vertical.indices.data() + y * vertical.taps;
+		const float* pRowWeights = vertical.weights.data() + y * vertical.taps;
+
+		size_t i{};
+#ifdef MIP_GENERATOR_SSE
+		if (simd)
+		{
+			for (; i + 4 <= rowSize; i += 4)
+			{
+				__m128 sum = _mm_mul_ps(_mm_set1_ps(pRowWeights[0]), _mm_loadu_ps(src.GetRow(pRows[0]) + i));
+				for (uint32_t t = 1; t < vertical.taps; ++t)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pRowWeights[t]), _mm_loadu_ps(src.GetRow(pRows[t]) + i)));
+				_mm_storeu_ps(pTemp + i, sum);
+			}
+		}
+#endif
+		for (; i < rowSize; ++i)
+		{
+			float sum = pRowWeights[0] * src.GetRow(pRows[0])[i];
+			for (uint32_t t = 1; t < vertical.taps; ++t)
+				sum += pRowWeights[t] * src.GetRow(pRows[t])[i];
+			pTemp[i] = sum;
+		}
+
+		float* pDst = dst.GetRow(y);
+		const uint32_t channels = src.channels;
+#ifdef MIP_GENERATOR_SSE
+		if (simd && channels == 4)
+		{
+			for (uint32_t x = 0; x < dst.width; ++x)
+			{
+				const uint32_t* pColumns = horizontal.indices.data() + x * horizontal.taps;
+				const float* pWeights = horizontal.weights.data() + x * horizontal.taps;
+				__m128 sum = _mm_mul_ps(_mm_set1_ps(pWeights[0]), _mm_loadu_ps(pTemp + pColumns[0] * 4));
+				for (uint32_t t = 1; t < horizontal.taps; ++t)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(pTemp + pColumns[t] * 4)));
+				_mm_storeu_ps(pDst + x * 4, sum);
+			}
+			return;
+		}
+#endif
+		for (uint32_t x = 0; x < dst.width; ++x)
+		{
+			const uint32_t* pColumns = horizontal.indices.data() + x * horizontal.taps;
+			const float* pWeights = horizontal.weights.data() + x * horizontal.taps;
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				float sum = pWeights[0] * pTemp[pColumns[0] * channels + c];
+				for (uint32_t t = 1; t < horizontal.taps; ++t)
+					sum += pWeights[t] * pTemp[pColumns[t] * channels + c];
+				pDst[x * channels + c] = sum;
+			}
+		}
+	}
+
+	// Runs job for every band of rows, on the job threads when fast is set and there is more than one band
+	void ForEachBand(uint32_t height, bool fast, const std::function<void(uint32_t, uint32_t)>& job)
+	{
+		const uint32_t bandCount = (height + g_RowsPerJob - 1) / g_RowsPerJob;
+		auto band = [height, &job](size_t index)
+		{
+			const uint32_t first = static_cast<uint32_t>(index) * g_RowsPerJob;
+			job(first, (std::min)(first + g_RowsPerJob, height));
+		};
+
+		if (fast && bandCount > 1)
+			JobSystem::GetInstance()->ParallelFor(bandCount, band);
+		else
+		{
+			for (uint32_t i = 0; i < bandCount; ++i)
+				band(i);
+		}
+	}
+
+	void Generate(std::vector<Image>& levels, const MipGenerator::Settings& settings, bool fast)
+	{
+		if (levels.empty() || !levels[0].IsValid())
+			return;
+
+		levels.resize(1);
+		const uint32_t mipCount = MipGenerator::GetMipCount(levels[0].width, levels[0].height);
+		levels.reserve(mipCount);
+
+		const ImageFormat format = levels[0].format;
+		const bool srgb = settings.srgb && format == ImageFormat::RGBA8;
+
+		FloatImage current{};
+		current.width = levels[0].width;
+		current.height = levels[0].height;
+		current.channels = format == ImageFormat::RGBA8 ? 4 : 1;
+		current.data.resize(current.GetRowSize() * current.height);
+		ForEachBand(current.height, fast, [&current, &levels, srgb](uint32_t first, uint32_t last)
+		{
+			for (uint32_t y = first; y < last; ++y)
+				ToFloatRow(levels[0], y, srgb, current.GetRow(y));
+		});
+
+		FloatImage next{};
+		next.channels = current.channels;
+		for (uint32_t level = 1; level < mipCount; ++level)
+		{
+			next.width = (std::max)(current.width / 2, 1u);
+			next.height = (std::max)(current.height / 2, 1u);
+			next.data.resize(next.GetRowSize() * next.height);
+
+			const Kernel horizontal = BuildKernel(current.width, next.width, settings.filter);
+			const Kernel vertical = BuildKernel(current.height, next.height, settings.filter);
+
+			Image& image = levels.emplace_back();
+			image.width = next.width;
+			image.height = next.height;
+			image.format = format;
+			image.pixels.resize(image.GetRowPitch() * image.height);
+
+			ForEachBand(next.height, fast, [&](uint32_t first, uint32_t last)
+			{
+				std::vector<float> temp(current.GetRowSize());
+				for (uint32_t y = first; y < last; ++y)
+				{
+					FilterRow(current, next, vertical, horizontal, y, temp.data(), fast);
+					ToImageRow(next.GetRow(y), y, srgb, fast, image);
+				}
+			});
+
+			std::swap(current, next);
+		}
+	}
+
+	bool ContainsAny(const std::string& text, std::initializer_list<const char*> words)
+	{
+		return std::any_of(words.begin(), words.end(), [&text](const char* pWord) { return text.find(pWord) != std::string::npos; });
+	}
+
+	std::string GetLowerCaseStem(const std::string& filename)
+	{
+		std::string name = std::filesystem::path(filename).stem().string();
+		std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		return name;
+	}
+}
+
+uint32_t MipGenerator::GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count{ 1 };
+	for (uint32_t size = (std::max)(width, height); size > 1; size >>= 1)
+		++count;
+	return count;
+}
+
+MipGenerator::Settings MipGenerator::GetDefaultSettings(const std::string& filename, const Image& image)
+{
+	if (image.format != ImageFormat::RGBA8)
+		return Settings{ Filter::Box, false };
+
+	// The sharpening of the Kaiser filter bends normals, they are averaged as they are
+	if (IsNormalMap(filename))
+		return Settings{ Filter::Box, false };
+	if (IsDataMap(filename))
+		return Settings{ Filter::Kaiser, false };
+	return Settings{ Filter::Kaiser, true };
+}
+
+bool MipGenerator::IsNormalMap(const std::string& filename)
+{
+	const std::string name = GetLowerCaseStem(filename);
+	return ContainsAny(name, { "normal", "_nrm" }) || (name.size() > 2 && name.compare(name.size() - 2, 2, "_n") == 0);
+}
+
+bool MipGenerator::IsDataMap(const std::string& filename)
+{
+	return ContainsAny(GetLowerCaseStem(filename), { "gloss", "specular", "rough", "metal", "height", "mask" });
+}
+
+void MipGenerator::GenerateMips(std::vector<Image>& levels, const Settings& settings)
+{
+	Generate(levels, settings, true);
+}
+
+void MipGenerator::GenerateMipsReference(std::vector<Image>& levels, const Settings& settings)
+{
+	Generate(levels, settings, false);
+}
+
+void MipGenerator::Benchmark(const std::vector<std::string>& filenames, int iterations)
+{
+	struct Configuration
+	{
+		const char* pName;
+		Settings settings;
+	};
+	const Configuration configurations[]{ { "box", { Filter::Box, false } }, { "box sRGB", { Filter::Box, true } },
+		{ "Kaiser", { Filter::Kaiser, false } }, { "Kaiser sRGB", { Filter::Kaiser, true } } };
+
+	for (const auto& filename : filenames)
+	{
+		Image image{};
+		{
+			AssetFile file{ filename };
+			if (!file.IsOpen() || !ImageDecoder::Decode(filename, reinterpret_cast<const uint8_t*>(file.GetData()), file.GetSize(), image))
+				continue;
+		}
+		const double megapixels = static_cast<double>(image.width) * image.height / 1e6;
+
+		for (const Configuration& configuration : configurations)
+		{
+			if (configuration.settings.srgb && image.format != ImageFormat::RGBA8)
+				continue;
+
+			auto measure = [&](auto generate, std::vector<Image>& levels)
+			{
+				double bestSeconds = DBL_MAX;
+				for (int i = 0; i < iterations; ++i)
+				{
+					levels.clear();
+					levels.push_back(image);
+
+					const auto start = std::chrono::steady_clock::now();
+					generate(levels, configuration.settings);
+					const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+					if (seconds < bestSeconds)
+						bestSeconds = seconds;
+				}
+				return bestSeconds;
+			};
+
+			std::vector<Image> referenceLevels{};
+			std::vector<Image> fastLevels{};
+			const double referenceSeconds = measure(GenerateMipsReference, referenceLevels);
+			const double fastSeconds = measure(GenerateMips, fastLevels);
+
+			Logger::GetInstance()->LogInfo("MipGenerator: " + filename + " " + configuration.pName + " " + std::to_string(megapixels) + " MP, scalar 1 thread "
+				+ std::to_string(referenceSeconds * 1000.0) + " ms (" + std::to_string(megapixels / referenceSeconds) + " MP/s), SSE "
+				+ std::to_string(JobSystem::GetInstance()->GetWorkerCount() + 1) + " threads " + std::to_string(fastSeconds * 1000.0) + " ms ("
+				+ std::to_string(megapixels / fastSeconds) + " MP/s)");
+
+			// SSE does the same float operations in the same order, anything but identical mips is a bug
+			bool identical = referenceLevels.size() == fastLevels.size();
+			for (size_t i = 0; identical && i < referenceLevels.size(); ++i)
+				identical = referenceLevels[i].pixels == fastLevels[i].pixels;
+			if (!identical)
+				Logger::GetInstance()->LogWarning("MipGenerator: " + filename + " " + configuration.pName + " SSE mips do not match the reference");
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+// Builds the smaller mips of an image on the CPU, so textures are uploaded with their whole chain and no longer need
+// a device context to get mips. Filters in float, 4 channels at a time with SSE, and splits every level in bands of
+// rows over the job threads.
+namespace MipGenerator
+{
+	enum class Filter
+	{
+		Box,
+		// Kaiser windowed sinc, sharper than the box filter at the cost of a wider kernel
+		Kaiser
+	};
+
+	struct Settings
+	{
+		Filter filter{ Filter::Box };
+		// RGB is averaged in linear space and stored as sRGB again, alpha is always linear. Only for RGBA8.
+		bool srgb{ false };
+	};
+
+	// Every level from the full size down to 1x1
+	uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+	// Color textures are Kaiser filtered in sRGB, normal maps, other data textures (by their name) and single channel
+	// images get a linear box filter
+	Settings GetDefaultSettings(const std::string& filename, const Image& image);
+	// By the name of the file: normal, _nrm or a _n suffix
+	bool IsNormalMap(const std::string& filename);
+	// Textures that hold data and no color, by the name of the file: gloss, specular, rough, metal, height, mask
+	bool IsDataMap(const std::string& filename);
+
+	// levels[0] is the full size image, the smaller levels are appended down to 1x1
+	void GenerateMips(std::vector<Image>& levels, const Settings& settings);
+	// The same without SSE and on the calling thread only, to compare the fast path with
+	void GenerateMipsReference(std::vector<Image>& levels, const Settings& settings);
+
+	// Logs the megapixels per second of every filter on the files, reference against the fast path
+	void Benchmark(const std::vector<std::string>& filenames, int iterations = 5);
+}
@@ -27,13 +27,22 @@
 #include "TerrainComponent.h"
 
 #include "Logger.h"
+#include "AssetPack.h"
+#include "DirectoryModel.h"
+
+// Everything under Resources/ and the level files, built from the Tools menu
+static const std::string g_AssetPackFile{ "Resources.pack" };
 
 #include "EditorWindow.h"
 #include "LogWindow.h"
+#include "ResourceWindow.h"
 
 #include <iostream>
 #include <filesystem>
 #include "DebugRenderer.h"
+#include "JobSystem.h"
+#include "EffectCache.h"
+#include "MipGenerator.h"
 
 #define MY_ENGINE MyEngine::GetSingleton()
 
@@ -61,10 +70,12 @@ MyApplication::~MyApplication()
 
 	delete m_pScene;
 
+	delete JobSystem::GetInstance();
 	delete MaterialManager::GetInstance();
 	delete ResourceManager::GetInstance();
 	delete PhysXManager::GetInstance();
 	delete DebugRenderer::GetInstance();
+	delete EffectCache::GetInstance();
 }
 
 //-------------------------------------------------
@@ -116,7 +127,7 @@ Camera* MyApplication::GetCamera() const
 	return m_pCamera;
 }
 
-void MyApplication::ApplicationFiles(const std::string& path)
+void MyApplication::ApplicationFiles()
 {
 	static ImGuiTreeNodeFlags base_flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick | ImGuiTreeNodeFlags_SpanAvailWidth;
 
@@ -124,16 +135,15 @@ void MyApplication::ApplicationFiles(const std::string& path)
 	static int selection_mask = (1 << 2);
 	int node_clicked = -1;
 
+	// Kept up to date by the file watcher, drawing it does not touch the file system
+	const DirectoryModel* pDirectoryModel = ResourceManager::GetInstance()->GetDirectoryModel();
+	if (pDirectoryModel == nullptr)
+		return;
+
 	int i{};
-	for (const auto& file : std::filesystem::directory_iterator(path))
+	for (const auto& pNode : pDirectoryModel->GetRoot().children)
 	{
-		std::string filepath{ file.path().string() };
-		if (filepath.substr(filepath.find_last_of(".") + 1) == "obj")
-		{
-			ResourceManager::GetInstance()->AddMeshFile(filepath);
-		}
-
-		DialogueFolder(i, filepath, base_flags, node_clicked, test_drag_and_drop);
+		DialogueFolder(i, *pNode, base_flags, node_clicked, test_drag_and_drop);
 		++i;
 	}
 
@@ -145,12 +155,11 @@ void MyApplication::ApplicationFiles(const std::string& path)
 			selection_mask = (1 << node_clicked);
 	}
 }
-void MyApplication::DialogueFolder(int i, const std::string& path, ImGuiTreeNodeFlags node_flags, int& node_clicked, bool test_drag_and_drop)
+void MyApplication::DialogueFolder(int i, const DirectoryNode& node, ImGuiTreeNodeFlags node_flags, int& node_clicked, bool test_drag_and_drop)
 {
-	std::wstring wpath{ path.begin(), path.end() };
-	if (GetFileAttributes(wpath.c_str()) == FILE_ATTRIBUTE_DIRECTORY)
+	if (node.isDirectory)
 	{
-		bool node_open = ImGui::TreeNodeEx((void*)(intptr_t)i, node_flags, path.c_str(), i);
+		bool node_open = ImGui::TreeNodeEx((void*)(intptr_t)i, node_flags, "%s", node.path.c_str());
 		if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
 		{
 			node_clicked = i;
@@ -164,9 +173,9 @@ void MyApplication::DialogueFolder(int i, const std::string& path, ImGuiTreeNode
 		if (node_open)
 		{
 			int j{};
-			for (const auto& file : std::filesystem::directory_iterator(path))
+			for (const auto& pChild : node.children)
 			{
-				DialogueFolder(j, file.path().string(), node_flags, node_clicked, test_drag_and_drop);
+				DialogueFolder(j, *pChild, node_flags, node_clicked, test_drag_and_drop);
 				++j;
 			}
 			ImGui::TreePop();
@@ -175,7 +184,7 @@ void MyApplication::DialogueFolder(int i, const std::string& path, ImGuiTreeNode
 	else
 	{
 		node_flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
-		ImGui::TreeNodeEx((void*)(intptr_t)i, node_flags, path.c_str(), i);
+		ImGui::TreeNodeEx((void*)(intptr_t)i, node_flags, "%s", node.path.c_str());
 		if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
 		{
 			node_clicked = i;
@@ -220,7 +229,7 @@ void MyApplication::RenderGUI()
 	windowFlags |= ImGuiWindowFlags_MenuBar;
 
 	ImGui::Begin("Files");
-	ApplicationFiles("Resources/");
+	ApplicationFiles();
 	ImGui::End();
 
 	ImGui::Begin("Application", 0, windowFlags);
@@ -245,11 +254,16 @@ void MyApplication::RenderGUI()
 				ImGui::InputText("Filename:", filename, 128);
 				if (ImGui::Button("Load"))
 				{
-					delete m_pScene;
-
-					m_pScene = new Scene();
-					m_pScene->Deserialize(filename);
-					m_pScene->Start();
+					// The scene that is open stays when the file can not be loaded
+					Scene* pScene = new Scene();
+					if (pScene->Deserialize(filename))
+					{
+						delete m_pScene;
+						m_pScene = pScene;
+						m_pScene->Start();
+					}
+					else
+						delete pScene;
 				}
 				ImGui::EndMenu();
 			}
@@ -280,6 +294,46 @@ void MyApplication::RenderGUI()
 				m_pScene->AddGameObject(new GameObject("New Gameobject"));
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu("Tools"))
+		{
+			if (ImGui::MenuItem("Benchmark OBJ parser"))
+			{
+				std::vector<std::string> objFiles{};
+				for (const auto& file : std::filesystem::recursive_directory_iterator("Resources/"))
+				{
+					if (file.path().extension() == ".obj")
+						objFiles.emplace_back(file.path().string());
+				}
+				BenchmarkOBJParser(objFiles);
+			}
+			if (ImGui::MenuItem("Benchmark mip generation"))
+			{
+				std::vector<std::string> imageFiles{};
+				for (const auto& file : std::filesystem::recursive_directory_iterator("Resources/"))
+				{
+					const auto extension = file.path().extension();
+					if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+						imageFiles.emplace_back(file.path().string());
+				}
+				MipGenerator::Benchmark(imageFiles);
+			}
+			// Fast cooks color textures to BC1 and BC3, Normal and High to BC7 with a longer search
+			if (ImGui::BeginMenu("Build asset pack"))
+			{
+				for (BlockCompressor::Quality quality : { BlockCompressor::Quality::Fast, BlockCompressor::Quality::Normal, BlockCompressor::Quality::High })
+				{
+					if (ImGui::MenuItem(BlockCompressor::GetQualityName(quality)))
+					{
+						// The pack is replaced, nothing may still read from the old one and the meshes are cooked from their sources
+						ResourceManager::GetInstance()->UnmountPack();
+						AssetPacker::Build(g_AssetPackFile, AssetPacker::GatherFiles("Resources/"), quality);
+						ResourceManager::GetInstance()->MountPack(g_AssetPackFile);
+					}
+				}
+				ImGui::EndMenu();
+			}
+			ImGui::EndMenu();
+		}
 
 		ImGui::EndMenuBar();
 	}
@@ -307,6 +361,9 @@ void MyApplication::RenderGUI()
 
 void MyApplication::BaseUpdate()
 {
+	// Finishes the resources that were loaded on the workers, also while the game is not playing
+	ResourceManager::GetInstance()->Update();
+
 #ifdef _DEBUG
 	m_pCamera->UpdateCamera();
 #endif // _DEBUG
@@ -324,6 +381,13 @@ void MyApplication::BaseUpdate()
 
 void MyApplication::BaseInitialize()
 {
+	// Loose files are used when no pack was built
+	ResourceManager::GetInstance()->MountPack(g_AssetPackFile);
+#ifdef _DEBUG
+	// Registers the files for the editor and reimports the ones that change while it runs
+	ResourceManager::GetInstance()->WatchDirectory("Resources/");
+	AddWindowEditor(new ResourceWindow());
+#endif // _DEBUG
 	Initialize();
 }
 Scene* MyApplication::GetScene()
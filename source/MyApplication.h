@@ -14,6 +14,7 @@ class Material;
 class LitMaterial;
 class Scene;
 class EditorWindow;
+struct DirectoryNode;
 
 typedef int ImGuiTreeNodeFlags;
 
@@ -69,7 +70,7 @@ protected:
 
 private:
 #ifdef  _DEBUG
-	void ApplicationFiles(const std::string& path);
-	void DialogueFolder(int i, const std::string& path, ImGuiTreeNodeFlags node_flags, int& node_clicked, bool test_drag_and_drop);
+	void ApplicationFiles();
+	void DialogueFolder(int i, const DirectoryNode& node, ImGuiTreeNodeFlags node_flags, int& node_clicked, bool test_drag_and_drop);
 #endif //  _DEBUG
 };
\ No newline at end of file
@@ -402,6 +402,22 @@ void MyEngine::Render()
             ImVec2{ ImGui::GetWindowPos().x + ImGui::GetWindowWidth(), ImGui::GetWindowPos().y + ImGui::GetWindowHeight() }
         );
 
+        // Click in the viewport to select the object under the cursor, releasing after a drag moved the camera instead
+        if (ImGui::IsWindowHovered() && ImGui::IsMouseReleased(0) && ImGui::GetIO().MouseDragMaxDistanceSqr[0] < ImGui::GetIO().MouseDragThreshold * ImGui::GetIO().MouseDragThreshold)
+        {
+            const ImVec2 mousePosition = ImGui::GetMousePos();
+            const float x = (mousePosition.x - ImGui::GetWindowPos().x) / ImGui::GetWindowWidth();
+            const float y = (mousePosition.y - ImGui::GetWindowPos().y) / ImGui::GetWindowHeight();
+
+            DirectX::XMFLOAT3 origin{};
+            DirectX::XMFLOAT3 direction{};
+            pCamera->ScreenToRay(x, y, origin, direction);
+
+            RaycastHit hit{};
+            if (pScene->Raycast(origin, direction, hit))
+                pScene->SetSelectedObject(hit.pGameObject);
+        }
+
 
         auto selectedObject = m_pApplication->GetScene()->GetSelectedObject();
         if (selectedObject != nullptr)
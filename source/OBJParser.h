@@ -4,9 +4,16 @@
 /*=============================================================================*/
 // EOBJParser.h: most basic OBJParser!
 /*=============================================================================*/
+#pragma once
 
+#include <algorithm>
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
 #include <vector>
 #include "Mesh.h"
 #include "Material.h"
@@ -16,777 +23,1137 @@
 
 #include "ResourceManager.h"
 #include "MaterialManager.h"
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "TangentSpace.h"
+#include "VertexFormat.h"
 #include "Logger.h"
 #include "Utils.h"
 
+// Bump whenever the importer output changes, cooked meshes of older versions are imported again
+constexpr uint32_t g_OBJImporterVersion{ 7 };
+
+// Part of the cache key, asset packs store the flags their meshes were cooked with
+constexpr uint32_t GetOBJImportFlags(bool flipZ, bool splitMeshes)
+{
+	return (flipZ ? 1u : 0u) | (splitMeshes ? 2u : 0u);
+}
+// Largest quantization error allowed before a submesh keeps full float vertices on the GPU
+constexpr VertexQuantization::Tolerance g_OBJQuantizationTolerance{};
+// Every OBJ material is drawn with this effect, materials without a diffuse map get the grid
+constexpr const char* g_OBJEffectFile{ "Resources/material_unlit.fx" };
+constexpr const char* g_OBJDefaultDiffuseMap{ "Resources/uv_grid_2.png" };
+
 struct Mesh_Struct 
 {
 	std::vector<Vertex> vertices;
 	std::vector<u_int> indices;
 	std::string materialName;
+	std::vector<MeshSimplifier::Lod> lods;
+	std::vector<Meshlets::Meshlet> meshlets;
+	VertexFormat vertexFormat{ VertexFormat::Float };
 };
 
-static void CreateMesh(std::vector<Mesh*>& pMeshes,  Mesh_Struct& mesh, Scene* pScene, const std::string& filepath)
+static void CreateMesh(std::vector<Mesh*>& pMeshes, const MeshCache::Submesh& submesh, Scene* pScene, const std::string& filepath)
 {
-	if (mesh.vertices.empty() || mesh.indices.empty())
+	if (submesh.vertexCount == 0 || submesh.indexCount == 0)
 		return;
 
-	for (uint32_t i = 0; i < mesh.indices.size(); i += 3)
-	{
-		uint32_t index0 = mesh.indices[i];
-		uint32_t index1 = mesh.indices[i + 1];
-		uint32_t index2 = mesh.indices[i + 2];
-
-		const DirectX::XMVECTOR& p0 = DirectX::XMLoadFloat3( &mesh.vertices[index0].position);
-		const DirectX::XMVECTOR& p1 = DirectX::XMLoadFloat3( &mesh.vertices[index1].position);
-		const DirectX::XMVECTOR& p2 = DirectX::XMLoadFloat3( &mesh.vertices[index2].position);
-		const DirectX::XMFLOAT2& uv0 = mesh.vertices[index0].uv;
-		const DirectX::XMFLOAT2& uv1 = mesh.vertices[index1].uv;
-		const DirectX::XMFLOAT2& uv2 = mesh.vertices[index2].uv;
-
-		const DirectX::XMVECTOR edge0 = DirectX::XMVectorSubtract(p1 , p0);
-		const DirectX::XMVECTOR edge1 = DirectX::XMVectorSubtract(p2 , p0);
-
-		const auto diffx = DirectX::XMFLOAT2(uv1.x - uv0.x, uv2.x - uv0.x);
-		const auto diffy = DirectX::XMFLOAT2(uv1.y - uv0.y, uv2.y - uv0.y);
-
-		const DirectX::XMVECTOR diffX = DirectX::XMLoadFloat2(&diffx);
-		const DirectX::XMVECTOR diffY = DirectX::XMLoadFloat2(&diffy);
-
-		float one = 1.0f;
-		auto oneVector = DirectX::XMLoadFloat(&one);
-		auto r = DirectX::XMVectorDivide( oneVector , DirectX::XMVector3Cross(diffX, diffY));
-
-		DirectX::XMFLOAT2 storedDiff;
-		DirectX::XMStoreFloat2(&storedDiff, diffY);
-
-		DirectX::XMVECTOR tangent0 = DirectX::XMLoadFloat3(&mesh.vertices[index0].tangent);
-		DirectX::XMVECTOR tangent1 = DirectX::XMLoadFloat3(&mesh.vertices[index1].tangent);
-		DirectX::XMVECTOR tangent2 = DirectX::XMLoadFloat3(&mesh.vertices[index2].tangent);
-
-		DirectX::XMVECTOR tangent = DirectX::XMVectorMultiply( DirectX::XMVectorSubtract( DirectX::XMVectorMultiply(edge0 , DirectX::XMLoadFloat(&storedDiff.y)) , DirectX::XMVectorMultiply(edge1 , DirectX::XMLoadFloat(&storedDiff.x))) , r);
-
-		DirectX::XMVectorAdd(tangent0, tangent);
-		DirectX::XMVectorAdd(tangent1, tangent);
-		DirectX::XMVectorAdd(tangent2, tangent);
-
-		DirectX::XMStoreFloat3(&mesh.vertices[index0].tangent, tangent0);
-		DirectX::XMStoreFloat3(&mesh.vertices[index1].tangent, tangent1);
-		DirectX::XMStoreFloat3(&mesh.vertices[index2].tangent, tangent2);
-	}
-	for (auto& v : mesh.vertices)
-	{
-		auto tangent = DirectX::XMLoadFloat3(&v.tangent);
-		auto normal = DirectX::XMLoadFloat3(&v.normal);
-
-		auto project = DirectX::XMVectorMultiply(normal , DirectX::XMVectorDivide(DirectX::XMVector3Dot(normal, tangent) , DirectX::XMVectorSqrt(normal) ) ) ;
-
-		tangent = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(tangent, project));
+	Mesh* pMesh = new Mesh(
+		MyEngine::GetSingleton()->GetDevice(),
+		MyEngine::GetSingleton()->GetWindowHandle(),
+		submesh.pVertices,
+		submesh.vertexCount,
+		submesh.pIndices,
+		submesh.indexCount,
+		filepath,
+		static_cast<int>(pMeshes.size()),
+		pScene->GetMaterial(std::string(submesh.materialName)),
+		submesh.vertexFormat
+	);
+	if (submesh.lodCount > 0)
+		pMesh->SetLods(std::vector<MeshSimplifier::Lod>(submesh.pLods, submesh.pLods + submesh.lodCount));
+	if (submesh.meshletCount > 0)
+		pMesh->SetMeshlets(std::vector<Meshlets::Meshlet>(submesh.pMeshlets, submesh.pMeshlets + submesh.meshletCount));
+	pMeshes.push_back(pMesh);
+}
 
-		DirectX::XMStoreFloat3(&v.tangent, tangent);
-	}
+static void CreateMesh(std::vector<Mesh*>& pMeshes, const MeshCache::Submesh& submesh, const std::string& filepath)
+{
+	if (submesh.vertexCount == 0 || submesh.indexCount == 0)
+		return;
 
-	//auto mat = new Material(MyEngine::GetSingleton()->GetDevice(), L"Resources/material_unlit.fx");
-	//
-	//Texture* pDiffuseTexture = new Texture(MyEngine::GetSingleton()->GetDevice(), L"Resources/uv_grid_2.png");
-	//mat->SetDiffuseMap(pDiffuseTexture);
+	auto materialManager = MaterialManager::GetInstance();
 
 	Mesh* pMesh = new Mesh(
 		MyEngine::GetSingleton()->GetDevice(),
 		MyEngine::GetSingleton()->GetWindowHandle(),
-		mesh.vertices,
-		mesh.indices,
+		submesh.pVertices,
+		submesh.vertexCount,
+		submesh.pIndices,
+		submesh.indexCount,
 		filepath,
 		static_cast<int>(pMeshes.size()),
-		pScene->GetMaterial(mesh.materialName)
+		materialManager->GetMaterial( (submesh.materialName.empty() ? "default" : std::string(submesh.materialName))),
+		submesh.vertexFormat
 	);
+	if (submesh.lodCount > 0)
+		pMesh->SetLods(std::vector<MeshSimplifier::Lod>(submesh.pLods, submesh.pLods + submesh.lodCount));
+	if (submesh.meshletCount > 0)
+		pMesh->SetMeshlets(std::vector<Meshlets::Meshlet>(submesh.pMeshlets, submesh.pMeshlets + submesh.meshletCount));
 	pMeshes.push_back(pMesh);
 }
 
-static Mesh* CreateSphere(float radius, int steps)
+// Line based tokenizer that works directly on the mapped file, it does not allocate and is not locale aware
+namespace OBJTokenizer
 {
-	auto resourceManager = ResourceManager::GetInstance();
-	std::string name = "Cube(" + std::to_string(radius) + ", " + std::to_string(steps)  + ")";
-	if (resourceManager->GetMeshConst(name) != nullptr)
-		return resourceManager->GetMeshConst(name);
-
-	// Vertices
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-
-	const auto vertCount = steps * (steps - 1) + 2;
-	const float deltaTheta = F_PI / steps;
-	const float deltaPhi = (G_PI * 2.0f) / steps;
-	float theta = 0;
-	float phi = 0;
+	inline const char* SkipSpaces(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+			++p;
+		return p;
+	}
 
-	vertices.emplace_back(DirectX::XMFLOAT3{ 0, radius, 0 }, DirectX::XMFLOAT3{ 0,1,0 });
+	inline std::string_view ReadWord(const char*& p, const char* pEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		const char* pStart = p;
+		while (p < pEnd && *p != ' ' && *p != '\t' && *p != '\r')
+			++p;
+		return std::string_view(pStart, p - pStart);
+	}
 
-	for (auto i = 0; i < steps - 1; ++i)
+	inline bool ReadFloat(const char*& p, const char* pEnd, float& value)
 	{
-		theta += deltaTheta;
-		for (auto j = 0; j < steps; ++j)
-		{
-			phi += deltaPhi;
-			DirectX::XMFLOAT3 pos;
-			pos.x = radius * sin(theta) * cos(phi);
-			pos.z = radius * sin(theta) * sin(phi);
-			pos.y = radius * cos(theta);
+		p = SkipSpaces(p, pEnd);
+		if (p < pEnd && *p == '+')
+			++p;
 
-			const DirectX::XMVECTOR vPos = DirectX::XMLoadFloat3(&pos);
-			DirectX::XMFLOAT3 normal;
-			DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(vPos));
+		const auto result = std::from_chars(p, pEnd, value);
+		if (result.ec != std::errc{})
+			return false;
 
-			vertices.emplace_back(pos, normal);
-		}
+		p = result.ptr;
+		return true;
+	}
+
+	// The rest of the line without the spaces around it, paths can contain spaces
+	inline std::string_view ReadRest(const char*& p, const char* pEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		const char* pLast = pEnd;
+		while (pLast > p && (pLast[-1] == ' ' || pLast[-1] == '\t' || pLast[-1] == '\r'))
+			--pLast;
+
+		const std::string_view rest(p, pLast - p);
+		p = pEnd;
+		return rest;
 	}
-	vertices.emplace_back(DirectX::XMFLOAT3{ 0, -radius, 0 }, DirectX::XMFLOAT3{ 0,-1,0 });
 
-	for (auto i = 1; i < steps + 1; ++i)
+	inline bool ReadInt(const char*& p, const char* pEnd, int& value)
 	{
-		indices.emplace_back(i);
+		if (p < pEnd && *p == '+')
+			++p;
 
-		auto v1 = i + 1;
-		if (i % steps == 0)
-			v1 -= steps;
+		const auto result = std::from_chars(p, pEnd, value);
+		if (result.ec != std::errc{})
+			return false;
 
-		indices.emplace_back(v1);
-		indices.emplace_back(0);
+		p = result.ptr;
+		return true;
 	}
 
-	//MIDDLE
-	for (auto i = 1; i < vertCount - 1 - steps; ++i)
+	// OBJ indices are 1-based, negative indices are relative to the end of the list
+	inline bool ResolveIndex(int index, size_t count, size_t& resolved)
 	{
-		const auto v0 = i;
-		auto v1 = i + 1;
-
-		if (i % steps == 0)
-			v1 -= steps;
+		if (index > 0 && static_cast<size_t>(index) <= count)
+		{
+			resolved = static_cast<size_t>(index) - 1;
+			return true;
+		}
+		if (index < 0 && static_cast<size_t>(-index) <= count)
+		{
+			resolved = count - static_cast<size_t>(-index);
+			return true;
+		}
+		return false;
+	}
+}
 
-		const auto v2 = v1 + steps;
-		const auto v3 = v0 + steps;
+// Position/uv/normal index triple of a face corner, corners with the same triple share one vertex
+struct OBJVertexKey
+{
+	uint32_t position;
+	uint32_t uv;
+	uint32_t normal;
 
-		indices.emplace_back(v0);
-		indices.emplace_back(v1);
-		indices.emplace_back(v2);
-		indices.emplace_back(v2);
-		indices.emplace_back(v3);
-		indices.emplace_back(v0);
+	bool operator==(const OBJVertexKey& other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
 	}
+};
 
-	//BOTTOM
-	for (auto i = vertCount - steps - 1; i < vertCount - 1; ++i)
+struct OBJVertexKeyHash
+{
+	size_t operator()(const OBJVertexKey& key) const
 	{
-		indices.emplace_back(i);
+		uint64_t hash = key.position * 0x9E3779B97F4A7C15ull;
+		hash ^= (key.uv + 0x632BE59BD9B4E019ull + (hash << 6) + (hash >> 2));
+		hash ^= (key.normal * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2));
+		return static_cast<size_t>(hash);
+	}
+};
 
-		auto v1 = i + 1;
-		if (i % steps == 0)
-			v1 -= steps;
+using OBJVertexMap = std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash>;
 
-		indices.emplace_back(v1);
-		indices.emplace_back(vertCount - 1);
-	}
+struct OBJParseResult
+{
+	std::vector<Mesh_Struct> meshes;
+	std::vector<std::string> materialNames;
+	std::vector<std::string> materialLibraries;		// As written after mtllib, relative to the OBJ file
+	size_t faceCount{};
+	size_t skippedLineCount{};						// Malformed lines, the rest of the file is still read
+	size_t firstSkippedLine{};
+};
 
-	return new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), vertices, indices, name);
+static void AddOBJSkippedLine(size_t lineNumber, size_t& skippedLineCount, size_t& firstSkippedLine)
+{
+	if (skippedLineCount++ == 0)
+		firstSkippedLine = lineNumber;
 }
 
-static Mesh* CreateCube(float width, float height, float depth)
+static void LogOBJSkippedLines(const OBJParseResult& result)
 {
-	auto resourceManager = ResourceManager::GetInstance();
+	if (result.skippedLineCount > 0)
+		Logger::GetInstance()->LogWarning("OBJParser: skipped " + std::to_string(result.skippedLineCount) + " invalid line(s), the first is line " + std::to_string(result.firstSkippedLine));
+}
 
-	std::string name = "Cube(" + std::to_string(width) + ", " + std::to_string(height) + ", " + std::to_string(depth) + ")";
-	if (resourceManager->GetMeshConst(name) != nullptr)
-		return resourceManager->GetMeshConst(name);
+// A vt line only needs u, v and w are optional and 0 when left out
+static bool ReadOBJTexCoord(const char*& p, const char* pLineEnd, DirectX::XMFLOAT2& uv)
+{
+	float u{}, v{};
+	if (!OBJTokenizer::ReadFloat(p, pLineEnd, u))
+		return false;
+	if (OBJTokenizer::SkipSpaces(p, pLineEnd) < pLineEnd && !OBJTokenizer::ReadFloat(p, pLineEnd, v))
+		return false;
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-
-	const float halfWidth = width / 2.f;
-	const float halfHeight = height / 2.f;
-	const float halfDepth = depth / 2.f;
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,-1} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,1} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,0,1} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{-1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{-1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{-1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{-1,0,0} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{1,0,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{1,0,0} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, halfDepth}, DirectX::XMFLOAT3{0,1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,1,0} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,-1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, -halfDepth}, DirectX::XMFLOAT3{0,-1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,-1,0} });
-	vertices.emplace_back(Vertex{ DirectX::XMFLOAT3{-halfWidth, -halfHeight, halfDepth}, DirectX::XMFLOAT3{0,-1,0} });
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 3));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 2));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 1));
-	indices.emplace_back(static_cast<uint32_t>(vertices.size() - 4));
-
-	return new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), vertices, indices, name);
+	uv = DirectX::XMFLOAT2(u, 1 - v);
+	return true;
 }
 
-static void CreateMesh(std::vector<Mesh*>& pMeshes, Mesh_Struct& mesh, const std::string& filepath)
+static void AddOBJMaterialLibraries(const char* p, const char* pLineEnd, std::vector<std::string>& libraries)
 {
-	if (mesh.vertices.empty() || mesh.indices.empty())
-		return;
-
-	for (uint32_t i = 0; i < mesh.indices.size(); i += 3)
+	for (std::string_view library = OBJTokenizer::ReadWord(p, pLineEnd); !library.empty(); library = OBJTokenizer::ReadWord(p, pLineEnd))
 	{
-		uint32_t index0 = mesh.indices[i];
-		uint32_t index1 = mesh.indices[i + 1];
-		uint32_t index2 = mesh.indices[i + 2];
+		if (std::find(libraries.begin(), libraries.end(), library) == libraries.end())
+			libraries.emplace_back(library);
+	}
+}
 
-		const DirectX::XMVECTOR& p0 = DirectX::XMLoadFloat3(&mesh.vertices[index0].position);
-		const DirectX::XMVECTOR& p1 = DirectX::XMLoadFloat3(&mesh.vertices[index1].position);
-		const DirectX::XMVECTOR& p2 = DirectX::XMLoadFloat3(&mesh.vertices[index2].position);
-		const DirectX::XMFLOAT2& uv0 = mesh.vertices[index0].uv;
-		const DirectX::XMFLOAT2& uv1 = mesh.vertices[index1].uv;
-		const DirectX::XMFLOAT2& uv2 = mesh.vertices[index2].uv;
+// Reads the corners of a face, polygons are split up as a triangle fan.
+// Corners are welded through vertexMap so every unique index triple becomes one vertex,
+// onNewVertex receives the key of every vertex that gets added.
+// All corners are read into the corners scratch list first, an invalid face adds nothing.
+template<typename NewVertexFunc>
+static bool ParseOBJFace(const char*& p, const char* pLineEnd, size_t positionCount, size_t uvCount, size_t normalCount, std::vector<OBJVertexKey>& corners, OBJVertexMap& vertexMap, std::vector<uint32_t>& indices, NewVertexFunc onNewVertex)
+{
+	corners.clear();
+	while (true)
+	{
+		p = OBJTokenizer::SkipSpaces(p, pLineEnd);
+		if (p >= pLineEnd)
+			break;
 
-		const DirectX::XMVECTOR edge0 = DirectX::XMVectorSubtract(p1, p0);
-		const DirectX::XMVECTOR edge1 = DirectX::XMVectorSubtract(p2, p0);
+		OBJVertexKey key{ UINT32_MAX, UINT32_MAX, UINT32_MAX };
+		int index{};
+		size_t resolved{};
 
-		const auto diffx = DirectX::XMFLOAT2(uv1.x - uv0.x, uv2.x - uv0.x);
-		const auto diffy = DirectX::XMFLOAT2(uv1.y - uv0.y, uv2.y - uv0.y);
+		if (!OBJTokenizer::ReadInt(p, pLineEnd, index) || !OBJTokenizer::ResolveIndex(index, positionCount, resolved))
+			return false;
+		key.position = static_cast<uint32_t>(resolved);
 
-		const DirectX::XMVECTOR diffX = DirectX::XMLoadFloat2(&diffx);
-		const DirectX::XMVECTOR diffY = DirectX::XMLoadFloat2(&diffy);
+		if (p < pLineEnd && *p == '/')
+		{
+			++p;
+			if (p < pLineEnd && *p != '/')
+			{
+				// Optional texture coordinate
+				if (!OBJTokenizer::ReadInt(p, pLineEnd, index) || !OBJTokenizer::ResolveIndex(index, uvCount, resolved))
+					return false;
+				key.uv = static_cast<uint32_t>(resolved);
+			}
 
-		float one = 1.0f;
-		auto oneVector = DirectX::XMLoadFloat(&one);
-		auto r = DirectX::XMVectorDivide(oneVector, DirectX::XMVector3Cross(diffX, diffY));
+			if (p < pLineEnd && *p == '/')
+			{
+				++p;
 
-		DirectX::XMFLOAT2 storedDiff;
-		DirectX::XMStoreFloat2(&storedDiff, diffY);
+				// Optional vertex normal
+				if (!OBJTokenizer::ReadInt(p, pLineEnd, index) || !OBJTokenizer::ResolveIndex(index, normalCount, resolved))
+					return false;
+				key.normal = static_cast<uint32_t>(resolved);
+			}
+		}
 
-		DirectX::XMVECTOR tangent0 = DirectX::XMLoadFloat3(&mesh.vertices[index0].tangent);
-		DirectX::XMVECTOR tangent1 = DirectX::XMLoadFloat3(&mesh.vertices[index1].tangent);
-		DirectX::XMVECTOR tangent2 = DirectX::XMLoadFloat3(&mesh.vertices[index2].tangent);
+		corners.push_back(key);
+	}
 
-		DirectX::XMVECTOR tangent = DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(DirectX::XMVectorMultiply(edge0, DirectX::XMLoadFloat(&storedDiff.y)), DirectX::XMVectorMultiply(edge1, DirectX::XMLoadFloat(&storedDiff.x))), r);
+	if (corners.size() < 3)
+		return false;
 
-		DirectX::XMVectorAdd(tangent0, tangent);
-		DirectX::XMVectorAdd(tangent1, tangent);
-		DirectX::XMVectorAdd(tangent2, tangent);
+	uint32_t firstIndex{};
+	uint32_t previousIndex{};
+	int cornerCount{};
 
-		DirectX::XMStoreFloat3(&mesh.vertices[index0].tangent, tangent0);
-		DirectX::XMStoreFloat3(&mesh.vertices[index1].tangent, tangent1);
-		DirectX::XMStoreFloat3(&mesh.vertices[index2].tangent, tangent2);
-	}
-	for (auto& v : mesh.vertices)
+	for (const OBJVertexKey& key : corners)
 	{
-		auto tangent = DirectX::XMLoadFloat3(&v.tangent);
-		auto normal = DirectX::XMLoadFloat3(&v.normal);
-
-		auto project = DirectX::XMVectorMultiply(normal, DirectX::XMVectorDivide(DirectX::XMVector3Dot(normal, tangent), DirectX::XMVectorSqrt(normal)));
-
-		tangent = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(tangent, project));
+		const auto [iter, inserted] = vertexMap.try_emplace(key, static_cast<uint32_t>(vertexMap.size()));
+		if (inserted)
+			onNewVertex(key);
+		const uint32_t vertexIndex = iter->second;
+
+		if (cornerCount == 0)
+			firstIndex = vertexIndex;
+		else if (cornerCount >= 2)
+		{
+			indices.push_back(firstIndex);
+			indices.push_back(previousIndex);
+			indices.push_back(vertexIndex);
+		}
 
-		DirectX::XMStoreFloat3(&v.tangent, tangent);
+		previousIndex = vertexIndex;
+		++cornerCount;
 	}
 
-	//auto mat = new Material(MyEngine::GetSingleton()->GetDevice(), L"Resources/material_unlit.fx");
-	//
-	//Texture* pDiffuseTexture = new Texture(MyEngine::GetSingleton()->GetDevice(), L"Resources/uv_grid_2.png");
-	//mat->SetDiffuseMap(pDiffuseTexture);
-
-	auto materialManager = MaterialManager::GetInstance();
-
-	Mesh* pMesh = new Mesh(
-		MyEngine::GetSingleton()->GetDevice(),
-		MyEngine::GetSingleton()->GetWindowHandle(),
-		mesh.vertices,
-		mesh.indices,
-		filepath,
-		static_cast<int>(pMeshes.size()),
-		materialManager->GetMaterial( (mesh.materialName.empty() ? "default" : mesh.materialName))
-	);
-	pMeshes.push_back(pMesh);
+	return true;
 }
 
-static bool ParseOBJ(const std::string& filename, std::vector<Mesh*>& m_pMeshes)
+static Vertex MakeOBJVertex(const OBJVertexKey& key, const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<DirectX::XMFLOAT2>& UVs, const std::vector<DirectX::XMFLOAT3>& normals)
 {
-	std::ifstream file(filename);
-	if (!file)
-		return false;
+	Vertex vertex{};
+	vertex.position = positions[key.position];
+	if (key.uv != UINT32_MAX)
+		vertex.uv = UVs[key.uv];
+	if (key.normal != UINT32_MAX)
+		vertex.normal = normals[key.normal];
+
+	return vertex;
+}
 
+// Shared parser core, splitMeshes starts a new mesh on every object and material change
+static bool ParseOBJData(const char* pData, size_t size, bool flipZ, bool splitMeshes, OBJParseResult& result)
+{
 	std::vector<DirectX::XMFLOAT3> positions;
 	std::vector<DirectX::XMFLOAT3> normals;
 	std::vector<DirectX::XMFLOAT2> UVs;
 
-	std::vector<Vertex> vertices;
-	std::vector<u_int> indices;
-	std::vector<Mesh_Struct> meshes;
-	std::vector<std::string> meshmatNames;
+	Mesh_Struct currentMesh{};
+	std::string currentMaterial{};
+	OBJVertexMap vertexMap{};
+	std::vector<OBJVertexKey> corners{};
 
-	std::string sCommand;
-	while (!file.eof())
+	auto flushMesh = [&]()
 	{
-		//read the first word of the string, use the >> operator (istream::operator>>) 
-		file >> sCommand;
-		//use conditional statements to process the different commands	
-		if (sCommand == "#")
+		if (!currentMesh.vertices.empty() && !currentMesh.indices.empty())
 		{
-			// Ignore Comment
+			currentMesh.materialName = currentMaterial;
+			result.meshes.emplace_back(std::move(currentMesh));
 		}
-		else if (sCommand == "v")
+		currentMesh = Mesh_Struct{};
+		vertexMap.clear();
+	};
+
+	const char* p = pData;
+	const char* pEnd = pData + size;
+	size_t lineNumber{};
+
+	while (p < pEnd)
+	{
+		++lineNumber;
+		const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', pEnd - p));
+		if (pLineEnd == nullptr)
+			pLineEnd = pEnd;
+
+		const std::string_view command = OBJTokenizer::ReadWord(p, pLineEnd);
+		bool valid = true;
+
+		// Malformed attributes still take their place so the indices after them stay right
+		if (command == "v")
 		{
 			//Vertex
-			float x, y, z;
-			file >> x >> y >> z;
-			positions.push_back(DirectX::XMFLOAT3(x, y, -z));
+			float x{}, y{}, z{};
+			valid = OBJTokenizer::ReadFloat(p, pLineEnd, x) && OBJTokenizer::ReadFloat(p, pLineEnd, y) && OBJTokenizer::ReadFloat(p, pLineEnd, z);
+			positions.push_back(valid ? DirectX::XMFLOAT3(x, y, flipZ ? -z : z) : DirectX::XMFLOAT3{});
 		}
-		else if (sCommand == "vt")
+		else if (command == "vt")
 		{
 			// Vertex TexCoord
-			float u, v;
-			file >> u >> v;
-			UVs.push_back(DirectX::XMFLOAT2(u, 1 - v));
+			DirectX::XMFLOAT2 uv{};
+			valid = ReadOBJTexCoord(p, pLineEnd, uv);
+			UVs.push_back(uv);
 		}
-		else if (sCommand == "vn")
+		else if (command == "vn")
 		{
 			// Vertex Normal
-			float x, y, z;
-			file >> x >> y >> z;
-			normals.push_back(DirectX::XMFLOAT3(x, y, z));
+			float x{}, y{}, z{};
+			valid = OBJTokenizer::ReadFloat(p, pLineEnd, x) && OBJTokenizer::ReadFloat(p, pLineEnd, y) && OBJTokenizer::ReadFloat(p, pLineEnd, z);
+			normals.push_back(valid ? DirectX::XMFLOAT3(x, y, z) : DirectX::XMFLOAT3{});
 		}
-		else if (sCommand == "f")
+		else if (command == "f")
 		{
-			//if a face is read:
-			//construct the 3 vertices, add them to the vertex array
-			//add three indices to the index array
-			//add the material index as attibute to the attribute array
-			//
-			// Faces or triangles
-			Vertex vertex{};
-			size_t iPosition, iTexCoord, iNormal;
-			for (size_t iFace = 0; iFace < 3; iFace++)
+			valid = ParseOBJFace(p, pLineEnd, positions.size(), UVs.size(), normals.size(), corners, vertexMap, currentMesh.indices, [&](const OBJVertexKey& key)
 			{
-				// OBJ format uses 1-based arrays
-				file >> iPosition;
-				vertex.position = positions[iPosition - 1];
-
-				if ('/' == file.peek())//is next in buffer ==  '/' ?
-				{
-					file.ignore();//read and ignore one element ('/')
-
-					if ('/' != file.peek())
-					{
-						// Optional texture coordinate
-						file >> iTexCoord;
-						vertex.uv = UVs[iTexCoord - 1];
-					}
-
-					if ('/' == file.peek())
-					{
-						file.ignore();
-
-						// Optional vertex normal
-						file >> iNormal;
-						vertex.normal = normals[iNormal - 1];
-					}
-				}
-
-				vertices.push_back(vertex);
-				indices.push_back(uint32_t(vertices.size()) - 1);
-			}
+				currentMesh.vertices.push_back(MakeOBJVertex(key, positions, UVs, normals));
+			});
+			if (valid)
+				++result.faceCount;
 		}
-		else if (sCommand == "o")
+		else if (command == "o")
 		{
-			if (!vertices.empty() && !indices.empty())
-				meshes.push_back(Mesh_Struct{ vertices, indices, meshmatNames[meshmatNames.size() - 1] });
-
-			vertices.clear();
-			indices.clear();
+			if (splitMeshes)
+				flushMesh();
 		}
-		else if (sCommand == "usemtl")
+		else if (command == "usemtl")
 		{
-			std::string name;
-			file >> name;
-
-			meshmatNames.push_back(name);
-
-			if (!indices.empty() && !vertices.empty())
-			{
-				//Create mesh
-				meshes.push_back(Mesh_Struct{ vertices, indices });
-			}
-
-			auto mat = new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx");
+			const std::string_view name = OBJTokenizer::ReadWord(p, pLineEnd);
+			if (splitMeshes)
+				flushMesh();
 
-			Texture* pDiffuseTexture = new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png");
-			mat->SetDiffuseMap(pDiffuseTexture);
-
-			MaterialManager::GetInstance()->AddMaterial(name, mat);
+			currentMaterial.assign(name.data(), name.size());
+			if (std::find(result.materialNames.begin(), result.materialNames.end(), currentMaterial) == result.materialNames.end())
+				result.materialNames.push_back(currentMaterial);
+		}
+		else if (command == "mtllib")
+		{
+			AddOBJMaterialLibraries(p, pLineEnd, result.materialLibraries);
 		}
 
-		//read till end of line and ignore all remaining chars
-		file.ignore(1000, '\n');
-	}
-	file.close();
+		if (!valid)
+			AddOBJSkippedLine(lineNumber, result.skippedLineCount, result.firstSkippedLine);
 
-	// Create the final mesh
-	meshes.emplace_back(Mesh_Struct{ vertices, indices, meshmatNames[meshmatNames.size() - 1] });
-	vertices.clear();
-	indices.clear();
-	for (auto& meshStruct : meshes)
-	{
-		CreateMesh(m_pMeshes, meshStruct, filename);
+		p = pLineEnd + 1;
 	}
 
+	// Create the final mesh
+	flushMesh();
+	LogOBJSkippedLines(result);
 	return true;
 }
 
-static bool ParseOBJ(const std::string& filename,  std::vector<Mesh*>& pMeshes, Scene* pScene)
+// Multithreaded version of ParseOBJData, the file is split into chunks at line boundaries.
+// A first pass counts the attributes and lines of every chunk so the second pass knows the
+// global offsets and can parse and weld every chunk on its own. The chunks are merged in file
+// order, which gives exactly the same output as the single threaded parse.
+namespace OBJChunked
 {
-	std::ifstream file(filename);
-	if (!file)
-		return false;
-
-	std::vector<DirectX::XMFLOAT3> positions;
-	std::vector<DirectX::XMFLOAT3> normals;
-	std::vector<DirectX::XMFLOAT2> UVs;
+	constexpr size_t g_MinChunkSize{ 1024 * 1024 };
+	constexpr size_t g_ChunksPerThread{ 4 };
 
-	std::vector<Vertex> vertices;
-	std::vector<u_int> indices;
-	std::vector<Mesh_Struct> meshes;
-	std::vector<std::string> meshmatNames;
+	// Faces between two o/usemtl lines of a chunk, welded locally
+	struct Run
+	{
+		std::vector<OBJVertexKey> vertices{}; // Unique keys in order of first use
+		std::vector<uint32_t> indices{};      // Indices into vertices
+		std::vector<uint32_t> remap{};        // Local to mesh vertex index, filled in while merging
+		size_t indexOffset{};                 // Where the indices start in the merged mesh
+	};
 
+	struct Event
+	{
+		bool isMaterial{};
+		std::string_view name{};
+	};
 
-	std::string sCommand;
-	while (!file.eof())
+	struct Chunk
+	{
+		const char* pBegin{};
+		const char* pEnd{};
+
+		size_t lineCount{};
+		size_t positionCount{};
+		size_t uvCount{};
+		size_t normalCount{};
+
+		size_t lineBase{};
+		size_t positionBase{};
+		size_t uvBase{};
+		size_t normalBase{};
+
+		// events[i] sits between runs[i] and runs[i + 1]
+		std::vector<Run> runs{};
+		std::vector<Event> events{};
+		std::vector<std::string> materialLibraries{};
+		size_t faceCount{};
+		size_t skippedLineCount{};
+		size_t firstSkippedLine{}; // Inside the chunk
+	};
+
+	inline void CountChunk(Chunk& chunk)
 	{
-		//read the first word of the string, use the >> operator (istream::operator>>) 
-		file >> sCommand;
-		//use conditional statements to process the different commands	
-		if (sCommand == "#")
+		const char* p = chunk.pBegin;
+		while (p < chunk.pEnd)
 		{
-			// Ignore Comment
+			++chunk.lineCount;
+			const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', chunk.pEnd - p));
+			if (pLineEnd == nullptr)
+				pLineEnd = chunk.pEnd;
+
+			const std::string_view command = OBJTokenizer::ReadWord(p, pLineEnd);
+			if (command == "v")
+				++chunk.positionCount;
+			else if (command == "vt")
+				++chunk.uvCount;
+			else if (command == "vn")
+				++chunk.normalCount;
+
+			p = pLineEnd + 1;
 		}
-		else if (sCommand == "v")
+	}
+
+	inline void ParseChunk(Chunk& chunk, bool flipZ, std::vector<DirectX::XMFLOAT3>& positions, std::vector<DirectX::XMFLOAT2>& UVs, std::vector<DirectX::XMFLOAT3>& normals)
+	{
+		size_t positionCount = chunk.positionBase;
+		size_t uvCount = chunk.uvBase;
+		size_t normalCount = chunk.normalBase;
+
+		OBJVertexMap vertexMap{};
+		std::vector<OBJVertexKey> corners{};
+		chunk.runs.emplace_back();
+
+		const char* p = chunk.pBegin;
+		size_t lineNumber{};
+
+		while (p < chunk.pEnd)
 		{
-			//Vertex
-			float x, y, z;
-			file >> x >> y >> z;
-			positions.push_back(DirectX::XMFLOAT3(x, y, -z));
+			++lineNumber;
+			const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', chunk.pEnd - p));
+			if (pLineEnd == nullptr)
+				pLineEnd = chunk.pEnd;
+
+			const std::string_view command = OBJTokenizer::ReadWord(p, pLineEnd);
+			bool valid = true;
+
+			// The counting pass gave every attribute line a place, malformed ones keep theirs
+			if (command == "v")
+			{
+				float x{}, y{}, z{};
+				valid = OBJTokenizer::ReadFloat(p, pLineEnd, x) && OBJTokenizer::ReadFloat(p, pLineEnd, y) && OBJTokenizer::ReadFloat(p, pLineEnd, z);
+				positions[positionCount++] = valid ? DirectX::XMFLOAT3(x, y, flipZ ? -z : z) : DirectX::XMFLOAT3{};
+			}
+			else if (command == "vt")
+			{
+				DirectX::XMFLOAT2 uv{};
+				valid = ReadOBJTexCoord(p, pLineEnd, uv);
+				UVs[uvCount++] = uv;
+			}
+			else if (command == "vn")
+			{
+				float x{}, y{}, z{};
+				valid = OBJTokenizer::ReadFloat(p, pLineEnd, x) && OBJTokenizer::ReadFloat(p, pLineEnd, y) && OBJTokenizer::ReadFloat(p, pLineEnd, z);
+				normals[normalCount++] = valid ? DirectX::XMFLOAT3(x, y, z) : DirectX::XMFLOAT3{};
+			}
+			else if (command == "f")
+			{
+				Run& run = chunk.runs.back();
+				valid = ParseOBJFace(p, pLineEnd, positionCount, uvCount, normalCount, corners, vertexMap, run.indices, [&](const OBJVertexKey& key)
+				{
+					run.vertices.push_back(key);
+				});
+				if (valid)
+					++chunk.faceCount;
+			}
+			else if (command == "o" || command == "usemtl")
+			{
+				const bool isMaterial = command == "usemtl";
+				chunk.events.push_back(Event{ isMaterial, isMaterial ? OBJTokenizer::ReadWord(p, pLineEnd) : std::string_view{} });
+				chunk.runs.emplace_back();
+				vertexMap.clear();
+			}
+			else if (command == "mtllib")
+			{
+				AddOBJMaterialLibraries(p, pLineEnd, chunk.materialLibraries);
+			}
+
+			if (!valid)
+				AddOBJSkippedLine(lineNumber, chunk.skippedLineCount, chunk.firstSkippedLine);
+
+			p = pLineEnd + 1;
 		}
-		else if (sCommand == "vt")
+	}
+
+	// Welds the runs of one mesh together, first uses stay in file order so the vertex order matches the serial parse
+	inline void MergeMesh(const std::vector<Run*>& runs, const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<DirectX::XMFLOAT2>& UVs, const std::vector<DirectX::XMFLOAT3>& normals, Mesh_Struct& mesh)
+	{
+		OBJVertexMap vertexMap{};
+		size_t indexCount{};
+		for (Run* pRun : runs)
 		{
-			// Vertex TexCoord
-			float u, v;
-			file >> u >> v;
-			UVs.push_back(DirectX::XMFLOAT2(u, 1 - v));
+			pRun->remap.resize(pRun->vertices.size());
+			for (size_t i = 0; i < pRun->vertices.size(); ++i)
+			{
+				const auto [iter, inserted] = vertexMap.try_emplace(pRun->vertices[i], static_cast<uint32_t>(mesh.vertices.size()));
+				if (inserted)
+					mesh.vertices.push_back(MakeOBJVertex(pRun->vertices[i], positions, UVs, normals));
+				pRun->remap[i] = iter->second;
+			}
+
+			pRun->indexOffset = indexCount;
+			indexCount += pRun->indices.size();
 		}
-		else if (sCommand == "vn")
+
+		mesh.indices.resize(indexCount);
+	}
+}
+
+static bool ParseOBJDataChunked(const char* pData, size_t size, bool flipZ, bool splitMeshes, OBJParseResult& result)
+{
+	JobSystem* pJobSystem = JobSystem::GetInstance();
+	const size_t maxChunks = (pJobSystem->GetWorkerCount() + 1) * OBJChunked::g_ChunksPerThread;
+	const size_t chunkCount = (std::max)(size_t(1), (std::min)(maxChunks, size / OBJChunked::g_MinChunkSize));
+
+	// Split at line boundaries
+	std::vector<OBJChunked::Chunk> chunks(chunkCount);
+	const char* pEnd = pData + size;
+	const char* pBegin = pData;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const char* pChunkEnd = pEnd;
+		if (i + 1 < chunkCount)
 		{
-			// Vertex Normal
-			float x, y, z;
-			file >> x >> y >> z;
-			normals.push_back(DirectX::XMFLOAT3(x, y, z));
+			pChunkEnd = (std::max)(pBegin, pData + size * (i + 1) / chunkCount);
+			const char* pNewLine = static_cast<const char*>(memchr(pChunkEnd, '\n', pEnd - pChunkEnd));
+			pChunkEnd = pNewLine ? pNewLine + 1 : pEnd;
 		}
-		else if (sCommand == "f")
-		{
-			//if a face is read:
-			//construct the 3 vertices, add them to the vertex array
-			//add three indices to the index array
-			//add the material index as attibute to the attribute array
-			//
-			// Faces or triangles
-			Vertex vertex{};
-			size_t iPosition, iTexCoord, iNormal;
-			for (size_t iFace = 0; iFace < 3; iFace++)
-			{
-				// OBJ format uses 1-based arrays
-				file >> iPosition;
-				vertex.position = positions[iPosition - 1];
 
-				if ('/' == file.peek())//is next in buffer ==  '/' ?
-				{
-					file.ignore();//read and ignore one element ('/')
-
-					if ('/' != file.peek())
-					{
-						// Optional texture coordinate
-						file >> iTexCoord;
-						vertex.uv = UVs[iTexCoord - 1];
-					}
-
-					if ('/' == file.peek())
-					{
-						file.ignore();
-
-						// Optional vertex normal
-						file >> iNormal;
-						vertex.normal = normals[iNormal - 1];
-					}
-				}
-
-				vertices.push_back(vertex);
-				indices.push_back(uint32_t(vertices.size()) - 1);
-			}
+		chunks[i].pBegin = pBegin;
+		chunks[i].pEnd = pChunkEnd;
+		pBegin = pChunkEnd;
+	}
+
+	pJobSystem->ParallelFor(chunkCount, [&](size_t i) { OBJChunked::CountChunk(chunks[i]); });
+
+	size_t lineCount{}, positionCount{}, uvCount{}, normalCount{};
+	for (auto& chunk : chunks)
+	{
+		chunk.lineBase = lineCount;
+		chunk.positionBase = positionCount;
+		chunk.uvBase = uvCount;
+		chunk.normalBase = normalCount;
+
+		lineCount += chunk.lineCount;
+		positionCount += chunk.positionCount;
+		uvCount += chunk.uvCount;
+		normalCount += chunk.normalCount;
+	}
+
+	std::vector<DirectX::XMFLOAT3> positions(positionCount);
+	std::vector<DirectX::XMFLOAT2> UVs(uvCount);
+	std::vector<DirectX::XMFLOAT3> normals(normalCount);
+
+	pJobSystem->ParallelFor(chunkCount, [&](size_t i) { OBJChunked::ParseChunk(chunks[i], flipZ, positions, UVs, normals); });
+
+	for (const auto& chunk : chunks)
+	{
+		if (chunk.skippedLineCount > 0 && result.skippedLineCount == 0)
+			result.firstSkippedLine = chunk.lineBase + chunk.firstSkippedLine;
+		result.skippedLineCount += chunk.skippedLineCount;
+		result.faceCount += chunk.faceCount;
+
+		for (const auto& library : chunk.materialLibraries)
+		{
+			if (std::find(result.materialLibraries.begin(), result.materialLibraries.end(), library) == result.materialLibraries.end())
+				result.materialLibraries.push_back(library);
 		}
-		else if (sCommand == "o")
+	}
+
+	// Resolve the object and material boundaries in file order
+	std::vector<std::vector<OBJChunked::Run*>> meshRuns{};
+	std::vector<OBJChunked::Run*> currentRuns{};
+	std::string currentMaterial{};
+
+	auto flushMesh = [&]()
+	{
+		bool hasFaces = false;
+		for (const auto* pRun : currentRuns)
+			hasFaces |= !pRun->indices.empty();
+
+		if (hasFaces)
 		{
-			if(!vertices.empty() && !indices.empty())
-				meshes.push_back(Mesh_Struct{ vertices, indices, meshmatNames[meshmatNames.size() -1]});
-			
-			vertices.clear();
-			indices.clear();
+			Mesh_Struct mesh{};
+			mesh.materialName = currentMaterial;
+			result.meshes.emplace_back(std::move(mesh));
+			meshRuns.emplace_back(std::move(currentRuns));
 		}
-		else if (sCommand == "usemtl")
+		currentRuns.clear();
+	};
+
+	for (auto& chunk : chunks)
+	{
+		for (size_t i = 0; i < chunk.runs.size(); ++i)
 		{
-			std::string name;
-			file >> name;
+			currentRuns.push_back(&chunk.runs[i]);
+			if (i >= chunk.events.size())
+				continue;
 
-			meshmatNames.push_back(name);
+			const auto& event = chunk.events[i];
+			if (splitMeshes)
+				flushMesh();
 
-			if (!indices.empty() && !vertices.empty())
+			if (event.isMaterial)
 			{
-				//Create mesh
-				meshes.push_back(Mesh_Struct{ vertices, indices });
+				currentMaterial.assign(event.name.data(), event.name.size());
+				if (std::find(result.materialNames.begin(), result.materialNames.end(), currentMaterial) == result.materialNames.end())
+					result.materialNames.push_back(currentMaterial);
 			}
+		}
+	}
+	flushMesh();
 
-			auto mat = new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx", meshmatNames[meshmatNames.size() - 1]);
+	// Result meshes are only appended above, the new ones are at the back
+	const size_t firstMesh = result.meshes.size() - meshRuns.size();
+	pJobSystem->ParallelFor(meshRuns.size(), [&](size_t i) { OBJChunked::MergeMesh(meshRuns[i], positions, UVs, normals, result.meshes[firstMesh + i]); });
 
-			Texture* pDiffuseTexture = new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png");
-			mat->SetDiffuseMap(pDiffuseTexture);
+	std::vector<std::pair<OBJChunked::Run*, uint32_t*>> runTargets{};
+	for (size_t i = 0; i < meshRuns.size(); ++i)
+	{
+		for (auto* pRun : meshRuns[i])
+			runTargets.emplace_back(pRun, result.meshes[firstMesh + i].indices.data() + pRun->indexOffset);
+	}
 
-			pScene->AddMaterial(name, mat);
-		}
+	pJobSystem->ParallelFor(runTargets.size(), [&](size_t i)
+	{
+		const auto& [pRun, pTarget] = runTargets[i];
+		for (size_t index = 0; index < pRun->indices.size(); ++index)
+			pTarget[index] = pRun->remap[pRun->indices[index]];
+	});
+
+	LogOBJSkippedLines(result);
+	return true;
+}
+
+// Compares the welded meshes against one vertex per face corner, the layout before welding
+static void LogOBJWeldStatistics(const std::string& filename, const OBJParseResult& result)
+{
+	size_t vertexCount{};
+	size_t triangleCount{};
+	float missCount{};
+	for (const auto& mesh : result.meshes)
+	{
+		vertexCount += mesh.vertices.size();
+		triangleCount += mesh.indices.size() / 3;
 
-		//read till end of line and ignore all remaining chars
-		file.ignore(1000, '\n');
+		const auto statistics = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+		missCount += statistics.acmr * static_cast<float>(mesh.indices.size() / 3);
 	}
-	file.close();
 
-	// Create the final mesh
-	meshes.push_back(Mesh_Struct{ vertices, indices, meshmatNames[meshmatNames.size()-1] });
-	vertices.clear();
-	indices.clear();
-	for (auto& meshStruct : meshes)
-		CreateMesh(pMeshes, meshStruct, pScene, filename);
+	if (triangleCount == 0)
+		return;
+
+	// Every face of n corners is fanned into n - 2 triangles
+	const size_t cornerCount = triangleCount + 2 * result.faceCount;
+	const size_t savedBytes = (cornerCount - vertexCount) * sizeof(Vertex);
+	Logger::GetInstance()->LogDebug("OBJParser: " + filename + " welded " + std::to_string(cornerCount) + " corners into " + std::to_string(vertexCount)
+		+ " vertices (" + std::to_string(savedBytes / 1024) + " KB saved), ACMR " + std::to_string(static_cast<float>(cornerCount) / triangleCount)
+		+ " -> " + std::to_string(missCount / triangleCount));
+}
+
+static bool ParseOBJSource(const std::string& filename, const MappedFile& file, bool flipZ, bool splitMeshes, OBJParseResult& result)
+{
+	// Small files are not worth waking up the workers for
+	const bool chunked = file.GetSize() >= 4 * OBJChunked::g_MinChunkSize;
+	if (!(chunked ? ParseOBJDataChunked : ParseOBJData)(file.GetData(), file.GetSize(), flipZ, splitMeshes, result))
+		return false;
 
+	LogOBJWeldStatistics(filename, result);
 	return true;
 }
 
-static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+static bool ParseOBJFile(const std::string& filename, bool flipZ, bool splitMeshes, OBJParseResult& result)
 {
-	std::ifstream file(filename);
-	if (!file)
+	MappedFile file{ filename };
+	if (!file.IsOpen())
 		return false;
 
-	std::vector<DirectX::XMFLOAT3> positions;
-	std::vector<DirectX::XMFLOAT3> normals;
-	std::vector<DirectX::XMFLOAT2> UVs;
+	return ParseOBJSource(filename, file, flipZ, splitMeshes, result);
+}
 
-	vertices.clear();
-	indices.clear();
+// Everything the importer does to a parsed submesh before it is cooked: tangents, vertex order, lods, meshlets
+// and the vertex format. The golden tests run it on the demo models as well.
+static void ProcessOBJMesh(const std::string& name, Mesh_Struct& mesh)
+{
+	// Tangents first, mirrored uvs can split vertices and the optimizer puts those in fetch order as well
+	TangentSpace::GenerateTangents(mesh.vertices, mesh.indices);
+	MeshOptimizer::LogStatistics(name, MeshOptimizer::OptimizeMesh(mesh.vertices, mesh.indices));
+	mesh.lods = MeshSimplifier::GenerateLods(mesh.vertices, mesh.indices);
+
+	// Only the full detail level is culled per meshlet, the first lod always starts at index 0
+	if (mesh.lods[0].indexCount / 3 >= Meshlets::g_MinTriangles)
+		mesh.meshlets = Meshlets::Build(mesh.indices.data(), mesh.lods[0].indexCount, mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex));
+
+	VertexQuantization::Error error{};
+	mesh.vertexFormat = VertexQuantization::ChooseFormat(mesh.vertices.data(), mesh.vertices.size(), g_OBJQuantizationTolerance, &error);
+	Logger::GetInstance()->LogDebug("OBJParser: " + name + (mesh.vertexFormat == VertexFormat::Quantized ? " quantized" : " kept float")
+		+ ", error position " + std::to_string(error.position) + " normal " + std::to_string(error.normalDegrees) + " deg uv " + std::to_string(error.uv));
+}
 
-	std::string sCommand;
-	// start a while iteration ending when the end of file is reached (ios::eof)
-	while (!file.eof())
+// Returns the imported submeshes with tangents. An up to date cooked file is mapped as is,
+// otherwise the source is parsed and the result is cooked for the next run.
+static std::unique_ptr<CookedMesh> ImportOBJ(const std::string& filename, bool flipZ, bool splitMeshes)
+{
+	const auto start = std::chrono::steady_clock::now();
+	auto logTime = [&](const std::string& message)
 	{
-		//read the first word of the string, use the >> operator (istream::operator>>) 
-		file >> sCommand;
-		//use conditional statements to process the different commands	
-		if (sCommand == "#")
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Logger::GetInstance()->LogDebug("OBJParser: " + filename + " " + message + " in " + std::to_string(milliseconds) + " ms");
+	};
+
+	// Packed builds ship the cooked mesh without its source, it is used straight from the mapped pack
+	if (const AssetPack* pPack = ResourceManager::GetInstance()->GetPack())
+	{
+		const AssetPacker::IndexEntry* pEntry = pPack->Find(GetResourceId(filename));
+		if (pEntry != nullptr && pEntry->type == AssetType::Mesh && pEntry->flags == GetOBJImportFlags(flipZ, splitMeshes))
 		{
-			// Ignore Comment
+			auto pPacked = std::make_unique<CookedMesh>(pPack->GetData(*pEntry));
+			if (pPacked->IsValid())
+			{
+				logTime("mapped cooked mesh from the pack");
+				return pPacked;
+			}
 		}
-		else if (sCommand == "v")
+	}
+
+	MappedFile source{ filename };
+	if (!source.IsOpen())
+		return nullptr;
+
+	MeshCache::Key key{};
+	key.sourceHash = HashBytes(source.GetData(), source.GetSize());
+	key.sourceSize = source.GetSize();
+	key.importerVersion = g_OBJImporterVersion;
+	key.flags = GetOBJImportFlags(flipZ, splitMeshes);
+
+	const std::string cachePath = MeshCache::GetCachePath(filename, key.flags);
+	auto pCooked = std::make_unique<CookedMesh>(cachePath);
+	if (pCooked->Matches(key))
+	{
+		logTime("loaded cooked mesh");
+		return pCooked;
+	}
+	// Unmap the stale file so it can be replaced
+	pCooked.reset();
+
+	OBJParseResult result{};
+	if (!ParseOBJSource(filename, source, flipZ, splitMeshes, result))
+		return nullptr;
+
+	std::vector<MeshCache::Submesh> submeshes{};
+	submeshes.reserve(result.meshes.size());
+	for (size_t i = 0; i < result.meshes.size(); ++i)
+	{
+		Mesh_Struct& mesh = result.meshes[i];
+		ProcessOBJMesh(filename + " submesh " + std::to_string(i), mesh);
+		MeshCache::Submesh submesh{};
+		submesh.pVertices = mesh.vertices.data();
+		submesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		submesh.pIndices = mesh.indices.data();
+		submesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		submesh.pLods = mesh.lods.data();
+		submesh.lodCount = static_cast<uint32_t>(mesh.lods.size());
+		submesh.pMeshlets = mesh.meshlets.data();
+		submesh.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+		submesh.materialName = mesh.materialName;
+		submesh.vertexFormat = mesh.vertexFormat;
+		submeshes.push_back(submesh);
+	}
+
+	// Stored as the path the library is loaded by, packed builds do not have the source to resolve them against
+	const std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+	std::vector<std::string> materialLibraries{};
+	for (const auto& library : result.materialLibraries)
+		materialLibraries.push_back((directory / library).lexically_normal().generic_string());
+
+	std::vector<char> cooked = MeshCache::Cook(key, result.materialNames, materialLibraries, submeshes);
+	if (!MeshCache::WriteFile(cachePath, cooked))
+		Logger::GetInstance()->LogWarning("OBJParser: could not write the cooked mesh " + cachePath);
+
+	pCooked = std::make_unique<CookedMesh>(std::move(cooked));
+	if (!pCooked->IsValid())
+		return nullptr;
+
+	logTime("imported and cooked");
+	return pCooked;
+}
+
+// A material of a .mtl file, only what the engine materials can show
+struct OBJMaterial
+{
+	std::string name{};
+	std::string diffuseMap{};		// Resolved to a file that exists, empty when it has none or it was not found
+};
+
+static bool OBJAssetExists(const std::string& path)
+{
+	if (const AssetPack* pPack = ResourceManager::GetInstance()->GetPack(); pPack != nullptr && pPack->Find(GetResourceId(path)) != nullptr)
+		return true;
+
+	std::error_code error{};
+	return std::filesystem::is_regular_file(path, error);
+}
+
+// Texture paths in .mtl files are often absolute paths on the machine they were exported on. The path is tried
+// relative to the library first and then only its file name next to the library.
+static std::string ResolveOBJTexturePath(const std::filesystem::path& directory, std::string_view path)
+{
+	std::string generic(path);
+	std::replace(generic.begin(), generic.end(), '\\', '/');
+	const std::filesystem::path texture{ generic };
+
+	if (texture.is_relative())
+	{
+		std::string candidate = (directory / texture).lexically_normal().generic_string();
+		if (OBJAssetExists(candidate))
+			return candidate;
+	}
+
+	std::string candidate = (directory / texture.filename()).lexically_normal().generic_string();
+	if (OBJAssetExists(candidate))
+		return candidate;
+
+	return {};
+}
+
+// Skips the options in front of the file name of a map statement, e.g. map_Kd -s 1 1 1 -clamp on diffuse.png
+static std::string_view ReadMTLMapFile(const char* p, const char* pLineEnd)
+{
+	while (true)
+	{
+		p = OBJTokenizer::SkipSpaces(p, pLineEnd);
+		if (p >= pLineEnd || *p != '-')
+			return OBJTokenizer::ReadRest(p, pLineEnd);
+
+		const std::string_view option = OBJTokenizer::ReadWord(p, pLineEnd);
+		// The arguments are numbers, on/off or the channel of -imfchan
+		while (true)
 		{
-			//Vertex
-			float x, y, z;
-			file >> x >> y >> z;
-			positions.push_back(DirectX::XMFLOAT3(x, y, z));
+			const char* pArgument = p;
+			const std::string_view argument = OBJTokenizer::ReadWord(pArgument, pLineEnd);
+			float number{};
+			const char* pNumber = argument.data();
+			const bool isNumber = !argument.empty() && OBJTokenizer::ReadFloat(pNumber, argument.data() + argument.size(), number) && pNumber == argument.data() + argument.size();
+			const bool isSwitch = argument == "on" || argument == "off";
+			const bool isChannel = option == "-imfchan" && argument.size() == 1;
+			if (!isNumber && !isSwitch && !isChannel)
+				break;
+			p = pArgument;
 		}
-		else if (sCommand == "vt")
+	}
+}
+
+static void ParseMTLData(const char* pData, size_t size, const std::filesystem::path& directory, std::vector<OBJMaterial>& materials)
+{
+	const char* p = pData;
+	const char* pEnd = pData + size;
+	OBJMaterial* pMaterial{};
+
+	while (p < pEnd)
+	{
+		const char* pLineEnd = static_cast<const char*>(memchr(p, '\n', pEnd - p));
+		if (pLineEnd == nullptr)
+			pLineEnd = pEnd;
+
+		const std::string_view command = OBJTokenizer::ReadWord(p, pLineEnd);
+		if (command == "newmtl")
 		{
-			// Vertex TexCoord
-			float u, v;
-			file >> u >> v;
-			UVs.push_back(DirectX::XMFLOAT2(u, 1 - v));
+			const std::string_view name = OBJTokenizer::ReadRest(p, pLineEnd);
+			auto iter = std::find_if(materials.begin(), materials.end(), [name](const OBJMaterial& material) { return material.name == name; });
+			// The first library that describes a material wins
+			pMaterial = iter == materials.end() ? &materials.emplace_back(OBJMaterial{ std::string(name) }) : nullptr;
 		}
-		else if (sCommand == "vn")
+		else if (command == "map_Kd" && pMaterial != nullptr)
 		{
-			// Vertex Normal
-			float x, y, z;
-			file >> x >> y >> z;
-			normals.push_back(DirectX::XMFLOAT3(x, y, z));
+			const std::string_view file = ReadMTLMapFile(p, pLineEnd);
+			pMaterial->diffuseMap = ResolveOBJTexturePath(directory, file);
+			if (pMaterial->diffuseMap.empty())
+				Logger::GetInstance()->LogWarning("OBJParser: could not find the diffuse map " + std::string(file) + " of " + pMaterial->name);
 		}
-		else if (sCommand == "f")
+
+		p = pLineEnd + 1;
+	}
+}
+
+static std::vector<OBJMaterial> ParseOBJMaterialLibraries(const CookedMesh& cooked)
+{
+	std::vector<OBJMaterial> materials{};
+	for (const auto& library : cooked.GetMaterialLibraries())
+	{
+		const std::string filename{ library };
+		AssetFile file{ filename };
+		if (!file.IsOpen())
 		{
-			//if a face is read:
-			//construct the 3 vertices, add them to the vertex array
-			//add three indices to the index array
-			//add the material index as attibute to the attribute array
-			//
-			// Faces or triangles
-			Vertex vertex{};
-			size_t iPosition, iTexCoord, iNormal;
-			for (size_t iFace = 0; iFace < 3; iFace++)
-			{
-				// OBJ format uses 1-based arrays
-				file >> iPosition;
-				vertex.position = positions[iPosition - 1];
+			Logger::GetInstance()->LogWarning("OBJParser: could not read the material library " + filename);
+			continue;
+		}
 
-				if ('/' == file.peek())//is next in buffer ==  '/' ?
-				{
-					file.ignore();//read and ignore one element ('/')
-
-					if ('/' != file.peek())
-					{
-						// Optional texture coordinate
-						file >> iTexCoord;
-						vertex.uv = UVs[iTexCoord - 1];
-					}
-
-					if ('/' == file.peek())
-					{
-						file.ignore();
-
-						// Optional vertex normal
-						file >> iNormal;
-						vertex.normal = normals[iNormal - 1];
-					}
-				}
-
-				vertices.push_back(vertex);
-				indices.push_back(uint32_t(vertices.size()) - 1);
-			}
+		ParseMTLData(file.GetData(), file.GetSize(), std::filesystem::path(filename).parent_path(), materials);
+	}
+	return materials;
+}
+
+static MaterialDescription GetOBJMaterialDescription(const std::vector<OBJMaterial>& materials, std::string_view name)
+{
+	MaterialDescription description{ g_OBJEffectFile, g_OBJDefaultDiffuseMap };
+	const auto iter = std::find_if(materials.begin(), materials.end(), [name](const OBJMaterial& material) { return material.name == name; });
+	if (iter != materials.end() && !iter->diffuseMap.empty())
+		description.diffuseMap = iter->diffuseMap;
+	return description;
+}
+
+// Registers a material for every material name of the file that the material manager does not know yet. They share
+// their effect and textures, the libraries are only read when a material is missing.
+static void CreateOBJMaterials(const CookedMesh& cooked)
+{
+	MaterialManager* pMaterialManager = MaterialManager::GetInstance();
+
+	std::vector<OBJMaterial> materials{};
+	bool librariesParsed{ false };
+	for (const auto& name : cooked.GetMaterialNames())
+	{
+		const std::string materialName{ name };
+		if (pMaterialManager->GetMaterial(materialName) != nullptr)
+			continue;
+
+		if (!librariesParsed)
+		{
+			materials = ParseOBJMaterialLibraries(cooked);
+			librariesParsed = true;
 		}
-		//read till end of line and ignore all remaining chars
-		file.ignore(1000, '\n');
+		pMaterialManager->AddMaterial(materialName, GetOBJMaterialDescription(materials, name));
 	}
+}
 
-	for (uint32_t i = 0; i < indices.size(); i += 3)
+static bool ParseOBJ(const std::string& filename, std::vector<Mesh*>& m_pMeshes)
+{
+	const auto pCooked = ImportOBJ(filename, true, true);
+	if (!pCooked)
+		return false;
+
+	CreateOBJMaterials(*pCooked);
+
+	for (size_t i = 0; i < pCooked->GetSubmeshCount(); ++i)
+		CreateMesh(m_pMeshes, pCooked->GetSubmesh(i), filename);
+
+	return true;
+}
+
+static bool ParseOBJ(const std::string& filename,  std::vector<Mesh*>& pMeshes, Scene* pScene)
+{
+	const auto pCooked = ImportOBJ(filename, true, true);
+	if (!pCooked)
+		return false;
+
+	// The scene owns its materials, they still share the effect and the textures
+	const std::vector<OBJMaterial> materials = ParseOBJMaterialLibraries(*pCooked);
+	for (const auto& name : pCooked->GetMaterialNames())
 	{
-		uint32_t index0 = indices[i];
-		uint32_t index1 = indices[i + 1];
-		uint32_t index2 = indices[i + 2];
+		const std::string materialName{ name };
+		if (pScene->GetMaterial(materialName) != nullptr)
+			continue;
+
+		const MaterialDescription description = GetOBJMaterialDescription(materials, name);
+		auto mat = new Material(MyEngine::GetSingleton()->GetDevice(), description.effectFile, materialName);
+		mat->SetDiffuseMap(ResourceManager::GetInstance()->LoadTextureAsync(description.diffuseMap));
+
+		pScene->AddMaterial(materialName, mat);
+	}
 
-		const DirectX::XMVECTOR& p0 = DirectX::XMLoadFloat3(&vertices[index0].position);
-		const DirectX::XMVECTOR& p1 = DirectX::XMLoadFloat3(&vertices[index1].position);
-		const DirectX::XMVECTOR& p2 = DirectX::XMLoadFloat3(&vertices[index2].position);
-		const DirectX::XMFLOAT2& uv0 = vertices[index0].uv;
-		const DirectX::XMFLOAT2& uv1 = vertices[index1].uv;
-		const DirectX::XMFLOAT2& uv2 = vertices[index2].uv;
+	for (size_t i = 0; i < pCooked->GetSubmeshCount(); ++i)
+		CreateMesh(pMeshes, pCooked->GetSubmesh(i), pScene, filename);
 
-		const DirectX::XMVECTOR edge0 = DirectX::XMVectorSubtract(p1, p0);
-		const DirectX::XMVECTOR edge1 = DirectX::XMVectorSubtract(p2, p0);
+	return true;
+}
 
-		const auto diffx = DirectX::XMFLOAT2(uv1.x - uv0.x, uv2.x - uv0.x);
-		const auto diffy = DirectX::XMFLOAT2(uv1.y - uv0.y, uv2.y - uv0.y);
+static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
 
-		const DirectX::XMVECTOR diffX = DirectX::XMLoadFloat2(&diffx);
-		const DirectX::XMVECTOR diffY = DirectX::XMLoadFloat2(&diffy);
+	const auto pCooked = ImportOBJ(filename, false, false);
+	if (!pCooked)
+		return false;
 
-		float one = 1.0f;
-		auto oneVector = DirectX::XMLoadFloat(&one);
-		auto r = DirectX::XMVectorDivide(oneVector, DirectX::XMVector3Cross(diffX, diffY));
+	if (pCooked->GetSubmeshCount() == 0)
+		return true;
 
-		DirectX::XMFLOAT2 storedDiff;
-		DirectX::XMStoreFloat2(&storedDiff, diffY);
+	const MeshCache::Submesh& submesh = pCooked->GetSubmesh(0);
+	vertices.assign(submesh.pVertices, submesh.pVertices + submesh.vertexCount);
+	// Only the full detail level, the caller has no use for the lod ranges
+	const uint32_t indexCount = submesh.lodCount > 0 ? submesh.pLods[0].indexCount : submesh.indexCount;
+	indices.assign(submesh.pIndices, submesh.pIndices + indexCount);
 
-		DirectX::XMVECTOR tangent0 = DirectX::XMLoadFloat3(&vertices[index0].tangent);
-		DirectX::XMVECTOR tangent1 = DirectX::XMLoadFloat3(&vertices[index1].tangent);
-		DirectX::XMVECTOR tangent2 = DirectX::XMLoadFloat3(&vertices[index2].tangent);
+	return true;
+}
 
-		DirectX::XMVECTOR tangent = DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(DirectX::XMVectorMultiply(edge0, DirectX::XMLoadFloat(&storedDiff.y)), DirectX::XMVectorMultiply(edge1, DirectX::XMLoadFloat(&storedDiff.x))), r);
+static bool AreOBJResultsIdentical(const OBJParseResult& a, const OBJParseResult& b)
+{
+	if (a.meshes.size() != b.meshes.size() || a.materialNames != b.materialNames || a.materialLibraries != b.materialLibraries || a.faceCount != b.faceCount)
+		return false;
 
-		DirectX::XMVectorAdd(tangent0, tangent);
-		DirectX::XMVectorAdd(tangent1, tangent);
-		DirectX::XMVectorAdd(tangent2, tangent);
+	for (size_t i = 0; i < a.meshes.size(); ++i)
+	{
+		const Mesh_Struct& meshA = a.meshes[i];
+		const Mesh_Struct& meshB = b.meshes[i];
+		if (meshA.materialName != meshB.materialName || meshA.vertices.size() != meshB.vertices.size() || meshA.indices != meshB.indices)
+			return false;
 
-		DirectX::XMStoreFloat3(&vertices[index0].tangent, tangent0);
-		DirectX::XMStoreFloat3(&vertices[index1].tangent, tangent1);
-		DirectX::XMStoreFloat3(&vertices[index2].tangent, tangent2);
+		if (!meshA.vertices.empty() && memcmp(meshA.vertices.data(), meshB.vertices.data(), meshA.vertices.size() * sizeof(Vertex)) != 0)
+			return false;
 	}
-	for (auto& v : vertices)
+
+	return true;
+}
+
+// Parses every file a couple of times single and multithreaded, logs the best throughput of both
+// and checks that they produce exactly the same meshes
+static void BenchmarkOBJParser(const std::vector<std::string>& filenames, int iterations = 5)
+{
+	for (const auto& filename : filenames)
 	{
-		auto tangent = DirectX::XMLoadFloat3(&v.tangent);
-		auto normal = DirectX::XMLoadFloat3(&v.normal);
+		MappedFile file{ filename };
+		if (!file.IsOpen() || file.GetSize() == 0)
+			continue;
 
-		auto project = DirectX::XMVectorMultiply(normal, DirectX::XMVectorDivide(DirectX::XMVector3Dot(normal, tangent), DirectX::XMVectorSqrt(normal)));
+		auto measure = [&](auto parse, OBJParseResult& result)
+		{
+			double bestSeconds = DBL_MAX;
+			for (int i = 0; i < iterations; ++i)
+			{
+				result = OBJParseResult{};
 
-		tangent = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(tangent, project));
+				const auto start = std::chrono::steady_clock::now();
+				parse(file.GetData(), file.GetSize(), true, true, result);
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-		DirectX::XMStoreFloat3(&v.tangent, tangent);
-	}
+				if (seconds < bestSeconds)
+					bestSeconds = seconds;
+			}
+			return bestSeconds;
+		};
 
-	return true;
-}
\ No newline at end of file
+		OBJParseResult serialResult{};
+		OBJParseResult chunkedResult{};
+		const double serialSeconds = measure(ParseOBJData, serialResult);
+		const double chunkedSeconds = measure(ParseOBJDataChunked, chunkedResult);
+
+		const double megabytes = static_cast<double>(file.GetSize()) / (1024.0 * 1024.0);
+		Logger::GetInstance()->LogInfo("OBJParser: " + filename + " " + std::to_string(megabytes) + " MB, 1 thread " + std::to_string(serialSeconds * 1000.0) + " ms ("
+			+ std::to_string(megabytes / serialSeconds) + " MB/s), " + std::to_string(JobSystem::GetInstance()->GetWorkerCount() + 1) + " threads "
+			+ std::to_string(chunkedSeconds * 1000.0) + " ms (" + std::to_string(megabytes / chunkedSeconds) + " MB/s)");
+
+		if (!AreOBJResultsIdentical(serialResult, chunkedResult))
+			Logger::GetInstance()->LogWarning("OBJParser: " + filename + " multithreaded parse does not match the single threaded parse");
+	}
+}
@@ -21,7 +21,7 @@ ParticleComponent::ParticleComponent(int particleCount)
 	, m_ParticleCount{ particleCount }
 	, m_MaxParticles{ particleCount }
 	, m_EmitterSettings{ }
-	, m_pTexture{ new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/uv_grid_2.png") }
+	, m_Texture{ ResourceManager::GetInstance()->LoadTextureAsync("Resources/uv_grid_2.png") }
 	, m_pMaterial{ new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/ParticleRenderer.fx", "Particle_Material") }
 {
 }
@@ -32,7 +32,7 @@ ParticleComponent::ParticleComponent(const std::string& textureFile, const Parti
 	, m_ParticleCount{particleCount}
 	, m_MaxParticles{particleCount}
 	, m_EmitterSettings{emmiterSettings}
-	, m_pTexture{new Texture(MyEngine::GetSingleton()->GetDevice(), textureFile)}
+	, m_Texture{ResourceManager::GetInstance()->LoadTextureAsync(textureFile)}
 	, m_pMaterial{new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/ParticleRenderer.fx", "Particle_Material")}
 {
 }
@@ -40,7 +40,6 @@ ParticleComponent::ParticleComponent(const std::string& textureFile, const Parti
 ParticleComponent::~ParticleComponent()
 {
 	delete m_pMaterial;
-	delete m_pTexture;
 
 	delete m_pParticleArray;
 	delete m_pParticleBuffer;
@@ -50,7 +49,12 @@ ParticleComponent::~ParticleComponent()
 
 void ParticleComponent::Start()
 {
-	//m_pMaterial->SetDiffuseMap(m_pTexture);
+	// Every emitter shares the effect, so its variables are set again on every draw
+	ID3DX11Effect* pEffect = m_pMaterial->GetEffect();
+	m_pWorldViewProjVariable = pEffect->GetVariableByName("gWorldViewProj")->AsMatrix();
+	m_pViewInverseVariable = pEffect->GetVariableByName("gViewInverse")->AsMatrix();
+	m_pTextureVariable = pEffect->GetVariableByName("gParticleTexture")->AsShaderResource();
+
 	if(!m_pInputLayout)
 		CreateInputLayout();
 	if(!m_pVertexBuffer)
@@ -63,9 +67,10 @@ void ParticleComponent::Render()
 	auto worldViewProj = camera->GetViewProjection();
 	auto viewInv = camera->GetViewInv();
 
-	m_pMaterial->GetEffect()->GetVariableByName("gWorldViewProj")->AsMatrix()->SetMatrix(&worldViewProj._11);
-	m_pMaterial->GetEffect()->GetVariableByName("gViewInverse")->AsMatrix()->SetMatrix(&viewInv._11);
-	m_pMaterial->GetEffect()->GetVariableByName("gParticleTexture")->AsShaderResource()->SetResource(m_pTexture->GetTextureShaderResource());
+	m_pWorldViewProjVariable->SetMatrix(&worldViewProj._11);
+	m_pViewInverseVariable->SetMatrix(&viewInv._11);
+	const Texture* pTexture = m_Texture.Get();
+	m_pTextureVariable->SetResource(pTexture != nullptr ? pTexture->GetTextureShaderResource() : nullptr);
 
 	auto pDeviceContext = MyEngine::GetSingleton()->GetDeviceContext();
 
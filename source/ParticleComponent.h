@@ -1,6 +1,8 @@
 #pragma once
 #include "Component.h"
+#include "ResourceHandle.h"
 #include <d3d11.h>
+#include <d3dx11effect.h>
 
 struct ParticleEmmiterSettings
 {
@@ -64,10 +66,14 @@ private:
 	void UpdateParticle(Particle& particle, float dt);
 	void SpawnParticle(Particle& particle);
 
-	Texture* m_pTexture{};
+	// Shared with every other emitter of the same texture
+	TextureHandle m_Texture{};
 
 	Particle* m_pParticleArray{};
 	Material* m_pMaterial{};
+	ID3DX11EffectMatrixVariable* m_pWorldViewProjVariable{};
+	ID3DX11EffectMatrixVariable* m_pViewInverseVariable{};
+	ID3DX11EffectShaderResourceVariable* m_pTextureVariable{};
 	VertexParticle* m_pParticleBuffer{};
 
 	int m_ParticleCount{};
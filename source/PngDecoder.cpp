@@ -0,0 +1,390 @@
+#include "ImageDecoder.h"
+#include "Inflate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	enum ColorType : uint8_t
+	{
+		Gray = 0,
+		Rgb = 2,
+		Palette = 3,
+		GrayAlpha = 4,
+		Rgba = 6
+	};
+
+	// The largest side accepted, keeps the size calculations far away from overflowing
+	constexpr uint32_t g_MaxSize{ 1 << 15 };
+
+	struct Header
+	{
+		uint32_t width{};
+		uint32_t height{};
+		uint8_t bitDepth{};
+		uint8_t colorType{};
+		bool interlaced{};
+
+		uint32_t GetChannelCount() const
+		{
+			switch (colorType)
+			{
+			case Rgb: return 3;
+			case GrayAlpha: return 2;
+			case Rgba: return 4;
+			default: return 1;
+			}
+		}
+
+		size_t GetRowSize(uint32_t pixelCount) const
+		{
+			return (size_t(pixelCount) * GetChannelCount() * bitDepth + 7) / 8;
+		}
+
+		// The byte a filter compares with, whole pixels or 1 for the packed depths
+		size_t GetFilterStride() const
+		{
+			return (std::max)(size_t(1), size_t(GetChannelCount()) * bitDepth / 8);
+		}
+	};
+
+	// Chunk data the pixels need besides the header
+	struct ColorInfo
+	{
+		uint32_t palette[256]{};	// RGBA, as packed in Image
+		uint32_t paletteSize{};
+		bool hasColorKey{};
+		uint16_t colorKey[3]{};		// Gray or RGB sample that is transparent, at the bit depth of the file
+	};
+
+	// Adam7, 7 reduced images that together cover every pixel
+	struct Pass
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t stepX;
+		uint32_t stepY;
+	};
+	constexpr Pass g_Passes[7]{ { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+
+	// Pixels of a pass along one side, passes that start past the edge are empty
+	inline uint32_t GetPassSize(uint32_t size, uint32_t start, uint32_t step)
+	{
+		return size > start ? (size - start + step - 1) / step : 0;
+	}
+
+	inline uint32_t ReadBigEndian32(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+	}
+
+	// Little endian, the bytes end up in R, G, B, A order
+	inline uint32_t PackRgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	inline uint8_t Paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<uint8_t>(a);
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
+
+	// Undoes the filter of every row in place, the filter type byte stays in front of each row
+	bool Unfilter(uint8_t* pData, size_t rowSize, uint32_t rowCount, size_t stride)
+	{
+		// The row above the first one is all zeros
+		const std::vector<uint8_t> zeros(rowSize);
+		const uint8_t* pUp = zeros.data();
+		for (uint32_t y = 0; y < rowCount; ++y)
+		{
+			uint8_t* pRow = pData + y * (rowSize + 1);
+			const uint8_t filter = *pRow++;
+			const size_t first = (std::min)(stride, rowSize);
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1:
+				for (size_t i = stride; i < rowSize; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + pRow[i - stride]);
+				break;
+			case 2:
+				for (size_t i = 0; i < rowSize; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + pUp[i]);
+				break;
+			case 3:
+				for (size_t i = 0; i < first; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + (pUp[i] >> 1));
+				for (size_t i = first; i < rowSize; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + ((pRow[i - stride] + pUp[i]) >> 1));
+				break;
+			case 4:
+				// Without a left neighbour Paeth always picks the byte above
+				for (size_t i = 0; i < first; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + pUp[i]);
+				for (size_t i = first; i < rowSize; ++i)
+					pRow[i] = static_cast<uint8_t>(pRow[i] + Paeth(pRow[i - stride], pUp[i], pUp[i - stride]));
+				break;
+			default:
+				return false;
+			}
+			pUp = pRow;
+		}
+		return true;
+	}
+
+	inline uint32_t GetSample(const uint8_t* pRow, size_t index, uint8_t bitDepth)
+	{
+		switch (bitDepth)
+		{
+		case 16:
+			return (uint32_t(pRow[index * 2]) << 8) | pRow[index * 2 + 1];
+		case 8:
+			return pRow[index];
+		default:
+		{
+			// Packed from the highest bits down
+			const size_t bit = index * bitDepth;
+			const uint32_t shift = 8 - bitDepth - static_cast<uint32_t>(bit & 7);
+			return (pRow[bit >> 3] >> shift) & ((1u << bitDepth) - 1);
+		}
+		}
+	}
+
+	// Scales a sample to 8 bits, the low depths are stretched so their maximum becomes 255
+	inline uint32_t To8Bit(uint32_t sample, uint8_t bitDepth)
+	{
+		switch (bitDepth)
+		{
+		case 1: return sample * 255;
+		case 2: return sample * 85;
+		case 4: return sample * 17;
+		case 16: return sample >> 8;
+		default: return sample;
+		}
+	}
+
+	// One unfiltered row to RGBA, pDst advances by dstStep pixels so interlaced passes land in their place
+	void ConvertRow(const uint8_t* pRow, uint32_t count, const Header& header, const ColorInfo& info, uint32_t* pDst, size_t dstStep)
+	{
+		const uint8_t depth = header.bitDepth;
+
+		// The common files first, without any per sample work
+		if (depth == 8 && header.colorType == Rgba && dstStep == 1)
+		{
+			memcpy(pDst, pRow, size_t(count) * 4);
+			return;
+		}
+		if (depth == 8 && header.colorType == Rgb && !info.hasColorKey)
+		{
+			for (uint32_t x = 0; x < count; ++x, pRow += 3)
+				pDst[x * dstStep] = PackRgba(pRow[0], pRow[1], pRow[2], 255);
+			return;
+		}
+
+		for (uint32_t x = 0; x < count; ++x)
+		{
+			uint32_t& dst = pDst[x * dstStep];
+			switch (header.colorType)
+			{
+			case Gray:
+			{
+				const uint32_t sample = GetSample(pRow, x, depth);
+				const uint32_t gray = To8Bit(sample, depth);
+				dst = PackRgba(gray, gray, gray, info.hasColorKey && sample == info.colorKey[0] ? 0 : 255);
+				break;
+			}
+			case GrayAlpha:
+			{
+				const uint32_t gray = To8Bit(GetSample(pRow, x * 2, depth), depth);
+				dst = PackRgba(gray, gray, gray, To8Bit(GetSample(pRow, x * 2 + 1, depth), depth));
+				break;
+			}
+			case Rgb:
+			{
+				const uint32_t r = GetSample(pRow, x * 3, depth);
+				const uint32_t g = GetSample(pRow, x * 3 + 1, depth);
+				const uint32_t b = GetSample(pRow, x * 3 + 2, depth);
+				const bool transparent = info.hasColorKey && r == info.colorKey[0] && g == info.colorKey[1] && b == info.colorKey[2];
+				dst = PackRgba(To8Bit(r, depth), To8Bit(g, depth), To8Bit(b, depth), transparent ? 0 : 255);
+				break;
+			}
+			case Rgba:
+				dst = PackRgba(To8Bit(GetSample(pRow, x * 4, depth), depth), To8Bit(GetSample(pRow, x * 4 + 1, depth), depth),
+					To8Bit(GetSample(pRow, x * 4 + 2, depth), depth), To8Bit(GetSample(pRow, x * 4 + 3, depth), depth));
+				break;
+			case Palette:
+			{
+				// An index outside the palette is black, like most decoders do
+				const uint32_t index = GetSample(pRow, x, depth);
+				dst = index < info.paletteSize ? info.palette[index] : PackRgba(0, 0, 0, 255);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+
+	bool IsValidDepth(const Header& header)
+	{
+		switch (header.colorType)
+		{
+		case Gray:
+			return header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8 || header.bitDepth == 16;
+		case Palette:
+			return header.bitDepth == 1 || header.bitDepth == 2 || header.bitDepth == 4 || header.bitDepth == 8;
+		case Rgb: case GrayAlpha: case Rgba:
+			return header.bitDepth == 8 || header.bitDepth == 16;
+		default:
+			return false;
+		}
+	}
+
+	bool Fail(std::string* pError, const char* pMessage)
+	{
+		if (pError)
+			*pError = pMessage;
+		return false;
+	}
+}
+
+bool ImageDecoder::DecodePng(const uint8_t* pData, size_t size, Image& image, std::string* pError)
+{
+	constexpr uint8_t signature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (size < sizeof(signature) || memcmp(pData, signature, sizeof(signature)) != 0)
+		return Fail(pError, "not a PNG file");
+
+	Header header{};
+	ColorInfo info{};
+	bool hasHeader{};
+	bool ended{};
+	// IDAT chunks are one zlib stream split up, they are joined before inflating
+	std::vector<uint8_t> compressed{};
+
+	size_t offset = sizeof(signature);
+	while (!ended)
+	{
+		if (size - offset < 12)
+			return Fail(pError, "truncated chunk");
+
+		const uint32_t length = ReadBigEndian32(pData + offset);
+		const uint8_t* pType = pData + offset + 4;
+		const uint8_t* pChunk = pData + offset + 8;
+		if (length > size - offset - 12)
+			return Fail(pError, "truncated chunk");
+		offset += size_t(length) + 12;
+
+		if (memcmp(pType, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+				return Fail(pError, "bad header");
+			header.width = ReadBigEndian32(pChunk);
+			header.height = ReadBigEndian32(pChunk + 4);
+			header.bitDepth = pChunk[8];
+			header.colorType = pChunk[9];
+			header.interlaced = pChunk[12] == 1;
+			if (header.width == 0 || header.height == 0 || header.width > g_MaxSize || header.height > g_MaxSize)
+				return Fail(pError, "unsupported image size");
+			if (!IsValidDepth(header) || pChunk[10] != 0 || pChunk[11] != 0 || pChunk[12] > 1)
+				return Fail(pError, "unsupported color type or bit depth");
+			hasHeader = true;
+		}
+		else if (!hasHeader)
+			return Fail(pError, "missing header");
+		else if (memcmp(pType, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length / 3 > 256)
+				return Fail(pError, "bad palette");
+			info.paletteSize = length / 3;
+			for (uint32_t i = 0; i < info.paletteSize; ++i)
+				info.palette[i] = PackRgba(pChunk[i * 3], pChunk[i * 3 + 1], pChunk[i * 3 + 2], 255);
+		}
+		else if (memcmp(pType, "tRNS", 4) == 0)
+		{
+			if (header.colorType == Palette)
+			{
+				for (uint32_t i = 0; i < (std::min)(length, info.paletteSize); ++i)
+					info.palette[i] = (info.palette[i] & 0x00FFFFFF) | (uint32_t(pChunk[i]) << 24);
+			}
+			else if (header.colorType == Gray && length >= 2)
+			{
+				info.colorKey[0] = static_cast<uint16_t>((pChunk[0] << 8) | pChunk[1]);
+				info.hasColorKey = true;
+			}
+			else if (header.colorType == Rgb && length >= 6)
+			{
+				for (int i = 0; i < 3; ++i)
+					info.colorKey[i] = static_cast<uint16_t>((pChunk[i * 2] << 8) | pChunk[i * 2 + 1]);
+				info.hasColorKey = true;
+			}
+		}
+		else if (memcmp(pType, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), pChunk, pChunk + length);
+		else if (memcmp(pType, "IEND", 4) == 0)
+			ended = true;
+		// Chunks with a lowercase first letter can be skipped, anything else changes how the pixels are read
+		else if ((pType[0] & 32) == 0)
+			return Fail(pError, "unknown critical chunk");
+	}
+
+	if (header.colorType == Palette && info.paletteSize == 0)
+		return Fail(pError, "missing palette");
+
+	// Every row starts with its filter type
+	size_t filteredSize{};
+	for (const Pass& pass : g_Passes)
+	{
+		const uint32_t passWidth = header.interlaced ? GetPassSize(header.width, pass.x, pass.stepX) : header.width;
+		const uint32_t passHeight = header.interlaced ? GetPassSize(header.height, pass.y, pass.stepY) : header.height;
+		if (passWidth > 0 && passHeight > 0)
+			filteredSize += (header.GetRowSize(passWidth) + 1) * passHeight;
+		if (!header.interlaced)
+			break;
+	}
+
+	std::vector<uint8_t> filtered{};
+	if (!Inflate::DecompressZlib(compressed.data(), compressed.size(), filtered, filteredSize) || filtered.size() < filteredSize)
+		return Fail(pError, "corrupt image data");
+	compressed = std::vector<uint8_t>{};
+
+	image.width = header.width;
+	image.height = header.height;
+	image.format = ImageFormat::RGBA8;
+	image.pixels.resize(size_t(header.width) * header.height * 4);
+	uint32_t* pPixels = reinterpret_cast<uint32_t*>(image.pixels.data());
+
+	const size_t stride = header.GetFilterStride();
+	uint8_t* pFiltered = filtered.data();
+	for (const Pass& pass : g_Passes)
+	{
+		const Pass current = header.interlaced ? pass : Pass{ 0, 0, 1, 1 };
+		const uint32_t passWidth = GetPassSize(header.width, current.x, current.stepX);
+		const uint32_t passHeight = GetPassSize(header.height, current.y, current.stepY);
+		if (passWidth > 0 && passHeight > 0)
+		{
+			const size_t rowSize = header.GetRowSize(passWidth);
+			if (!Unfilter(pFiltered, rowSize, passHeight, stride))
+				return Fail(pError, "bad filter type");
+
+			for (uint32_t y = 0; y < passHeight; ++y)
+			{
+				uint32_t* pDst = pPixels + size_t(current.y + y * current.stepY) * header.width + current.x;
+				ConvertRow(pFiltered + y * (rowSize + 1) + 1, passWidth, header, info, pDst, current.stepX);
+			}
+			pFiltered += (rowSize + 1) * passHeight;
+		}
+		if (!header.interlaced)
+			break;
+	}
+
+	return true;
+}
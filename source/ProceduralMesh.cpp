@@ -0,0 +1,339 @@
+#include "ProceduralMesh.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "ResourceManager.h"
+#include "TangentSpace.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	void Reserve(const ProceduralMesh::Counts& counts, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		vertices.clear();
+		indices.clear();
+		vertices.reserve(counts.vertexCount);
+		indices.reserve(counts.indexCount);
+	}
+
+	// Quads between the rows of a grid of rows x (columns + 1) vertices that starts at first, the last column repeats the
+	// first for the uv seam. A row that is a pole only gets the triangles that are not degenerate.
+	void AddGridIndices(std::vector<uint32_t>& indices, uint32_t first, int rows, int columns, bool topPole, bool bottomPole)
+	{
+		const uint32_t stride = static_cast<uint32_t>(columns) + 1;
+		for (int row = 0; row + 1 < rows; ++row)
+		{
+			const uint32_t top = first + static_cast<uint32_t>(row) * stride;
+			const uint32_t bottom = top + stride;
+			for (uint32_t column = 0; column < static_cast<uint32_t>(columns); ++column)
+			{
+				const uint32_t topLeft = top + column;
+				const uint32_t topRight = topLeft + 1;
+				const uint32_t bottomRight = bottom + column + 1;
+				const uint32_t bottomLeft = bottom + column;
+
+				if (!(topPole && row == 0))
+					indices.insert(indices.end(), { topLeft, topRight, bottomRight });
+				if (!(bottomPole && row + 2 == rows))
+					indices.insert(indices.end(), { bottomRight, bottomLeft, topLeft });
+			}
+		}
+	}
+
+	// A ring of the surface of revolution around the y axis, columns + 1 vertices so the seam gets both u = 0 and 1
+	void AddRing(std::vector<Vertex>& vertices, int columns, float radius, float y, float normalY, float v)
+	{
+		const float normalScale = std::sqrt((std::max)(0.f, 1.f - normalY * normalY));
+		for (int column = 0; column <= columns; ++column)
+		{
+			const float u = static_cast<float>(column) / columns;
+			const float phi = u * 2.f * F_PI;
+			const float cosPhi = std::cos(phi);
+			const float sinPhi = std::sin(phi);
+
+			vertices.push_back(Vertex{ XMFLOAT3{ radius * cosPhi, y, radius * sinPhi }, XMFLOAT3{ normalScale * cosPhi, normalY, normalScale * sinPhi },
+				XMFLOAT4{}, XMFLOAT2{ u, v } });
+		}
+	}
+
+	// A flat disc facing up or down, the center followed by the rim
+	void AddCap(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int columns, float radius, float y, bool up)
+	{
+		const uint32_t center = static_cast<uint32_t>(vertices.size());
+		const float normalY = up ? 1.f : -1.f;
+		vertices.push_back(Vertex{ XMFLOAT3{ 0.f, y, 0.f }, XMFLOAT3{ 0.f, normalY, 0.f }, XMFLOAT4{}, XMFLOAT2{ 0.5f, 0.5f } });
+
+		for (int column = 0; column < columns; ++column)
+		{
+			const float phi = static_cast<float>(column) / columns * 2.f * F_PI;
+			const float cosPhi = std::cos(phi);
+			const float sinPhi = std::sin(phi);
+			vertices.push_back(Vertex{ XMFLOAT3{ radius * cosPhi, y, radius * sinPhi }, XMFLOAT3{ 0.f, normalY, 0.f }, XMFLOAT4{},
+				XMFLOAT2{ 0.5f + 0.5f * cosPhi, 0.5f - 0.5f * normalY * sinPhi } });
+		}
+
+		// The angle runs counterclockwise seen from above and clockwise seen from below
+		for (uint32_t column = 0; column < static_cast<uint32_t>(columns); ++column)
+		{
+			const uint32_t current = center + 1 + column;
+			const uint32_t next = center + 1 + (column + 1) % static_cast<uint32_t>(columns);
+			if (up)
+				indices.insert(indices.end(), { center, next, current });
+			else
+				indices.insert(indices.end(), { center, current, next });
+		}
+	}
+
+	void AppendFloat(std::string& name, float value)
+	{
+		char buffer[32];
+		const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		name.append(buffer, result.ptr);
+	}
+
+	template<typename Generate>
+	MeshHandle CreateMesh(const std::string& name, Generate generate)
+	{
+		ResourceManager* pResourceManager = ResourceManager::GetInstance();
+		if (pResourceManager->GetMeshConst(name) != nullptr)
+			return pResourceManager->GetMesh(name);
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		generate(vertices, indices);
+		MeshOptimizer::LogStatistics(name, MeshOptimizer::OptimizeMesh(vertices, indices));
+
+		// Registers itself with the resource manager under its name, which owns it from then on
+		new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), vertices, indices, name);
+		return pResourceManager->GetMesh(name);
+	}
+}
+
+ProceduralMesh::Counts ProceduralMesh::GetBoxCounts()
+{
+	return Counts{ 24, 36 };
+}
+
+ProceduralMesh::Counts ProceduralMesh::GetSphereCounts(int slices, int stacks)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	stacks = (std::max)(stacks, g_MinStacks);
+	return Counts{ static_cast<size_t>(slices + 1) * (stacks + 1), static_cast<size_t>(6) * slices * (stacks - 1) };
+}
+
+ProceduralMesh::Counts ProceduralMesh::GetPlaneCounts(int subdivisionsX, int subdivisionsZ)
+{
+	subdivisionsX = (std::max)(subdivisionsX, g_MinSubdivisions);
+	subdivisionsZ = (std::max)(subdivisionsZ, g_MinSubdivisions);
+	return Counts{ static_cast<size_t>(subdivisionsX + 1) * (subdivisionsZ + 1), static_cast<size_t>(6) * subdivisionsX * subdivisionsZ };
+}
+
+ProceduralMesh::Counts ProceduralMesh::GetCylinderCounts(int slices)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	// Two rings for the side, a center and a rim for each cap
+	return Counts{ static_cast<size_t>(4) * (slices + 1), static_cast<size_t>(12) * slices };
+}
+
+ProceduralMesh::Counts ProceduralMesh::GetCapsuleCounts(int slices, int stacks)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	stacks = (std::max)(stacks, g_MinCapStacks);
+	// Both caps end in their own copy of the equator ring, the side is the band between them
+	return Counts{ static_cast<size_t>(2 * stacks + 2) * (slices + 1), static_cast<size_t>(12) * slices * stacks };
+}
+
+void ProceduralMesh::GenerateBox(float width, float height, float depth, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	Reserve(GetBoxCounts(), vertices, indices);
+
+	// The normal and the up direction of every face, right is their cross product so the corners go clockwise from outside
+	const XMFLOAT3 faces[6][2]
+	{
+		{ { 0, 0, -1 }, { 0, 1, 0 } },
+		{ { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { -1, 0, 0 }, { 0, 1, 0 } },
+		{ { 1, 0, 0 }, { 0, 1, 0 } },
+		{ { 0, 1, 0 }, { 0, 0, 1 } },
+		{ { 0, -1, 0 }, { 0, 0, -1 } },
+	};
+	const XMVECTOR halfExtents = XMVectorSet(width / 2.f, height / 2.f, depth / 2.f, 0.f);
+	constexpr float corners[4][2]{ { -1, 1 }, { 1, 1 }, { 1, -1 }, { -1, -1 } };
+
+	for (const auto& face : faces)
+	{
+		const XMVECTOR normal = XMLoadFloat3(&face[0]);
+		const XMVECTOR up = XMLoadFloat3(&face[1]);
+		const XMVECTOR right = XMVector3Cross(normal, up);
+
+		const uint32_t first = static_cast<uint32_t>(vertices.size());
+		for (const auto& corner : corners)
+		{
+			Vertex vertex{};
+			XMStoreFloat3(&vertex.position, XMVectorMultiply(XMVectorAdd(normal, XMVectorAdd(XMVectorScale(right, corner[0]), XMVectorScale(up, corner[1]))), halfExtents));
+			vertex.normal = face[0];
+			vertex.uv = XMFLOAT2{ (corner[0] + 1.f) / 2.f, (1.f - corner[1]) / 2.f };
+			vertices.push_back(vertex);
+		}
+		indices.insert(indices.end(), { first, first + 1, first + 2, first + 2, first + 3, first });
+	}
+
+	TangentSpace::GenerateTangents(vertices, indices);
+}
+
+void ProceduralMesh::GenerateSphere(float radius, int slices, int stacks, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	stacks = (std::max)(stacks, g_MinStacks);
+	Reserve(GetSphereCounts(slices, stacks), vertices, indices);
+
+	for (int stack = 0; stack <= stacks; ++stack)
+	{
+		const float v = static_cast<float>(stack) / stacks;
+		const float cosTheta = std::cos(v * F_PI);
+		AddRing(vertices, slices, radius * std::sin(v * F_PI), radius * cosTheta, cosTheta, v);
+	}
+	AddGridIndices(indices, 0, stacks + 1, slices, true, true);
+
+	TangentSpace::GenerateTangents(vertices, indices);
+}
+
+void ProceduralMesh::GeneratePlane(float width, float depth, int subdivisionsX, int subdivisionsZ, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	subdivisionsX = (std::max)(subdivisionsX, g_MinSubdivisions);
+	subdivisionsZ = (std::max)(subdivisionsZ, g_MinSubdivisions);
+	Reserve(GetPlaneCounts(subdivisionsX, subdivisionsZ), vertices, indices);
+
+	// Rows run from the far edge to the near one, seen from above +z is up
+	for (int row = 0; row <= subdivisionsZ; ++row)
+	{
+		const float v = static_cast<float>(row) / subdivisionsZ;
+		for (int column = 0; column <= subdivisionsX; ++column)
+		{
+			const float u = static_cast<float>(column) / subdivisionsX;
+			vertices.push_back(Vertex{ XMFLOAT3{ (u - 0.5f) * width, 0.f, (0.5f - v) * depth }, XMFLOAT3{ 0.f, 1.f, 0.f }, XMFLOAT4{}, XMFLOAT2{ u, v } });
+		}
+	}
+	AddGridIndices(indices, 0, subdivisionsZ + 1, subdivisionsX, false, false);
+
+	TangentSpace::GenerateTangents(vertices, indices);
+}
+
+void ProceduralMesh::GenerateCylinder(float radius, float height, int slices, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	Reserve(GetCylinderCounts(slices), vertices, indices);
+
+	const float halfHeight = height / 2.f;
+	AddRing(vertices, slices, radius, halfHeight, 0.f, 0.f);
+	AddRing(vertices, slices, radius, -halfHeight, 0.f, 1.f);
+	AddGridIndices(indices, 0, 2, slices, false, false);
+
+	AddCap(vertices, indices, slices, radius, halfHeight, true);
+	AddCap(vertices, indices, slices, radius, -halfHeight, false);
+
+	TangentSpace::GenerateTangents(vertices, indices);
+}
+
+void ProceduralMesh::GenerateCapsule(float radius, float height, int slices, int stacks, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	slices = (std::max)(slices, g_MinSlices);
+	stacks = (std::max)(stacks, g_MinCapStacks);
+	Reserve(GetCapsuleCounts(slices, stacks), vertices, indices);
+
+	height = (std::max)(height, 2.f * radius);
+	const float halfCylinder = height / 2.f - radius;
+
+	// Pole to equator of the top cap, then equator to pole of the bottom one
+	for (int row = 0; row < 2 * stacks + 2; ++row)
+	{
+		const bool top = row <= stacks;
+		const float theta = (top ? row : row - 1) * (F_PI / 2.f) / stacks;
+		const float cosTheta = std::cos(theta);
+		const float y = radius * cosTheta + (top ? halfCylinder : -halfCylinder);
+		AddRing(vertices, slices, radius * std::sin(theta), y, cosTheta, (height / 2.f - y) / height);
+	}
+	AddGridIndices(indices, 0, 2 * stacks + 2, slices, true, true);
+
+	TangentSpace::GenerateTangents(vertices, indices);
+}
+
+std::string ProceduralMesh::GetBoxName(float width, float height, float depth)
+{
+	std::string name{ "Box(" };
+	AppendFloat(name, width);
+	name += ", ";
+	AppendFloat(name, height);
+	name += ", ";
+	AppendFloat(name, depth);
+	return name + ")";
+}
+
+std::string ProceduralMesh::GetSphereName(float radius, int slices, int stacks)
+{
+	std::string name{ "Sphere(" };
+	AppendFloat(name, radius);
+	return name + ", " + std::to_string((std::max)(slices, g_MinSlices)) + ", " + std::to_string((std::max)(stacks, g_MinStacks)) + ")";
+}
+
+std::string ProceduralMesh::GetPlaneName(float width, float depth, int subdivisionsX, int subdivisionsZ)
+{
+	std::string name{ "Plane(" };
+	AppendFloat(name, width);
+	name += ", ";
+	AppendFloat(name, depth);
+	return name + ", " + std::to_string((std::max)(subdivisionsX, g_MinSubdivisions)) + ", " + std::to_string((std::max)(subdivisionsZ, g_MinSubdivisions)) + ")";
+}
+
+std::string ProceduralMesh::GetCylinderName(float radius, float height, int slices)
+{
+	std::string name{ "Cylinder(" };
+	AppendFloat(name, radius);
+	name += ", ";
+	AppendFloat(name, height);
+	return name + ", " + std::to_string((std::max)(slices, g_MinSlices)) + ")";
+}
+
+std::string ProceduralMesh::GetCapsuleName(float radius, float height, int slices, int stacks)
+{
+	std::string name{ "Capsule(" };
+	AppendFloat(name, radius);
+	name += ", ";
+	AppendFloat(name, (std::max)(height, 2.f * radius));
+	return name + ", " + std::to_string((std::max)(slices, g_MinSlices)) + ", " + std::to_string((std::max)(stacks, g_MinCapStacks)) + ")";
+}
+
+MeshHandle ProceduralMesh::CreateBox(float width, float height, float depth)
+{
+	return CreateMesh(GetBoxName(width, height, depth), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{ GenerateBox(width, height, depth, vertices, indices); });
+}
+
+MeshHandle ProceduralMesh::CreateSphere(float radius, int slices, int stacks)
+{
+	return CreateMesh(GetSphereName(radius, slices, stacks), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{ GenerateSphere(radius, slices, stacks, vertices, indices); });
+}
+
+MeshHandle ProceduralMesh::CreatePlane(float width, float depth, int subdivisionsX, int subdivisionsZ)
+{
+	return CreateMesh(GetPlaneName(width, depth, subdivisionsX, subdivisionsZ), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{ GeneratePlane(width, depth, subdivisionsX, subdivisionsZ, vertices, indices); });
+}
+
+MeshHandle ProceduralMesh::CreateCylinder(float radius, float height, int slices)
+{
+	return CreateMesh(GetCylinderName(radius, height, slices), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{ GenerateCylinder(radius, height, slices, vertices, indices); });
+}
+
+MeshHandle ProceduralMesh::CreateCapsule(float radius, float height, int slices, int stacks)
+{
+	return CreateMesh(GetCapsuleName(radius, height, slices, stacks), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{ GenerateCapsule(radius, height, slices, stacks, vertices, indices); });
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ResourceHandle.h"
+
+struct Vertex;
+
+// Meshes generated from a handful of parameters. The name of a mesh is its shape and the exact parameters it was
+// generated with, so asking for the same shape twice gets the same GPU mesh from the resource manager.
+// Every shape is wound clockwise seen from outside, has normals, uvs and tangents. Y is up.
+namespace ProceduralMesh
+{
+	constexpr int g_MinSlices{ 3 };
+	constexpr int g_MinStacks{ 2 };
+	constexpr int g_MinCapStacks{ 1 };
+	constexpr int g_MinSubdivisions{ 1 };
+
+	// The exact sizes of a generated shape, the generators reserve these up front
+	struct Counts
+	{
+		size_t vertexCount{};
+		size_t indexCount{};
+	};
+
+	Counts GetBoxCounts();
+	Counts GetSphereCounts(int slices, int stacks);
+	Counts GetPlaneCounts(int subdivisionsX, int subdivisionsZ);
+	Counts GetCylinderCounts(int slices);
+	Counts GetCapsuleCounts(int slices, int stacks);
+
+	// CPU only, replaces the contents of vertices and indices. Counts below the minimum are clamped.
+	void GenerateBox(float width, float height, float depth, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// slices around the y axis, stacks from pole to pole
+	void GenerateSphere(float radius, int slices, int stacks, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// Facing up, subdivided into quads
+	void GeneratePlane(float width, float depth, int subdivisionsX, int subdivisionsZ, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// Capped, height is the total height
+	void GenerateCylinder(float radius, float height, int slices, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// height is the total height including both caps, it never gets smaller than the diameter. stacks per cap.
+	void GenerateCapsule(float radius, float height, int slices, int stacks, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Resource names, floats are written in their shortest exact form so different parameters never share a name
+	std::string GetBoxName(float width, float height, float depth);
+	std::string GetSphereName(float radius, int slices, int stacks);
+	std::string GetPlaneName(float width, float depth, int subdivisionsX, int subdivisionsZ);
+	std::string GetCylinderName(float radius, float height, int slices);
+	std::string GetCapsuleName(float radius, float height, int slices, int stacks);
+
+	// Generated and uploaded the first time, shared afterwards. Owned by the resource manager and never evicted.
+	MeshHandle CreateBox(float width, float height, float depth);
+	MeshHandle CreateSphere(float radius, int slices, int stacks);
+	MeshHandle CreatePlane(float width, float depth, int subdivisionsX = 1, int subdivisionsZ = 1);
+	MeshHandle CreateCylinder(float radius, float height, int slices);
+	MeshHandle CreateCapsule(float radius, float height, int slices, int stacks);
+}
@@ -0,0 +1,70 @@
+#include "ResourceBudget.h"
+
+void ResourceBudget::Acquire(ResourceEntryBase& entry)
+{
+	++entry.referenceCount;
+	if (entry.inLru)
+	{
+		m_Lru.erase(entry.lruPosition);
+		entry.inLru = false;
+	}
+}
+
+bool ResourceBudget::Release(ResourceEntryBase& entry)
+{
+	return --entry.referenceCount == 0;
+}
+
+void ResourceBudget::Update(ResourceEntryBase& entry, bool loaded, size_t memory)
+{
+	size_t& typeMemory = m_Memory[static_cast<size_t>(entry.type)];
+	typeMemory = typeMemory - entry.memory + memory;
+	entry.memory = memory;
+
+	if (!loaded && entry.inLru)
+	{
+		m_Lru.erase(entry.lruPosition);
+		entry.inLru = false;
+	}
+	// Released while loaded, or loaded while nothing references it (e.g. the other submeshes of a file)
+	else if (loaded && entry.referenceCount == 0 && entry.reloadable && !entry.inLru)
+	{
+		entry.lruPosition = m_Lru.insert(m_Lru.end(), &entry);
+		entry.inLru = true;
+	}
+}
+
+ResourceEntryBase* ResourceBudget::GetEvictionCandidate() const
+{
+	return GetMemory() > m_Budget && !m_Lru.empty() ? m_Lru.front() : nullptr;
+}
+
+void ResourceBudget::Clear()
+{
+	for (ResourceEntryBase* pEntry : m_Lru)
+		pEntry->inLru = false;
+	m_Lru.clear();
+}
+
+void ResourceBudget::SetBudget(size_t bytes)
+{
+	m_Budget = bytes;
+}
+
+size_t ResourceBudget::GetBudget() const
+{
+	return m_Budget;
+}
+
+size_t ResourceBudget::GetMemory(ResourceType type) const
+{
+	return m_Memory[static_cast<size_t>(type)];
+}
+
+size_t ResourceBudget::GetMemory() const
+{
+	size_t memory{};
+	for (const size_t typeMemory : m_Memory)
+		memory += typeMemory;
+	return memory;
+}
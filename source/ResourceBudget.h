@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <list>
+
+#include "ResourceHandle.h"
+
+// Reference counts, memory and eviction order of the resource entries. A resource that was loaded from a file and
+// has no handles left waits in a least recently used list, the front is evicted first once the loaded memory goes
+// over the budget. Only bookkeeping, the resource manager loads and unloads and reports back, so it runs without a device.
+class ResourceBudget final
+{
+public:
+	ResourceBudget() = default;
+	~ResourceBudget() = default;
+
+	ResourceBudget(const ResourceBudget& other) = delete;
+	ResourceBudget(ResourceBudget&& other) noexcept = delete;
+	ResourceBudget& operator=(const ResourceBudget& other) = delete;
+	ResourceBudget& operator=(ResourceBudget&& other) noexcept = delete;
+
+	// A handle references the entry, it can not be evicted while it does
+	void Acquire(ResourceEntryBase& entry);
+	// True when it was the last handle, the caller measures the resource again with Update
+	bool Release(ResourceEntryBase& entry);
+	// The resource of the entry was loaded, unloaded, replaced or changed its size, memory is 0 when it is not loaded
+	void Update(ResourceEntryBase& entry, bool loaded, size_t memory);
+
+	// Least recently used entry to unload while over budget, nullptr when everything fits or nothing can go.
+	// It stays the candidate until the caller unloads it and reports that with Update.
+	ResourceEntryBase* GetEvictionCandidate() const;
+	// Forgets the entries that wait for eviction, for when the entries are destroyed
+	void Clear();
+
+	void SetBudget(size_t bytes);
+	size_t GetBudget() const;
+	size_t GetMemory(ResourceType type) const;
+	size_t GetMemory() const;
+
+private:
+	std::list<ResourceEntryBase*> m_Lru{};
+	size_t m_Memory[static_cast<size_t>(ResourceType::Count)]{};
+	size_t m_Budget{ 512ull * 1024 * 1024 };
+};
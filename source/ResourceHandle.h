@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+
+#include "ResourceId.h"
+
+class Mesh;
+class Texture;
+
+enum class ResourceType
+{
+	Mesh,
+	Texture,
+	Count
+};
+
+// Bookkeeping the resource manager keeps for every named resource, the entry outlives the resource itself so
+// handles stay valid when it is evicted and loaded again
+struct ResourceEntryBase
+{
+	std::string name;
+	ResourceId id{};
+	ResourceType type;
+	uint32_t referenceCount{};
+	size_t memory{};			// Counted in the budget while the resource is loaded
+	bool reloadable{};			// Loaded from a file, it can be evicted once nothing references it
+	bool loading{};				// A load is queued or running, handles hand out the placeholder until it is done
+	bool listed{};				// In the id list of the manager, entries of submeshes that turn out not to exist never are
+	bool inLru{};
+	std::list<ResourceEntryBase*>::iterator lruPosition{};
+};
+
+template<typename T>
+struct ResourceEntry final : ResourceEntryBase
+{
+	T* pResource{};
+	std::string file{};			// File that is loaded again after an eviction
+	int submeshId{};
+};
+
+// Counted reference to a resource owned by the resource manager. Unreferenced resources stay loaded until the
+// manager goes over its memory budget. Works like a future: Get() never blocks, it starts loading an evicted
+// resource again and returns the placeholder of the type while it loads, Wait() finishes the load right away.
+template<typename T>
+class ResourceHandle final
+{
+public:
+	ResourceHandle() = default;
+	explicit ResourceHandle(ResourceEntry<T>* pEntry);
+	~ResourceHandle();
+
+	ResourceHandle(const ResourceHandle& other);
+	ResourceHandle(ResourceHandle&& other) noexcept;
+	ResourceHandle& operator=(const ResourceHandle& other);
+	ResourceHandle& operator=(ResourceHandle&& other) noexcept;
+
+	// The placeholder while loading, nullptr for an empty handle or a resource that could not be loaded
+	T* Get() const;
+	T* Wait() const;
+	T* operator->() const { return Get(); }
+	explicit operator bool() const { return m_pEntry != nullptr; }
+
+	bool IsLoaded() const;
+	bool IsLoading() const;
+	const std::string& GetName() const;
+	ResourceId GetId() const;
+	// File and submesh it is loaded from, known while it is not loaded as well. Empty for resources that were not
+	// loaded from a file.
+	const std::string& GetFile() const;
+	int GetSubmeshId() const;
+	void Reset();
+
+	bool operator==(const ResourceHandle& other) const { return m_pEntry == other.m_pEntry; }
+	bool operator!=(const ResourceHandle& other) const { return m_pEntry != other.m_pEntry; }
+
+private:
+	ResourceEntry<T>* m_pEntry{};
+};
+
+using MeshHandle = ResourceHandle<Mesh>;
+using TextureHandle = ResourceHandle<Texture>;
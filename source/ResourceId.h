@@ -0,0 +1,164 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 64-bit FNV-1a hash of a resource path, both kinds of slashes hash the same. Ids are streamed so the id of a
+// suffixed name (e.g. the submeshes of a file) follows from the id of the file without building the string.
+using ResourceId = uint64_t;
+
+constexpr ResourceId g_InvalidResourceId{ 0 };
+constexpr ResourceId g_ResourceIdOffset{ 14695981039346656037ull };
+constexpr ResourceId g_ResourceIdPrime{ 1099511628211ull };
+
+constexpr ResourceId AppendResourceId(ResourceId id, std::string_view text)
+{
+	for (char character : text)
+	{
+		if (character == '\\')
+			character = '/';
+		id ^= static_cast<uint8_t>(character);
+		id *= g_ResourceIdPrime;
+	}
+	return id;
+}
+
+constexpr ResourceId GetResourceId(std::string_view path)
+{
+	return AppendResourceId(g_ResourceIdOffset, path);
+}
+
+// Open addressing map from resource ids to small values, linear probing in one flat array. Id 0 marks an empty
+// slot. Values move when the table grows so store pointers to anything that has to stay put.
+template<typename Value>
+class ResourceIdMap final
+{
+public:
+	Value* Find(ResourceId id)
+	{
+		if (m_Size == 0)
+			return nullptr;
+
+		for (size_t slot = GetHome(id); ; slot = (slot + 1) & m_Mask)
+		{
+			if (m_Slots[slot].id == id)
+				return &m_Slots[slot].value;
+			if (m_Slots[slot].id == g_InvalidResourceId)
+				return nullptr;
+		}
+	}
+
+	const Value* Find(ResourceId id) const
+	{
+		return const_cast<ResourceIdMap*>(this)->Find(id);
+	}
+
+	bool Contains(ResourceId id) const
+	{
+		return Find(id) != nullptr;
+	}
+
+	// False when the id was already in the map, its value is left alone
+	bool Insert(ResourceId id, const Value& value = {})
+	{
+		if ((m_Size + 1) * 4 > m_Slots.size() * 3)
+			Grow();
+
+		size_t slot = GetHome(id);
+		for (; m_Slots[slot].id != g_InvalidResourceId; slot = (slot + 1) & m_Mask)
+		{
+			if (m_Slots[slot].id == id)
+				return false;
+		}
+
+		m_Slots[slot] = Slot{ id, value };
+		++m_Size;
+		return true;
+	}
+
+	bool Erase(ResourceId id)
+	{
+		if (m_Size == 0)
+			return false;
+
+		size_t slot = GetHome(id);
+		for (; m_Slots[slot].id != id; slot = (slot + 1) & m_Mask)
+		{
+			if (m_Slots[slot].id == g_InvalidResourceId)
+				return false;
+		}
+
+		// Shift the following entries of the cluster back instead of leaving a tombstone
+		for (size_t next = (slot + 1) & m_Mask; m_Slots[next].id != g_InvalidResourceId; next = (next + 1) & m_Mask)
+		{
+			const size_t home = GetHome(m_Slots[next].id);
+			const bool canMove = slot <= next ? (home <= slot || home > next) : (home <= slot && home > next);
+			if (canMove)
+			{
+				m_Slots[slot] = std::move(m_Slots[next]);
+				slot = next;
+			}
+		}
+
+		m_Slots[slot] = Slot{};
+		--m_Size;
+		return true;
+	}
+
+	void Clear()
+	{
+		m_Slots.clear();
+		m_Size = 0;
+		m_Mask = 0;
+	}
+
+	size_t GetSize() const
+	{
+		return m_Size;
+	}
+
+	template<typename Function>
+	void ForEach(Function function) const
+	{
+		for (const Slot& slot : m_Slots)
+		{
+			if (slot.id != g_InvalidResourceId)
+				function(slot.id, slot.value);
+		}
+	}
+
+private:
+	struct Slot
+	{
+		ResourceId id{ g_InvalidResourceId };
+		Value value{};
+	};
+
+	size_t GetHome(ResourceId id) const
+	{
+		// Fibonacci hashing spreads the low bits of similar paths over the whole table
+		return static_cast<size_t>((id * 11400714819323198485ull) >> 32) & m_Mask;
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> slots(m_Slots.empty() ? 16 : m_Slots.size() * 2);
+		std::swap(slots, m_Slots);
+		m_Mask = m_Slots.size() - 1;
+		m_Size = 0;
+
+		for (Slot& slot : slots)
+		{
+			if (slot.id != g_InvalidResourceId)
+				Insert(slot.id, std::move(slot.value));
+		}
+	}
+
+	std::vector<Slot> m_Slots{};
+	size_t m_Size{};
+	size_t m_Mask{};
+};
+
+using ResourceIdSet = ResourceIdMap<bool>;
@@ -2,19 +2,298 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Texture.h"
+#include "Logger.h"
+#pragma warning (push, 0)
+#include "OBJParser.h"
+#include "ProceduralMesh.h"
+#pragma warning (pop)
+
+#include "AssetPack.h"
+#include "DirectoryModel.h"
+#include "FileWatcher.h"
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ResourceReport.h"
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+// Stream loads running on the workers at once, the rest waits in the queue of the streamer
+static constexpr size_t g_MaxStreamLoads{ 4 };
 
 ResourceManager* ResourceManager::m_pResourceManager{};
 
+template<typename T>
+ResourceHandle<T>::ResourceHandle(ResourceEntry<T>* pEntry)
+	: m_pEntry{ pEntry }
+{
+	if (m_pEntry)
+		ResourceManager::GetInstance()->Acquire(m_pEntry);
+}
+
+template<typename T>
+ResourceHandle<T>::~ResourceHandle()
+{
+	Reset();
+}
+
+template<typename T>
+ResourceHandle<T>::ResourceHandle(const ResourceHandle& other)
+	: ResourceHandle(other.m_pEntry)
+{
+}
+
+template<typename T>
+ResourceHandle<T>::ResourceHandle(ResourceHandle&& other) noexcept
+	: m_pEntry{ std::exchange(other.m_pEntry, nullptr) }
+{
+}
+
+template<typename T>
+ResourceHandle<T>& ResourceHandle<T>::operator=(const ResourceHandle& other)
+{
+	// Acquire first, the old entry might be the same one
+	if (other.m_pEntry)
+		ResourceManager::GetInstance()->Acquire(other.m_pEntry);
+	Reset();
+	m_pEntry = other.m_pEntry;
+	return *this;
+}
+
+template<typename T>
+ResourceHandle<T>& ResourceHandle<T>::operator=(ResourceHandle&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		m_pEntry = std::exchange(other.m_pEntry, nullptr);
+	}
+	return *this;
+}
+
+template<typename T>
+T* ResourceHandle<T>::Get() const
+{
+	if (m_pEntry == nullptr)
+		return nullptr;
+
+	if (m_pEntry->pResource == nullptr)
+		return ResourceManager::GetInstance()->Resolve(m_pEntry);
+
+	return m_pEntry->pResource;
+}
+
+template<typename T>
+T* ResourceHandle<T>::Wait() const
+{
+	if (m_pEntry == nullptr)
+		return nullptr;
+
+	if (m_pEntry->pResource == nullptr)
+		ResourceManager::GetInstance()->Finish(m_pEntry);
+
+	return m_pEntry->pResource;
+}
+
+template<typename T>
+bool ResourceHandle<T>::IsLoaded() const
+{
+	return m_pEntry && m_pEntry->pResource;
+}
+
+template<typename T>
+bool ResourceHandle<T>::IsLoading() const
+{
+	return m_pEntry && m_pEntry->loading;
+}
+
+template<typename T>
+const std::string& ResourceHandle<T>::GetName() const
+{
+	static const std::string empty{};
+	return m_pEntry ? m_pEntry->name : empty;
+}
+
+template<typename T>
+ResourceId ResourceHandle<T>::GetId() const
+{
+	return m_pEntry ? m_pEntry->id : g_InvalidResourceId;
+}
+
+template<typename T>
+const std::string& ResourceHandle<T>::GetFile() const
+{
+	static const std::string empty{};
+	return m_pEntry ? m_pEntry->file : empty;
+}
+
+template<typename T>
+int ResourceHandle<T>::GetSubmeshId() const
+{
+	return m_pEntry ? m_pEntry->submeshId : 0;
+}
+
+template<typename T>
+void ResourceHandle<T>::Reset()
+{
+	if (m_pEntry == nullptr)
+		return;
+
+	ResourceManager::GetInstance()->Release(m_pEntry);
+	m_pEntry = nullptr;
+}
+
+template class ResourceHandle<Mesh>;
+template class ResourceHandle<Texture>;
+
+struct ResourceManager::AsyncLoad
+{
+	ResourceType type{};
+	ResourceId id{};					// Of the file
+	bool reload{};						// The file changed, its loaded resources are replaced
+	std::string file{};
+	std::chrono::steady_clock::time_point start{};
+	std::chrono::steady_clock::time_point workerStart{};
+	std::chrono::steady_clock::time_point workerEnd{};
+
+	std::atomic<bool> claimed{};
+	std::atomic<bool> done{};			// Run finished, the rest happens on the main thread
+
+	// Filled in by Run
+	std::unique_ptr<CookedMesh> pCooked{};
+	std::shared_ptr<AssetFile> pFile{};			// A view into the pack or the mapped loose file, never copied. Kept by the textures that stream.
+	std::vector<Image> mips{};					// Decoded texture and its mips, empty when the file is cooked or a type only WIC reads
+	std::string decodeError{};
+
+	// Main thread progress
+	bool materialsCreated{};
+	size_t nextSubmesh{};
+	std::vector<Mesh*> pMeshes{};
+
+	// File I/O and decoding. Runs on a worker, or on the main thread when the resource is needed before a worker
+	// picked the job up.
+	void Run()
+	{
+		if (claimed.exchange(true))
+			return;
+		workerStart = std::chrono::steady_clock::now();
+
+		if (type == ResourceType::Mesh)
+		{
+			pCooked = ImportOBJ(file, true, true);
+		}
+		else
+		{
+			pFile = std::make_shared<AssetFile>(file);
+			const auto* pData = reinterpret_cast<const uint8_t*>(pFile->GetData());
+			// Cooked textures are uploaded as they are, on the main thread
+			Image image{};
+			if (IsRead() && !TextureCooker::IsCooked(pData, pFile->GetSize()) && ImageDecoder::GetFileType(file, pData, pFile->GetSize()) != ImageDecoder::FileType::Unknown
+				&& ImageDecoder::Decode(file, pData, pFile->GetSize(), image, &decodeError))
+			{
+				const MipGenerator::Settings settings = MipGenerator::GetDefaultSettings(file, image);
+				mips.push_back(std::move(image));
+				MipGenerator::GenerateMips(mips, settings);
+			}
+		}
+
+		workerEnd = std::chrono::steady_clock::now();
+		done.store(true, std::memory_order_release);
+	}
+
+	bool IsRead() const
+	{
+		return pFile != nullptr && pFile->IsOpen() && pFile->GetSize() > 0;
+	}
+};
+
+struct ResourceManager::StreamLoad
+{
+	uint32_t slot{};
+	uint32_t mip{};						// First mip of the texture that is created
+	ID3D11Device* pDevice{};
+	std::shared_ptr<const AssetFile> pFile{};
+	bool cancelled{};					// The texture was replaced or unloaded, main thread only
+
+	std::atomic<bool> claimed{};
+	std::atomic<bool> done{};
+
+	// Filled in by Run, nullptr when the texture could not be created
+	ID3D11Resource* pResource{};
+	ID3D11ShaderResourceView* pView{};
+
+	~StreamLoad()
+	{
+		if (pResource)
+			pResource->Release();
+		if (pView)
+			pView->Release();
+	}
+
+	// The mips are read straight out of the mapping, the pages they are on are read from disk here
+	void Run()
+	{
+		if (claimed.exchange(true))
+			return;
+
+		const CookedTexture cooked{ std::string_view{ pFile->GetData(), pFile->GetSize() } };
+		if (cooked.IsValid())
+			Texture::CreateMips(pDevice, cooked, mip, &pResource, &pView);
+		done.store(true, std::memory_order_release);
+	}
+};
+
+// Spelled the same apart from the kind of slashes
+static bool IsSamePath(const std::string& a, const std::string& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (a[i] != b[i] && !((a[i] == '/' || a[i] == '\\') && (b[i] == '/' || b[i] == '\\')))
+			return false;
+	}
+	return true;
+}
+
+static size_t GetResourceMemory(const Mesh* pMesh)
+{
+	return pMesh ? pMesh->GetGpuMemory() + pMesh->GetBvh().GetMemory() : 0;
+}
+
+static size_t GetResourceMemory(const Texture* pTexture)
+{
+	return pTexture ? pTexture->GetMemory() : 0;
+}
+
 ResourceManager::~ResourceManager()
 {
-	for (auto meshPair : m_pMeshes)
-		delete meshPair.second;
+	WaitForStreamLoads();
+	m_StreamLoads.clear();
+	m_PlaceholderMesh.Reset();
+	m_PlaceholderTexture.Reset();
+	m_Loads.clear();
+	delete m_pPack;
+	delete m_pFileWatcher;
+	delete m_pDirectoryModel;
+
+	for (auto& entry : m_Meshes)
+		delete entry.pResource;
 
-	for (auto texturePair : m_pTextures)
-		delete texturePair.second;
+	for (auto& entry : m_Textures)
+		delete entry.pResource;
 
-	m_pMeshes.clear();
-	m_pTextures.clear();
+	m_Meshes.clear();
+	m_Textures.clear();
+	m_ResourceBudget.Clear();
 }
 
 ResourceManager* ResourceManager::GetInstance()
@@ -24,38 +303,163 @@ ResourceManager* ResourceManager::GetInstance()
 	return m_pResourceManager;
 }
 
+ResourceId ResourceManager::Intern(const std::string& name)
+{
+	const ResourceId id = GetResourceId(name);
+	if (const uint32_t* pIndex = m_NameIndices.Find(id))
+	{
+		if (!IsSamePath(m_Names[*pIndex], name))
+			Logger::GetInstance()->LogWarning("ResourceManager: " + name + " and " + m_Names[*pIndex] + " have the same id");
+		return id;
+	}
+
+	m_NameIndices.Insert(id, static_cast<uint32_t>(m_Names.size()));
+	m_Names.emplace_back(name);
+	return id;
+}
+
+const std::string& ResourceManager::GetName(ResourceId id) const
+{
+	static const std::string empty{};
+	const uint32_t* pIndex = m_NameIndices.Find(id);
+	return pIndex ? m_Names[*pIndex] : empty;
+}
+
+ResourceEntry<Mesh>& ResourceManager::GetMeshEntry(ResourceId id)
+{
+	if (ResourceEntry<Mesh>** ppEntry = m_MeshTable.Find(id))
+		return **ppEntry;
+
+	auto& entry = m_Meshes.emplace_back();
+	entry.name = GetName(id);
+	entry.id = id;
+	entry.type = ResourceType::Mesh;
+	m_MeshTable.Insert(id, &entry);
+	return entry;
+}
+
+ResourceEntry<Texture>& ResourceManager::GetTextureEntry(ResourceId id)
+{
+	if (ResourceEntry<Texture>** ppEntry = m_TextureTable.Find(id))
+		return **ppEntry;
+
+	auto& entry = m_Textures.emplace_back();
+	entry.name = GetName(id);
+	entry.id = id;
+	entry.type = ResourceType::Texture;
+	m_TextureTable.Insert(id, &entry);
+	return entry;
+}
+
 void ResourceManager::AddMesh(const std::string& name, Mesh* pMesh)
 {
 	if (pMesh == nullptr) return;
-	if (m_pMeshes[name] != nullptr)
+
+	auto& entry = GetMeshEntry(Intern(name));
+	if (!m_LoadingMeshFile.empty())
 	{
-		delete m_pMeshes[name];
+		// Loading the file again for one evicted submesh keeps the submeshes that are still loaded. Reloading a changed
+		// file replaces those instead and leaves the evicted ones evicted.
+		const bool evicted = entry.pResource == nullptr && entry.reloadable && !entry.loading;
+		if (m_ReplaceLoadedMeshes ? evicted : entry.pResource != nullptr)
+		{
+			m_pDuplicateMeshes.emplace_back(pMesh);
+			return;
+		}
+
+		entry.reloadable = true;
+		entry.loading = false;
+		entry.file = m_LoadingMeshFile;
+		entry.submeshId = pMesh->GetSubmeshID();
+	}
+	else
+	{
+		entry.reloadable = false;
+		entry.file.clear();
 	}
 
-	m_pMeshes[name] = pMesh;
+	SetResource(entry, pMesh);
 }
 
+MeshHandle ResourceManager::GetMesh(ResourceId id)
+{
+	if (ResourceEntry<Mesh>** ppEntry = m_MeshTable.Find(id))
+		return MeshHandle{ *ppEntry };
 
-Mesh* ResourceManager::GetMesh(const std::string& name)
+	return GetMesh(id, 0);
+}
+
+MeshHandle ResourceManager::GetMesh(const std::string& name)
+{
+	return GetMesh(Intern(name));
+}
+
+MeshHandle ResourceManager::GetMesh(ResourceId file, int submeshId)
 {
-	if (std::find(m_MeshFiles.begin(), m_MeshFiles.end(), name) != m_MeshFiles.end())
+	MeshHandle handle = LoadMeshAsync(file, submeshId);
+	if (handle.Wait() == nullptr)
+		return MeshHandle{};
+
+	// Referenced before the budget is checked so the mesh that was asked for is not the one that is evicted
+	EnforceBudget();
+	return handle;
+}
+
+MeshHandle ResourceManager::GetMesh(const std::string& file, int submeshId)
+{
+	return GetMesh(Intern(file), submeshId);
+}
+
+MeshHandle ResourceManager::LoadMeshAsync(ResourceId file, int submeshId)
+{
+	if (ResourceEntry<Mesh>** ppEntry = m_MeshTable.Find(GetSubmeshId(file, submeshId)))
+		return MeshHandle{ *ppEntry };
+
+	// Only a file that is not loaded yet can still turn out to have the submesh
+	const bool fileLoading = std::any_of(m_Loads.begin(), m_Loads.end(), [file](const auto& pLoad) { return pLoad->type == ResourceType::Mesh && pLoad->id == file; });
+	if (m_MeshTable.Contains(file) && !fileLoading)
+		return MeshHandle{};
+
+	const std::string& fileName = GetName(file);
+	if (fileName.empty())
 	{
-		m_MeshFiles.erase(std::remove(m_MeshFiles.begin(), m_MeshFiles.end(), name));
-		m_pMeshes[name] = new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), name, new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx"));
+		Logger::GetInstance()->LogWarning("ResourceManager: no mesh file has the id " + std::to_string(file));
+		return MeshHandle{};
 	}
 
-	if (m_pMeshes[name] == nullptr)
+	auto& entry = GetMeshEntry(Intern(GetSubmeshName(fileName, submeshId)));
+	entry.reloadable = true;
+	entry.loading = true;
+	entry.file = fileName;
+	entry.submeshId = submeshId;
+
+	MeshHandle handle{ &entry };
+	StartMeshLoad(file, true);
+	return handle;
+}
+
+MeshHandle ResourceManager::LoadMeshAsync(const std::string& file, int submeshId)
+{
+	return LoadMeshAsync(Intern(file), submeshId);
+}
+
+MeshHandle ResourceManager::GetMesh(const Mesh* pMesh)
+{
+	if (pMesh == nullptr) return MeshHandle{};
+
+	for (auto& entry : m_Meshes)
 	{
-		m_pMeshes[name] = new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), name, new Material(MyEngine::GetSingleton()->GetDevice(), "Resources/material_unlit.fx"));
+		if (entry.pResource == pMesh)
+			return MeshHandle{ &entry };
 	}
 
-	return m_pMeshes[name];
+	return MeshHandle{};
 }
 
 Mesh* ResourceManager::GetMeshConst(const std::string& name) const
 {
-	if(m_pMeshes.count(name) > 0)
-		return m_pMeshes.at(name);
+	if (ResourceEntry<Mesh>* const* ppEntry = m_MeshTable.Find(GetResourceId(name)))
+		return (*ppEntry)->pResource;
 	return nullptr;
 }
 
@@ -63,54 +467,318 @@ Mesh* ResourceManager::GetMeshConst(const std::string& name) const
 void ResourceManager::AddTexture(const std::string& name, Texture* pTexture)
 {
 	if (pTexture == nullptr) return;
-	if (m_pTextures[name] != nullptr)
+
+	auto& entry = GetTextureEntry(Intern(name));
+	entry.reloadable = false;
+	SetResource(entry, pTexture);
+}
+
+TextureHandle ResourceManager::GetTexture(ResourceId id)
+{
+	TextureHandle handle = LoadTextureAsync(id);
+	if (handle.Wait() == nullptr)
+		return TextureHandle{};
+
+	EnforceBudget();
+	return handle;
+}
+
+TextureHandle ResourceManager::GetTexture(const std::string& name)
+{
+	return GetTexture(Intern(name));
+}
+
+TextureHandle ResourceManager::LoadTextureAsync(ResourceId id)
+{
+	if (ResourceEntry<Texture>** ppEntry = m_TextureTable.Find(id))
+		return TextureHandle{ *ppEntry };
+
+	if (GetName(id).empty())
+	{
+		Logger::GetInstance()->LogWarning("ResourceManager: no texture file has the id " + std::to_string(id));
+		return TextureHandle{};
+	}
+
+	auto& entry = GetTextureEntry(id);
+	entry.reloadable = true;
+
+	TextureHandle handle{ &entry };
+	StartTextureLoad(entry, true);
+	return handle;
+}
+
+TextureHandle ResourceManager::LoadTextureAsync(const std::string& name)
+{
+	return LoadTextureAsync(Intern(name));
+}
+
+Mesh* ResourceManager::GetPlaceholderMesh()
+{
+	if (!m_PlaceholderMesh)
+		m_PlaceholderMesh = ProceduralMesh::CreateBox(1.f, 1.f, 1.f);
+
+	return m_PlaceholderMesh.Get();
+}
+
+Texture* ResourceManager::GetPlaceholderTexture()
+{
+	if (!m_PlaceholderTexture)
+	{
+		// Magenta and black checkers, hard to miss when a texture never finishes loading
+		const uint32_t pixels[4]{ 0xFFFF00FF, 0xFF000000, 0xFF000000, 0xFFFF00FF };
+		const std::string name{ "Placeholder texture" };
+		AddTexture(name, new Texture(MyEngine::GetSingleton()->GetDevice(), name, 2, 2, pixels));
+		m_PlaceholderTexture = TextureHandle{ *m_TextureTable.Find(GetResourceId(name)) };
+	}
+
+	return m_PlaceholderTexture.Get();
+}
+
+void ResourceManager::Update(float budgetMilliseconds)
+{
+	UpdateWatcher();
+	UpdateStreaming();
+
+	const auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		auto iter = std::find_if(m_Loads.begin(), m_Loads.end(), [](const auto& pLoad) { return pLoad->done.load(std::memory_order_acquire); });
+		if (iter == m_Loads.end())
+			return;
+
+		const std::shared_ptr<AsyncLoad> pLoad = *iter;
+		if (!Upload(*pLoad))
+			m_Loads.erase(std::find(m_Loads.begin(), m_Loads.end(), pLoad));
+
+		if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMilliseconds)
+			return;
+	}
+}
+
+size_t ResourceManager::GetLoadingCount() const
+{
+	return m_Loads.size();
+}
+
+bool ResourceManager::MountPack(const std::string& filename)
+{
+	UnmountPack();
+
+	auto pPack = new AssetPack(filename);
+	if (!pPack->IsValid())
+	{
+		delete pPack;
+		Logger::GetInstance()->LogInfo("ResourceManager: no asset pack " + filename + ", loading loose files");
+		return false;
+	}
+	m_pPack = pPack;
+
+	// The editor lists come from the index instead of scanning the directories
+	for (size_t i = 0; i < m_pPack->GetEntryCount(); ++i)
 	{
-		delete m_pTextures[name];
+		const AssetPacker::IndexEntry& entry = m_pPack->GetEntry(i);
+		if (entry.type == AssetType::Mesh)
+			AddMeshFile(std::string(m_pPack->GetName(entry)));
+		else if (entry.type == AssetType::Texture)
+			AddTextureFile(std::string(m_pPack->GetName(entry)));
 	}
 
-	m_pTextures[name] = pTexture;
+	Logger::GetInstance()->LogInfo("ResourceManager: mounted " + filename + " with " + std::to_string(m_pPack->GetEntryCount()) + " files ("
+		+ std::to_string(m_pPack->GetSize() / 1024) + " KB)");
+	return true;
 }
 
-Texture* ResourceManager::GetTexture(const std::string& name)
+void ResourceManager::UnmountPack()
 {
-	if (std::find(m_TextureFiles.begin(), m_TextureFiles.end(), name) != m_TextureFiles.end())
+	if (m_pPack == nullptr)
+		return;
+
+	// Running loads read straight out of the mapping
+	while (!m_Loads.empty())
+		Complete(m_Loads.front());
+
+	// The streamed textures keep the mips they have
+	WaitForStreamLoads();
+	if (ApplyStreamLoads())
+		EnforceBudget();
+	for (ResourceEntry<Texture>* pEntry : m_StreamedTextures)
 	{
-		m_TextureFiles.erase(std::remove(m_TextureFiles.begin(), m_TextureFiles.end(), name));
-		m_pTextures[name] = new Texture(MyEngine::GetSingleton()->GetDevice(), name);
+		if (pEntry != nullptr && pEntry->pResource->GetStreamFile()->IsPacked())
+			StopStreaming(*pEntry);
 	}
 
-	if (m_pTextures[name] == nullptr)
+	delete m_pPack;
+	m_pPack = nullptr;
+}
+
+const AssetPack* ResourceManager::GetPack() const
+{
+	return m_pPack;
+}
+
+void ResourceManager::WatchDirectory(const std::string& directory)
+{
+	delete m_pFileWatcher;
+	delete m_pDirectoryModel;
+	m_ChangedFiles.clear();
+
+	// The watcher first so nothing that changes during the walk is missed
+	m_pFileWatcher = new FileWatcher(directory);
+	m_pDirectoryModel = new DirectoryModel(directory);
+	RegisterFiles(m_pDirectoryModel->GetRoot());
+}
+
+const DirectoryModel* ResourceManager::GetDirectoryModel() const
+{
+	return m_pDirectoryModel;
+}
+
+bool ResourceManager::Reload(const std::string& file)
+{
+	const AssetType type = AssetPacker::GetAssetType(file);
+	if (type != AssetType::Mesh && type != AssetType::Texture)
+		return true;
+
+	const ResourceId id = GetResourceId(file);
+	const ResourceType resourceType = type == AssetType::Mesh ? ResourceType::Mesh : ResourceType::Texture;
+	if (std::any_of(m_Loads.begin(), m_Loads.end(), [id, resourceType](const auto& pLoad) { return pLoad->type == resourceType && pLoad->id == id; }))
+		return false;
+
+	if (m_pPack != nullptr && m_pPack->Find(id) != nullptr)
 	{
-		m_pTextures[name] = new Texture(MyEngine::GetSingleton()->GetDevice(), name);
+		Logger::GetInstance()->LogWarning("ResourceManager: " + file + " changed but is read from the asset pack, build the pack again");
+		return true;
 	}
 
-	return m_pTextures[name];
+	// Resources that are not loaded pick the new file up when they are loaded
+	if (resourceType == ResourceType::Mesh)
+	{
+		const bool loaded = std::any_of(m_Meshes.begin(), m_Meshes.end(), [id](const auto& entry) { return entry.pResource != nullptr && entry.reloadable && GetResourceId(entry.file) == id; });
+		if (loaded)
+			StartMeshLoad(id, true, true);
+	}
+	else if (ResourceEntry<Texture>** ppEntry = m_TextureTable.Find(id); ppEntry != nullptr && (*ppEntry)->pResource != nullptr && (*ppEntry)->reloadable)
+	{
+		StartTextureLoad(**ppEntry, true, true);
+	}
+
+	return true;
+}
+
+void ResourceManager::UpdateWatcher()
+{
+	if (m_pFileWatcher == nullptr)
+		return;
+
+	std::vector<FileEvent> events{};
+	m_pFileWatcher->Poll(events);
+
+	const auto now = std::chrono::steady_clock::now();
+	for (const FileEvent& event : events)
+	{
+		m_pDirectoryModel->Apply(event);
+
+		switch (event.type)
+		{
+		case FileEvent::Type::Overflow:
+			Logger::GetInstance()->LogWarning("ResourceManager: lost file changes under " + m_pFileWatcher->GetDirectory() + ", reload the changed files by hand");
+			RegisterFiles(m_pDirectoryModel->GetRoot());
+			break;
+		case FileEvent::Type::Added:
+			if (const DirectoryNode* pNode = m_pDirectoryModel->Find(event.path))
+				RegisterFiles(*pNode);
+			if (event.isDirectory)
+				break;
+			// Saving by renaming a temporary file over the old one shows up as an added file
+			[[fallthrough]];
+		case FileEvent::Type::Modified:
+		{
+			auto iter = std::find_if(m_ChangedFiles.begin(), m_ChangedFiles.end(), [&event](const auto& changed) { return changed.first == event.path; });
+			if (iter != m_ChangedFiles.end())
+				iter->second = now;
+			else
+				m_ChangedFiles.emplace_back(event.path, now);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// Editors save in several writes, a file is imported once it stopped changing for a moment
+	constexpr std::chrono::milliseconds settleTime{ 250 };
+	m_ChangedFiles.erase(std::remove_if(m_ChangedFiles.begin(), m_ChangedFiles.end(), [this, now, settleTime](const auto& changed)
+	{
+		return now - changed.second >= settleTime && Reload(changed.first);
+	}), m_ChangedFiles.end());
+}
+
+void ResourceManager::RegisterFiles(const DirectoryNode& node)
+{
+	if (!node.isDirectory)
+	{
+		const AssetType type = AssetPacker::GetAssetType(node.path);
+		if (type == AssetType::Mesh)
+			AddMeshFile(node.path);
+		else if (type == AssetType::Texture)
+			AddTextureFile(node.path);
+		return;
+	}
+
+	for (const auto& pChild : node.children)
+		RegisterFiles(*pChild);
+}
+
+const ResourceLoadTiming* ResourceManager::GetMeshLoadTiming(ResourceId file) const
+{
+	return m_MeshLoadTimings.Find(file);
+}
+
+const ResourceLoadTiming* ResourceManager::GetTextureLoadTiming(ResourceId id) const
+{
+	return m_TextureLoadTimings.Find(id);
 }
 
 void ResourceManager::AddMeshFile(const std::string& filename)
 {
-	if (std::find(m_MeshFiles.begin(), m_MeshFiles.end(), filename) != m_MeshFiles.end()) return;
+	const ResourceId id = GetResourceId(filename);
+	if (m_MeshTable.Contains(id) || m_PendingMeshFiles.Contains(id)) return;
 
-	m_MeshFiles.emplace_back(filename);
+	Intern(filename);
+	m_PendingMeshFiles.Insert(id);
+	m_MeshIds.emplace_back(id);
 }
 
 void ResourceManager::AddTextureFile(const std::string& filename)
 {
-	if (std::find(m_TextureFiles.begin(), m_TextureFiles.end(), filename) != m_TextureFiles.end()) return;
+	const ResourceId id = GetResourceId(filename);
+	if (m_TextureTable.Contains(id) || m_PendingTextureFiles.Contains(id)) return;
+
+	Intern(filename);
+	m_PendingTextureFiles.Insert(id);
+	m_TextureIds.emplace_back(id);
+}
+
+const std::vector<ResourceId>& ResourceManager::GetMeshIds() const
+{
+	return m_MeshIds;
+}
 
-	m_TextureFiles.emplace_back(filename);
+const std::vector<ResourceId>& ResourceManager::GetTextureIds() const
+{
+	return m_TextureIds;
 }
 
 std::vector<std::string> ResourceManager::GetMeshNames(bool includeFileNames) const
 {
 	std::vector<std::string> names;
+	names.reserve(m_MeshIds.size());
 
-	for (auto mesh : m_pMeshes)
-		names.emplace_back(mesh.first);
-
-	if (!includeFileNames) return names;
-	for (auto fileName : m_MeshFiles)
-		names.emplace_back(fileName);
+	for (ResourceId id : m_MeshIds)
+	{
+		if (includeFileNames || m_MeshTable.Contains(id))
+			names.emplace_back(GetName(id));
+	}
 
 	return names;
 }
@@ -118,13 +786,630 @@ std::vector<std::string> ResourceManager::GetMeshNames(bool includeFileNames) co
 std::vector<std::string> ResourceManager::GetTextureNames(bool includeFileNames) const
 {
 	std::vector<std::string> names;
+	names.reserve(m_TextureIds.size());
 
-	for (auto texture : m_pTextures)
-		names.emplace_back(texture.first);
-
-	if (!includeFileNames) return names;
-	for (auto fileName : m_TextureFiles)
-		names.emplace_back(fileName);
+	for (ResourceId id : m_TextureIds)
+	{
+		if (includeFileNames || m_TextureTable.Contains(id))
+			names.emplace_back(GetName(id));
+	}
 
 	return names;
 }
+
+std::string ResourceManager::GetSubmeshName(const std::string& file, int submeshId)
+{
+	if (submeshId == 0)
+		return file;
+	return file + std::to_string(submeshId);
+}
+
+ResourceId ResourceManager::GetSubmeshId(ResourceId file, int submeshId)
+{
+	if (submeshId == 0)
+		return file;
+
+	// Same id as the name GetSubmeshName builds
+	char digits[16]{};
+	const auto result = std::to_chars(std::begin(digits), std::end(digits), submeshId);
+	return AppendResourceId(file, std::string_view(digits, result.ptr - digits));
+}
+
+void ResourceManager::BeginNameTable()
+{
+	m_NameTableIds.Clear();
+	m_NameTable.clear();
+}
+
+ResourceId ResourceManager::AddToNameTable(ResourceId id)
+{
+	if (m_NameTableIds.Insert(id))
+		m_NameTable.emplace_back(id);
+	return id;
+}
+
+const std::vector<ResourceId>& ResourceManager::GetNameTable() const
+{
+	return m_NameTable;
+}
+
+bool ResourceManager::ReadNameTable(const std::vector<std::pair<ResourceId, std::string>>& names)
+{
+	bool valid{ true };
+	for (const auto& [id, name] : names)
+	{
+		if (Intern(name) != id)
+		{
+			Logger::GetInstance()->LogWarning("ResourceManager: the id of " + name + " does not match the name table");
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+void ResourceManager::SetMemoryBudget(size_t bytes)
+{
+	m_ResourceBudget.SetBudget(bytes);
+	EnforceBudget();
+}
+
+size_t ResourceManager::GetMemoryBudget() const
+{
+	return m_ResourceBudget.GetBudget();
+}
+
+size_t ResourceManager::GetMemory(ResourceType type) const
+{
+	return m_ResourceBudget.GetMemory(type);
+}
+
+size_t ResourceManager::GetMemory() const
+{
+	return m_ResourceBudget.GetMemory();
+}
+
+size_t ResourceManager::GetEvictionCount() const
+{
+	return m_EvictionCount;
+}
+
+void ResourceManager::GetRecords(std::vector<ResourceRecord>& records) const
+{
+	records.reserve(records.size() + m_Meshes.size() + m_Textures.size());
+
+	for (const auto& entry : m_Meshes)
+	{
+		// Submeshes that turned out not to exist never get listed
+		if (!entry.listed && !entry.loading && entry.pResource == nullptr)
+			continue;
+
+		ResourceRecord& record = records.emplace_back();
+		record.type = ResourceRecordType::Mesh;
+		record.name = entry.name;
+		record.source = entry.file;
+		record.referenceCount = entry.referenceCount;
+		record.loaded = entry.pResource != nullptr;
+		if (entry.pResource != nullptr)
+		{
+			record.cpuMemory = entry.pResource->GetCpuMemory();
+			record.gpuMemory = entry.pResource->GetGpuMemory();
+		}
+		if (const ResourceLoadTiming* pTiming = entry.file.empty() ? nullptr : m_MeshLoadTimings.Find(GetResourceId(entry.file)))
+			record.loadMilliseconds = pTiming->total;
+	}
+
+	for (const auto& entry : m_Textures)
+	{
+		ResourceRecord& record = records.emplace_back();
+		record.type = ResourceRecordType::Texture;
+		record.name = entry.name;
+		record.source = entry.reloadable ? entry.name : std::string{};
+		record.referenceCount = entry.referenceCount;
+		record.loaded = entry.pResource != nullptr;
+		if (entry.pResource != nullptr)
+		{
+			record.cpuMemory = entry.pResource->GetCpuMemory();
+			record.gpuMemory = entry.pResource->GetMemory();
+		}
+		if (const ResourceLoadTiming* pTiming = m_TextureLoadTimings.Find(entry.id))
+			record.loadMilliseconds = pTiming->total;
+	}
+}
+
+void ResourceManager::Acquire(ResourceEntryBase* pEntry)
+{
+	m_ResourceBudget.Acquire(*pEntry);
+}
+
+void ResourceManager::Release(ResourceEntryBase* pEntry)
+{
+	if (!m_ResourceBudget.Release(*pEntry))
+		return;
+
+	// Measured again, the mesh might have built its BVH since it was loaded
+	switch (pEntry->type)
+	{
+	case ResourceType::Mesh:
+	{
+		const Mesh* pMesh = static_cast<ResourceEntry<Mesh>*>(pEntry)->pResource;
+		m_ResourceBudget.Update(*pEntry, pMesh != nullptr, GetResourceMemory(pMesh));
+		break;
+	}
+	case ResourceType::Texture:
+	{
+		const Texture* pTexture = static_cast<ResourceEntry<Texture>*>(pEntry)->pResource;
+		m_ResourceBudget.Update(*pEntry, pTexture != nullptr, GetResourceMemory(pTexture));
+		break;
+	}
+	default:
+		break;
+	}
+	EnforceBudget();
+}
+
+Mesh* ResourceManager::Resolve(ResourceEntry<Mesh>* pEntry)
+{
+	if (!pEntry->loading && pEntry->reloadable)
+		StartMeshLoad(GetResourceId(pEntry->file), true);
+
+	return pEntry->loading ? GetPlaceholderMesh() : nullptr;
+}
+
+Texture* ResourceManager::Resolve(ResourceEntry<Texture>* pEntry)
+{
+	if (!pEntry->loading && pEntry->reloadable)
+		StartTextureLoad(*pEntry, true);
+
+	return pEntry->loading ? GetPlaceholderTexture() : nullptr;
+}
+
+void ResourceManager::Finish(ResourceEntry<Mesh>* pEntry)
+{
+	if (!pEntry->loading && !pEntry->reloadable)
+		return;
+
+	const ResourceId file = GetResourceId(pEntry->file);
+	Complete(StartMeshLoad(file, false));
+	// A load that was running already can have created the submesh before it was evicted
+	if (pEntry->pResource == nullptr && pEntry->reloadable)
+		Complete(StartMeshLoad(file, false));
+}
+
+void ResourceManager::Finish(ResourceEntry<Texture>* pEntry)
+{
+	if (!pEntry->loading && !pEntry->reloadable)
+		return;
+
+	Complete(StartTextureLoad(*pEntry, false));
+}
+
+std::shared_ptr<ResourceManager::AsyncLoad> ResourceManager::StartMeshLoad(ResourceId file, bool async, bool reload)
+{
+	for (const auto& pLoad : m_Loads)
+	{
+		if (pLoad->type == ResourceType::Mesh && pLoad->id == file)
+			return pLoad;
+	}
+
+	auto pLoad = std::make_shared<AsyncLoad>();
+	pLoad->type = ResourceType::Mesh;
+	pLoad->id = file;
+	pLoad->file = GetName(file);
+	pLoad->start = std::chrono::steady_clock::now();
+	pLoad->reload = reload;
+
+	// Every entry of the file that waits for it, also the ones that were evicted
+	for (auto& entry : m_Meshes)
+	{
+		if (!reload && entry.pResource == nullptr && entry.reloadable && GetResourceId(entry.file) == file)
+			entry.loading = true;
+	}
+
+	m_Loads.emplace_back(pLoad);
+	if (async)
+		JobSystem::GetInstance()->Execute([pLoad]() { pLoad->Run(); });
+	else
+		pLoad->Run();
+	return pLoad;
+}
+
+std::shared_ptr<ResourceManager::AsyncLoad> ResourceManager::StartTextureLoad(ResourceEntry<Texture>& entry, bool async, bool reload)
+{
+	for (const auto& pLoad : m_Loads)
+	{
+		if (pLoad->type == ResourceType::Texture && pLoad->id == entry.id)
+			return pLoad;
+	}
+
+	auto pLoad = std::make_shared<AsyncLoad>();
+	pLoad->type = ResourceType::Texture;
+	pLoad->id = entry.id;
+	pLoad->file = entry.name;
+	pLoad->start = std::chrono::steady_clock::now();
+	pLoad->reload = reload;
+	// The texture that is loaded stays in use while it reloads
+	if (!reload)
+		entry.loading = true;
+
+	m_Loads.emplace_back(pLoad);
+	if (async)
+		JobSystem::GetInstance()->Execute([pLoad]() { pLoad->Run(); });
+	else
+		pLoad->Run();
+	return pLoad;
+}
+
+bool ResourceManager::Upload(AsyncLoad& load)
+{
+	if (load.type == ResourceType::Texture)
+	{
+		if (ResourceEntry<Texture>** ppEntry = m_TextureTable.Find(load.id))
+		{
+			auto& entry = **ppEntry;
+			entry.loading = false;
+			if (!load.IsRead())
+			{
+				Logger::GetInstance()->LogWarning("ResourceManager: could not read the texture file " + load.file);
+				if (!load.reload)
+					entry.reloadable = false;
+			}
+			else if (!load.mips.empty())
+			{
+				// Decoded and filtered on the worker, only the upload is left
+				SetResource(entry, new Texture(MyEngine::GetSingleton()->GetDevice(), load.file, load.mips));
+			}
+			else if (!load.decodeError.empty())
+			{
+				// A file that could not be decoded (still being written) keeps the texture that was loaded
+				Logger::GetInstance()->LogWarning("ResourceManager: could not decode the texture file " + load.file + ", " + load.decodeError);
+				if (!load.reload)
+					entry.reloadable = false;
+			}
+			else
+			{
+				// Cooked in the pack, or a type only WIC reads and decodes while creating the texture. Uploads run on the
+				// main thread, so WIC gets the immediate context and generates the mips of those on the GPU.
+				ID3D11Device* pDevice = MyEngine::GetSingleton()->GetDevice();
+				ID3D11DeviceContext* pDeviceContext = MyEngine::GetSingleton()->GetDeviceContext();
+				Texture* pTexture = m_TextureStreaming ? new Texture(pDevice, load.file, load.pFile, pDeviceContext)
+					: new Texture(pDevice, load.file, reinterpret_cast<const uint8_t*>(load.pFile->GetData()), load.pFile->GetSize(), pDeviceContext);
+				// A file that could not be decoded (still being written) keeps the texture that was loaded
+				if (load.reload && pTexture->GetTextureShaderResource() == nullptr)
+					delete pTexture;
+				else
+					SetResource(entry, pTexture);
+			}
+		}
+		RecordLoadTiming(load, !load.IsRead() || !load.decodeError.empty());
+
+		m_PendingTextureFiles.Erase(load.id);
+		EnforceBudget();
+		return false;
+	}
+
+	if (load.pCooked == nullptr)
+	{
+		FinishMeshLoad(load);
+		return false;
+	}
+
+	if (!load.materialsCreated)
+	{
+		CreateOBJMaterials(*load.pCooked);
+		load.materialsCreated = true;
+		return true;
+	}
+
+	const size_t submeshCount = load.pCooked->GetSubmeshCount();
+	if (load.nextSubmesh < submeshCount)
+	{
+		m_LoadingMeshFile = load.file;
+		m_ReplaceLoadedMeshes = load.reload;
+		CreateMesh(load.pMeshes, load.pCooked->GetSubmesh(load.nextSubmesh++), load.file);
+		m_LoadingMeshFile.clear();
+		m_ReplaceLoadedMeshes = false;
+
+		for (Mesh* pMesh : m_pDuplicateMeshes)
+			delete pMesh;
+		m_pDuplicateMeshes.clear();
+
+		if (load.nextSubmesh < submeshCount)
+			return true;
+	}
+
+	FinishMeshLoad(load);
+	return false;
+}
+
+void ResourceManager::FinishMeshLoad(AsyncLoad& load)
+{
+	// Entries that are still waiting ask for a submesh the file does not have, or the file could not be loaded
+	for (auto& entry : m_Meshes)
+	{
+		if (entry.loading && GetResourceId(entry.file) == load.id)
+		{
+			entry.loading = false;
+			entry.reloadable = false;
+		}
+	}
+
+	RecordLoadTiming(load, load.pCooked == nullptr);
+	if (load.pCooked == nullptr)
+	{
+		Logger::GetInstance()->LogWarning("ResourceManager: could not load the mesh file " + load.file);
+		return;
+	}
+
+	m_PendingMeshFiles.Erase(load.id);
+	Logger::GetInstance()->LogDebug(std::string("ResourceManager: ") + (load.reload ? "reloaded " : "loaded ") + load.file + " in " + std::to_string(m_MeshLoadTimings.Find(load.id)->total) + " ms");
+	EnforceBudget();
+}
+
+void ResourceManager::RecordLoadTiming(const AsyncLoad& load, bool failed)
+{
+	using Milliseconds = std::chrono::duration<float, std::milli>;
+	const auto now = std::chrono::steady_clock::now();
+
+	ResourceLoadTiming timing{};
+	timing.queued = Milliseconds(load.workerStart - load.start).count();
+	timing.worker = Milliseconds(load.workerEnd - load.workerStart).count();
+	timing.upload = Milliseconds(now - load.workerEnd).count();
+	timing.total = Milliseconds(now - load.start).count();
+	timing.failed = failed;
+
+	auto& timings = load.type == ResourceType::Mesh ? m_MeshLoadTimings : m_TextureLoadTimings;
+	if (ResourceLoadTiming* pTiming = timings.Find(load.id))
+		*pTiming = timing;
+	else
+		timings.Insert(load.id, timing);
+}
+
+void ResourceManager::Complete(std::shared_ptr<AsyncLoad> pLoad)
+{
+	// Runs it here when no worker started it yet
+	pLoad->Run();
+	while (!pLoad->done.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	while (Upload(*pLoad))
+	{
+	}
+
+	m_Loads.erase(std::remove(m_Loads.begin(), m_Loads.end(), pLoad), m_Loads.end());
+}
+
+void ResourceManager::SetResource(ResourceEntry<Mesh>& entry, Mesh* pMesh)
+{
+	if (entry.pResource == pMesh)
+		return;
+
+	delete entry.pResource;
+	entry.pResource = pMesh;
+	m_ResourceBudget.Update(entry, pMesh != nullptr, GetResourceMemory(pMesh));
+
+	// Pending files are listed already
+	if (pMesh != nullptr && !entry.listed)
+	{
+		entry.listed = true;
+		if (!m_PendingMeshFiles.Contains(entry.id))
+			m_MeshIds.emplace_back(entry.id);
+	}
+}
+
+void ResourceManager::SetResource(ResourceEntry<Texture>& entry, Texture* pTexture)
+{
+	if (entry.pResource == pTexture)
+		return;
+
+	StopStreaming(entry);
+	delete entry.pResource;
+	entry.pResource = pTexture;
+	if (pTexture != nullptr && pTexture->IsStreamed())
+		StartStreaming(entry);
+
+	UpdateTextureMemory(entry);
+
+	if (pTexture != nullptr && !entry.listed)
+	{
+		entry.listed = true;
+		if (!m_PendingTextureFiles.Contains(entry.id))
+			m_TextureIds.emplace_back(entry.id);
+	}
+}
+
+void ResourceManager::Unload(ResourceEntryBase* pEntry)
+{
+	switch (pEntry->type)
+	{
+	case ResourceType::Mesh:
+		SetResource(*static_cast<ResourceEntry<Mesh>*>(pEntry), nullptr);
+		break;
+	case ResourceType::Texture:
+		SetResource(*static_cast<ResourceEntry<Texture>*>(pEntry), nullptr);
+		break;
+	default:
+		break;
+	}
+}
+
+void ResourceManager::UpdateTextureMemory(ResourceEntry<Texture>& entry)
+{
+	m_ResourceBudget.Update(entry, entry.pResource != nullptr, GetResourceMemory(entry.pResource));
+}
+
+void ResourceManager::EnforceBudget()
+{
+	while (ResourceEntryBase* pEntry = m_ResourceBudget.GetEvictionCandidate())
+	{
+		Logger::GetInstance()->LogDebug("ResourceManager: evicting " + pEntry->name + " (" + std::to_string(pEntry->memory / 1024) + " KB)");
+		Unload(pEntry);
+		++m_EvictionCount;
+	}
+}
+
+void ResourceManager::SetTextureStreaming(bool enabled)
+{
+	m_TextureStreaming = enabled;
+}
+
+bool ResourceManager::GetTextureStreaming() const
+{
+	return m_TextureStreaming;
+}
+
+void ResourceManager::RequestTextureSize(const Texture* pTexture, float pixels)
+{
+	if (pTexture != nullptr && pTexture->IsStreamed())
+		m_TextureStreamer.Request(pTexture->GetStreamSlot(), pixels);
+}
+
+void ResourceManager::SetTextureStreamingBudget(size_t bytes)
+{
+	// Applied by the next update, the mips of running loads can not be dropped before they finish
+	m_TextureStreamer.SetBudget(bytes);
+}
+
+size_t ResourceManager::GetTextureStreamingBudget() const
+{
+	return m_TextureStreamer.GetBudget();
+}
+
+TextureStreamer::Stats ResourceManager::GetTextureStreamingStats() const
+{
+	return m_TextureStreamer.GetStats();
+}
+
+void ResourceManager::UpdateStreaming()
+{
+	const bool loaded = ApplyStreamLoads();
+
+	// The sizes the draws of the last frame asked for
+	m_StreamEvictions.clear();
+	m_TextureStreamer.Update(m_StreamEvictions);
+	DropTextureMips(m_StreamEvictions);
+
+	TextureStreamer::Change load{};
+	while (m_StreamLoads.size() < g_MaxStreamLoads)
+	{
+		m_StreamEvictions.clear();
+		const bool started = m_TextureStreamer.PopLoad(load, m_StreamEvictions);
+		DropTextureMips(m_StreamEvictions);
+		if (!started)
+			break;
+
+		auto pLoad = std::make_shared<StreamLoad>();
+		pLoad->slot = load.slot;
+		pLoad->mip = load.mip;
+		pLoad->pDevice = MyEngine::GetSingleton()->GetDevice();
+		pLoad->pFile = m_StreamedTextures[load.slot]->pResource->GetStreamFile();
+
+		m_StreamLoads.emplace_back(pLoad);
+		JobSystem::GetInstance()->Execute([pLoad]() { pLoad->Run(); });
+	}
+
+	if (loaded)
+		EnforceBudget();
+}
+
+void ResourceManager::StartStreaming(ResourceEntry<Texture>& entry)
+{
+	Texture* pTexture = entry.pResource;
+
+	TextureStreamer::TextureInfo info{};
+	info.width = pTexture->GetWidth();
+	info.height = pTexture->GetHeight();
+	info.mipCount = pTexture->GetMipCount();
+	info.tailMip = pTexture->GetTailMip();
+	for (uint32_t mip = 0; mip < info.mipCount && mip < TextureStreamer::g_MaxMipCount; ++mip)
+		info.mipSizes[mip] = pTexture->GetMipSize(mip);
+
+	const uint32_t slot = m_TextureStreamer.Register(info);
+	if (slot == TextureStreamer::g_InvalidSlot)
+	{
+		Logger::GetInstance()->LogWarning("ResourceManager: " + entry.name + " can not be streamed, only its mip tail is loaded");
+		pTexture->StopStreaming();
+		return;
+	}
+
+	pTexture->SetStreamSlot(slot);
+	if (m_StreamedTextures.size() <= slot)
+		m_StreamedTextures.resize(slot + 1);
+	m_StreamedTextures[slot] = &entry;
+}
+
+void ResourceManager::StopStreaming(ResourceEntry<Texture>& entry)
+{
+	Texture* pTexture = entry.pResource;
+	if (pTexture == nullptr || !pTexture->IsStreamed())
+		return;
+
+	// The slot is used again, mips that are still being created for it are thrown away
+	const uint32_t slot = pTexture->GetStreamSlot();
+	for (const auto& pLoad : m_StreamLoads)
+	{
+		if (pLoad->slot == slot)
+			pLoad->cancelled = true;
+	}
+
+	m_TextureStreamer.Unregister(slot);
+	m_StreamedTextures[slot] = nullptr;
+	pTexture->StopStreaming();
+}
+
+bool ResourceManager::ApplyStreamLoads()
+{
+	bool loaded{};
+	for (auto iter = m_StreamLoads.begin(); iter != m_StreamLoads.end();)
+	{
+		StreamLoad& load = **iter;
+		if (!load.done.load(std::memory_order_acquire))
+		{
+			++iter;
+			continue;
+		}
+
+		if (!load.cancelled)
+		{
+			ResourceEntry<Texture>& entry = *m_StreamedTextures[load.slot];
+			if (load.pResource != nullptr)
+			{
+				entry.pResource->SetMips(load.mip, load.pResource, load.pView);
+				load.pResource = nullptr;
+				load.pView = nullptr;
+				m_TextureStreamer.SetResidentMip(load.slot, load.mip);
+				UpdateTextureMemory(entry);
+				loaded = true;
+			}
+			else
+			{
+				Logger::GetInstance()->LogWarning("ResourceManager: could not stream in the mips of " + entry.name);
+				m_TextureStreamer.OnLoadFailed(load.slot);
+			}
+		}
+		iter = m_StreamLoads.erase(iter);
+	}
+	return loaded;
+}
+
+void ResourceManager::DropTextureMips(const std::vector<TextureStreamer::Change>& evictions)
+{
+	for (const TextureStreamer::Change& eviction : evictions)
+	{
+		ResourceEntry<Texture>& entry = *m_StreamedTextures[eviction.slot];
+		Texture* pTexture = entry.pResource;
+		// Counted again with what it still has
+		if (!pTexture->DropMips(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetDeviceContext(), eviction.mip))
+			m_TextureStreamer.SetResidentMip(eviction.slot, pTexture->GetResidentMip());
+		UpdateTextureMemory(entry);
+	}
+}
+
+void ResourceManager::WaitForStreamLoads()
+{
+	for (const auto& pLoad : m_StreamLoads)
+	{
+		pLoad->Run();
+		while (!pLoad->done.load(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+}
@@ -1,11 +1,36 @@
 #pragma once
-#include <map>
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "ResourceBudget.h"
+#include "ResourceHandle.h"
+#include "TextureStreamer.h"
+
+class AssetPack;
+class DirectoryModel;
+class FileWatcher;
 class Mesh;
 class Texture;
+struct DirectoryNode;
+struct ResourceRecord;
+
+// Where the time of the last load of a file went, in milliseconds
+struct ResourceLoadTiming
+{
+	float queued{};			// Until a worker, or the thread that needed it, started on it
+	float worker{};			// File I/O and decoding
+	float upload{};			// Creating the GPU resources on the main thread, including the frames spent waiting for the budget
+	float total{};
+	bool failed{};
+};
 
+// Owns every mesh and texture, components hold handles instead of pointers. Resources loaded from a file are kept
+// after their last handle is released and only evicted, least recently used first, when the budget is exceeded.
+// Names are interned into 64-bit ids once, lookups by id never touch a string.
 class ResourceManager
 {
 public:
@@ -17,27 +42,202 @@ public:
 
 	static ResourceManager* GetInstance();
 
+	// Keeps the name so the id can be turned back into a name (the editor, loading the file, scene files)
+	ResourceId Intern(const std::string& name);
+	const std::string& GetName(ResourceId id) const;
+
+	// Takes ownership, a mesh that was registered under the same name is replaced and the handles follow the new one
 	void AddMesh(const std::string& name, Mesh* pMesh);
-	Mesh* GetMesh(const std::string& name);
+	MeshHandle GetMesh(ResourceId id);
+	MeshHandle GetMesh(const std::string& name);
+	// Loads the file right away when the submesh is not loaded yet
+	MeshHandle GetMesh(ResourceId file, int submeshId);
+	MeshHandle GetMesh(const std::string& file, int submeshId);
+	// Imports the file on the job system and returns right away, Update creates the meshes on the main thread.
+	// Empty when the file is loaded already and has no such submesh.
+	MeshHandle LoadMeshAsync(ResourceId file, int submeshId = 0);
+	MeshHandle LoadMeshAsync(const std::string& file, int submeshId = 0);
+	// Finds the handle of a mesh that is already owned by the manager
+	MeshHandle GetMesh(const Mesh* pMesh);
+	// Does not load or reference anything
 	Mesh* GetMeshConst(const std::string& name) const;
 	void AddTexture(const std::string& name, Texture* pTexture);
-	Texture* GetTexture(const std::string& name);
+	TextureHandle GetTexture(ResourceId id);
+	TextureHandle GetTexture(const std::string& name);
+	// Reads the file on the job system, Update decodes and uploads it on the main thread
+	TextureHandle LoadTextureAsync(ResourceId id);
+	TextureHandle LoadTextureAsync(const std::string& name);
+
+	// Handed out by the handles while their resource loads
+	Mesh* GetPlaceholderMesh();
+	Texture* GetPlaceholderTexture();
+
+	// Called once per frame on the main thread. Creates the GPU resources of the loads that finished on the
+	// workers, one submesh or texture at a time, until the time budget is used up (at least one step per frame).
+	void Update(float budgetMilliseconds = 2.f);
+	size_t GetLoadingCount() const;
+	// Resources are read out of the pack when it has them and from loose files otherwise. Mount before anything
+	// loads, unmounting finishes the loads that are still running first.
+	bool MountPack(const std::string& filename);
+	void UnmountPack();
+	const AssetPack* GetPack() const;
+
+	// Watches the directory from a background thread. Update keeps the directory model of the editor up to date,
+	// lists the mesh and texture files that were added and imports the loaded files that changed again.
+	void WatchDirectory(const std::string& directory);
+	// nullptr when no directory is watched
+	const DirectoryModel* GetDirectoryModel() const;
+	// Imports a changed file again when it is loaded. The old resource is used until the new one is uploaded and
+	// then replaced under the same entry, so every handle follows. False while a load of the file is running.
+	bool Reload(const std::string& file);
+
+	// Timing of the last finished load of a mesh file or texture, nullptr when it was never loaded
+	const ResourceLoadTiming* GetMeshLoadTiming(ResourceId file) const;
+	const ResourceLoadTiming* GetTextureLoadTiming(ResourceId id) const;
+
 
-	
 	void AddMeshFile(const std::string& filename);
 	void AddTextureFile(const std::string& filename);
 
+	// Every mesh and texture that was registered plus the files that were found but not loaded yet, in the order
+	// they were first seen. Kept up to date instead of being rebuilt for every call.
+	const std::vector<ResourceId>& GetMeshIds() const;
+	const std::vector<ResourceId>& GetTextureIds() const;
 	std::vector<std::string> GetMeshNames(bool includeFileNames = true) const;
 	std::vector<std::string> GetTextureNames(bool includeFileNames = true) const;
 
+	// Name the submesh of a file is registered under
+	static std::string GetSubmeshName(const std::string& file, int submeshId);
+	static ResourceId GetSubmeshId(ResourceId file, int submeshId);
+
+	// Scene files store ids and one table with the names of the ids that were written
+	void BeginNameTable();
+	ResourceId AddToNameTable(ResourceId id);
+	const std::vector<ResourceId>& GetNameTable() const;
+	// Interns the names of a table that was read back, false when a name does not match its id
+	bool ReadNameTable(const std::vector<std::pair<ResourceId, std::string>>& names);
+
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget() const;
+	// Memory of the loaded resources of one type
+	size_t GetMemory(ResourceType type) const;
+	size_t GetMemory() const;
+	size_t GetEvictionCount() const;
+
+	// Cooked textures with a mip tail load only the tail and stream their bigger mips in once the draws ask for
+	// them, see TextureStreamer. Changes the textures that are loaded afterwards.
+	void SetTextureStreaming(bool enabled);
+	bool GetTextureStreaming() const;
+	// Called by the draws, pixels is how many pixels the longest edge of the texture covers on screen
+	void RequestTextureSize(const Texture* pTexture, float pixels);
+	// The streamed textures, their tails included, stay inside it, the mips no draw asked for lately go first
+	void SetTextureStreamingBudget(size_t bytes);
+	size_t GetTextureStreamingBudget() const;
+	TextureStreamer::Stats GetTextureStreamingStats() const;
+	// Appends what every mesh and texture entry costs, also the ones that are not loaded
+	void GetRecords(std::vector<ResourceRecord>& records) const;
+
 private:
+	template<typename T>
+	friend class ResourceHandle;
+
 	ResourceManager() = default;
 	static ResourceManager* m_pResourceManager;
 
-	std::map<std::string, Mesh*> m_pMeshes{};
-	std::map<std::string, Texture*> m_pTextures{};
+	// A file that is read and decoded on a worker and finished on the main thread
+	struct AsyncLoad;
+	// Bigger mips of a streamed texture, created on a worker and swapped in on the main thread
+	struct StreamLoad;
+
+	void Acquire(ResourceEntryBase* pEntry);
+	void Release(ResourceEntryBase* pEntry);
+	// The resource of an entry that is not loaded, starts loading it again when it was evicted
+	Mesh* Resolve(ResourceEntry<Mesh>* pEntry);
+	Texture* Resolve(ResourceEntry<Texture>* pEntry);
+	// Loads the resource of the entry before returning
+	void Finish(ResourceEntry<Mesh>* pEntry);
+	void Finish(ResourceEntry<Texture>* pEntry);
+
+	// The load that is running for the file already or a new one, the worker part runs on the calling thread
+	// when async is false. A reload leaves the entries alone until the new resources replace the old ones.
+	std::shared_ptr<AsyncLoad> StartMeshLoad(ResourceId file, bool async, bool reload = false);
+	std::shared_ptr<AsyncLoad> StartTextureLoad(ResourceEntry<Texture>& entry, bool async, bool reload = false);
+	// One step of main thread work on a load the worker finished, false once the load is complete. Submeshes whose
+	// entry is still loaded are thrown away again.
+	bool Upload(AsyncLoad& load);
+	void FinishMeshLoad(AsyncLoad& load);
+	void RecordLoadTiming(const AsyncLoad& load, bool failed);
+	// Waits for the worker and does all the remaining steps
+	void Complete(std::shared_ptr<AsyncLoad> pLoad);
+	void SetResource(ResourceEntry<Mesh>& entry, Mesh* pMesh);
+	void SetResource(ResourceEntry<Texture>& entry, Texture* pTexture);
+	void Unload(ResourceEntryBase* pEntry);
+	void UpdateTextureMemory(ResourceEntry<Texture>& entry);
+	void EnforceBudget();
+
+	// Swaps in the mips that were streamed in, drops the ones the streamer evicts and starts the loads it picks
+	void UpdateStreaming();
+	// Registers a texture that streams with the streamer, or lets go of it again
+	void StartStreaming(ResourceEntry<Texture>& entry);
+	void StopStreaming(ResourceEntry<Texture>& entry);
+	// True when a texture got mips
+	bool ApplyStreamLoads();
+	void DropTextureMips(const std::vector<TextureStreamer::Change>& evictions);
+	// Runs the stream loads no worker started yet here and waits for the others
+	void WaitForStreamLoads();
+	void UpdateWatcher();
+	void RegisterFiles(const DirectoryNode& node);
+
+	ResourceEntry<Mesh>& GetMeshEntry(ResourceId id);
+	ResourceEntry<Texture>& GetTextureEntry(ResourceId id);
+
+	// Interned names, a deque so the strings handed out stay where they are
+	std::deque<std::string> m_Names{};
+	ResourceIdMap<uint32_t> m_NameIndices{};
+
+	// Entries never move, the handles point at them
+	std::deque<ResourceEntry<Mesh>> m_Meshes{};
+	std::deque<ResourceEntry<Texture>> m_Textures{};
+	ResourceIdMap<ResourceEntry<Mesh>*> m_MeshTable{};
+	ResourceIdMap<ResourceEntry<Texture>*> m_TextureTable{};
+
+	// Reference counts, memory and the unreferenced resources that can be loaded again
+	ResourceBudget m_ResourceBudget{};
+	size_t m_EvictionCount{};
+
+	// Set while the meshes of a file are created, they register themselves in their constructor
+	std::string m_LoadingMeshFile{};
+	bool m_ReplaceLoadedMeshes{};
+	std::vector<Mesh*> m_pDuplicateMeshes{};
+
+	// In the order they were started
+	std::deque<std::shared_ptr<AsyncLoad>> m_Loads{};
+	MeshHandle m_PlaceholderMesh{};
+	TextureHandle m_PlaceholderTexture{};
+	ResourceIdMap<ResourceLoadTiming> m_MeshLoadTimings{};
+	ResourceIdMap<ResourceLoadTiming> m_TextureLoadTimings{};
+
+	AssetPack* m_pPack{};
+
+	TextureStreamer m_TextureStreamer{};
+	// Entries of the streamed textures by their streamer slot
+	std::vector<ResourceEntry<Texture>*> m_StreamedTextures{};
+	std::vector<std::shared_ptr<StreamLoad>> m_StreamLoads{};
+	std::vector<TextureStreamer::Change> m_StreamEvictions{};
+	bool m_TextureStreaming{ true };
+
+	FileWatcher* m_pFileWatcher{};
+	DirectoryModel* m_pDirectoryModel{};
+	// Changed files and when they last changed, they are imported once they stopped changing
+	std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>> m_ChangedFiles{};
+
+	// Files that were found on disk but not loaded yet
+	ResourceIdSet m_PendingMeshFiles{};
+	ResourceIdSet m_PendingTextureFiles{};
+	std::vector<ResourceId> m_MeshIds{};
+	std::vector<ResourceId> m_TextureIds{};
 
-	std::vector<std::string> m_MeshFiles{};
-	std::vector<std::string> m_TextureFiles{};
+	ResourceIdSet m_NameTableIds{};
+	std::vector<ResourceId> m_NameTable{};
 };
 
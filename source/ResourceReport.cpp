@@ -0,0 +1,118 @@
+#include "ResourceReport.h"
+#include "MaterialManager.h"
+#include "ResourceManager.h"
+
+#include <fstream>
+#include <stringbuffer.h>
+#include <prettywriter.h>
+
+namespace
+{
+	// Quoted when it holds a separator, a quote or a line break, quotes are doubled
+	void WriteCsvField(std::ofstream& file, const std::string& value)
+	{
+		if (value.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			file << value;
+			return;
+		}
+
+		file << '"';
+		for (char c : value)
+		{
+			if (c == '"')
+				file << '"';
+			file << c;
+		}
+		file << '"';
+	}
+}
+
+const char* ResourceReport::GetTypeName(ResourceRecordType type)
+{
+	switch (type)
+	{
+	case ResourceRecordType::Mesh:
+		return "Mesh";
+	case ResourceRecordType::Texture:
+		return "Texture";
+	case ResourceRecordType::Material:
+		return "Material";
+	default:
+		return "Unknown";
+	}
+}
+
+std::vector<ResourceRecord> ResourceReport::Collect()
+{
+	std::vector<ResourceRecord> records{};
+	ResourceManager::GetInstance()->GetRecords(records);
+	MaterialManager::GetInstance()->GetRecords(records);
+	return records;
+}
+
+bool ResourceReport::WriteJson(const std::vector<ResourceRecord>& records, const std::string& filename)
+{
+	std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+	if (!file.is_open())
+		return false;
+
+	rapidjson::StringBuffer buffer{};
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+
+	const ResourceManager* pResourceManager = ResourceManager::GetInstance();
+	writer.StartObject();
+	writer.Key("MemoryBudget");
+	writer.Uint64(pResourceManager->GetMemoryBudget());
+	writer.Key("BudgetedMemory");
+	writer.Uint64(pResourceManager->GetMemory());
+
+	writer.Key("Resources");
+	writer.StartArray();
+	for (const ResourceRecord& record : records)
+	{
+		writer.StartObject();
+		writer.Key("Type");
+		writer.String(GetTypeName(record.type));
+		writer.Key("Name");
+		writer.String(record.name.c_str(), static_cast<rapidjson::SizeType>(record.name.size()));
+		writer.Key("Source");
+		writer.String(record.source.c_str(), static_cast<rapidjson::SizeType>(record.source.size()));
+		writer.Key("CpuBytes");
+		writer.Uint64(record.cpuMemory);
+		writer.Key("GpuBytes");
+		writer.Uint64(record.gpuMemory);
+		writer.Key("LoadMilliseconds");
+		writer.Double(record.loadMilliseconds);
+		writer.Key("References");
+		writer.Uint(record.referenceCount);
+		writer.Key("Loaded");
+		writer.Bool(record.loaded);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	file.write(buffer.GetString(), buffer.GetSize());
+	return static_cast<bool>(file);
+}
+
+bool ResourceReport::WriteCsv(const std::vector<ResourceRecord>& records, const std::string& filename)
+{
+	std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+	if (!file.is_open())
+		return false;
+
+	file << "Type,Name,Source,CpuBytes,GpuBytes,LoadMilliseconds,References,Loaded\n";
+	for (const ResourceRecord& record : records)
+	{
+		file << GetTypeName(record.type) << ',';
+		WriteCsvField(file, record.name);
+		file << ',';
+		WriteCsvField(file, record.source);
+		file << ',' << record.cpuMemory << ',' << record.gpuMemory << ',' << record.loadMilliseconds << ',' << record.referenceCount << ','
+			<< (record.loaded ? 1 : 0) << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ResourceRecordType
+{
+	Mesh,
+	Texture,
+	Material
+};
+
+// What one resource costs, gathered from the manager that owns it
+struct ResourceRecord
+{
+	ResourceRecordType type{};
+	std::string name{};
+	std::string source{};			// File it was loaded from, empty for resources made in code
+	size_t cpuMemory{};
+	size_t gpuMemory{};
+	float loadMilliseconds{};		// Last load, for a submesh the load of its whole file
+	uint32_t referenceCount{};		// Handles, for a material the names it is shared by
+	bool loaded{};					// Evicted resources and the ones that are still loading only have their entry
+};
+
+// Every mesh, texture and material in one list, for the editor and for finding what blows the memory budget.
+// Collected from the managers when asked for, nothing is tracked twice.
+namespace ResourceReport
+{
+	const char* GetTypeName(ResourceRecordType type);
+
+	std::vector<ResourceRecord> Collect();
+
+	// false when the file can not be written
+	bool WriteJson(const std::vector<ResourceRecord>& records, const std::string& filename);
+	bool WriteCsv(const std::vector<ResourceRecord>& records, const std::string& filename);
+}
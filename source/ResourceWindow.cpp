@@ -0,0 +1,212 @@
+#include "ResourceWindow.h"
+#include "Logger.h"
+#include "ResourceManager.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	// Collecting walks every entry, twice a second is plenty for a window that is read by a person
+	constexpr double g_RefreshInterval{ 0.5 };
+
+	constexpr const char* g_JsonFile{ "ResourceReport.json" };
+	constexpr const char* g_CsvFile{ "ResourceReport.csv" };
+
+	enum Column
+	{
+		Type,
+		Name,
+		Source,
+		CpuMemory,
+		GpuMemory,
+		LoadTime,
+		References,
+		Count
+	};
+
+	void FormatBytes(char* pBuffer, size_t size, size_t bytes)
+	{
+		if (bytes >= 1024 * 1024)
+			snprintf(pBuffer, size, "%.2f MB", bytes / (1024.0 * 1024.0));
+		else if (bytes >= 1024)
+			snprintf(pBuffer, size, "%.1f KB", bytes / 1024.0);
+		else
+			snprintf(pBuffer, size, "%zu B", bytes);
+	}
+
+	void TextBytes(size_t bytes)
+	{
+		char buffer[32];
+		FormatBytes(buffer, sizeof(buffer), bytes);
+		ImGui::TextUnformatted(buffer);
+	}
+}
+
+ResourceWindow::ResourceWindow(std::string title, ImVec2 size)
+	: EditorWindow(title, size)
+{
+}
+
+void ResourceWindow::Draw()
+{
+	const bool refresh = ImGui::Button("Refresh");
+	ImGui::SameLine();
+	if (ImGui::Button("Dump JSON"))
+	{
+		if (ResourceReport::WriteJson(ResourceReport::Collect(), g_JsonFile))
+			Logger::GetInstance()->LogInfo(std::string("ResourceWindow: wrote ") + g_JsonFile);
+		else
+			Logger::GetInstance()->LogWarning(std::string("ResourceWindow: could not write ") + g_JsonFile);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Dump CSV"))
+	{
+		if (ResourceReport::WriteCsv(ResourceReport::Collect(), g_CsvFile))
+			Logger::GetInstance()->LogInfo(std::string("ResourceWindow: wrote ") + g_CsvFile);
+		else
+			Logger::GetInstance()->LogWarning(std::string("ResourceWindow: could not write ") + g_CsvFile);
+	}
+	ImGui::SameLine();
+	const bool filterChanged = m_Filter.Draw("Filter", -100.0f);
+
+	if (refresh || m_LastRefresh < 0.0 || ImGui::GetTime() - m_LastRefresh >= g_RefreshInterval)
+		Refresh();
+	else if (filterChanged)
+		Sort();
+
+	// Totals per type, the budget only counts what is on the GPU
+	size_t cpuMemory[3]{};
+	size_t gpuMemory[3]{};
+	for (const ResourceRecord& record : m_Records)
+	{
+		cpuMemory[static_cast<size_t>(record.type)] += record.cpuMemory;
+		gpuMemory[static_cast<size_t>(record.type)] += record.gpuMemory;
+	}
+	for (size_t type = 0; type < 3; ++type)
+	{
+		char cpu[32];
+		char gpu[32];
+		FormatBytes(cpu, sizeof(cpu), cpuMemory[type]);
+		FormatBytes(gpu, sizeof(gpu), gpuMemory[type]);
+		ImGui::Text("%-9s CPU %-10s GPU %s", ResourceReport::GetTypeName(static_cast<ResourceRecordType>(type)), cpu, gpu);
+	}
+	const ResourceManager* pResourceManager = ResourceManager::GetInstance();
+	const float budgetFraction = pResourceManager->GetMemoryBudget() > 0 ? static_cast<float>(pResourceManager->GetMemory()) / pResourceManager->GetMemoryBudget() : 0.f;
+	char budget[32];
+	FormatBytes(budget, sizeof(budget), pResourceManager->GetMemoryBudget());
+	ImGui::ProgressBar((std::min)(budgetFraction, 1.f), ImVec2{ -1.f, 0.f }, (std::to_string(static_cast<int>(budgetFraction * 100.f)) + "% of " + budget).c_str());
+
+	// Mips of the streamed textures, their memory is part of the GPU memory of the textures above
+	const TextureStreamer::Stats streaming = pResourceManager->GetTextureStreamingStats();
+	char streamed[32];
+	char streamingBudget[32];
+	FormatBytes(streamed, sizeof(streamed), streaming.memory);
+	FormatBytes(streamingBudget, sizeof(streamingBudget), streaming.budget);
+	ImGui::Text("Streaming %zu textures, %s of %s, %u loading, %zu queued, %zu loads, %zu evictions", streaming.textureCount, streamed, streamingBudget,
+		streaming.loading, streaming.queued, streaming.loadCount, streaming.evictionCount);
+	ImGui::Separator();
+
+	constexpr ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter
+		| ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingStretchProp;
+	if (!ImGui::BeginTable("Resources", Column::Count, flags))
+		return;
+
+	ImGui::TableSetupScrollFreeze(0, 1);
+	ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed, 0.f, Column::Type);
+	ImGui::TableSetupColumn("Name", 0, 2.f, Column::Name);
+	ImGui::TableSetupColumn("Source", 0, 2.f, Column::Source);
+	ImGui::TableSetupColumn("CPU", ImGuiTableColumnFlags_PreferSortDescending, 1.f, Column::CpuMemory);
+	ImGui::TableSetupColumn("GPU", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending, 1.f, Column::GpuMemory);
+	ImGui::TableSetupColumn("Load (ms)", ImGuiTableColumnFlags_PreferSortDescending, 1.f, Column::LoadTime);
+	ImGui::TableSetupColumn("Refs", ImGuiTableColumnFlags_PreferSortDescending, 0.5f, Column::References);
+	ImGui::TableHeadersRow();
+
+	if (ImGuiTableSortSpecs* pSortSpecs = ImGui::TableGetSortSpecs(); pSortSpecs != nullptr && pSortSpecs->SpecsDirty)
+	{
+		if (pSortSpecs->SpecsCount > 0)
+		{
+			m_SortColumn = static_cast<int>(pSortSpecs->Specs[0].ColumnUserID);
+			m_SortAscending = pSortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+		}
+		pSortSpecs->SpecsDirty = false;
+		Sort();
+	}
+
+	ImGuiListClipper clipper{};
+	clipper.Begin(static_cast<int>(m_Rows.size()));
+	while (clipper.Step())
+	{
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+		{
+			const ResourceRecord& record = m_Records[m_Rows[row]];
+			ImGui::TableNextRow();
+
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(ResourceReport::GetTypeName(record.type));
+			ImGui::TableNextColumn();
+			if (record.loaded)
+				ImGui::TextUnformatted(record.name.c_str());
+			else
+				ImGui::TextDisabled("%s", record.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(record.source.c_str());
+			ImGui::TableNextColumn();
+			TextBytes(record.cpuMemory);
+			ImGui::TableNextColumn();
+			TextBytes(record.gpuMemory);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", record.loadMilliseconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", record.referenceCount);
+		}
+	}
+
+	ImGui::EndTable();
+}
+
+void ResourceWindow::Refresh()
+{
+	m_Records = ResourceReport::Collect();
+	m_LastRefresh = ImGui::GetTime();
+	Sort();
+}
+
+void ResourceWindow::Sort()
+{
+	m_Rows.clear();
+	for (size_t i = 0; i < m_Records.size(); ++i)
+	{
+		const ResourceRecord& record = m_Records[i];
+		if (m_Filter.PassFilter(record.name.c_str()) || m_Filter.PassFilter(record.source.c_str()))
+			m_Rows.push_back(i);
+	}
+
+	auto less = [this](size_t a, size_t b)
+	{
+		const ResourceRecord& left = m_Records[a];
+		const ResourceRecord& right = m_Records[b];
+		switch (m_SortColumn)
+		{
+		case Column::Type:
+			return left.type < right.type;
+		case Column::Name:
+			return left.name < right.name;
+		case Column::Source:
+			return left.source < right.source;
+		case Column::CpuMemory:
+			return left.cpuMemory < right.cpuMemory;
+		case Column::LoadTime:
+			return left.loadMilliseconds < right.loadMilliseconds;
+		case Column::References:
+			return left.referenceCount < right.referenceCount;
+		default:
+			return left.gpuMemory < right.gpuMemory;
+		}
+	};
+
+	if (m_SortAscending)
+		std::stable_sort(m_Rows.begin(), m_Rows.end(), less);
+	else
+		std::stable_sort(m_Rows.begin(), m_Rows.end(), [&less](size_t a, size_t b) { return less(b, a); });
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+#include "EditorWindow.h"
+#include "ResourceReport.h"
+
+// Every mesh, texture and material with what it costs, sortable so the ones that blow the memory budget end up
+// on top. Dumps the same list to JSON or CSV.
+class ResourceWindow final : public EditorWindow
+{
+public:
+	ResourceWindow(std::string title = "Resources", ImVec2 size = ImVec2{ 700, 400 });
+
+	void Draw() override;
+
+private:
+	void Refresh();
+	void Sort();
+
+	std::vector<ResourceRecord> m_Records{};
+	// Indices of the records that pass the filter, in sorted order
+	std::vector<size_t> m_Rows{};
+	ImGuiTextFilter m_Filter{};
+	double m_LastRefresh{ -1.0 };
+
+	// The column and direction of the table, kept between refreshes
+	int m_SortColumn{ 4 };
+	bool m_SortAscending{ false };
+};
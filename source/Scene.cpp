@@ -14,6 +14,17 @@
 #include "MaterialManager.h"
 #include "MyApplication.h"
 #include "DebugRenderer.h"
+#include "AssetPack.h"
+#include "Compression.h"
+#include "Logger.h"
+#include "Mesh.h"
+#include "MeshComponent.h"
+#include "ResourceManager.h"
+#include "TransformComponent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 Scene::Scene()
 {
@@ -140,9 +151,9 @@ void Scene::Update()
 	m_pPhysxProxy->Update();
 }
 
-void Scene::Serialize(const std::string& filename)
+void Scene::Serialize(const std::string& filename, bool compress)
 {
-	std::ofstream levelFile{ filename + ".json" };
+	std::ofstream levelFile{ filename + ".json", std::ios::binary };
 	if (!levelFile.is_open())
 	{
 		return;
@@ -157,6 +168,10 @@ void Scene::Serialize(const std::string& filename)
 	writer.Key("SceneName");
 	writer.String(filename.c_str());
 
+	// Components write resource ids, their names are written once after the gameobjects
+	auto pResourceManager = ResourceManager::GetInstance();
+	pResourceManager->BeginNameTable();
+
 	writer.Key("Gameobjects");
 	writer.StartArray();
 
@@ -167,25 +182,85 @@ void Scene::Serialize(const std::string& filename)
 		writer.EndObject();
 	}
 	writer.EndArray();
+
+	writer.Key("Resources");
+	writer.StartArray();
+	for (ResourceId id : pResourceManager->GetNameTable())
+	{
+		writer.StartObject();
+		writer.Key("Id");
+		writer.Uint64(id);
+		writer.Key("Name");
+		writer.String(pResourceManager->GetName(id).c_str());
+		writer.EndObject();
+	}
+	writer.EndArray();
 	writer.EndObject();
 
-	levelFile << outputFile.GetString();
+	if (compress)
+	{
+		Compression::WriteCompressed(levelFile, outputFile.GetString(), outputFile.GetSize());
+		Logger::GetInstance()->LogInfo("Saved " + filename + ": " + std::to_string(outputFile.GetSize()) + " bytes compressed to " + std::to_string(static_cast<long long>(levelFile.tellp())) + " bytes");
+	}
+	else
+		levelFile.write(outputFile.GetString(), outputFile.GetSize());
 
 	levelFile.close();
 }
 
-void Scene::Deserialize(const std::string& filename)
+bool Scene::Deserialize(const std::string& filename)
 {
+	// Out of the mounted pack when it has the level
+	AssetFile levelAsset{ filename + ".json" };
+	if (!levelAsset.IsOpen())
+	{
+		Logger::GetInstance()->LogWarning("Failed to open level file: " + filename);
+		return false;
+	}
+	AssetStreamBuffer levelBuffer{ levelAsset };
+	std::istream levelFile{ &levelBuffer };
+
+	rapidjson::Document levelDocument{};
+	if (Compression::IsCompressed(levelFile))
+	{
+		CompressedInputStream compressedStream{ levelFile };
+		levelDocument.ParseStream(compressedStream);
+
+		// A file cut off before its end marker can still hold a complete document, it is not loaded either
+		if (!compressedStream.IsValid())
+		{
+			Logger::GetInstance()->LogWarning("Corrupt or truncated compressed level file: " + filename);
+			return false;
+		}
+	}
+	else
+	{
+		// Legacy uncompressed level file
+		rapidjson::IStreamWrapper isw{ levelFile };
+		levelDocument.ParseStream(isw);
+	}
+
+	if (levelDocument.HasParseError())
+	{
+		Logger::GetInstance()->LogWarning("Failed to parse level file: " + filename);
+		return false;
+	}
+
 	m_pGameObjects.clear();
 
-	std::ifstream levelFile{ filename + ".json" };
-	if (!levelFile.is_open())
+	// The names have to be known before the components look their ids up
+	if (levelDocument.HasMember("Resources"))
 	{
-		return;
+		std::vector<std::pair<ResourceId, std::string>> names;
+		for (const auto& resource : levelDocument["Resources"].GetArray())
+			names.emplace_back(resource["Id"].GetUint64(), resource["Name"].GetString());
+
+		if (!ResourceManager::GetInstance()->ReadNameTable(names))
+			Logger::GetInstance()->LogWarning("Level file " + filename + " has a resource name table that does not match its ids");
 	}
-	rapidjson::IStreamWrapper isw{ levelFile };
-	rapidjson::Document levelDocument{};
-	levelDocument.ParseStream(isw);
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<Dependency> dependencies = PrefetchDependencies(levelDocument);
 
 	MaterialManager::GetInstance()->Deserialize(this, levelDocument);
 
@@ -193,6 +268,226 @@ void Scene::Deserialize(const std::string& filename)
 	{
 		AddGameObject(GameObject::Deserialize(this, gameobject));
 	}
+
+	WaitForDependencies(filename, dependencies, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+	return true;
+}
+
+std::vector<Scene::Dependency> Scene::PrefetchDependencies(const rapidjson::Document& levelDocument)
+{
+	const auto pResourceManager = ResourceManager::GetInstance();
+	std::vector<Dependency> dependencies;
+
+	ResourceIdSet requestedTextures;
+	if (levelDocument.HasMember("Materials"))
+	{
+		for (const auto& material : levelDocument["Materials"].GetArray())
+		{
+			if (!material.HasMember("DiffuseTexture"))
+				continue;
+
+			const ResourceId id = pResourceManager->Intern(material["DiffuseTexture"].GetString());
+			if (!requestedTextures.Insert(id))
+				continue;
+
+			Dependency dependency{ ResourceType::Texture, id, false };
+			dependency.texture = pResourceManager->LoadTextureAsync(id);
+			dependency.wasLoaded = dependency.texture.IsLoaded();
+			// Starts loading a texture that was evicted again as well
+			dependency.texture.Get();
+			dependencies.emplace_back(std::move(dependency));
+		}
+	}
+
+	ResourceIdSet requestedSubmeshes;
+	if (levelDocument.HasMember("Gameobjects"))
+	{
+		for (const auto& gameobject : levelDocument["Gameobjects"].GetArray())
+			PrefetchMeshes(gameobject, requestedSubmeshes, dependencies);
+	}
+
+	return dependencies;
+}
+
+void Scene::PrefetchMeshes(const rapidjson::Value& gameobject, ResourceIdSet& requested, std::vector<Dependency>& dependencies)
+{
+	const auto pResourceManager = ResourceManager::GetInstance();
+	for (const auto& component : gameobject["Components"].GetArray())
+	{
+		// Stored the way MeshComponent does, by id or by path in scenes saved before the name table
+		ResourceId file{ g_InvalidResourceId };
+		if (component.HasMember("Mesh") && component["Mesh"].IsUint64())
+			file = component["Mesh"].GetUint64();
+		else if (component.HasMember("MeshPath") && component["MeshPath"].IsString())
+			file = pResourceManager->Intern(component["MeshPath"].GetString());
+		else
+			continue;
+
+		const int submeshId = component.HasMember("SubmeshId") ? component["SubmeshId"].GetInt() : 0;
+		if (!requested.Insert(ResourceManager::GetSubmeshId(file, submeshId)))
+			continue;
+
+		Dependency dependency{ ResourceType::Mesh, file, false };
+		dependency.mesh = pResourceManager->LoadMeshAsync(file, submeshId);
+		dependency.wasLoaded = dependency.mesh.IsLoaded();
+		dependency.mesh.Get();
+		dependencies.emplace_back(std::move(dependency));
+	}
+
+	for (const auto& child : gameobject["Children"].GetArray())
+		PrefetchMeshes(child, requested, dependencies);
+}
+
+void Scene::WaitForDependencies(const std::string& filename, std::vector<Dependency>& dependencies, float elapsedMilliseconds)
+{
+	const auto pResourceManager = ResourceManager::GetInstance();
+	const auto start = std::chrono::steady_clock::now();
+
+	// Submeshes of one file share its load, it is reported once
+	ResourceIdSet reported;
+	float workerMilliseconds{};
+	size_t loadCount{};
+	for (Dependency& dependency : dependencies)
+	{
+		const bool isMesh = dependency.type == ResourceType::Mesh;
+		const bool failed = isMesh ? dependency.mesh.Wait() == nullptr : dependency.texture.Wait() == nullptr;
+		if (dependency.wasLoaded || !reported.Insert(dependency.file))
+			continue;
+
+		const ResourceLoadTiming* pTiming = isMesh ? pResourceManager->GetMeshLoadTiming(dependency.file) : pResourceManager->GetTextureLoadTiming(dependency.file);
+		const std::string& name = pResourceManager->GetName(dependency.file);
+		if (pTiming == nullptr)
+		{
+			Logger::GetInstance()->LogWarning("Scene: " + name + (failed ? " could not be loaded" : " has no load timing"));
+			continue;
+		}
+
+		char timing[128];
+		std::snprintf(timing, sizeof(timing), " %.2f ms (queued %.2f, worker %.2f, upload %.2f)%s", pTiming->total, pTiming->queued, pTiming->worker, pTiming->upload, pTiming->failed ? " failed" : "");
+		Logger::GetInstance()->LogInfo("Scene: " + name + timing);
+		workerMilliseconds += pTiming->worker;
+		++loadCount;
+	}
+
+	const float waitMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	char summary[160];
+	std::snprintf(summary, sizeof(summary), " loaded %zu of %zu dependencies in %.2f ms, %.2f ms building objects, %.2f ms waiting, %.2f ms of worker time",
+		loadCount, dependencies.size(), elapsedMilliseconds + waitMilliseconds, elapsedMilliseconds, waitMilliseconds, workerMilliseconds);
+	Logger::GetInstance()->LogInfo("Scene: " + filename + summary);
+}
+
+bool Scene::Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, RaycastHit& hit, float maxDistance)
+{
+	DirectX::XMFLOAT3 unitDirection{};
+	DirectX::XMStoreFloat3(&unitDirection, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&direction)));
+
+	m_RaycastCandidates.clear();
+	for (GameObject* pGameObject : m_pGameObjects)
+		GatherRaycastCandidates(pGameObject, origin, unitDirection, maxDistance, m_RaycastCandidates);
+	std::sort(m_RaycastCandidates.begin(), m_RaycastCandidates.end(), [](const RaycastCandidate& a, const RaycastCandidate& b) { return a.entry < b.entry; });
+
+	float closest = maxDistance;
+	bool found{};
+	for (const RaycastCandidate& candidate : m_RaycastCandidates)
+	{
+		// Every sphere after this one starts further away than what was already hit
+		if (candidate.entry >= closest)
+			break;
+
+		// The direction is transformed without normalizing, so the distance along it stays the world distance
+		const DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&candidate.world);
+		const DirectX::XMMATRIX inverseWorld = DirectX::XMMatrixInverse(nullptr, world);
+		DirectX::XMFLOAT3 localOrigin{};
+		DirectX::XMFLOAT3 localDirection{};
+		DirectX::XMStoreFloat3(&localOrigin, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&origin), inverseWorld));
+		DirectX::XMStoreFloat3(&localDirection, DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&unitDirection), inverseWorld));
+
+		Bvh::Hit meshHit{};
+		if (!candidate.pMesh->Raycast(localOrigin, localDirection, closest, meshHit))
+			continue;
+
+		closest = meshHit.distance;
+		found = true;
+		hit.pGameObject = candidate.pGameObject;
+		hit.distance = meshHit.distance;
+		hit.triangle = meshHit.triangle;
+		DirectX::XMStoreFloat3(&hit.position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&origin), DirectX::XMVectorScale(DirectX::XMLoadFloat3(&unitDirection), meshHit.distance)));
+
+		// Normals go through the inverse transpose so non uniform scale keeps them perpendicular
+		DirectX::XMVECTOR normal = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&meshHit.normal), DirectX::XMMatrixTranspose(inverseWorld)));
+		if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, DirectX::XMLoadFloat3(&unitDirection))) > 0.f)
+			normal = DirectX::XMVectorNegate(normal);
+		DirectX::XMStoreFloat3(&hit.normal, normal);
+	}
+
+	return found;
+}
+
+bool Scene::HasLineOfSight(const DirectX::XMFLOAT3& from, const DirectX::XMFLOAT3& to)
+{
+	const DirectX::XMVECTOR segment = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&to), DirectX::XMLoadFloat3(&from));
+	const float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(segment));
+	if (length <= 0.f)
+		return true;
+
+	DirectX::XMFLOAT3 direction{};
+	DirectX::XMStoreFloat3(&direction, DirectX::XMVectorScale(segment, 1.f / length));
+
+	m_RaycastCandidates.clear();
+	for (GameObject* pGameObject : m_pGameObjects)
+		GatherRaycastCandidates(pGameObject, from, direction, length, m_RaycastCandidates);
+
+	// Any hit blocks the view, so the order does not matter
+	for (const RaycastCandidate& candidate : m_RaycastCandidates)
+	{
+		const DirectX::XMMATRIX inverseWorld = DirectX::XMMatrixInverse(nullptr, DirectX::XMLoadFloat4x4(&candidate.world));
+		DirectX::XMFLOAT3 localOrigin{};
+		DirectX::XMFLOAT3 localDirection{};
+		DirectX::XMStoreFloat3(&localOrigin, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&from), inverseWorld));
+		DirectX::XMStoreFloat3(&localDirection, DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&direction), inverseWorld));
+		if (candidate.pMesh->Intersects(localOrigin, localDirection, length))
+			return false;
+	}
+
+	return true;
+}
+
+void Scene::GatherRaycastCandidates(GameObject* pGameObject, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, std::vector<RaycastCandidate>& candidates)
+{
+	if (!pGameObject->GetEnabled())
+		return;
+
+	for (int i = 0; i < pGameObject->GetChildCount(); ++i)
+		GatherRaycastCandidates(pGameObject->GetChild(i), origin, direction, maxDistance, candidates);
+
+	const MeshComponent* pMeshComponent = pGameObject->GetComponent<MeshComponent>();
+	if (pMeshComponent == nullptr || pMeshComponent->GetMesh() == nullptr || pGameObject->GetTransform() == nullptr)
+		return;
+
+	Mesh* pMesh = pMeshComponent->GetMesh();
+	const DirectX::XMFLOAT4X4 worldMatrix = pGameObject->GetTransform()->GetWorldMatrix();
+	const DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&worldMatrix);
+
+	// Bounding sphere in world space, the radius grows with the largest axis
+	const DirectX::XMFLOAT3 boundsCenter = pMesh->GetBoundsCenter();
+	const DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&boundsCenter), world);
+	float scale{};
+	for (int axis = 0; axis < 3; ++axis)
+		scale = (std::max)(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[axis])));
+	const float radius = pMesh->GetBoundsRadius() * scale;
+
+	const DirectX::XMVECTOR toOrigin = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&origin), center);
+	const float b = DirectX::XMVectorGetX(DirectX::XMVector3Dot(toOrigin, DirectX::XMLoadFloat3(&direction)));
+	const float c = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(toOrigin)) - radius * radius;
+	const float discriminant = b * b - c;
+	if ((c > 0.f && b > 0.f) || discriminant < 0.f)
+		return;
+
+	const float entry = (std::max)(0.f, -b - std::sqrt(discriminant));
+	if (entry > maxDistance)
+		return;
+
+	candidates.push_back(RaycastCandidate{ entry, pGameObject, pMesh, worldMatrix });
 }
 
 void Scene::SetCamera(CameraComponent* pCameraComponent)
@@ -219,6 +514,11 @@ GameObject* Scene::GetSelectedObject() const
 	return m_pSelectedGameobject;
 }
 
+void Scene::SetSelectedObject(GameObject* pGameObject)
+{
+	m_pSelectedGameobject = pGameObject;
+}
+
 PhysxProxy* Scene::GetPhysXProxy() const
 {
 	return m_pPhysxProxy;
@@ -1,17 +1,31 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <cfloat>
 #include "Material.h"
+#include "ResourceHandle.h"
 
 #include "PhysXManager.h"
 #include "PhysxProxy.h"
 
 typedef int ImGuiTreeNodeFlags;
 
-// The scene keeps track of all the components and entities it will also be able to load in save files and save to files
 class GameObject;
 class Camera;
 class CameraComponent;
+class Mesh;
+
+// Closest surface a ray hit, in world space
+struct RaycastHit
+{
+	GameObject* pGameObject{};
+	float distance{ FLT_MAX };
+	DirectX::XMFLOAT3 position{};
+	DirectX::XMFLOAT3 normal{};		// Faces the ray origin
+	uint32_t triangle{};			// In the first lod of the mesh
+};
+
+// The scene keeps track of all the components and entities it will also be able to load in save files and save to files
 class Scene
 {
 public:
@@ -31,15 +45,49 @@ public:
 
 	void Update();
 
-	void Serialize(const std::string& filename);
-	void Deserialize(const std::string& filename);
+	void Serialize(const std::string& filename, bool compress = true);
+	// False with a logged warning when the level file is missing, corrupt or truncated, the scene is left empty
+	bool Deserialize(const std::string& filename);
+
+	// Tests the bounding spheres of the enabled mesh objects first and only walks the BVH of the meshes whose sphere
+	// is hit, closest first. The direction is normalized here so the distance is in world units.
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, RaycastHit& hit, float maxDistance = FLT_MAX);
+	// True when no mesh blocks the segment between the two points
+	bool HasLineOfSight(const DirectX::XMFLOAT3& from, const DirectX::XMFLOAT3& to);
 
 	void SetCamera(CameraComponent* pCameraComponent);
 	Camera* GetCamera() const;
 	GameObject* GetSelectedObject() const;
+	void SetSelectedObject(GameObject* pGameObject);
 	PhysxProxy* GetPhysXProxy() const;
 
 private:
+	// A mesh object whose bounding sphere the ray enters at distance entry
+	struct RaycastCandidate
+	{
+		float entry;
+		GameObject* pGameObject;
+		Mesh* pMesh;
+		DirectX::XMFLOAT4X4 world;
+	};
+	void GatherRaycastCandidates(GameObject* pGameObject, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, std::vector<RaycastCandidate>& candidates);
+
+	// A mesh or texture a level file references, its load is started before the objects are built
+	struct Dependency
+	{
+		ResourceType type;
+		ResourceId file;
+		bool wasLoaded;			// Resident already, nothing was loaded for it
+		MeshHandle mesh{};
+		TextureHandle texture{};
+	};
+	// Starts loading everything the level file references on the job system, so the files are read and imported
+	// in parallel while the objects are built instead of one after the other as the components ask for them
+	std::vector<Dependency> PrefetchDependencies(const rapidjson::Document& levelDocument);
+	static void PrefetchMeshes(const rapidjson::Value& gameobject, ResourceIdSet& requested, std::vector<Dependency>& dependencies);
+	// Finishes the loads that are still running and logs how long every file took
+	void WaitForDependencies(const std::string& filename, std::vector<Dependency>& dependencies, float elapsedMilliseconds);
+
 	void RenderGameobjectSceneGraph(GameObject* pGameobject,int i, ImGuiTreeNodeFlags node_flags, int& node_clicked, bool test_drag_and_drop);
 
 	bool m_Started{ false };
@@ -51,5 +99,8 @@ private:
 	CameraComponent* m_pCameraComponent;
 
 	PhysxProxy* m_pPhysxProxy{};
+
+	// Reused by every raycast
+	std::vector<RaycastCandidate> m_RaycastCandidates{};
 };
 
@@ -1,4 +1,5 @@
 #include "SpriteComponent.h"
+#include "EffectCache.h"
 #include "ResourceManager.h"
 #include "TransformComponent.h"
 #include "MyEngine.h"
@@ -6,8 +7,8 @@
 #include "Texture.h"
 
 #include <DirectXMath.h>
+#include <cmath>
 
-#include <sstream>
 #include <comdef.h>
 #include <imgui.h>
 #include "Utils.h"
@@ -66,7 +67,7 @@ void SpriteComponent::Start()
 	//Effect
 
 	if(!m_pEffect)
-		m_pEffect = LoadShader(L"Resources/SpriteRenderer.fx");
+		m_pEffect = EffectCache::GetInstance()->GetEffect(MyEngine::GetSingleton()->GetDevice(), "Resources/SpriteRenderer.fx");
 	if(!m_pTechnique)
 		m_pTechnique = m_pEffect->GetTechniqueByIndex(0);
 
@@ -106,7 +107,8 @@ void SpriteComponent::Start()
 void SpriteComponent::Render()
 {
 	//assert(m_pTexture != nullptr);
-	if (!m_pTexture)
+	Texture* pTexture = m_Texture.Get();
+	if (!pTexture)
 		return;
 
 
@@ -145,20 +147,17 @@ void SpriteComponent::Render()
 	pDeviceContext->IASetInputLayout(m_pInputLayout);
 
 	//Set Texture
-	m_pEVar_TextureSRV->SetResource(m_pTexture->GetTextureShaderResource());
+	m_pEVar_TextureSRV->SetResource(pTexture->GetTextureShaderResource());
 
-	ID3D11Resource* pResource{};
-	m_pTexture->GetTextureShaderResource()->GetResource(&pResource);
-
-	D3D11_TEXTURE2D_DESC texDesc{};
-	const auto texResource = reinterpret_cast<ID3D11Texture2D*>(pResource);
-	texResource->GetDesc(&texDesc);
-	texResource->Release();
-
-	//Set Texture Size
-	auto texSize = DirectX::XMFLOAT2(static_cast<float>(texDesc.Width), static_cast<float>(texDesc.Height));
+	//Set Texture Size, the full size also while the biggest mips are still streaming in
+	auto texSize = DirectX::XMFLOAT2(static_cast<float>(pTexture->GetWidth()), static_cast<float>(pTexture->GetHeight()));
 	m_pEVar_TextureSize->SetFloatVector(&texSize.x);
 
+	// The quad reaches the texture size times the scale to both sides of the position
+	const DirectX::XMFLOAT3 scale = m_pTransformComponent->GetScale();
+	const float pixels = texSize.x >= texSize.y ? 2.f * texSize.x * std::abs(scale.x) : 2.f * texSize.y * std::abs(scale.y);
+	ResourceManager::GetInstance()->RequestTextureSize(pTexture, pixels);
+
 	//Set Transform
 	m_pEVar_TransformMatrix->SetMatrix(&m_Transform._11);
 
@@ -183,7 +182,7 @@ void SpriteComponent::RenderGUI()
 
 void SpriteComponent::SetTexture(const std::string& spriteAsset)
 {
-	m_pTexture = ResourceManager::GetInstance()->GetTexture(spriteAsset);
+	m_Texture = ResourceManager::GetInstance()->LoadTextureAsync(spriteAsset);
 }
 
 void SpriteComponent::SetColor(const DirectX::XMFLOAT4 color)
@@ -234,53 +233,3 @@ void SpriteComponent::CreateInputLayout()
 		return;
 	}
 }
-
-ID3DX11Effect* SpriteComponent::LoadShader(std::wstring filename)
-{
-	HRESULT result = S_OK;
-	ID3D10Blob* pErrorBlob = nullptr;
-	ID3DX11Effect* pEffect;
-
-	DWORD shaderFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)
-	shaderFlags |= D3DCOMPILE_DEBUG;
-	shaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-	std::wstring wFilename{ filename };
-	result = D3DX11CompileEffectFromFile(wFilename.c_str(),
-		nullptr,
-		nullptr,
-		shaderFlags,
-		0,
-		MyEngine().GetSingleton()->GetDevice(),
-		&pEffect,
-		&pErrorBlob);
-
-	if (FAILED(result))
-	{
-		if (pErrorBlob != nullptr)
-		{
-			char* pErrors = (char*)pErrorBlob->GetBufferPointer();
-
-			std::wstringstream ss{};
-			for (unsigned int i = 0; i < pErrorBlob->GetBufferSize(); i++)
-				ss << pErrors[i];
-
-			OutputDebugStringW(ss.str().c_str());
-			pErrorBlob->Release();
-			pErrorBlob = nullptr;
-
-			OutputDebugStringW(ss.str().c_str());
-		}
-		else
-		{
-			std::wstringstream ss;
-			ss << "EffectLoader: Failed to CreateEffectFromFile! \nPath: " << filename;
-
-			OutputDebugStringW(ss.str().c_str());
-			return nullptr;
-		}
-	}
-
-	return pEffect;
-}
@@ -1,5 +1,6 @@
 #pragma once
 #include "Component.h"
+#include "ResourceHandle.h"
 
 #include <d3d11.h>
 #include <d3dx11effect.h>
@@ -24,11 +25,10 @@ public:
 	void SetColor(const DirectX::XMFLOAT4 color);
 
 private:
-	ID3DX11Effect* LoadShader( std::wstring filename);
 	void CreateInputLayout();
 
 	TransformComponent* m_pTransformComponent{};
-	Texture* m_pTexture;
+	TextureHandle m_Texture{};
 
 	ID3D11Resource* m_pTextureResource{};
 	ID3D11ShaderResourceView* m_pTextureShaderResourceView{};
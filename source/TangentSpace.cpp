@@ -0,0 +1,261 @@
+#include "TangentSpace.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	constexpr size_t g_BatchSize{ 4 };
+	constexpr float g_Epsilon{ 1e-20f };
+
+	// One component of a vector for four triangles
+	struct Vector3SoA
+	{
+		XMVECTOR x;
+		XMVECTOR y;
+		XMVECTOR z;
+	};
+
+	inline Vector3SoA Subtract(const Vector3SoA& a, const Vector3SoA& b)
+	{
+		return Vector3SoA{ XMVectorSubtract(a.x, b.x), XMVectorSubtract(a.y, b.y), XMVectorSubtract(a.z, b.z) };
+	}
+
+	inline Vector3SoA Scale(const Vector3SoA& a, XMVECTOR scale)
+	{
+		return Vector3SoA{ XMVectorMultiply(a.x, scale), XMVectorMultiply(a.y, scale), XMVectorMultiply(a.z, scale) };
+	}
+
+	inline XMVECTOR Dot(const Vector3SoA& a, const Vector3SoA& b)
+	{
+		return XMVectorMultiplyAdd(a.x, b.x, XMVectorMultiplyAdd(a.y, b.y, XMVectorMultiply(a.z, b.z)));
+	}
+
+	// Lanes with a zero length vector come out as zero, valid receives which lanes were not
+	inline Vector3SoA Normalize(const Vector3SoA& a, XMVECTOR& valid)
+	{
+		const XMVECTOR lengthSquared = Dot(a, a);
+		valid = XMVectorGreater(lengthSquared, XMVectorReplicate(g_Epsilon));
+		const XMVECTOR inverseLength = XMVectorSelect(XMVectorZero(), XMVectorReciprocalSqrt(lengthSquared), valid);
+		return Scale(a, inverseLength);
+	}
+
+	// a - n * dot(n, a), the part of a in the plane of the normal
+	inline Vector3SoA Project(const Vector3SoA& a, const Vector3SoA& normal)
+	{
+		return Subtract(a, Scale(normal, Dot(normal, a)));
+	}
+
+	// Position, normal and uv of one corner of four triangles
+	struct CornerSoA
+	{
+		Vector3SoA position;
+		Vector3SoA normal;
+		XMVECTOR u;
+		XMVECTOR v;
+	};
+
+	// Transposes the corners of up to four triangles, missing triangles repeat the last one and are ignored later
+	void Gather(CornerSoA corners[3], const Vertex* pVertices, const uint32_t* pIndices, size_t triangleCount)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			XMFLOAT4 components[8]{};
+			float* pLanes[8]{ &components[0].x, &components[1].x, &components[2].x, &components[3].x, &components[4].x, &components[5].x, &components[6].x, &components[7].x };
+
+			for (size_t lane = 0; lane < g_BatchSize; ++lane)
+			{
+				const Vertex& vertex = pVertices[pIndices[(std::min)(lane, triangleCount - 1) * 3 + corner]];
+				const float values[8]{ vertex.position.x, vertex.position.y, vertex.position.z, vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.uv.x, vertex.uv.y };
+				for (int component = 0; component < 8; ++component)
+					pLanes[component][lane] = values[component];
+			}
+
+			CornerSoA& soa = corners[corner];
+			soa.position = Vector3SoA{ XMLoadFloat4(&components[0]), XMLoadFloat4(&components[1]), XMLoadFloat4(&components[2]) };
+			soa.normal = Vector3SoA{ XMLoadFloat4(&components[3]), XMLoadFloat4(&components[4]), XMLoadFloat4(&components[5]) };
+			soa.u = XMLoadFloat4(&components[6]);
+			soa.v = XMLoadFloat4(&components[7]);
+		}
+	}
+
+	// Weighted tangent of one triangle corner, per lane
+	struct CornerTangents
+	{
+		XMFLOAT4 x[3];
+		XMFLOAT4 y[3];
+		XMFLOAT4 z[3];
+		XMFLOAT4 weight[3];
+		XMFLOAT4 handedness;
+	};
+
+	void ComputeBatch(const CornerSoA corners[3], CornerTangents& result)
+	{
+		const Vector3SoA edge1 = Subtract(corners[1].position, corners[0].position);
+		const Vector3SoA edge2 = Subtract(corners[2].position, corners[0].position);
+		const XMVECTOR s1 = XMVectorSubtract(corners[1].u, corners[0].u);
+		const XMVECTOR t1 = XMVectorSubtract(corners[1].v, corners[0].v);
+		const XMVECTOR s2 = XMVectorSubtract(corners[2].u, corners[0].u);
+		const XMVECTOR t2 = XMVectorSubtract(corners[2].v, corners[0].v);
+
+		// Mirrored uvs flip the sign of the uv area, the tangent is flipped along so it always points along +u
+		const XMVECTOR signedArea = XMVectorSubtract(XMVectorMultiply(s1, t2), XMVectorMultiply(s2, t1));
+		const XMVECTOR handedness = XMVectorSelect(XMVectorReplicate(-1.f), XMVectorReplicate(1.f), XMVectorGreater(signedArea, XMVectorZero()));
+		const XMVECTOR hasArea = XMVectorGreater(XMVectorAbs(signedArea), XMVectorReplicate(g_Epsilon));
+
+		XMVECTOR validTangent{};
+		const Vector3SoA tangent = Normalize(Scale(Subtract(Scale(edge1, t2), Scale(edge2, t1)), handedness), validTangent);
+		const XMVECTOR valid = XMVectorAndInt(hasArea, validTangent);
+		XMStoreFloat4(&result.handedness, handedness);
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const CornerSoA& current = corners[corner];
+			const Vector3SoA& normal = current.normal;
+
+			// Corner angle measured in the tangent plane of the vertex, like MikkTSpace
+			XMVECTOR validEdges[2]{};
+			const Vector3SoA toNext = Normalize(Project(Subtract(corners[(corner + 1) % 3].position, current.position), normal), validEdges[0]);
+			const Vector3SoA toPrevious = Normalize(Project(Subtract(corners[(corner + 2) % 3].position, current.position), normal), validEdges[1]);
+			const XMVECTOR cosine = XMVectorClamp(Dot(toNext, toPrevious), XMVectorReplicate(-1.f), XMVectorReplicate(1.f));
+			const XMVECTOR angle = XMVectorACos(cosine);
+
+			XMVECTOR validProjection{};
+			const Vector3SoA projected = Normalize(Project(tangent, normal), validProjection);
+
+			// Degenerate triangles do not contribute, the vertex gets its tangent from its other triangles
+			const XMVECTOR contributes = XMVectorAndInt(XMVectorAndInt(valid, validProjection), XMVectorAndInt(validEdges[0], validEdges[1]));
+			XMStoreFloat4(&result.x[corner], projected.x);
+			XMStoreFloat4(&result.y[corner], projected.y);
+			XMStoreFloat4(&result.z[corner], projected.z);
+			XMStoreFloat4(&result.weight[corner], XMVectorSelect(XMVectorZero(), angle, contributes));
+		}
+	}
+
+	inline float GetLane(const XMFLOAT4& lanes, size_t lane)
+	{
+		return (&lanes.x)[lane];
+	}
+
+	// Any unit vector perpendicular to the normal, for vertices without a usable uv mapping
+	XMVECTOR GetPerpendicular(FXMVECTOR normal)
+	{
+		const XMVECTOR axis = std::abs(XMVectorGetX(normal)) < 0.9f ? XMVectorSet(1.f, 0.f, 0.f, 0.f) : XMVectorSet(0.f, 1.f, 0.f, 0.f);
+		return XMVector3Normalize(XMVector3Cross(normal, XMVector3Cross(axis, normal)));
+	}
+}
+
+void TangentSpace::GenerateNormals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	std::vector<XMFLOAT3> normals(vertices.size(), XMFLOAT3{});
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i]].position);
+		const XMVECTOR p1 = XMLoadFloat3(&vertices[indices[i + 1]].position);
+		const XMVECTOR p2 = XMLoadFloat3(&vertices[indices[i + 2]].position);
+
+		// The length of the cross product is twice the area, bigger triangles weigh more
+		const XMVECTOR faceNormal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			XMFLOAT3& normal = normals[indices[i + corner]];
+			XMStoreFloat3(&normal, XMVectorAdd(XMLoadFloat3(&normal), faceNormal));
+		}
+	}
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+		XMStoreFloat3(&vertices[i].normal, XMVector3Normalize(XMLoadFloat3(&normals[i])));
+}
+
+size_t TangentSpace::GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const size_t vertexCount = vertices.size();
+	const size_t triangleCount = indices.size() / 3;
+
+	// Regular and mirrored triangles are accumulated apart, w holds the summed weight
+	std::vector<XMFLOAT4> accumulated[2]{ std::vector<XMFLOAT4>(vertexCount, XMFLOAT4{}), std::vector<XMFLOAT4>(vertexCount, XMFLOAT4{}) };
+	std::vector<uint8_t> mirrored(triangleCount);
+
+	CornerSoA corners[3]{};
+	CornerTangents tangents{};
+	for (size_t first = 0; first < triangleCount; first += g_BatchSize)
+	{
+		const size_t count = (std::min)(g_BatchSize, triangleCount - first);
+		Gather(corners, vertices.data(), indices.data() + first * 3, count);
+		ComputeBatch(corners, tangents);
+
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			const size_t triangle = first + lane;
+			mirrored[triangle] = GetLane(tangents.handedness, lane) < 0.f ? 1 : 0;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const float weight = GetLane(tangents.weight[corner], lane);
+				if (weight <= 0.f)
+					continue;
+
+				XMFLOAT4& sum = accumulated[mirrored[triangle]][indices[triangle * 3 + corner]];
+				sum.x += GetLane(tangents.x[corner], lane) * weight;
+				sum.y += GetLane(tangents.y[corner], lane) * weight;
+				sum.z += GetLane(tangents.z[corner], lane) * weight;
+				sum.w += weight;
+			}
+		}
+	}
+
+	// A vertex used by both sides of a uv mirror keeps the side with the most weight, the other side gets a copy
+	std::vector<uint32_t> splitVertex(vertexCount, UINT32_MAX);
+	std::vector<uint8_t> vertexMirrored(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const float regularWeight = accumulated[0][i].w;
+		const float mirroredWeight = accumulated[1][i].w;
+		vertexMirrored[i] = mirroredWeight > regularWeight ? 1 : 0;
+		if (regularWeight > 0.f && mirroredWeight > 0.f)
+		{
+			splitVertex[i] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(vertices[i]);
+		}
+	}
+
+	const size_t addedCount = vertices.size() - vertexCount;
+	if (addedCount > 0)
+	{
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				uint32_t& index = indices[triangle * 3 + corner];
+				if (splitVertex[index] != UINT32_MAX && mirrored[triangle] != vertexMirrored[index])
+					index = splitVertex[index];
+			}
+		}
+	}
+
+	auto finalize = [](Vertex& vertex, const XMFLOAT4& sum, float handedness)
+	{
+		const XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&vertex.normal));
+		XMVECTOR tangent = XMVectorSet(sum.x, sum.y, sum.z, 0.f);
+
+		// The summed tangents are already in the normal plane, removing what is left keeps the frame orthonormal
+		tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+		if (XMVectorGetX(XMVector3LengthSq(tangent)) <= g_Epsilon)
+			tangent = XMVectorGetX(XMVector3LengthSq(normal)) > 0.f ? GetPerpendicular(normal) : XMVectorSet(1.f, 0.f, 0.f, 0.f);
+
+		XMStoreFloat4(&vertex.tangent, XMVectorSetW(XMVector3Normalize(tangent), handedness));
+	};
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const uint8_t side = vertexMirrored[i];
+		finalize(vertices[i], accumulated[side][i], side ? -1.f : 1.f);
+		if (splitVertex[i] != UINT32_MAX)
+			finalize(vertices[splitVertex[i]], accumulated[1 - side][i], side ? 1.f : -1.f);
+	}
+
+	return addedCount;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex;
+
+// Per vertex tangent frames for normal mapping, shared by the importer and the generated meshes
+namespace TangentSpace
+{
+	// Smooth area weighted normals, for generated meshes that have none
+	void GenerateNormals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	// Tangents that match MikkTSpace: the uv tangent of every triangle is projected onto the vertex normal
+	// and weighted by the corner angle, w holds the handedness of the bitangent (cross(tangent, normal) * w).
+	// Triangles are processed four at a time in SoA form. A vertex shared by mirrored and regular triangles
+	// is split so both sides get their own handedness, returns the amount of vertices added.
+	size_t GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+}
@@ -7,8 +7,12 @@
 #include "Texture.h"
 #include "TransformComponent.h"
 #include "MeshComponent.h"
+#include "MeshOptimizer.h"
+#include "TangentSpace.h"
+#include "AssetPack.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <imgui.h>
 
@@ -70,15 +74,14 @@ void TerrainComponent::ParseHeightMap()
 {
 	m_VecHeightValues.resize(m_NrOfVertices, 0);
 
-	std::ifstream inFile{};
-	inFile.open(m_HeightMapFile.c_str(), std::ios_base::binary);
-	if (!inFile)
+	AssetFile file{ m_HeightMapFile };
+	if (!file.IsOpen())
 	{
 		return;
 	}
 
-	inFile.read(reinterpret_cast<char*>(&m_VecHeightValues[0]), static_cast<std::streamsize>(m_NrOfVertices * sizeof(unsigned short)));
-	inFile.close();
+	// A short file leaves the rest of the heights at 0
+	memcpy(m_VecHeightValues.data(), file.GetData(), (std::min)(file.GetSize(), m_VecHeightValues.size() * sizeof(unsigned short)));
 }
 
 void TerrainComponent::CreateGrid()
@@ -132,10 +135,17 @@ void TerrainComponent::CreateGrid()
 		}
 	}
 
+	TangentSpace::GenerateNormals(m_VertexArr, m_IndexArr);
+	TangentSpace::GenerateTangents(m_VertexArr, m_IndexArr);
+	MeshOptimizer::LogStatistics(m_pGameobject->GetName() + " terrain", MeshOptimizer::OptimizeMesh(m_VertexArr, m_IndexArr));
+
 	// Set mesh from the mesh component
 
-	m_pMeshComponent->SetMesh(new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), m_VertexArr, m_IndexArr, m_pGameobject->GetName(), 0, MaterialManager::GetInstance()->GetMaterial("default")));
-	m_pMeshComponent->GetMesh()->GetMaterial("default")->SetDiffuseMap(new Texture(MyEngine::GetSingleton()->GetDevice(), "Resources/ireland_map.png"));
+	// Large terrains exceed the position tolerance and stay float
+	const VertexFormat vertexFormat = VertexQuantization::ChooseFormat(m_VertexArr.data(), m_VertexArr.size());
+	// Its own material instead of changing the default one
+	Material* pMaterial = MaterialManager::GetInstance()->AddMaterial("terrain", MaterialDescription{ "Resources/material_unlit.fx", "Resources/ireland_map.png" });
+	m_pMeshComponent->SetMesh(new Mesh(MyEngine::GetSingleton()->GetDevice(), MyEngine::GetSingleton()->GetWindowHandle(), m_VertexArr, m_IndexArr, m_pGameobject->GetName(), 0, pMaterial, vertexFormat));
 }
 
 void TerrainComponent::Remesh()
@@ -1,55 +1,198 @@
 #include "Texture.h"
 #include "WICTextureLoader.h"
+#include "Logger.h"
+#include "AssetPack.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
+
+#include <algorithm>
 
 // Static datamembers
 
+// Bytes of one 4x4 block for the block compressed formats, 0 for the others
+static UINT GetBlockSize(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		return 8;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+// Bytes per pixel of the uncompressed formats the loaders create
+static UINT GetPixelSize(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+		return 8;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM: case DXGI_FORMAT_B5G6R5_UNORM:
+		return 2;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		return 1;
+	default:
+		return 4;
+	}
+}
+
+static DXGI_FORMAT GetFormat(ImageFormat format)
+{
+	switch (format)
+	{
+	case ImageFormat::R8:
+		return DXGI_FORMAT_R8_UNORM;
+	case ImageFormat::R16:
+		return DXGI_FORMAT_R16_UNORM;
+	default:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+static DXGI_FORMAT GetFormat(TextureCooker::Format format)
+{
+	switch (format)
+	{
+	case TextureCooker::Format::R8:
+		return DXGI_FORMAT_R8_UNORM;
+	case TextureCooker::Format::R16:
+		return DXGI_FORMAT_R16_UNORM;
+	case TextureCooker::Format::BC1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case TextureCooker::Format::BC3:
+		return DXGI_FORMAT_BC3_UNORM;
+	case TextureCooker::Format::BC4:
+		return DXGI_FORMAT_BC4_UNORM;
+	case TextureCooker::Format::BC5:
+		return DXGI_FORMAT_BC5_UNORM;
+	case TextureCooker::Format::BC7:
+		return DXGI_FORMAT_BC7_UNORM;
+	default:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+static size_t GetMipSize(DXGI_FORMAT format, UINT width, UINT height)
+{
+	const UINT blockSize = GetBlockSize(format);
+	if (blockSize > 0)
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+	return size_t(width) * height * GetPixelSize(format);
+}
+
+static bool GetDesc(ID3D11Resource* pResource, D3D11_TEXTURE2D_DESC& desc)
+{
+	if (pResource == nullptr)
+		return false;
+
+	ID3D11Texture2D* pTexture{};
+	if (FAILED(pResource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&pTexture))))
+		return false;
+
+	pTexture->GetDesc(&desc);
+	pTexture->Release();
+	return true;
+}
+
+static bool CreateTexture(ID3D11Device* pDevice, uint32_t width, uint32_t height, DXGI_FORMAT format, const std::vector<D3D11_SUBRESOURCE_DATA>& mips,
+	ID3D11Resource** ppResource, ID3D11ShaderResourceView** ppView)
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = static_cast<UINT>(mips.size());
+	desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ID3D11Texture2D* pTexture{};
+	if (FAILED(pDevice->CreateTexture2D(&desc, mips.data(), &pTexture)))
+		return false;
+
+	if (FAILED(pDevice->CreateShaderResourceView(pTexture, nullptr, ppView)))
+	{
+		pTexture->Release();
+		return false;
+	}
+
+	*ppResource = pTexture;
+	return true;
+}
+
 // Constructor(s) & Destructor
 Texture::Texture(ID3D11Device* pDevice, const std::string& texturePath, ID3D11DeviceContext* pDeviceContext)
 	: m_Path{texturePath}
 {
-	//SDL_Surface* pTexture{ nullptr };
-	//pTexture = IMG_Load(texturePath.c_str());
+	// Out of the mounted pack when it has the file
+	AssetFile file{ texturePath };
+	if (!file.IsOpen())
+	{
+		Logger::GetInstance()->LogWarning("Texture: failed to load " + texturePath);
+		return;
+	}
 
-	std::wstring path{ texturePath.begin(), texturePath.end() };
-	auto hr = CreateWICTextureFromFile(pDevice, pDeviceContext, path.c_str(), &m_pResource, &m_pTextureResourceView);
-	if (FAILED(hr))
+	Load(pDevice, reinterpret_cast<const uint8_t*>(file.GetData()), file.GetSize(), pDeviceContext);
+}
+
+Texture::Texture(ID3D11Device* pDevice, const std::string& texturePath, const uint8_t* pData, size_t dataSize, ID3D11DeviceContext* pDeviceContext)
+	: m_Path{ texturePath }
+{
+	Load(pDevice, pData, dataSize, pDeviceContext);
+}
+
+Texture::Texture(ID3D11Device* pDevice, const std::string& name, uint32_t width, uint32_t height, const uint32_t* pPixels)
+	: m_Path{ name }
+{
+	std::vector<Image> levels(1);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].pixels.assign(reinterpret_cast<const uint8_t*>(pPixels), reinterpret_cast<const uint8_t*>(pPixels + size_t(width) * height));
+	Create(pDevice, levels);
+}
+
+Texture::Texture(ID3D11Device* pDevice, const std::string& name, const std::vector<Image>& levels)
+	: m_Path{ name }
+{
+	if (levels.empty() || !levels[0].IsValid())
 	{
-		OutputDebugStringW(L"Failed to load in : " + *texturePath.c_str());
+		Logger::GetInstance()->LogWarning("Texture: no pixels for " + name);
+		return;
 	}
 
-	if (pDeviceContext)
-		pDeviceContext->GenerateMips(m_pTextureResourceView);
-	
-	//desc.Width = m_pResource.get;
-	//desc.Height = pTexture->h;
-	//desc.MipLevels = 1;
-	//desc.ArraySize = 1;
-	//desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	//desc.SampleDesc.Count = 1;
-	//desc.SampleDesc.Quality = 0;
-	//desc.Usage = D3D11_USAGE_DEFAULT;
-	//desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	//desc.CPUAccessFlags = 0;
-	//desc.MiscFlags = 0;
-
-	//D3D11_SUBRESOURCE_DATA initData;
-	//initData.pSysMem = pTexture->pixels;
-	//initData.SysMemPitch = static_cast<UINT>(pTexture->pitch);
-	//initData.SysMemSlicePitch = static_cast<UINT>(pTexture->h * pTexture->pitch);
-	//
-	//HRESULT hr = pDevice->CreateTexture2D(&desc, &initData, &m_pTexture);
-	//if (FAILED(hr))
-	//	return;
-	//
-	//D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
-	//SRVDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	//SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	//SRVDesc.Texture2D.MipLevels = 1;
-	//
-	//hr = pDevice->CreateShaderResourceView(m_pTexture, &SRVDesc, &m_pTextureResourceView);
-	//
-	//if (pDeviceContext)
-	//	pDeviceContext->GenerateMips(m_pTextureResourceView);
+	Create(pDevice, levels);
+}
+
+Texture::Texture(ID3D11Device* pDevice, const std::string& texturePath, std::shared_ptr<const AssetFile> pFile, ID3D11DeviceContext* pDeviceContext)
+	: m_Path{ texturePath }
+{
+	const auto* pData = reinterpret_cast<const uint8_t*>(pFile->GetData());
+	if (TextureCooker::IsCooked(pData, pFile->GetSize()))
+	{
+		const CookedTexture cooked{ std::string_view{ pFile->GetData(), pFile->GetSize() } };
+		if (cooked.IsValid() && cooked.GetTailMip() > 0 && cooked.GetMipCount() <= TextureStreamer::g_MaxMipCount)
+		{
+			Create(pDevice, cooked, cooked.GetTailMip());
+			if (m_pResource != nullptr)
+				m_pStreamFile = std::move(pFile);
+			return;
+		}
+	}
+
+	Load(pDevice, pData, pFile->GetSize(), pDeviceContext);
 }
 
 Texture::~Texture()
@@ -80,6 +223,161 @@ Texture& Texture::operator=(const Texture& other)
 	return *this;
 }
 
+void Texture::Load(ID3D11Device* pDevice, const uint8_t* pData, size_t dataSize, ID3D11DeviceContext* pDeviceContext)
+{
+	if (TextureCooker::IsCooked(pData, dataSize))
+	{
+		const CookedTexture cooked{ std::string_view{ reinterpret_cast<const char*>(pData), dataSize } };
+		if (!cooked.IsValid())
+		{
+			Logger::GetInstance()->LogWarning("Texture: the cooked texture " + m_Path + " is corrupt or from an older cooker");
+			return;
+		}
+
+		Create(pDevice, cooked);
+		return;
+	}
+
+	if (ImageDecoder::GetFileType(m_Path, pData, dataSize) != ImageDecoder::FileType::Unknown)
+	{
+		std::vector<Image> levels(1);
+		std::string error{};
+		if (!ImageDecoder::Decode(m_Path, pData, dataSize, levels[0], &error))
+		{
+			Logger::GetInstance()->LogWarning("Texture: failed to decode " + m_Path + ", " + error);
+			return;
+		}
+
+		MipGenerator::GenerateMips(levels, MipGenerator::GetDefaultSettings(m_Path, levels[0]));
+		Create(pDevice, levels);
+		return;
+	}
+
+	auto hr = CreateWICTextureFromMemory(pDevice, pDeviceContext, pData, dataSize, &m_pResource, &m_pTextureResourceView);
+	if (FAILED(hr))
+	{
+		Logger::GetInstance()->LogWarning("Texture: failed to decode " + m_Path);
+		return;
+	}
+
+	if (pDeviceContext)
+		pDeviceContext->GenerateMips(m_pTextureResourceView);
+
+	D3D11_TEXTURE2D_DESC desc{};
+	if (GetDesc(m_pResource, desc))
+	{
+		m_Width = desc.Width;
+		m_Height = desc.Height;
+		m_MipCount = desc.MipLevels;
+	}
+}
+
+void Texture::Create(ID3D11Device* pDevice, const std::vector<Image>& levels)
+{
+	std::vector<D3D11_SUBRESOURCE_DATA> mips(levels.size());
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		mips[i].pSysMem = levels[i].pixels.data();
+		mips[i].SysMemPitch = static_cast<UINT>(levels[i].GetRowPitch());
+	}
+
+	Create(pDevice, levels[0].width, levels[0].height, GetFormat(levels[0].format), mips);
+}
+
+void Texture::Create(ID3D11Device* pDevice, const CookedTexture& cooked, uint32_t firstMip)
+{
+	ID3D11Resource* pResource{};
+	ID3D11ShaderResourceView* pView{};
+	if (!CreateMips(pDevice, cooked, firstMip, &pResource, &pView))
+		return;
+
+	SetMips(firstMip, pResource, pView);
+	m_Width = cooked.GetWidth();
+	m_Height = cooked.GetHeight();
+	m_MipCount = cooked.GetMipCount();
+	m_TailMip = cooked.GetTailMip();
+}
+
+void Texture::Create(ID3D11Device* pDevice, uint32_t width, uint32_t height, DXGI_FORMAT format, const std::vector<D3D11_SUBRESOURCE_DATA>& mips)
+{
+	ID3D11Resource* pResource{};
+	ID3D11ShaderResourceView* pView{};
+	if (!CreateTexture(pDevice, width, height, format, mips, &pResource, &pView))
+		return;
+
+	SetMips(0, pResource, pView);
+	m_Width = width;
+	m_Height = height;
+	m_MipCount = static_cast<uint32_t>(mips.size());
+}
+
+bool Texture::CreateMips(ID3D11Device* pDevice, const CookedTexture& cooked, uint32_t firstMip, ID3D11Resource** ppResource, ID3D11ShaderResourceView** ppView)
+{
+	if (firstMip >= cooked.GetMipCount())
+		return false;
+
+	// Straight from the pack, the device copies the mips while creating the texture
+	std::vector<D3D11_SUBRESOURCE_DATA> mips(cooked.GetMipCount() - firstMip);
+	for (uint32_t i = 0; i < mips.size(); ++i)
+	{
+		const CookedTexture::Mip mip = cooked.GetMip(firstMip + i);
+		mips[i].pSysMem = mip.pData;
+		mips[i].SysMemPitch = mip.rowPitch;
+	}
+
+	const uint32_t width = (std::max)(cooked.GetWidth() >> firstMip, 1u);
+	const uint32_t height = (std::max)(cooked.GetHeight() >> firstMip, 1u);
+	return CreateTexture(pDevice, width, height, GetFormat(cooked.GetFormat()), mips, ppResource, ppView);
+}
+
+void Texture::SetMips(uint32_t firstMip, ID3D11Resource* pResource, ID3D11ShaderResourceView* pView)
+{
+	if (m_pResource)
+		m_pResource->Release();
+	if (m_pTextureResourceView)
+		m_pTextureResourceView->Release();
+
+	m_pResource = pResource;
+	m_pTextureResourceView = pView;
+	m_ResidentMip = firstMip;
+}
+
+bool Texture::DropMips(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, uint32_t mip)
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	if (mip <= m_ResidentMip || mip >= m_MipCount || !GetDesc(m_pResource, desc))
+		return false;
+
+	// Default usage, the mips are copied in on the GPU instead of being read from the file again
+	desc.Width = (std::max)(m_Width >> mip, 1u);
+	desc.Height = (std::max)(m_Height >> mip, 1u);
+	desc.MipLevels = m_MipCount - mip;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+
+	ID3D11Texture2D* pTexture{};
+	if (FAILED(pDevice->CreateTexture2D(&desc, nullptr, &pTexture)))
+		return false;
+
+	ID3D11ShaderResourceView* pView{};
+	if (FAILED(pDevice->CreateShaderResourceView(pTexture, nullptr, &pView)))
+	{
+		pTexture->Release();
+		return false;
+	}
+
+	for (UINT level = 0; level < desc.MipLevels; ++level)
+		pDeviceContext->CopySubresourceRegion(pTexture, level, 0, 0, 0, m_pResource, level + mip - m_ResidentMip, nullptr);
+
+	SetMips(mip, pTexture, pView);
+	return true;
+}
+
+void Texture::StopStreaming()
+{
+	m_pStreamFile.reset();
+	m_StreamSlot = UINT32_MAX;
+}
+
 ID3D11ShaderResourceView* Texture::GetTextureShaderResource() const
 {
 	return m_pTextureResourceView;
@@ -89,3 +387,75 @@ std::string Texture::GetPath() const
 {
 	return m_Path;
 }
+
+size_t Texture::GetCpuMemory() const
+{
+	return sizeof(Texture) + m_Path.capacity();
+}
+
+size_t Texture::GetMemory() const
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	if (!GetDesc(m_pResource, desc))
+		return 0;
+
+	size_t memory{};
+	for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+		memory += ::GetMipSize(desc.Format, (std::max)(desc.Width >> mip, 1u), (std::max)(desc.Height >> mip, 1u));
+
+	return memory * desc.ArraySize;
+}
+
+uint32_t Texture::GetWidth() const
+{
+	return m_Width;
+}
+
+uint32_t Texture::GetHeight() const
+{
+	return m_Height;
+}
+
+uint32_t Texture::GetMipCount() const
+{
+	return m_MipCount;
+}
+
+size_t Texture::GetMipSize(uint32_t mip) const
+{
+	D3D11_TEXTURE2D_DESC desc{};
+	if (mip >= m_MipCount || !GetDesc(m_pResource, desc))
+		return 0;
+
+	return ::GetMipSize(desc.Format, (std::max)(m_Width >> mip, 1u), (std::max)(m_Height >> mip, 1u));
+}
+
+bool Texture::IsStreamed() const
+{
+	return m_pStreamFile != nullptr;
+}
+
+uint32_t Texture::GetResidentMip() const
+{
+	return m_ResidentMip;
+}
+
+uint32_t Texture::GetTailMip() const
+{
+	return m_TailMip;
+}
+
+const std::shared_ptr<const AssetFile>& Texture::GetStreamFile() const
+{
+	return m_pStreamFile;
+}
+
+uint32_t Texture::GetStreamSlot() const
+{
+	return m_StreamSlot;
+}
+
+void Texture::SetStreamSlot(uint32_t slot)
+{
+	m_StreamSlot = slot;
+}
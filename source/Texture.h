@@ -2,11 +2,21 @@
 // Include Files
 #include "MyEngine.h"
 
+#include <memory>
+
+struct Image;
+class AssetFile;
+class CookedTexture;
+
 // Texture Class									
 class Texture final
 {
 public:
 	Texture(ID3D11Device* pDevice, const std::string& texturePath, ID3D11DeviceContext* pDeviceContext = nullptr);				// Constructor
+	Texture(ID3D11Device* pDevice, const std::string& texturePath, const uint8_t* pData, size_t dataSize, ID3D11DeviceContext* pDeviceContext = nullptr);	// Constructor, decodes a file that was read into memory already
+	Texture(ID3D11Device* pDevice, const std::string& name, uint32_t width, uint32_t height, const uint32_t* pPixels);	// Constructor, uploads RGBA8 pixels made in code
+	Texture(ID3D11Device* pDevice, const std::string& name, const std::vector<Image>& levels);	// Constructor, uploads a mip chain that was built on the CPU, levels[0] is the full size
+	Texture(ID3D11Device* pDevice, const std::string& texturePath, std::shared_ptr<const AssetFile> pFile, ID3D11DeviceContext* pDeviceContext = nullptr);	// Constructor, a cooked texture with a mip tail uploads only the tail and keeps the file to stream the other mips from, anything else loads whole
 	~Texture();				// Destructor
 
 	// Copy/move constructors and assignment operators
@@ -18,8 +28,46 @@ public:
 	// Member functions						
 	ID3D11ShaderResourceView* GetTextureShaderResource() const;
 	std::string GetPath() const;
+	// Size of the resident mips on the GPU
+	size_t GetMemory() const;
+	// The pixels only live on the GPU
+	size_t GetCpuMemory() const;
+	// Of the full size mip, also while it is not resident
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	uint32_t GetMipCount() const;
+	// GPU memory of one mip of the full chain
+	size_t GetMipSize(uint32_t mip) const;
+
+	// Streaming (see TextureStreamer), textures that do not stream have every mip resident
+	bool IsStreamed() const;
+	uint32_t GetResidentMip() const;
+	// The mips from here down are never dropped
+	uint32_t GetTailMip() const;
+	// The cooked file the mips are streamed from, a view into the mounted pack or the mapped loose file
+	const std::shared_ptr<const AssetFile>& GetStreamFile() const;
+	uint32_t GetStreamSlot() const;
+	void SetStreamSlot(uint32_t slot);
+	// Takes ownership of a texture of the mips from firstMip down, made by CreateMips on a worker
+	void SetMips(uint32_t firstMip, ID3D11Resource* pResource, ID3D11ShaderResourceView* pView);
+	// Copies the mips from mip down into a smaller texture on the GPU and releases the bigger mips
+	bool DropMips(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, uint32_t mip);
+	// Keeps the mips that are resident and lets go of the file, the pack it is in is unmounted
+	void StopStreaming();
+
+	// Immutable texture of the mips of a cooked texture from firstMip down. Only uses the device, which is free
+	// threaded, so the stream jobs call it on the workers.
+	static bool CreateMips(ID3D11Device* pDevice, const CookedTexture& cooked, uint32_t firstMip, ID3D11Resource** ppResource, ID3D11ShaderResourceView** ppView);
 private:
 	// Private member functions								
+	// Uploads cooked textures as they are, decodes with the portable decoders and builds the mips on the CPU
+	// otherwise. WIC only reads the formats they do not know.
+	void Load(ID3D11Device* pDevice, const uint8_t* pData, size_t dataSize, ID3D11DeviceContext* pDeviceContext);
+	// Immutable, with as many mips as there are levels
+	void Create(ID3D11Device* pDevice, const std::vector<Image>& levels);
+	// Only the mips from firstMip down are resident
+	void Create(ID3D11Device* pDevice, const CookedTexture& cooked, uint32_t firstMip = 0);
+	void Create(ID3D11Device* pDevice, uint32_t width, uint32_t height, DXGI_FORMAT format, const std::vector<D3D11_SUBRESOURCE_DATA>& mips);
 
 
 	// Datamembers
@@ -29,4 +77,12 @@ private:
 	ID3D11Texture2D* m_pTexture{ nullptr };
 	ID3D11ShaderResourceView* m_pTextureResourceView{ nullptr };
 
+	uint32_t m_Width{};
+	uint32_t m_Height{};
+	uint32_t m_MipCount{};
+	uint32_t m_ResidentMip{};
+	uint32_t m_TailMip{};
+	std::shared_ptr<const AssetFile> m_pStreamFile{};
+	uint32_t m_StreamSlot{ UINT32_MAX };
+
 };
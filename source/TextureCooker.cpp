@@ -0,0 +1,281 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	inline size_t AlignUp(size_t value)
+	{
+		return (value + TextureCooker::g_MipAlignment - 1) & ~(TextureCooker::g_MipAlignment - 1);
+	}
+
+	size_t GetPixelSize(TextureCooker::Format format)
+	{
+		switch (format)
+		{
+		case TextureCooker::Format::R8:
+			return 1;
+		case TextureCooker::Format::R16:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	uint32_t GetRowPitch(TextureCooker::Format format, uint32_t width)
+	{
+		if (TextureCooker::IsCompressed(format))
+			return static_cast<uint32_t>(BlockCompressor::GetRowPitch(TextureCooker::GetBlockFormat(format), width));
+		return static_cast<uint32_t>(width * GetPixelSize(format));
+	}
+
+	uint32_t GetRowCount(TextureCooker::Format format, uint32_t height)
+	{
+		return TextureCooker::IsCompressed(format) ? (height + 3) / 4 : height;
+	}
+
+	bool HasAlpha(const Image& image)
+	{
+		for (size_t i = 3; i < image.pixels.size(); i += 4)
+		{
+			if (image.pixels[i] != 255)
+				return true;
+		}
+		return false;
+	}
+
+	// Every texel the same in red, green and blue and opaque, nothing is lost keeping only red
+	bool IsGrey(const Image& image)
+	{
+		for (size_t i = 0; i < image.pixels.size(); i += 4)
+		{
+			const uint8_t* pTexel = image.pixels.data() + i;
+			if (pTexel[1] != pTexel[0] || pTexel[2] != pTexel[0] || pTexel[3] != 255)
+				return false;
+		}
+		return true;
+	}
+}
+
+const char* TextureCooker::GetFormatName(Format format)
+{
+	switch (format)
+	{
+	case Format::RGBA8:
+		return "RGBA8";
+	case Format::R8:
+		return "R8";
+	case Format::R16:
+		return "R16";
+	case Format::BC1:
+		return "BC1";
+	case Format::BC3:
+		return "BC3";
+	case Format::BC4:
+		return "BC4";
+	case Format::BC5:
+		return "BC5";
+	case Format::BC7:
+		return "BC7";
+	default:
+		return "Unknown";
+	}
+}
+
+bool TextureCooker::IsCompressed(Format format)
+{
+	return format == Format::BC1 || format == Format::BC3 || format == Format::BC4 || format == Format::BC5 || format == Format::BC7;
+}
+
+BlockCompressor::Format TextureCooker::GetBlockFormat(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return BlockCompressor::Format::BC1;
+	case Format::BC3:
+		return BlockCompressor::Format::BC3;
+	case Format::BC4:
+		return BlockCompressor::Format::BC4;
+	case Format::BC5:
+		return BlockCompressor::Format::BC5;
+	default:
+		return BlockCompressor::Format::BC7;
+	}
+}
+
+uint32_t TextureCooker::GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	uint32_t mip = 0;
+	while (mip + 1 < mipCount && ((std::max)(width >> mip, 1u) > g_MipTailSize || (std::max)(height >> mip, 1u) > g_MipTailSize))
+		++mip;
+	return mip;
+}
+
+TextureCooker::Settings TextureCooker::GetDefaultSettings(const std::string& filename, const Image& image, BlockCompressor::Quality quality)
+{
+	Settings settings{};
+	settings.quality = quality;
+	settings.mips = MipGenerator::GetDefaultSettings(filename, image);
+	settings.format = image.format == ImageFormat::R8 ? Format::R8 : image.format == ImageFormat::R16 ? Format::R16 : Format::RGBA8;
+
+	// The top level of a block compressed texture has to be made of whole blocks
+	if (image.format != ImageFormat::RGBA8 || image.width % 4 != 0 || image.height % 4 != 0)
+		return settings;
+
+	const bool fast = quality == BlockCompressor::Quality::Fast;
+	if (MipGenerator::IsNormalMap(filename))
+		settings.format = Format::BC5;
+	else if (MipGenerator::IsDataMap(filename) && IsGrey(image))
+		settings.format = Format::BC4;
+	else if (HasAlpha(image))
+		settings.format = fast ? Format::BC3 : Format::BC7;
+	else
+		settings.format = fast ? Format::BC1 : Format::BC7;
+	return settings;
+}
+
+bool TextureCooker::CanCook(const std::string& filename, const uint8_t* pData, size_t size)
+{
+	const ImageDecoder::FileType type = ImageDecoder::GetFileType(filename, pData, size);
+	return type == ImageDecoder::FileType::Png || type == ImageDecoder::FileType::Jpeg;
+}
+
+bool TextureCooker::IsCooked(const uint8_t* pData, size_t size)
+{
+	if (pData == nullptr || size < sizeof(FileHeader))
+		return false;
+
+	uint32_t magic{};
+	std::memcpy(&magic, pData, sizeof(magic));
+	return magic == g_Magic;
+}
+
+bool TextureCooker::Cook(const std::string& filename, const uint8_t* pData, size_t size, BlockCompressor::Quality quality, std::vector<char>& cooked,
+	Stats* pStats, std::string* pError)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<Image> levels(1);
+	if (!ImageDecoder::Decode(filename, pData, size, levels[0], pError))
+		return false;
+
+	const Settings settings = GetDefaultSettings(filename, levels[0], quality);
+	MipGenerator::GenerateMips(levels, settings.mips);
+	cooked = Cook(levels, settings);
+
+	if (pStats != nullptr)
+	{
+		const CookedTexture texture{ std::string_view{ cooked.data(), cooked.size() } };
+
+		*pStats = Stats{};
+		pStats->format = settings.format;
+		pStats->width = levels[0].width;
+		pStats->height = levels[0].height;
+		pStats->mipCount = static_cast<uint32_t>(levels.size());
+		for (const Image& level : levels)
+			pStats->uncompressedSize += level.pixels.size();
+		pStats->cookedSize = cooked.size();
+		if (IsCompressed(settings.format) && texture.IsValid())
+		{
+			const BlockCompressor::Format blockFormat = GetBlockFormat(settings.format);
+			const Image decompressed = BlockCompressor::Decompress(texture.GetMip(0).pData, levels[0].width, levels[0].height, blockFormat);
+			pStats->psnr = BlockCompressor::GetPSNR(levels[0], decompressed, blockFormat);
+		}
+		pStats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	return true;
+}
+
+std::vector<char> TextureCooker::Cook(const std::vector<Image>& levels, const Settings& settings)
+{
+	if (levels.empty())
+		return {};
+
+	const bool compressed = IsCompressed(settings.format);
+	std::vector<std::vector<uint8_t>> compressedLevels{};
+	if (compressed)
+	{
+		compressedLevels.reserve(levels.size());
+		for (const Image& level : levels)
+			compressedLevels.push_back(BlockCompressor::Compress(level, GetBlockFormat(settings.format), settings.quality));
+	}
+
+	FileHeader header{};
+	header.width = levels[0].width;
+	header.height = levels[0].height;
+	header.mipCount = static_cast<uint32_t>(levels.size());
+	header.format = settings.format;
+	header.tailMip = GetTailMip(header.width, header.height, header.mipCount);
+
+	std::vector<MipEntry> mips(levels.size());
+	size_t offset = AlignUp(sizeof(FileHeader) + sizeof(MipEntry) * mips.size());
+	for (size_t i = 0; i < mips.size(); ++i)
+	{
+		mips[i].offset = offset;
+		mips[i].rowPitch = GetRowPitch(settings.format, levels[i].width);
+		mips[i].rowCount = GetRowCount(settings.format, levels[i].height);
+		mips[i].size = size_t(mips[i].rowPitch) * mips[i].rowCount;
+		offset = AlignUp(offset + mips[i].size);
+	}
+
+	std::vector<char> data(offset);
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), mips.data(), sizeof(MipEntry) * mips.size());
+	for (size_t i = 0; i < mips.size(); ++i)
+	{
+		const uint8_t* pSource = compressed ? compressedLevels[i].data() : levels[i].pixels.data();
+		std::memcpy(data.data() + mips[i].offset, pSource, mips[i].size);
+	}
+	return data;
+}
+
+CookedTexture::CookedTexture(std::string_view data)
+	: m_Data{ data }
+{
+	Validate();
+}
+
+CookedTexture::Mip CookedTexture::GetMip(uint32_t level) const
+{
+	const TextureCooker::MipEntry& entry = m_pMips[level];
+	return Mip{ reinterpret_cast<const uint8_t*>(m_Data.data() + entry.offset), static_cast<size_t>(entry.size), entry.rowPitch };
+}
+
+void CookedTexture::Validate()
+{
+	using namespace TextureCooker;
+
+	if (m_Data.data() == nullptr || m_Data.size() < sizeof(FileHeader))
+		return;
+
+	const auto* pHeader = reinterpret_cast<const FileHeader*>(m_Data.data());
+	if (pHeader->magic != g_Magic || pHeader->formatVersion != g_FormatVersion || pHeader->format > Format::BC7)
+		return;
+	if (pHeader->width == 0 || pHeader->height == 0 || pHeader->mipCount == 0 || pHeader->mipCount > MipGenerator::GetMipCount(pHeader->width, pHeader->height)
+		|| pHeader->tailMip >= pHeader->mipCount)
+		return;
+
+	const size_t tableSize = sizeof(FileHeader) + sizeof(MipEntry) * size_t(pHeader->mipCount);
+	if (tableSize > m_Data.size())
+		return;
+
+	const auto* pMips = reinterpret_cast<const MipEntry*>(m_Data.data() + sizeof(FileHeader));
+	for (uint32_t i = 0; i < pHeader->mipCount; ++i)
+	{
+		const MipEntry& mip = pMips[i];
+		const uint32_t width = (std::max)(pHeader->width >> i, 1u);
+		const uint32_t height = (std::max)(pHeader->height >> i, 1u);
+		if (mip.rowPitch != GetRowPitch(pHeader->format, width) || mip.rowCount != GetRowCount(pHeader->format, height)
+			|| mip.size != uint64_t(mip.rowPitch) * mip.rowCount)
+			return;
+		if (mip.offset % g_MipAlignment != 0 || mip.offset < tableSize || mip.offset > m_Data.size() || m_Data.size() - mip.offset < mip.size)
+			return;
+	}
+
+	m_pHeader = pHeader;
+	m_pMips = pMips;
+	m_Valid = true;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+// Cooked texture format, the whole mip chain already in the format the GPU samples, so loading a cooked texture is
+// one upload without decoding, filtering or compressing anything.
+// Layout: FileHeader, MipEntry[mipCount] from the full size down, then the 16 byte aligned data of every mip. The
+// mips from tailMip down are the mip tail, loaded with the texture and kept at the end of the file in one piece, the
+// bigger mips are streamed in when the texture is drawn big enough to need them.
+namespace TextureCooker
+{
+	constexpr uint32_t g_Magic{ 0x31584554 }; // "TEX1"
+	constexpr uint32_t g_FormatVersion{ 2 };
+	constexpr size_t g_MipAlignment{ 16 };
+	// Mips no bigger than this on either side are in the mip tail
+	constexpr uint32_t g_MipTailSize{ 128 };
+
+	enum class Format : uint32_t
+	{
+		// Uncompressed, for what the block formats can not hold
+		RGBA8,
+		R8,
+		R16,
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic{ g_Magic };
+		uint32_t formatVersion{ g_FormatVersion };
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t mipCount{};
+		Format format{ Format::RGBA8 };
+		uint32_t tailMip{};			// First mip of the mip tail, 0 when the whole texture is one
+		uint32_t reserved{};		// Keeps the mip table 8 byte aligned
+	};
+
+	struct MipEntry
+	{
+		uint64_t offset{};
+		uint64_t size{};
+		uint32_t rowPitch{};		// Of a row of blocks for the compressed formats
+		uint32_t rowCount{};
+	};
+
+	struct Settings
+	{
+		Format format{ Format::RGBA8 };
+		BlockCompressor::Quality quality{ BlockCompressor::Quality::Normal };
+		MipGenerator::Settings mips{};
+	};
+
+	// What cooking a texture did, for the log
+	struct Stats
+	{
+		Format format{ Format::RGBA8 };
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t mipCount{};
+		size_t uncompressedSize{};		// The mip chain as the decoder makes it
+		size_t cookedSize{};
+		double psnr{};					// Of the full size level, 0 for the uncompressed formats
+		double milliseconds{};
+	};
+
+	const char* GetFormatName(Format format);
+	bool IsCompressed(Format format);
+	BlockCompressor::Format GetBlockFormat(Format format);
+	// The largest mip that fits g_MipTailSize, the last mip when none does
+	uint32_t GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount);
+
+	// Normal maps go to BC5, grey data maps (by name, see MipGenerator::IsDataMap) to BC4 and are read from red.
+	// Color goes to BC7, or to BC1 (opaque) and BC3 (with alpha) at the fast quality. Images that are not RGBA8 or
+	// whose size is not a multiple of 4 stay uncompressed.
+	Settings GetDefaultSettings(const std::string& filename, const Image& image, BlockCompressor::Quality quality);
+
+	// PNG and JPEG files, raw files are read as they are by the terrain and not cooked
+	bool CanCook(const std::string& filename, const uint8_t* pData, size_t size);
+	bool IsCooked(const uint8_t* pData, size_t size);
+
+	// Decodes, builds the mips and compresses every level with the default settings. false when the file can not
+	// be decoded, pError then says why.
+	bool Cook(const std::string& filename, const uint8_t* pData, size_t size, BlockCompressor::Quality quality, std::vector<char>& cooked,
+		Stats* pStats = nullptr, std::string* pError = nullptr);
+	// The levels are already filtered, every one is compressed to the format of the settings
+	std::vector<char> Cook(const std::vector<Image>& levels, const Settings& settings);
+}
+
+// Cooked texture held by someone else (a mounted asset pack or a cooked buffer), it has to outlive the view
+class CookedTexture final
+{
+public:
+	struct Mip
+	{
+		const uint8_t* pData{};
+		size_t size{};
+		uint32_t rowPitch{};
+	};
+
+	explicit CookedTexture(std::string_view data);
+	~CookedTexture() = default;
+
+	CookedTexture(const CookedTexture& other) = delete;
+	CookedTexture(CookedTexture&& other) noexcept = delete;
+	CookedTexture& operator=(const CookedTexture& other) = delete;
+	CookedTexture& operator=(CookedTexture&& other) noexcept = delete;
+
+	bool IsValid() const { return m_Valid; }
+
+	uint32_t GetWidth() const { return m_pHeader->width; }
+	uint32_t GetHeight() const { return m_pHeader->height; }
+	uint32_t GetMipCount() const { return m_pHeader->mipCount; }
+	uint32_t GetTailMip() const { return m_pHeader->tailMip; }
+	TextureCooker::Format GetFormat() const { return m_pHeader->format; }
+	Mip GetMip(uint32_t level) const;
+
+private:
+	// Checks every mip against the size of its level and the data size before anything is handed out
+	void Validate();
+
+	std::string_view m_Data{};
+	const TextureCooker::FileHeader* m_pHeader{};
+	const TextureCooker::MipEntry* m_pMips{};
+	bool m_Valid{ false };
+};
@@ -0,0 +1,307 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Not rounded, 0 when one texel covers one pixel and below when the texture is magnified
+	float GetLevel(uint32_t width, uint32_t height, float pixels)
+	{
+		return std::log2(static_cast<float>((std::max)(width, height)) / pixels);
+	}
+}
+
+uint32_t TextureStreamer::Register(const TextureInfo& info)
+{
+	if (info.mipCount == 0 || info.mipCount > g_MaxMipCount || info.tailMip >= info.mipCount)
+		return g_InvalidSlot;
+
+	uint32_t index{};
+	if (!m_FreeSlots.empty())
+	{
+		index = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_Slots.size());
+		m_Slots.emplace_back();
+	}
+
+	Slot& slot = m_Slots[index];
+	slot = Slot{};
+	slot.info = info;
+	for (uint32_t mip = info.mipCount; mip-- > 0;)
+		slot.residentSizes[mip] = slot.residentSizes[mip + 1] + info.mipSizes[mip];
+	slot.residentMip = info.tailMip;
+	slot.wantedMip = info.tailMip;
+	slot.loadingMip = info.tailMip;
+	slot.registered = true;
+
+	m_Memory += GetMemory(slot);
+	++m_TextureCount;
+	return index;
+}
+
+void TextureStreamer::Unregister(uint32_t slot)
+{
+	if (!IsRegistered(slot))
+		return;
+
+	Slot& texture = m_Slots[slot];
+	m_Memory -= GetMemory(texture);
+	if (texture.loadingMip != texture.residentMip)
+		--m_LoadingCount;
+	texture.registered = false;
+
+	m_FreeSlots.push_back(slot);
+	--m_TextureCount;
+}
+
+void TextureStreamer::Request(uint32_t slot, float pixels)
+{
+	if (!IsRegistered(slot) || !(pixels > 0.f))
+		return;
+
+	Slot& texture = m_Slots[slot];
+	const float level = GetLevel(texture.info.width, texture.info.height, pixels);
+	if (!texture.requested || level < texture.requestedLevel)
+		texture.requestedLevel = level;
+	texture.requested = true;
+}
+
+void TextureStreamer::Update(std::vector<Change>& evictions)
+{
+	for (Slot& slot : m_Slots)
+	{
+		if (!slot.registered)
+			continue;
+
+		if (slot.requested)
+		{
+			const uint32_t mip = slot.requestedLevel <= 0.f ? 0 : (std::min)(static_cast<uint32_t>(slot.requestedLevel), slot.info.tailMip);
+			slot.lastUsedFrames[mip] = m_Frame;
+			slot.lastLevel = slot.requestedLevel;
+			slot.lastRequestFrame = m_Frame;
+			slot.requested = false;
+		}
+
+		// The finest mip that was asked for within the last frames, a mip drawn once in a while is kept
+		slot.wantedMip = slot.info.tailMip;
+		for (uint32_t mip = 0; mip < slot.info.tailMip; ++mip)
+		{
+			if (slot.lastUsedFrames[mip] != 0 && m_Frame - slot.lastUsedFrames[mip] <= m_KeepFrames)
+			{
+				slot.wantedMip = mip;
+				break;
+			}
+		}
+	}
+
+	// The budget was lowered, unused mips go first and then everything above the tail of the textures that were
+	// asked for the longest time ago
+	if (m_Memory > m_Budget && !EvictUnused(0, evictions))
+	{
+		std::vector<uint32_t> candidates{};
+		for (uint32_t i = 0; i < m_Slots.size(); ++i)
+		{
+			const Slot& slot = m_Slots[i];
+			if (slot.registered && slot.loadingMip == slot.residentMip && slot.residentMip < slot.info.tailMip)
+				candidates.push_back(i);
+		}
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) { return m_Slots[a].lastRequestFrame < m_Slots[b].lastRequestFrame; });
+
+		for (uint32_t index : candidates)
+		{
+			if (m_Memory <= m_Budget)
+				break;
+			Evict(m_Slots[index], m_Slots[index].info.tailMip, index, evictions);
+		}
+	}
+
+	// Missing the most levels relative to how big they were drawn last goes first
+	m_Queue.clear();
+	for (uint32_t i = 0; i < m_Slots.size(); ++i)
+	{
+		const Slot& slot = m_Slots[i];
+		if (slot.registered && !slot.failed && slot.loadingMip == slot.residentMip && slot.residentMip > slot.wantedMip)
+			m_Queue.push_back(QueueEntry{ static_cast<float>(slot.residentMip) - slot.lastLevel, i });
+	}
+	std::make_heap(m_Queue.begin(), m_Queue.end());
+
+	++m_Frame;
+}
+
+bool TextureStreamer::PopLoad(Change& load, std::vector<Change>& evictions)
+{
+	while (!m_Queue.empty())
+	{
+		std::pop_heap(m_Queue.begin(), m_Queue.end());
+		const uint32_t index = m_Queue.back().slot;
+		m_Queue.pop_back();
+
+		Slot& slot = m_Slots[index];
+		if (!slot.registered || slot.failed || slot.loadingMip != slot.residentMip || slot.residentMip <= slot.wantedMip)
+			continue;
+
+		const size_t resident = slot.residentSizes[slot.residentMip];
+		if (m_Memory + slot.residentSizes[slot.wantedMip] - resident > m_Budget)
+			EvictUnused(slot.residentSizes[slot.wantedMip] - resident, evictions);
+
+		// As many of the wanted mips as fit, the others follow once something else is evicted
+		uint32_t mip = slot.wantedMip;
+		while (mip < slot.residentMip && m_Memory + slot.residentSizes[mip] - resident > m_Budget)
+			++mip;
+		if (mip == slot.residentMip)
+			continue;
+
+		m_Memory += slot.residentSizes[mip] - resident;
+		slot.loadingMip = mip;
+		++m_LoadingCount;
+
+		load = Change{ index, mip };
+		return true;
+	}
+	return false;
+}
+
+void TextureStreamer::SetResidentMip(uint32_t slot, uint32_t mip)
+{
+	if (!IsRegistered(slot))
+		return;
+
+	Slot& texture = m_Slots[slot];
+	m_Memory -= GetMemory(texture);
+	if (texture.loadingMip != texture.residentMip)
+	{
+		--m_LoadingCount;
+		if (mip < texture.residentMip)
+			++m_LoadCount;
+	}
+	texture.residentMip = (std::min)(mip, texture.info.tailMip);
+	texture.loadingMip = texture.residentMip;
+	m_Memory += GetMemory(texture);
+}
+
+void TextureStreamer::OnLoadFailed(uint32_t slot)
+{
+	if (!IsRegistered(slot))
+		return;
+
+	Slot& texture = m_Slots[slot];
+	if (texture.loadingMip != texture.residentMip)
+	{
+		m_Memory -= GetMemory(texture);
+		texture.loadingMip = texture.residentMip;
+		m_Memory += GetMemory(texture);
+		--m_LoadingCount;
+	}
+	texture.failed = true;
+}
+
+void TextureStreamer::SetBudget(size_t bytes)
+{
+	m_Budget = bytes;
+}
+
+size_t TextureStreamer::GetBudget() const
+{
+	return m_Budget;
+}
+
+size_t TextureStreamer::GetMemory() const
+{
+	return m_Memory;
+}
+
+void TextureStreamer::SetKeepFrames(uint32_t frames)
+{
+	m_KeepFrames = frames;
+}
+
+bool TextureStreamer::IsRegistered(uint32_t slot) const
+{
+	return slot < m_Slots.size() && m_Slots[slot].registered;
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t slot) const
+{
+	return IsRegistered(slot) ? m_Slots[slot].residentMip : 0;
+}
+
+uint32_t TextureStreamer::GetWantedMip(uint32_t slot) const
+{
+	return IsRegistered(slot) ? m_Slots[slot].wantedMip : 0;
+}
+
+bool TextureStreamer::IsLoading(uint32_t slot) const
+{
+	return IsRegistered(slot) && m_Slots[slot].loadingMip != m_Slots[slot].residentMip;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+	Stats stats{};
+	stats.textureCount = m_TextureCount;
+	stats.memory = m_Memory;
+	stats.budget = m_Budget;
+	stats.queued = m_Queue.size();
+	stats.loading = m_LoadingCount;
+	stats.loadCount = m_LoadCount;
+	stats.evictionCount = m_EvictionCount;
+	return stats;
+}
+
+uint32_t TextureStreamer::GetMip(uint32_t width, uint32_t height, float pixels)
+{
+	if (!(pixels > 0.f))
+		return g_MaxMipCount;
+
+	const float level = GetLevel(width, height, pixels);
+	return level <= 0.f ? 0 : static_cast<uint32_t>(level);
+}
+
+size_t TextureStreamer::GetMemory(const Slot& slot) const
+{
+	// A running load has its memory reserved already
+	return slot.residentSizes[(std::min)(slot.residentMip, slot.loadingMip)];
+}
+
+bool TextureStreamer::EvictUnused(size_t needed, std::vector<Change>& evictions)
+{
+	// Most recent use of the mips that are resident but not wanted, the oldest are evicted first
+	std::vector<std::pair<uint64_t, uint32_t>> candidates{};
+	for (uint32_t i = 0; i < m_Slots.size(); ++i)
+	{
+		const Slot& slot = m_Slots[i];
+		if (!slot.registered || slot.loadingMip != slot.residentMip || slot.residentMip >= slot.wantedMip)
+			continue;
+
+		uint64_t lastUsed{};
+		for (uint32_t mip = slot.residentMip; mip < slot.wantedMip; ++mip)
+			lastUsed = (std::max)(lastUsed, slot.lastUsedFrames[mip]);
+		candidates.emplace_back(lastUsed, i);
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (const auto& candidate : candidates)
+	{
+		if (m_Memory + needed <= m_Budget)
+			break;
+		Slot& slot = m_Slots[candidate.second];
+		Evict(slot, slot.wantedMip, candidate.second, evictions);
+	}
+	return m_Memory + needed <= m_Budget;
+}
+
+void TextureStreamer::Evict(Slot& slot, uint32_t mip, uint32_t index, std::vector<Change>& evictions)
+{
+	m_Memory -= GetMemory(slot);
+	slot.residentMip = mip;
+	slot.loadingMip = mip;
+	m_Memory += GetMemory(slot);
+
+	++m_EvictionCount;
+	evictions.push_back(Change{ index, mip });
+}
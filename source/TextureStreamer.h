@@ -0,0 +1,132 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decides which mips of the streamed textures are resident. Draws report how big a texture is on screen, once per
+// frame Update turns that into the mip every texture wants, queues the textures that are missing mips, most blurry
+// first, and keeps the resident mips inside the budget by evicting the mips nothing asked for lately.
+// Only bookkeeping, the caller creates and drops the mips on the GPU and reports back, so it runs without a device.
+class TextureStreamer final
+{
+public:
+	static constexpr uint32_t g_InvalidSlot{ UINT32_MAX };
+	static constexpr uint32_t g_MaxMipCount{ 16 };
+
+	struct TextureInfo
+	{
+		uint32_t width{};
+		uint32_t height{};
+		uint32_t mipCount{};
+		uint32_t tailMip{};			// This mip and the smaller ones are always resident
+		std::array<size_t, g_MaxMipCount> mipSizes{};
+	};
+
+	// A texture and the first mip it keeps after a load or an eviction
+	struct Change
+	{
+		uint32_t slot{ g_InvalidSlot };
+		uint32_t mip{};
+	};
+
+	struct Stats
+	{
+		size_t textureCount{};
+		size_t memory{};			// Resident mips and the loads that are running
+		size_t budget{};
+		size_t queued{};			// Textures that are missing mips they want
+		uint32_t loading{};
+		size_t loadCount{};
+		size_t evictionCount{};
+	};
+
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	TextureStreamer(const TextureStreamer& other) = delete;
+	TextureStreamer(TextureStreamer&& other) noexcept = delete;
+	TextureStreamer& operator=(const TextureStreamer& other) = delete;
+	TextureStreamer& operator=(TextureStreamer&& other) noexcept = delete;
+
+	// The texture starts with only its mip tail resident. Slots of unregistered textures are used again.
+	uint32_t Register(const TextureInfo& info);
+	// A load that is running for it is forgotten, its mips have to be thrown away
+	void Unregister(uint32_t slot);
+
+	// Called by the draws, pixels is how many pixels the longest edge of the texture covers on screen. The biggest
+	// request of a frame counts.
+	void Request(uint32_t slot, float pixels);
+	// Once per frame, after the draws of the last frame requested their sizes. Textures that are over budget
+	// (after it was lowered) are added to evictions.
+	void Update(std::vector<Change>& evictions);
+	// The texture that needs its mips the most and the mip to load it up to, its memory is reserved until the load
+	// finished or failed. Evicts unused mips into evictions to make room, false when nothing is queued or fits.
+	bool PopLoad(Change& load, std::vector<Change>& evictions);
+	// A load finished, or the caller could not apply a change and reports what is resident instead
+	void SetResidentMip(uint32_t slot, uint32_t mip);
+	// The texture stays at what it has and is not streamed any more
+	void OnLoadFailed(uint32_t slot);
+
+	void SetBudget(size_t bytes);
+	size_t GetBudget() const;
+	size_t GetMemory() const;
+	// Frames a mip is kept after it was last asked for before it counts as unused
+	void SetKeepFrames(uint32_t frames);
+
+	bool IsRegistered(uint32_t slot) const;
+	uint32_t GetResidentMip(uint32_t slot) const;
+	uint32_t GetWantedMip(uint32_t slot) const;
+	bool IsLoading(uint32_t slot) const;
+	Stats GetStats() const;
+
+	// Mip a texture of that size needs to have at least one texel per pixel, can be above the mip count
+	static uint32_t GetMip(uint32_t width, uint32_t height, float pixels);
+
+private:
+	struct Slot
+	{
+		TextureInfo info{};
+		std::array<size_t, g_MaxMipCount + 1> residentSizes{};	// Memory when the mips from the index down are resident
+		std::array<uint64_t, g_MaxMipCount> lastUsedFrames{};	// 0 when a mip was never asked for
+		float requestedLevel{};			// Finest level asked for this frame, not rounded, for the priority
+		float lastLevel{};				// Of the last frame the texture was asked for
+		uint64_t lastRequestFrame{};
+		uint32_t residentMip{};
+		uint32_t wantedMip{};
+		uint32_t loadingMip{};			// Equal to residentMip when no load is running
+		bool requested{};
+		bool registered{};
+		bool failed{};
+	};
+
+	struct QueueEntry
+	{
+		float priority{};
+		uint32_t slot{};
+
+		bool operator<(const QueueEntry& other) const
+		{
+			return priority < other.priority || (priority == other.priority && slot > other.slot);
+		}
+	};
+
+	size_t GetMemory(const Slot& slot) const;
+	// Drops the mips of the least recently used textures that are finer than they want until needed more bytes fit,
+	// false when not enough of them are unused
+	bool EvictUnused(size_t needed, std::vector<Change>& evictions);
+	void Evict(Slot& slot, uint32_t mip, uint32_t index, std::vector<Change>& evictions);
+
+	std::vector<Slot> m_Slots{};
+	std::vector<uint32_t> m_FreeSlots{};
+	// A heap, rebuilt every frame
+	std::vector<QueueEntry> m_Queue{};
+	size_t m_Memory{};
+	size_t m_Budget{ 256ull * 1024 * 1024 };
+	uint64_t m_Frame{ 1 };
+	uint32_t m_KeepFrames{ 120 };
+	uint32_t m_LoadingCount{};
+	size_t m_TextureCount{};
+	size_t m_LoadCount{};
+	size_t m_EvictionCount{};
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <cfloat>
 #include <limits>
 #include <type_traits>
@@ -64,4 +65,25 @@ inline DirectX::XMFLOAT3 QuaternionToEuler(DirectX::XMFLOAT4 q)
 	euler.z = atan2f(2.f * q.x * q.y + 2.f * q.z * q.w, 1.f - 2.f * (q.y * q.y + q.z * q.z));      // Roll 
 
 	return euler;
-}
\ No newline at end of file
+}
+
+// 64 bit FNV-1a style hash over 8 byte words, fast enough to key caches on file contents
+inline uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = 0)
+{
+	constexpr uint64_t prime{ 0x100000001B3ull };
+	const auto* pBytes = static_cast<const uint8_t*>(pData);
+
+	uint64_t hash = 0xCBF29CE484222325ull ^ seed;
+	size_t i{};
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, pBytes + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; ++i)
+		hash = (hash ^ pBytes[i]) * prime;
+
+	return hash ^ (hash >> 32) ^ size;
+}
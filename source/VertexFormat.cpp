@@ -0,0 +1,207 @@
+#include "VertexFormat.h"
+#include "Mesh.h"
+
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr float g_PositionRange{ 65535.f };
+	constexpr float g_DirectionRange{ 32767.f };
+
+	inline float FromSnorm(int16_t value)
+	{
+		return (std::max)(value / g_DirectionRange, -1.f);
+	}
+
+	inline float Dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline float Length(const DirectX::XMFLOAT3& direction)
+	{
+		return std::sqrt(Dot(direction, direction));
+	}
+
+	// Angle between the original and the decoded direction, zero length directions carry no information
+	float GetAngleError(const DirectX::XMFLOAT3& original, const int16_t encoded[2])
+	{
+		const float length = Length(original);
+		if (length <= 0.f)
+			return 0.f;
+
+		// atan2 of sine and cosine stays accurate for the tiny angles acos can not resolve in floats
+		const DirectX::XMFLOAT3 decoded = VertexQuantization::DecodeOctahedral(encoded);
+		const DirectX::XMFLOAT3 cross{ original.y * decoded.z - original.z * decoded.y, original.z * decoded.x - original.x * decoded.z, original.x * decoded.y - original.y * decoded.x };
+		return std::atan2(Length(cross), Dot(original, decoded)) * 180.f / DirectX::XM_PI;
+	}
+}
+
+size_t VertexQuantization::GetStride(VertexFormat format)
+{
+	return format == VertexFormat::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+void VertexQuantization::EncodeOctahedral(const DirectX::XMFLOAT3& direction, int16_t encoded[2])
+{
+	const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+	if (length <= 0.f)
+	{
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	float x = direction.x / length;
+	float y = direction.y / length;
+	if (direction.z < 0.f)
+	{
+		// Fold the lower hemisphere over the diagonals
+		const float foldedX = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+		const float foldedY = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// Rounding both components to the nearest value is not always the closest direction, try the neighbours as well
+	const float scaledX = std::clamp(x, -1.f, 1.f) * g_DirectionRange;
+	const float scaledY = std::clamp(y, -1.f, 1.f) * g_DirectionRange;
+	const float inverseLength = 1.f / Length(direction);
+	const DirectX::XMFLOAT3 unit{ direction.x * inverseLength, direction.y * inverseLength, direction.z * inverseLength };
+
+	float bestDot = -2.f;
+	for (int i = 0; i < 4; ++i)
+	{
+		const int16_t candidate[2]
+		{
+			static_cast<int16_t>(std::clamp((i & 1) ? std::ceil(scaledX) : std::floor(scaledX), -g_DirectionRange, g_DirectionRange)),
+			static_cast<int16_t>(std::clamp((i & 2) ? std::ceil(scaledY) : std::floor(scaledY), -g_DirectionRange, g_DirectionRange))
+		};
+
+		const float dot = Dot(unit, DecodeOctahedral(candidate));
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+DirectX::XMFLOAT3 VertexQuantization::DecodeOctahedral(const int16_t encoded[2])
+{
+	DirectX::XMFLOAT3 direction{ FromSnorm(encoded[0]), FromSnorm(encoded[1]), 0.f };
+	direction.z = 1.f - std::abs(direction.x) - std::abs(direction.y);
+
+	// Same unfold as the shader, see DecodeOctahedral in the material effects
+	const float fold = (std::max)(-direction.z, 0.f);
+	direction.x += direction.x >= 0.f ? -fold : fold;
+	direction.y += direction.y >= 0.f ? -fold : fold;
+
+	const float length = Length(direction);
+	return DirectX::XMFLOAT3{ direction.x / length, direction.y / length, direction.z / length };
+}
+
+VertexQuantization::Dequantization VertexQuantization::GetDequantization(const Vertex* pVertices, size_t vertexCount)
+{
+	Dequantization dequantization{};
+	if (vertexCount == 0)
+		return dequantization;
+
+	DirectX::XMFLOAT3 minimum = pVertices[0].position;
+	DirectX::XMFLOAT3 maximum = pVertices[0].position;
+	for (size_t i = 1; i < vertexCount; ++i)
+	{
+		const DirectX::XMFLOAT3& position = pVertices[i].position;
+		minimum = DirectX::XMFLOAT3{ (std::min)(minimum.x, position.x), (std::min)(minimum.y, position.y), (std::min)(minimum.z, position.z) };
+		maximum = DirectX::XMFLOAT3{ (std::max)(maximum.x, position.x), (std::max)(maximum.y, position.y), (std::max)(maximum.z, position.z) };
+	}
+
+	// A flat axis still needs a scale to divide by, every position lands on 0 anyway
+	auto extent = [](float low, float high) { return high > low ? high - low : 1.f; };
+	dequantization.offset = minimum;
+	dequantization.scale = DirectX::XMFLOAT3{ extent(minimum.x, maximum.x), extent(minimum.y, maximum.y), extent(minimum.z, maximum.z) };
+	return dequantization;
+}
+
+void VertexQuantization::Quantize(QuantizedVertex* pDestination, const Vertex* pVertices, size_t vertexCount, const Dequantization& dequantization)
+{
+	const DirectX::XMFLOAT3& offset = dequantization.offset;
+	const DirectX::XMFLOAT3 inverseScale{ g_PositionRange / dequantization.scale.x, g_PositionRange / dequantization.scale.y, g_PositionRange / dequantization.scale.z };
+	auto toUnorm = [](float value) { return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, g_PositionRange))); };
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const Vertex& vertex = pVertices[i];
+		QuantizedVertex& quantized = pDestination[i];
+
+		quantized.position[0] = toUnorm((vertex.position.x - offset.x) * inverseScale.x);
+		quantized.position[1] = toUnorm((vertex.position.y - offset.y) * inverseScale.y);
+		quantized.position[2] = toUnorm((vertex.position.z - offset.z) * inverseScale.z);
+		quantized.position[3] = vertex.tangent.w < 0.f ? 0 : static_cast<uint16_t>(g_PositionRange);
+
+		EncodeOctahedral(vertex.normal, quantized.normal);
+		EncodeOctahedral(DirectX::XMFLOAT3{ vertex.tangent.x, vertex.tangent.y, vertex.tangent.z }, quantized.tangent);
+
+		quantized.uv[0] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.uv.x);
+		quantized.uv[1] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.uv.y);
+	}
+}
+
+void VertexQuantization::Dequantize(Vertex* pDestination, const QuantizedVertex* pVertices, size_t vertexCount, const Dequantization& dequantization)
+{
+	const DirectX::XMFLOAT3& offset = dequantization.offset;
+	const DirectX::XMFLOAT3 scale{ dequantization.scale.x / g_PositionRange, dequantization.scale.y / g_PositionRange, dequantization.scale.z / g_PositionRange };
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const QuantizedVertex& quantized = pVertices[i];
+		Vertex& vertex = pDestination[i];
+
+		vertex.position = DirectX::XMFLOAT3{ offset.x + quantized.position[0] * scale.x, offset.y + quantized.position[1] * scale.y, offset.z + quantized.position[2] * scale.z };
+		vertex.normal = DecodeOctahedral(quantized.normal);
+		const DirectX::XMFLOAT3 tangent = DecodeOctahedral(quantized.tangent);
+		vertex.tangent = DirectX::XMFLOAT4{ tangent.x, tangent.y, tangent.z, quantized.position[3] == 0 ? -1.f : 1.f };
+		vertex.uv = DirectX::XMFLOAT2{ DirectX::PackedVector::XMConvertHalfToFloat(quantized.uv[0]), DirectX::PackedVector::XMConvertHalfToFloat(quantized.uv[1]) };
+	}
+}
+
+VertexQuantization::Error VertexQuantization::MeasureError(const Vertex* pVertices, size_t vertexCount)
+{
+	Error error{};
+	const Dequantization dequantization = GetDequantization(pVertices, vertexCount);
+
+	QuantizedVertex quantized{};
+	Vertex decoded{};
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const Vertex& vertex = pVertices[i];
+		Quantize(&quantized, &vertex, 1, dequantization);
+		Dequantize(&decoded, &quantized, 1, dequantization);
+
+		const float positionError = (std::max)({ std::abs(decoded.position.x - vertex.position.x), std::abs(decoded.position.y - vertex.position.y), std::abs(decoded.position.z - vertex.position.z) });
+		const float normalError = (std::max)(GetAngleError(vertex.normal, quantized.normal), GetAngleError(DirectX::XMFLOAT3{ vertex.tangent.x, vertex.tangent.y, vertex.tangent.z }, quantized.tangent));
+		const float uvError = (std::max)(std::abs(decoded.uv.x - vertex.uv.x), std::abs(decoded.uv.y - vertex.uv.y));
+
+		error.position = (std::max)(error.position, positionError);
+		error.normalDegrees = (std::max)(error.normalDegrees, normalError);
+		// NaN uvs can not be represented either, treat them as out of tolerance
+		error.uv = std::isnan(uvError) ? INFINITY : (std::max)(error.uv, uvError);
+	}
+
+	return error;
+}
+
+VertexFormat VertexQuantization::ChooseFormat(const Vertex* pVertices, size_t vertexCount, const Tolerance& tolerance, Error* pError)
+{
+	const Error error = MeasureError(pVertices, vertexCount);
+	if (pError != nullptr)
+		*pError = error;
+
+	if (vertexCount == 0 || error.position > tolerance.position || error.normalDegrees > tolerance.normalDegrees || error.uv > tolerance.uv)
+		return VertexFormat::Float;
+
+	return VertexFormat::Quantized;
+}
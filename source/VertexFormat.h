@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <DirectXMath.h>
+
+struct Vertex;
+
+// Layout of the vertex buffer on the GPU, the CPU side always works with Vertex
+enum class VertexFormat : uint32_t
+{
+	Float,		// Vertex as is, 48 bytes
+	Quantized	// QuantizedVertex, 20 bytes
+};
+
+// Position relative to the mesh bounds in 16 bit unorm with the tangent handedness in w (0 or 1),
+// octahedral normal and tangent in 16 bit snorm and half float uvs. Matches the QuantizedTechnique input of the material effects.
+struct QuantizedVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t uv[2];
+};
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex has to match the input layout");
+
+namespace VertexQuantization
+{
+	// Largest error allowed before a mesh keeps the float format. Position and uv are absolute, in object and uv units.
+	struct Tolerance
+	{
+		float position{ 0.001f };
+		float normalDegrees{ 0.5f };
+		float uv{ 1.f / 2048.f };
+	};
+
+	struct Error
+	{
+		float position{};
+		float normalDegrees{};
+		float uv{};
+	};
+
+	// Object space position = offset + quantized position * scale
+	struct Dequantization
+	{
+		DirectX::XMFLOAT3 offset{};
+		DirectX::XMFLOAT3 scale{ 1.f, 1.f, 1.f };
+	};
+
+	size_t GetStride(VertexFormat format);
+
+	// Octahedral mapping of a unit vector onto two components in [-1, 1] (Cigolle et al. 2014)
+	void EncodeOctahedral(const DirectX::XMFLOAT3& direction, int16_t encoded[2]);
+	DirectX::XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+
+	Dequantization GetDequantization(const Vertex* pVertices, size_t vertexCount);
+	void Quantize(QuantizedVertex* pDestination, const Vertex* pVertices, size_t vertexCount, const Dequantization& dequantization);
+	void Dequantize(Vertex* pDestination, const QuantizedVertex* pVertices, size_t vertexCount, const Dequantization& dequantization);
+
+	// Quantizes every vertex and returns the largest difference with the original
+	Error MeasureError(const Vertex* pVertices, size_t vertexCount);
+
+	// Quantized when the error of every attribute stays within the tolerance
+	VertexFormat ChooseFormat(const Vertex* pVertices, size_t vertexCount, const Tolerance& tolerance = {}, Error* pError = nullptr);
+
+	// 16 bit indices whenever every vertex can be addressed with them
+	inline bool CanUse16BitIndices(size_t vertexCount) { return vertexCount <= UINT16_MAX; }
+}